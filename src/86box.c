@@ -106,6 +106,7 @@
 #include <86box/version.h>
 #include <86box/gdbstub.h>
 #include <86box/machine_status.h>
+#include <86box/snapshot.h>
 #include <86box/apm.h>
 #include <86box/acpi.h>
 #include <86box/nv/vid_nv_rivatimer.h>
@@ -157,6 +158,9 @@ int      clear_cmos                             = 0;
 uint8_t  instru_enabled                         = 0;
 uint64_t instru_run_ms                          = 0;
 #endif
+#ifdef USE_HEADLESS
+uint32_t bench_run_secs                         = 10;
+#endif
 int      clear_flash                            = 0;
 int      auto_paused                            = 0;
 
@@ -196,10 +200,12 @@ int      voodoo_enabled                         = 0;              /* (C) video o
 int      ibm8514_standalone_enabled             = 0;              /* (C) video option */
 int      xga_standalone_enabled                 = 0;              /* (C) video option */
 int      da2_standalone_enabled                 = 0;              /* (C) video option */
+int      video_deferred_render                  = 0;              /* (C) video option */
 uint32_t mem_size                               = 0;              /* (C) memory size (Installed on
                                                                          system board)*/
 uint32_t isa_mem_size                           = 0;              /* (C) memory size (ISA Memory Cards) */
 int      cpu_use_dynarec                        = 0;              /* (C) cpu uses/needs Dyna */
+int      cpu_dynarec_cache                      = 0;              /* (C) keep dynarec block profile on disk */
 int      cpu                                    = 0;              /* (C) cpu type */
 int      fpu_type                               = 0;              /* (C) fpu type */
 int      fpu_softfloat                          = 0;              /* (C) fpu uses softfloat */
@@ -671,6 +677,10 @@ pc_show_usage(char *s)
             "Valid options are:\n\n"
             "-? or --help\t\t\t- show this information\n"
             "-A or --assetpath path\t\t- set 'path' to be asset path\n"
+#ifdef USE_HEADLESS
+            "-B or --bench secs\t\t- run for 'secs' emulated seconds (0 = until\n"
+            "\t\t\t\t   the unit tester exits) and report statistics\n"
+#endif
 #ifdef SHOW_EXTRA_PARAMS
             "-C or --config path\t\t- set 'path' to be config file\n"
 #endif
@@ -689,6 +699,7 @@ pc_show_usage(char *s)
 #endif
 #endif
             "-I or --image d:path\t\t- load 'path' as floppy image on drive d\n"
+            "-K or --savestate path\t\t- save the machine state to 'path' on exit\n"
 #ifdef USE_INSTRUMENT
             "-J or --instrument name\t- set 'name' to be the profiling instrument\n"
 #endif
@@ -696,6 +707,7 @@ pc_show_usage(char *s)
             "-M or --missing\t\t- dump missing machines and video cards\n"
             "-N or --noconfirm\t\t- do not ask for confirmation on quit\n"
             "-P or --vmpath path\t\t- set 'path' to be root for vm\n"
+            "-Q or --loadstate path\t\t- resume from the machine state in 'path'\n"
             "-O or --global path\t\t- set 'path' to be global config file\n"
             "-R or --rompath path\t\t- set 'path' to be ROM path\n"
 #ifndef USE_SDL_UI
@@ -905,6 +917,16 @@ usage:
             pclog("Drive %c: %s\n", drive + 0x41, fn[(int) drive]);
             free(temp2);
             temp2 = NULL;
+        } else if (!strcasecmp(argv[c], "--savestate") || !strcasecmp(argv[c], "-K")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            strncpy(snapshot_exit_path, argv[++c], sizeof(snapshot_exit_path) - 1);
+        } else if (!strcasecmp(argv[c], "--loadstate") || !strcasecmp(argv[c], "-Q")) {
+            if ((c + 1) == argc)
+                goto usage;
+
+            strncpy(snapshot_load_path, argv[++c], sizeof(snapshot_load_path) - 1);
         } else if (!strcasecmp(argv[c], "--vmname") || !strcasecmp(argv[c], "-V")) {
             if ((c + 1) == argc)
                 goto usage;
@@ -970,6 +992,12 @@ usage:
                 goto usage;
             instru_enabled = 1;
             sscanf(argv[++c], "%llu", &instru_run_ms);
+#endif
+#ifdef USE_HEADLESS
+        } else if (!strcasecmp(argv[c], "--bench") || !strcasecmp(argv[c], "-B")) {
+            if ((c + 1) == argc)
+                goto usage;
+            bench_run_secs = strtoul(argv[++c], NULL, 10);
 #endif
         }
 
@@ -1459,6 +1487,9 @@ pc_init_modules(void)
     }
 #    endif
     codegen_init();
+#    ifdef USE_NEW_DYNAREC
+    codegen_cache_load();
+#    endif
 #    if defined(__APPLE__) && defined(__aarch64__)
     if (__builtin_available(macOS 11.0, *)) {
         pthread_jit_write_protect_np(1);
@@ -1882,6 +1913,13 @@ pc_close(UNUSED(thread_t *ptr))
 
     config_save();
 
+    if (snapshot_exit_path[0] != '\0')
+        snapshot_save(snapshot_exit_path);
+
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_cache_save();
+#endif
+
     plat_mouse_capture(0);
 
     /* Close all the memory mappings. */
@@ -1957,6 +1995,9 @@ pc_run(void)
         pc_reset_hard_init();
     }
 
+    /* Take or restore a snapshot if one was requested. */
+    snapshot_process();
+
     /* Update the guest-CPU independent timer for devices with independent clock speed */
     rivatimer_update_all();
 
@@ -362,6 +362,40 @@ cdrom_is_sector_good(cdrom_t *dev, const uint8_t *b, const uint8_t mode2, const
     return ret;
 }
 
+/*
+   Read a raw sector, taking it from the read-ahead buffer if possible.
+   Within a transfer announced with cdrom_read_ahead(), a miss refills
+   the buffer with a single multi-sector read from the image.
+ */
+static int
+read_raw_sector(cdrom_t *dev, uint8_t *buffer, const uint32_t lba)
+{
+    if (((lba - dev->prefetch_lba) >= dev->prefetch_count) &&
+        (dev->ops->read_sectors != NULL) && (lba < dev->prefetch_end) &&
+        ((dev->prefetch_end - lba) > 1)) {
+        uint32_t count = dev->prefetch_end - lba;
+
+        if (count > CD_PREFETCH_SECTORS)
+            count = CD_PREFETCH_SECTORS;
+
+        if (dev->prefetch_buffer == NULL)
+            dev->prefetch_buffer = (uint8_t *) malloc(CD_PREFETCH_SECTORS * 2448);
+
+        dev->prefetch_lba   = lba;
+        dev->prefetch_count = 0;
+        if (dev->prefetch_buffer != NULL)
+            dev->prefetch_count = dev->ops->read_sectors(dev->local, dev->prefetch_buffer,
+                                                         lba, count);
+    }
+
+    if ((lba - dev->prefetch_lba) < dev->prefetch_count) {
+        memcpy(buffer, dev->prefetch_buffer + ((lba - dev->prefetch_lba) * 2448), 2448);
+        return 1;
+    }
+
+    return dev->ops->read_sector(dev->local, buffer, lba);
+}
+
 static int
 read_data(cdrom_t *dev, const uint32_t lba, int check)
 {
@@ -371,8 +405,7 @@ read_data(cdrom_t *dev, const uint32_t lba, int check)
     if (dev->cached_sector != lba) {
         dev->cached_sector = lba;
 
-        ret = dev->ops->read_sector(dev->local,
-                                    dev->raw_buffer[dev->cur_buf ^ 1], lba);
+        ret = read_raw_sector(dev, dev->raw_buffer[dev->cur_buf ^ 1], lba);
 
         if ((ret > 0) && check) {
             if (dev->mode2) {
@@ -1036,7 +1069,9 @@ cdrom_drive_reset(cdrom_t *dev)
     dev->get_volume    = NULL;
     dev->get_channel   = NULL;
 
-    dev->cached_sector = -1;
+    dev->cached_sector  = -1;
+    dev->prefetch_count = 0;
+    dev->prefetch_end   = 0;
 
     if (cdrom_drive_types[dev->type].speed == -1)
         dev->real_speed  = dev->speed;
@@ -1051,8 +1086,10 @@ cdrom_unload(cdrom_t *dev)
         cdrom_log(dev->log, "CDROM: cdrom_unload(%s)\n", dev->image_path);
     }
 
-    dev->cd_status     = CD_STATUS_EMPTY;
-    dev->cached_sector = -1;
+    dev->cd_status      = CD_STATUS_EMPTY;
+    dev->cached_sector  = -1;
+    dev->prefetch_count = 0;
+    dev->prefetch_end   = 0;
 
     if (dev->local != NULL) {
         dev->ops->close(dev->local);
@@ -2458,6 +2495,17 @@ cdrom_is_track_audio(cdrom_t *dev, const int sector,
     return audio;
 }
 
+/*
+   Announce that the sectors from lba to lba + count - 1 are about to be
+   read one by one, so that they can be fetched from the image in bulk.
+ */
+void
+cdrom_read_ahead(cdrom_t *dev, const uint32_t lba, const uint32_t count)
+{
+    if ((dev->ops != NULL) && (dev->ops->read_sectors != NULL))
+        dev->prefetch_end = lba + count;
+}
+
 int
 cdrom_readsector_raw(cdrom_t *dev, uint8_t *buffer, const int sector, const int ismsf,
                      int cdrom_sector_type, const int cdrom_sector_flags,
@@ -3017,6 +3065,8 @@ cdrom_load(cdrom_t *dev, const char *fn, const int skip_insert)
         dev->local = image_open(dev, dev->image_path);
 
     dev->cached_sector  = -1;
+    dev->prefetch_count = 0;
+    dev->prefetch_end   = 0;
 
     if (dev->local == NULL) {
         dev->ops           = NULL;
@@ -3170,6 +3220,9 @@ cdrom_close(void)
 
         cdrom_drive_reset(dev);
 
+        free(dev->prefetch_buffer);
+        dev->prefetch_buffer = NULL;
+
         if (dev->log != NULL) {
             cdrom_log(dev->log, "Log closed\n");
 
@@ -106,6 +106,23 @@ typedef struct
 
 #define dstruct_t mds_disc_struct_t
 
+/* A non-empty index, for looking up the track and index of a sector. */
+typedef struct image_range_t {
+    uint64_t      start;
+    uint64_t      end;
+    int           track;
+    int           index;
+} image_range_t;
+
+/* Index ranges sorted by start, with the last hit checked first. */
+typedef struct image_map_t {
+    image_range_t *ranges;
+    int            num;
+    int            last;
+    /* Some ranges overlap, scan the track list instead. */
+    int            overlap;
+} image_map_t;
+
 typedef struct cd_image_t {
     cdrom_t      *dev;
     void         *log;
@@ -117,6 +134,10 @@ typedef struct cd_image_t {
     track_t      *tracks;
     uint32_t     *bad_sectors;
     dstruct_t     dstruct;
+    /* All tracks, for image_get_track(). */
+    image_map_t   track_map;
+    /* Tracks 01-99, for image_get_track_and_index(). */
+    image_map_t   index_map;
 } cd_image_t;
 
 typedef enum
@@ -520,11 +541,134 @@ index_file_close(track_index_t *idx)
 }
 
 /* Internal functions. */
+static int
+image_range_cmp(const void *a, const void *b)
+{
+    const image_range_t *ra = (const image_range_t *) a;
+    const image_range_t *rb = (const image_range_t *) b;
+
+    return (ra->start > rb->start) - (ra->start < rb->start);
+}
+
+static void
+image_map_free(image_map_t *map)
+{
+    free(map->ranges);
+    memset(map, 0x00, sizeof(image_map_t));
+}
+
+/*
+   Collect every non-empty index into a table sorted by start frame,
+   so that sector lookups can use a binary search instead of walking
+   all tracks and all their indexes.
+ */
+static void
+image_map_build(const cd_image_t *img, image_map_t *map, const int tracks_only)
+{
+    int num = 0;
+
+    image_map_free(map);
+
+    for (int i = 0; i < img->tracks_num; i++) {
+        const track_t *ct = &(img->tracks[i]);
+
+        if (tracks_only && ((ct->point < 1) || (ct->point > 99)))
+            continue;
+
+        for (int j = 0; j <= ct->max_index; j++)
+            if ((ct->idx[j].type >= INDEX_ZERO) && (ct->idx[j].length != 0ULL))
+                num++;
+    }
+
+    if (num == 0)
+        return;
+
+    map->ranges = (image_range_t *) calloc(num, sizeof(image_range_t));
+    if (map->ranges == NULL)
+        return;
+
+    for (int i = 0; i < img->tracks_num; i++) {
+        const track_t *ct = &(img->tracks[i]);
+
+        if (tracks_only && ((ct->point < 1) || (ct->point > 99)))
+            continue;
+
+        for (int j = 0; j <= ct->max_index; j++) {
+            const track_index_t *ci = &(ct->idx[j]);
+
+            if ((ci->type >= INDEX_ZERO) && (ci->length != 0ULL)) {
+                image_range_t *r = &(map->ranges[map->num++]);
+
+                r->start = ci->start;
+                r->end   = ci->start + ci->length - 1;
+                r->track = i;
+                r->index = j;
+            }
+        }
+    }
+
+    qsort(map->ranges, map->num, sizeof(image_range_t), image_range_cmp);
+
+    /*
+       The track list scan returns the last match, which a binary search
+       can not reproduce if ranges overlap, so keep using it in that case.
+     */
+    for (int i = 1; i < map->num; i++)
+        if (map->ranges[i].start <= map->ranges[i - 1].end) {
+            image_log(img->log, "Overlapping indexes at %016" PRIX64 ", not using "
+                      "the sector map\n", map->ranges[i].start);
+            map->overlap = 1;
+            break;
+        }
+}
+
+/* Returns the range containing the sector, or NULL if there is none. */
+static const image_range_t *
+image_map_find(const image_map_t *map, const uint32_t sector)
+{
+    /* Same wrap-around as the track list scan, for the LBA -150 to -1 pre-gap. */
+    const uint64_t       pos    = (uint32_t) (sector + 150);
+    const image_range_t *r      = &(map->ranges[map->last]);
+    int                  lo     = 0;
+    int                  hi     = map->num - 1;
+
+    if ((pos >= r->start) && (pos <= r->end))
+        return r;
+
+    /* Sequential reads running into the next index. */
+    if (((map->last + 1) < map->num) && (pos >= r[1].start) && (pos <= r[1].end)) {
+        ((image_map_t *) map)->last++;
+        return &(r[1]);
+    }
+
+    while (lo <= hi) {
+        const int mid = (lo + hi) >> 1;
+
+        r = &(map->ranges[mid]);
+        if (pos < r->start)
+            hi = mid - 1;
+        else if (pos > r->end)
+            lo = mid + 1;
+        else {
+            ((image_map_t *) map)->last = mid;
+            return r;
+        }
+    }
+
+    return NULL;
+}
+
 static int
 image_get_track(const cd_image_t *img, const uint32_t sector)
 {
     int ret = -1;
 
+    if ((img->track_map.ranges != NULL) && !img->track_map.overlap) {
+        const image_range_t *r = image_map_find(&img->track_map, sector);
+
+        return (r != NULL) ? r->track : -1;
+    }
+
     for (int i = 0; i < img->tracks_num; i++) {
         track_t *ct = &(img->tracks[i]);
         for (int j = 0; j <= ct->max_index; j++) {
@@ -547,6 +691,17 @@ image_get_track_and_index(const cd_image_t *img, const uint32_t sector,
     *track = -1;
     *index = -1;
 
+    if ((img->index_map.ranges != NULL) && !img->index_map.overlap) {
+        const image_range_t *r = image_map_find(&img->index_map, sector);
+
+        if (r != NULL) {
+            *track = r->track;
+            *index = r->index;
+        }
+
+        return;
+    }
+
     for (int i = 0; i < img->tracks_num; i++) {
         track_t *ct = &(img->tracks[i]);
         if ((ct->point >= 1) && (ct->point <= 99))  for (int j = 0; j <= ct->max_index; j++) {
@@ -561,16 +716,24 @@ image_get_track_and_index(const cd_image_t *img, const uint32_t sector,
     }
 }
 
+static int
+image_bad_sector_cmp(const void *a, const void *b)
+{
+    const uint32_t sa = *(const uint32_t *) a;
+    const uint32_t sb = *(const uint32_t *) b;
+
+    return (sa > sb) - (sa < sb);
+}
+
 static int
 image_is_sector_bad(const cd_image_t *img, const uint32_t sector)
 {
     int ret = 0;
 
-    if (img->bad_sectors_num > 0)  for (int i = 0; i < img->bad_sectors_num; i++)
-        if (img->bad_sectors[i] == sector) {
-            ret = 1;
-            break;
-        }
+    /* The list is sorted in image_open(). */
+    if (img->bad_sectors_num > 0)
+        ret = (bsearch(&sector, img->bad_sectors, img->bad_sectors_num,
+                       sizeof(uint32_t), image_bad_sector_cmp) != NULL);
 
     return ret;
 }
@@ -2322,6 +2485,9 @@ image_clear_tracks(cd_image_t *img)
         free(img->tracks);
         img->tracks = NULL;
 
+        image_map_free(&img->track_map);
+        image_map_free(&img->index_map);
+
         /* Mark that there's no tracks. */
         img->tracks_num = 0;
     }
@@ -2409,137 +2575,214 @@ image_is_track_pre(const void *local, const uint32_t sector)
     return ret;
 }
 
+/*
+   Assemble a raw sector of the given track and index. If data is not NULL,
+   it holds the sector as stored in the file, otherwise it is read here.
+ */
+static int
+image_make_sector(const cd_image_t *img, uint8_t *buffer, const uint32_t lba,
+                  const int track, const int index, const uint8_t *data)
+{
+    cdrom_t             *dev          = (cdrom_t *) img->dev;
+    const track_t       *trk          = &(img->tracks[track]);
+    const track_index_t *idx          = &(trk->idx[index]);
+    const uint64_t       sect         = (uint64_t) lba;
+    const int            track_is_raw = ((trk->sector_size == RAW_SECTOR_SIZE) ||
+                                         (trk->sector_size == 2448));
+    const uint64_t       seek         = ((sect + 150 - idx->start + idx->file_start) *
+                                         trk->sector_size) + trk->skip;
+    int                  m            = 0;
+    int                  s            = 0;
+    int                  f            = 0;
+    int                  ret;
+    uint8_t              q[16]        = { 0x00 };
+    uint8_t             *buf          = buffer;
+
+    /* Signal CIRC error to the guest if sector is bad. */
+    ret = image_is_sector_bad(img, lba) ? -1 : 1;
+
+    if (ret > 0) {
+        uint64_t       offset = 0ULL;
+
+        image_log(img->log, "cdrom_read_sector(%08X): track %02X, index %02X, %016"
+                  PRIX64 ", %i, %i, %i, %i\n",
+                  lba, track, index, idx->start, trk->sector_size, track_is_raw,
+                  trk->mode, trk->form);
+
+        memset(buffer, 0x00, 2448);
+
+        if ((trk->attr & 0x04) && ((idx->type < INDEX_NORMAL) || !track_is_raw)) {
+            offset += 16ULL;
+
+            /* Construct the header. */
+            memset(buffer + 1, 0xff, 10);
+            buffer += 12;
+            FRAMES_TO_MSF(lba + 150, &m, &s, &f);
+            /* These have to be BCD. */
+            buffer[0] = bin2bcd(m & 0xff);
+            buffer[1] = bin2bcd(s & 0xff);
+            buffer[2] = bin2bcd(f & 0xff);
+            /* Data, should reflect the actual sector type. */
+            buffer[3] = trk->mode;
+            buffer += 4;
+            if (trk->form >= 1) {
+                offset += 8ULL;
+
+                /* Construct the CD-I/XA sub-header. */
+                buffer[2] = buffer[6] = (trk->form - 1) << 5;
+                buffer += 8;
+            }
+        }
+
+        if (idx->type < INDEX_NORMAL)
+            /* Index is not in the file, no read to fail here. */
+            ret = 1;
+        else if (data != NULL) {
+            /* Already read along with other sectors. */
+            memcpy(buffer, data, trk->sector_size);
+            ret = 1;
+        } else
+            /* Read the data from the file. */
+            ret = idx->file->read(idx->file, buffer, seek, trk->sector_size);
+
+        if ((ret > 0) && (trk->attr & 0x04) && ((idx->type < INDEX_NORMAL) || !track_is_raw)) {
+            uint32_t crc;
+
+            if ((trk->mode == 2) && (trk->form == 1)) {
+                crc = cdrom_crc32(0xffffffff, &(buf[16]), 2056) ^ 0xffffffff;
+                memcpy(&(buf[2072]), &crc, 4);
+            } else {
+                crc = cdrom_crc32(0xffffffff, buf, 2064) ^ 0xffffffff;
+                memcpy(&(buf[2064]), &crc, 4);
+            }
+
+            int m2f1 = (trk->mode == 2) && (trk->form == 1);
+
+            /* Compute ECC P code. */
+            cdrom_compute_ecc_block(dev, &(buf[2076]), &(buf[12]), 86, 24, 2, 86, m2f1);
+
+            /* Compute ECC Q code. */
+            cdrom_compute_ecc_block(dev, &(buf[2248]), &(buf[12]), 52, 43, 86, 88, m2f1);
+        }
+
+        if ((ret > 0) && ((idx->type < INDEX_NORMAL) || (trk->subch_type != 0x08))) {
+            buffer -= offset;
+
+            if (trk->subch_type == 0x10)
+                memcpy(q, &(buffer[2352]), 12);
+            else {
+                /* Construct Q. */
+                q[0] = (trk->attr >> 4) | ((trk->attr & 0xf) << 4);
+                q[1] = bin2bcd(trk->point);
+                q[2] = index;
+                if (index == 0) {
+                    /*
+                       Pre-gap sector relative frame addresses count from
+                       00:01:74 downwards.
+                     */
+                    FRAMES_TO_MSF((int32_t) (149 - (lba + 150 - idx->start)), &m, &s, &f);
+                } else {
+                    FRAMES_TO_MSF((int32_t) (lba + 150 - idx->start), &m, &s, &f);
+                }
+                q[3] = bin2bcd(m & 0xff);
+                q[4] = bin2bcd(s & 0xff);
+                q[5] = bin2bcd(f & 0xff);
+                FRAMES_TO_MSF(lba + 150, &m, &s, &f);
+                q[7] = bin2bcd(m & 0xff);
+                q[8] = bin2bcd(s & 0xff);
+                q[9] = bin2bcd(f & 0xff);
+            }
+
+            /* Construct raw subchannel data from Q only. */
+            for (int i = 0; i < 12; i++)
+                 for (int j = 0; j < 8; j++)
+                      buffer[2352 + (i << 3) + j] = ((q[i] >> (7 - j)) & 0x01) << 6;
+        }
+    }
+
+    return ret;
+}
+
 static int
 image_read_sector(const void *local, uint8_t *buffer,
                   const uint32_t sector)
 {
     const cd_image_t *img    = (const cd_image_t *) local;
-    cdrom_t          *dev    = (cdrom_t *) img->dev;
-    int               m      = 0;
-    int               s      = 0;
-    int               f      = 0;
     int               ret    = 0;
     uint32_t          lba    = sector;
     int               track;
     int               index;
-    uint8_t           q[16]  = { 0x00 };
-    uint8_t          *buf    = buffer;
 
     if (sector == 0xffffffff)
         lba = img->dev->seek_pos;
 
-    const uint64_t sect   = (uint64_t) lba;
-
     image_get_track_and_index(img, lba, &track, &index);
 
-    const track_t       *trk          = &(img->tracks[track]);
-    const track_index_t *idx          = &(trk->idx[index]);
-    const int            track_is_raw = ((trk->sector_size == RAW_SECTOR_SIZE) ||
-                                         (trk->sector_size == 2448));
-    const uint64_t       seek         = ((sect + 150 - idx->start + idx->file_start) *
-                                         trk->sector_size) + trk->skip;
+    if (track >= 0)
+        ret = image_make_sector(img, buffer, lba, track, index, NULL);
 
-    if (track >= 0) {
-        /* Signal CIRC error to the guest if sector is bad. */
-        ret = image_is_sector_bad(img, lba) ? -1 : 1;
+    return ret;
+}
 
-        if (ret > 0) {
-            uint64_t       offset = 0ULL;
-
-            image_log(img->log, "cdrom_read_sector(%08X): track %02X, index %02X, %016"
-                      PRIX64 ", %i, %i, %i, %i\n",
-                      lba, track, index, idx->start, trk->sector_size, track_is_raw,
-                      trk->mode, trk->form);
-
-            memset(buffer, 0x00, 2448);
-
-            if ((trk->attr & 0x04) && ((idx->type < INDEX_NORMAL) || !track_is_raw)) {
-                offset += 16ULL;
-
-                /* Construct the header. */
-                memset(buffer + 1, 0xff, 10);
-                buffer += 12;
-                FRAMES_TO_MSF(sector + 150, &m, &s, &f);
-                /* These have to be BCD. */
-                buffer[0] = bin2bcd(m & 0xff);
-                buffer[1] = bin2bcd(s & 0xff);
-                buffer[2] = bin2bcd(f & 0xff);
-                /* Data, should reflect the actual sector type. */
-                buffer[3] = trk->mode;
-                buffer += 4;
-                if (trk->form >= 1) {
-                    offset += 8ULL;
-
-                    /* Construct the CD-I/XA sub-header. */
-                    buffer[2] = buffer[6] = (trk->form - 1) << 5;
-                    buffer += 8;
-                }
-            }
+/*
+   Read up to count raw sectors of 2448 bytes each, reading each run of
+   sectors that lie in the same index of the same file with a single read.
+   Returns the number of sectors read, stopping before the first one that
+   fails, so that the caller can get the error from image_read_sector().
+ */
+static int
+image_read_sectors(const void *local, uint8_t *buffer,
+                   const uint32_t sector, const uint32_t count)
+{
+    const cd_image_t *img  = (const cd_image_t *) local;
+    uint8_t          *data = (uint8_t *) malloc((size_t) count * 2448);
+    uint32_t          done = 0;
+    int               track;
+    int               index;
 
-            if (idx->type >= INDEX_NORMAL)
-                /* Read the data from the file. */
-                ret = idx->file->read(idx->file, buffer, seek, trk->sector_size);
-            else
-                /* Index is not in the file, no read to fail here. */
-                ret = 1;
+    if (data == NULL)
+        return 0;
 
-            if ((ret > 0) && (trk->attr & 0x04) && ((idx->type < INDEX_NORMAL) || !track_is_raw)) {
-                uint32_t crc;
+    while (done < count) {
+        const uint32_t lba = sector + done;
 
-                if ((trk->mode == 2) && (trk->form == 1)) {
-                    crc = cdrom_crc32(0xffffffff, &(buf[16]), 2056) ^ 0xffffffff;
-                    memcpy(&(buf[2072]), &crc, 4);
-                } else {
-                    crc = cdrom_crc32(0xffffffff, buf, 2064) ^ 0xffffffff;
-                    memcpy(&(buf[2064]), &crc, 4);
-                }
+        image_get_track_and_index(img, lba, &track, &index);
+        if (track < 0)
+            break;
 
-                int m2f1 = (trk->mode == 2) && (trk->form == 1);
+        const track_t       *trk = &(img->tracks[track]);
+        const track_index_t *idx = &(trk->idx[index]);
+        uint64_t             run = idx->start + idx->length - (uint64_t) (lba + 150);
+        const uint8_t       *src = NULL;
 
-                /* Compute ECC P code. */
-                cdrom_compute_ecc_block(dev, &(buf[2076]), &(buf[12]), 86, 24, 2, 86, m2f1);
+        if (run > (count - done))
+            run = count - done;
 
-                /* Compute ECC Q code. */
-                cdrom_compute_ecc_block(dev, &(buf[2248]), &(buf[12]), 52, 43, 86, 88, m2f1);
-            }
+        if (idx->type >= INDEX_NORMAL) {
+            const uint64_t seek = (((uint64_t) lba + 150 - idx->start + idx->file_start) *
+                                   trk->sector_size) + trk->skip;
 
-            if ((ret > 0) && ((idx->type < INDEX_NORMAL) || (trk->subch_type != 0x08))) {
-                buffer -= offset;
-
-                if (trk->subch_type == 0x10)
-                    memcpy(q, &(buffer[2352]), 12);
-                else {
-                    /* Construct Q. */
-                    q[0] = (trk->attr >> 4) | ((trk->attr & 0xf) << 4);
-                    q[1] = bin2bcd(trk->point);
-                    q[2] = index;
-                    if (index == 0) {
-                        /*
-                           Pre-gap sector relative frame addresses count from
-                           00:01:74 downwards.
-                         */
-                        FRAMES_TO_MSF((int32_t) (149 - (lba + 150 - idx->start)), &m, &s, &f);
-                    } else {
-                        FRAMES_TO_MSF((int32_t) (lba + 150 - idx->start), &m, &s, &f);
-                    }
-                    q[3] = bin2bcd(m & 0xff);
-                    q[4] = bin2bcd(s & 0xff);
-                    q[5] = bin2bcd(f & 0xff);
-                    FRAMES_TO_MSF(lba + 150, &m, &s, &f);
-                    q[7] = bin2bcd(m & 0xff);
-                    q[8] = bin2bcd(s & 0xff);
-                    q[9] = bin2bcd(f & 0xff);
-                }
+            if (idx->file->read(idx->file, data, seek, run * trk->sector_size) <= 0)
+                break;
 
-                /* Construct raw subchannel data from Q only. */
-                for (int i = 0; i < 12; i++)
-                     for (int j = 0; j < 8; j++)
-                          buffer[2352 + (i << 3) + j] = ((q[i] >> (7 - j)) & 0x01) << 6;
-            }
+            src = data;
+        }
+
+        for (uint32_t i = 0; i < run; i++) {
+            if (image_make_sector(img, buffer + ((size_t) done * 2448), lba + i,
+                                  track, index, src) <= 0)
+                goto end;
+
+            if (src != NULL)
+                src += trk->sector_size;
+            done++;
         }
     }
 
-    return ret;
+end:
+    free(data);
+
+    return done;
 }
 
 static uint8_t
@@ -2668,7 +2911,8 @@ static const cdrom_ops_t image_ops = {
     image_has_audio,
     NULL,
     image_close,
-    NULL
+    NULL,
+    image_read_sectors
 };
 
 /* Public functions. */
@@ -2716,6 +2960,13 @@ image_open(cdrom_t *dev, const char *path)
         }
 
         if (ret > 0) {
+            image_map_build(img, &img->track_map, 0);
+            image_map_build(img, &img->index_map, 1);
+
+            if (img->bad_sectors_num > 0)
+                qsort(img->bad_sectors, img->bad_sectors_num, sizeof(uint32_t),
+                      image_bad_sector_cmp);
+
             if (img->is_dvd == 2) {
                 uint32_t lb = image_get_last_block(img); /* Should be safer than previous way of doing it? */
                 img->is_dvd = (lb >= 524287);    /* Minimum 1 GB total capacity as threshold for DVD. */
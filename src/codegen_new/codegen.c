@@ -55,6 +55,9 @@ codegen_set_loop_start(ir_data_t *ir, int first_instruction)
 
 int has_ea;
 
+int        codegen_branch_followed;
+static int codegen_branches_followed;
+
 codeblock_t *codeblock;
 uint16_t    *codeblock_hash;
 
@@ -89,6 +92,38 @@ codegen_generate_reset(void)
     last_op_ea_seg = NULL;
     last_op_32     = -1;
     has_ea         = 0;
+
+    codegen_branch_followed   = 0;
+    codegen_branches_followed = 0;
+}
+
+int
+codegen_can_follow_branch(codeblock_t *block, uint32_t dest_addr)
+{
+    uint32_t dest = cs + dest_addr;
+
+    /*Only forward of this instruction and within the first page of the
+      block, so the code stays in the pages tracked for it and the block size
+      check still applies. Backward branches are left to loop unrolling*/
+    if ((block->flags & CODEBLOCK_BYTE_MASK) || block->page_mask2)
+        return 0;
+    if (((dest ^ block->pc) & ~0xfff) || (dest <= cs + cpu_state.oldpc))
+        return 0;
+    if (codegen_branches_followed >= CODEBLOCK_MAX_TRACE)
+        return 0;
+    /*This instruction ends the block anyway once it is the last one allowed*/
+    if (block->ins >= MAX_INSTRUCTION_COUNT - 1)
+        return 0;
+
+    for (uint8_t c = 0; c < block->nr_trace; c++) {
+        if (block->trace_pc[c] == dest) {
+            codegen_branches_followed++;
+            codegen_branch_followed = 1;
+            return 1;
+        }
+    }
+
+    return 0;
 }
 
 void
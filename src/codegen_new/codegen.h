@@ -30,6 +30,12 @@
   same page).
 */
 
+/*Maximum number of taken branch targets a block can be compiled to carry on
+  at, and the number of consecutive exits to the same place in the page that
+  makes it one of them*/
+#define CODEBLOCK_MAX_TRACE 4
+#define CODEBLOCK_TRACE_HOT 32
+
 typedef struct codeblock_t {
     uint32_t pc;
     uint32_t _cs;
@@ -54,6 +60,23 @@ typedef struct codeblock_t {
     uint16_t prev, next;
     uint16_t prev_2, next_2;
 
+    /*Blocks that have been seen to follow this one in the same page, most
+      recent first. exec386_dynarec_dyn() runs them directly, without going
+      through the hash and tree lookup, after checking that they are still
+      valid for the current state; stale links are simply ignored.*/
+    uint16_t link[2];
+
+    /*Superblock formation. exit_pc and exit_count track where the block
+      has been leaving to; once that has been the same place later in the
+      page for CODEBLOCK_TRACE_HOT runs in a row, it is added to trace_pc and
+      the block is recompiled. A taken branch to any address in trace_pc is
+      then compiled as a side exit for the not taken path, with compilation
+      carrying on at the branch target.*/
+    uint32_t trace_pc[CODEBLOCK_MAX_TRACE];
+    uint32_t exit_pc;
+    uint8_t  exit_count;
+    uint8_t  nr_trace;
+
     /*First mem_block_t used by this block. Any subsequent mem_block_ts
       will be in the list starting at head_mem_block->next.*/
     struct mem_block_t *head_mem_block;
@@ -81,6 +104,8 @@ extern uint8_t *block_write_data;
 #define CODEBLOCK_IN_DIRTY_LIST 0x40
 /*Code block is not inlining immediate parameters, parameters must be fetched from memory*/
 #define CODEBLOCK_NO_IMMEDIATES 0x80
+/*Code block has been run since the eviction clock hand last passed it*/
+#define CODEBLOCK_ACCESSED 0x100
 
 #define BLOCK_PC_INVALID        0xffffffff
 
@@ -296,7 +321,18 @@ extern void codegen_block_remove(void);
 extern void codegen_block_start_recompile(codeblock_t *block);
 extern void codegen_block_end_recompile(codeblock_t *block);
 extern void codegen_block_end(void);
+extern void codegen_block_end_cached(uint64_t page_mask);
 extern void codegen_delete_block(codeblock_t *block);
+extern void codegen_block_link(codeblock_t *block, codeblock_t *next);
+extern void codegen_block_add_trace(codeblock_t *block, uint32_t pc);
+
+/*On-disk block profile, see codegen_cache.c*/
+extern void         codegen_cache_update(codeblock_t *block);
+extern codeblock_t *codegen_cache_block_init(uint32_t phys_addr);
+
+/*Set when the instruction being compiled is a taken branch that is being
+  followed; the block carries on at the branch target rather than ending*/
+extern int codegen_branch_followed;
 extern void codegen_generate_call(uint8_t opcode, OpFn op, uint32_t fetchdat, uint32_t new_pc, uint32_t old_pc);
 extern void codegen_generate_seg_restore(void);
 extern void codegen_set_op32(void);
@@ -309,9 +345,11 @@ extern void codegen_check_seg_write(codeblock_t *block, struct ir_data_t *ir, x8
 extern void codegen_check_regs(void);
 
 extern int codegen_purge_purgable_list(void);
-/*Delete a random code block to free memory. This is obviously quite expensive, and
-  will only be called when the allocator is out of memory*/
-extern void codegen_delete_random_block(int required_mem_block);
+/*Delete a code block to free memory, picking one that has not run recently
+  using a clock (second chance) sweep. This is obviously quite expensive, and will
+  only be called when the allocator is out of memory. Returns 0 if there was no
+  block that could be deleted*/
+extern int codegen_evict_block(int required_mem_block);
 
 extern int      cpu_block_end;
 extern uint32_t codegen_endpc;
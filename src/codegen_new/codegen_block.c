@@ -18,6 +18,7 @@
 #include "386_common.h"
 
 #include "codegen.h"
+#include "codegen_public.h"
 #include "codegen_accumulate.h"
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
@@ -58,7 +59,10 @@ uint32_t instr_counts[256 * 256];
 #endif
 
 static uint16_t block_free_list;
+static int      block_clock_hand = 0;
 static void     delete_block(codeblock_t *block);
+
+static codegen_stats_t codegen_stats;
 static void     delete_dirty_block(codeblock_t *block);
 
 /*Temporary list of code blocks that have recently been evicted. This allows for
@@ -203,8 +207,8 @@ block_free_list_get(void)
             break;
         }
         /*Free list is empty - free up a block*/
-        if (!codegen_purge_purgable_list())
-            codegen_delete_random_block(0);
+        if (!codegen_purge_purgable_list() && !codegen_evict_block(0))
+            fatal("block_free_list_get: no block to evict\n");
     }
 
     block           = &codeblock[block_free_list];
@@ -379,6 +383,8 @@ invalidate_block(codeblock_t *block)
 #endif
     remove_from_block_list(block, old_pc);
     block_dirty_list_add(block);
+    codegen_stats.invalidations++;
+    block->link[0] = block->link[1] = BLOCK_INVALID;
     if (block->head_mem_block)
         codegen_allocator_free(block->head_mem_block);
     block->head_mem_block = NULL;
@@ -396,7 +402,8 @@ delete_block(codeblock_t *block)
     if (block->pc == BLOCK_PC_INVALID)
         fatal("Deleting deleted block\n");
 #endif
-    block->pc = BLOCK_PC_INVALID;
+    block->pc      = BLOCK_PC_INVALID;
+    block->link[0] = block->link[1] = BLOCK_INVALID;
 
     codeblock_tree_delete(block);
     if (block->flags & CODEBLOCK_IN_DIRTY_LIST)
@@ -419,7 +426,8 @@ delete_dirty_block(codeblock_t *block)
     if (block->pc == BLOCK_PC_INVALID)
         fatal("Deleting deleted block\n");
 #endif
-    block->pc = BLOCK_PC_INVALID;
+    block->pc      = BLOCK_PC_INVALID;
+    block->link[0] = block->link[1] = BLOCK_INVALID;
 
     codeblock_tree_delete(block);
     block_free_list_add(block);
@@ -432,22 +440,76 @@ codegen_delete_block(codeblock_t *block)
         delete_block(block);
 }
 
+/* Remember that next followed block. Links into blocks that have since been
+   deleted or reused are caught by the checks done before following them, so
+   only a block's own links have to be dropped when it goes away. */
 void
-codegen_delete_random_block(int required_mem_block)
+codegen_block_link(codeblock_t *block, codeblock_t *next)
 {
-    int block_nr = rand() & BLOCK_MASK;
+    uint16_t next_nr = get_block_nr(next);
 
-    while (1) {
-        if (block_nr && block_nr != block_current) {
-            codeblock_t *block = &codeblock[block_nr];
+    if ((block->link[0] == next_nr) || (block->link[1] == next_nr))
+        return;
 
-            if (block->pc != BLOCK_PC_INVALID && (!required_mem_block || block->head_mem_block)) {
-                delete_block(block);
-                return;
-            }
+    block->link[1] = block->link[0];
+    block->link[0] = next_nr;
+}
+
+/* pc has become the usual exit of this block; have the block recompiled on
+   its next run, following taken branches to pc instead of stopping there. */
+void
+codegen_block_add_trace(codeblock_t *block, uint32_t pc)
+{
+    for (uint8_t c = 0; c < block->nr_trace; c++) {
+        if (block->trace_pc[c] == pc)
+            return;
+    }
+    if (block->nr_trace >= CODEBLOCK_MAX_TRACE)
+        return;
+
+    block->trace_pc[block->nr_trace++] = pc;
+    block->flags &= ~CODEBLOCK_WAS_RECOMPILED;
+    codegen_stats.traces++;
+}
+
+int
+codegen_evict_block(int required_mem_block)
+{
+    /*Two full turns, as the first one may only be clearing accessed bits*/
+    for (int c = 0; c < (BLOCK_SIZE * 2); c++) {
+        codeblock_t *block;
+
+        block_clock_hand = (block_clock_hand + 1) & BLOCK_MASK;
+        if (!block_clock_hand || (block_clock_hand == block_current))
+            continue;
+
+        block = &codeblock[block_clock_hand];
+        if ((block->pc == BLOCK_PC_INVALID) || (required_mem_block && !block->head_mem_block))
+            continue;
+
+        if (block->flags & CODEBLOCK_ACCESSED) {
+            block->flags &= ~CODEBLOCK_ACCESSED;
+            continue;
         }
-        block_nr = (block_nr + 1) & BLOCK_MASK;
+
+        delete_block(block);
+        codegen_stats.evictions++;
+        return 1;
     }
+
+    return 0;
+}
+
+void
+codegen_get_stats(codegen_stats_t *stats)
+{
+    *stats = codegen_stats;
+}
+
+void
+codegen_reset_stats(void)
+{
+    memset(&codegen_stats, 0x00, sizeof(codegen_stats_t));
 }
 
 void
@@ -528,7 +590,11 @@ codegen_block_init(uint32_t phys_addr)
     block->next = block->prev = BLOCK_INVALID;
     block->next_2 = block->prev_2 = BLOCK_INVALID;
     block->page_mask = block->page_mask2 = 0;
-    block->flags                         = CODEBLOCK_STATIC_TOP;
+    block->link[0] = block->link[1]      = BLOCK_INVALID;
+    block->exit_pc                       = BLOCK_PC_INVALID;
+    block->exit_count                    = 0;
+    block->nr_trace                      = 0;
+    block->flags                         = CODEBLOCK_STATIC_TOP | CODEBLOCK_ACCESSED;
     block->status                        = cpu_cur_status;
 
     recomp_page = block->phys & ~0xfff;
@@ -595,6 +661,7 @@ codegen_block_start_recompile(codeblock_t *block)
 
     block->TOP = cpu_state.TOP & 7;
     block->flags |= CODEBLOCK_WAS_RECOMPILED;
+    codegen_stats.recompiles++;
 
     codegen_flat_ds = !(cpu_cur_status & CPU_STATUS_NOTFLATDS);
     codegen_flat_ss = !(cpu_cur_status & CPU_STATUS_NOTFLATSS);
@@ -761,6 +828,26 @@ codegen_block_end(void)
     add_to_block_list(block);
 }
 
+/*End a block that was set up from the on-disk profile rather than by an
+  interpreted pass, so it sits on its page list like any other*/
+void
+codegen_block_end_cached(uint64_t page_mask)
+{
+    codeblock_t *block = &codeblock[block_current];
+    page_t      *p     = &pages[block->phys >> 12];
+
+    block->page_mask  = page_mask;
+    block->page_mask2 = 0;
+    block->phys_2     = -1;
+
+    p->code_present_mask |= page_mask;
+    if ((p->dirty_mask & page_mask) && !page_in_evict_list(p))
+        page_add_to_evict_list(p);
+
+    recomp_page = -1;
+    add_to_block_list(block);
+}
+
 void
 codegen_block_end_recompile(codeblock_t *block)
 {
@@ -781,6 +868,7 @@ codegen_block_end_recompile(codeblock_t *block)
 
     codegen_accumulate_flush(ir_data);
     codegen_ir_compile(ir_data, block);
+    codegen_cache_update(block);
 }
 
 void
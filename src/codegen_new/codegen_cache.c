@@ -0,0 +1,280 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Persistent code cache profile for the new dynarec.
+ *
+ *          Compiled code can not be reused across sessions, as it is
+ *          full of host addresses (cpu_state, RAM, helper functions)
+ *          and code generation depends on the live CPU state. What is
+ *          kept instead is the shape of each compiled block: where it
+ *          starts, the CPU mode it was compiled for, the 64 byte chunks
+ *          of the page it covers with a hash of their contents, and the
+ *          hot exits it was extended to follow. A block whose code
+ *          still hashes the same is compiled the first time it is run
+ *          rather than being interpreted once first, and starts with
+ *          its known superblock shape rather than having to grow it
+ *          again through recompiles.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include "cpu.h"
+#include <86box/mem.h>
+#include <86box/path.h>
+#include <86box/plat.h>
+
+#include "codegen.h"
+
+#define CACHE_MAGIC   0x43524442 /*'BDRC'*/
+#define CACHE_VERSION 1
+
+#define CACHE_SIZE  0x10000
+#define CACHE_MASK  (CACHE_SIZE - 1)
+#define CACHE_PROBE 8
+
+#define CACHE_FILE "dynarec.bin"
+
+typedef struct cache_entry_t {
+    uint32_t phys;
+    uint32_t pc;
+    uint32_t _cs;
+    uint16_t status;
+    uint8_t  nr_trace;
+    uint8_t  valid;
+    uint64_t page_mask;
+    uint64_t hash;
+    uint32_t trace_pc[CODEBLOCK_MAX_TRACE];
+} cache_entry_t;
+
+static cache_entry_t *cache_entries = NULL;
+static int            cache_dirty   = 0;
+
+#ifdef ENABLE_CODEGEN_CACHE_LOG
+int codegen_cache_do_log = ENABLE_CODEGEN_CACHE_LOG;
+
+static void
+codegen_cache_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (codegen_cache_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define codegen_cache_log(fmt, ...)
+#endif
+
+static char *
+cache_path(void)
+{
+    static char path[1024];
+
+    path_append_filename(path, usr_path, CACHE_FILE);
+    return path;
+}
+
+static __inline uint32_t
+cache_slot(uint32_t phys, uint32_t pc)
+{
+    uint32_t h = (phys ^ (pc << 7)) * 0x9e3779b1;
+
+    return (h >> 16) & CACHE_MASK;
+}
+
+/*FNV-1a over the 64 byte chunks of the page selected by page_mask. Returns 0
+  if the page is not backed by RAM, in which case nothing is cached for it*/
+static uint64_t
+cache_hash(uint32_t phys, uint64_t page_mask)
+{
+    const uint8_t *mem  = pages[phys >> 12].mem;
+    uint64_t       hash = 0xcbf29ce484222325ULL;
+
+    if ((mem == NULL) || (mem == page_ff))
+        return 0;
+
+    for (int c = 0; c < 64; c++) {
+        if (!(page_mask & ((uint64_t) 1 << c)))
+            continue;
+
+        for (int d = c << PAGE_MASK_SHIFT; d < ((c + 1) << PAGE_MASK_SHIFT); d++) {
+            hash ^= mem[d];
+            hash *= 0x100000001b3ULL;
+        }
+    }
+
+    return hash ? hash : 1;
+}
+
+static cache_entry_t *
+cache_find(uint32_t phys, uint32_t pc, uint32_t _cs, uint16_t status)
+{
+    uint32_t index = cache_slot(phys, pc);
+
+    for (int c = 0; c < CACHE_PROBE; c++) {
+        cache_entry_t *entry = &cache_entries[(index + c) & CACHE_MASK];
+
+        if (entry->valid && (entry->phys == phys) && (entry->pc == pc) && (entry->_cs == _cs) && (entry->status == status))
+            return entry;
+    }
+
+    return NULL;
+}
+
+static cache_entry_t *
+cache_insert(uint32_t phys, uint32_t pc)
+{
+    uint32_t index = cache_slot(phys, pc);
+
+    for (int c = 0; c < CACHE_PROBE; c++) {
+        cache_entry_t *entry = &cache_entries[(index + c) & CACHE_MASK];
+
+        if (!entry->valid)
+            return entry;
+    }
+
+    /*Probe sequence full; replace the entry in the home slot*/
+    return &cache_entries[index];
+}
+
+/*Record the shape of a block that has just been compiled*/
+void
+codegen_cache_update(codeblock_t *block)
+{
+    cache_entry_t *entry;
+    uint64_t       hash;
+
+    if (!cache_entries || (block->flags & CODEBLOCK_BYTE_MASK) || block->page_mask2 || !block->page_mask)
+        return;
+
+    hash = cache_hash(block->phys, block->page_mask);
+    if (!hash)
+        return;
+
+    entry = cache_find(block->phys, block->pc, block->_cs, block->status);
+    if (!entry)
+        entry = cache_insert(block->phys, block->pc);
+
+    entry->phys      = block->phys;
+    entry->pc        = block->pc;
+    entry->_cs       = block->_cs;
+    entry->status    = block->status;
+    entry->page_mask = block->page_mask;
+    entry->hash      = hash;
+    entry->nr_trace  = block->nr_trace;
+    entry->valid     = 1;
+    memcpy(entry->trace_pc, block->trace_pc, sizeof(entry->trace_pc));
+
+    cache_dirty = 1;
+}
+
+/*Set up a block for the code at the current CS:EIP if it is in the cache and
+  its code is unchanged. The block can then be compiled straight away*/
+codeblock_t *
+codegen_cache_block_init(uint32_t phys_addr)
+{
+    cache_entry_t *entry;
+    codeblock_t   *block;
+
+    if (!cache_entries)
+        return NULL;
+
+    entry = cache_find(phys_addr, cs + cpu_state.pc, cs, cpu_cur_status);
+    if (!entry)
+        return NULL;
+    if (cache_hash(entry->phys, entry->page_mask) != entry->hash) {
+        /*Different code at the same address*/
+        entry->valid = 0;
+        cache_dirty  = 1;
+        return NULL;
+    }
+
+    codegen_block_init(phys_addr);
+    block = &codeblock[block_current];
+
+    block->nr_trace = entry->nr_trace;
+    memcpy(block->trace_pc, entry->trace_pc, sizeof(block->trace_pc));
+
+    /*Recompiling takes the block off its page list first*/
+    codegen_block_end_cached(entry->page_mask);
+
+    return block;
+}
+
+void
+codegen_cache_load(void)
+{
+    uint32_t header[3];
+    FILE    *fp;
+
+    if (cache_entries) {
+        free(cache_entries);
+        cache_entries = NULL;
+    }
+    cache_dirty = 0;
+
+    if (!cpu_dynarec_cache)
+        return;
+
+    cache_entries = calloc(CACHE_SIZE, sizeof(cache_entry_t));
+    if (!cache_entries)
+        return;
+
+    fp = plat_fopen(cache_path(), "rb");
+    if (!fp)
+        return;
+
+    if ((fread(header, sizeof(header), 1, fp) == 1) && (header[0] == CACHE_MAGIC) && (header[1] == CACHE_VERSION) &&
+        (header[2] == sizeof(cache_entry_t))) {
+        cache_entry_t entry;
+        int           count = 0;
+
+        while (fread(&entry, sizeof(entry), 1, fp) == 1) {
+            if (!entry.valid || (entry.nr_trace > CODEBLOCK_MAX_TRACE))
+                continue;
+            *cache_insert(entry.phys, entry.pc) = entry;
+            count++;
+        }
+        codegen_cache_log("Code cache: %i blocks loaded\n", count);
+    } else
+        codegen_cache_log("Code cache: %s not valid, ignored\n", cache_path());
+
+    fclose(fp);
+}
+
+void
+codegen_cache_save(void)
+{
+    uint32_t header[3] = { CACHE_MAGIC, CACHE_VERSION, sizeof(cache_entry_t) };
+    FILE    *fp;
+
+    if (!cache_entries || !cache_dirty)
+        return;
+
+    fp = plat_fopen(cache_path(), "wb");
+    if (!fp) {
+        codegen_cache_log("Code cache: unable to write %s\n", cache_path());
+        return;
+    }
+
+    fwrite(header, sizeof(header), 1, fp);
+    for (uint32_t c = 0; c < CACHE_SIZE; c++) {
+        if (cache_entries[c].valid)
+            fwrite(&cache_entries[c], sizeof(cache_entry_t), 1, fp);
+    }
+    fclose(fp);
+
+    cache_dirty = 0;
+}
@@ -1,9 +1,12 @@
 #include <stdint.h>
+#include <string.h>
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/mem.h>
 #include <86box/plat_unused.h>
 
+#include "x86.h"
+#include "x86_flags.h"
 #include "codegen.h"
 #include "codegen_allocator.h"
 #include "codegen_backend.h"
@@ -62,6 +65,248 @@ duplicate_uop(ir_data_t *ir, uop_t *uop, int offset)
     }
 }
 
+/*uOPs that are jumped to. Register versions written between a jump and its
+  destination may not have been computed when the destination is reached,
+  so nothing learned about them can be carried past it*/
+static uint8_t ir_jump_dest[UOP_NR_MAX];
+
+/*Known constant value of the last version of each register, if any*/
+static uint8_t  ir_const_valid[IREG_COUNT];
+static uint8_t  ir_const_version[IREG_COUNT];
+static uint32_t ir_const_value[IREG_COUNT];
+
+static void
+ir_find_jump_dests(ir_data_t *ir)
+{
+    memset(ir_jump_dest, 0, sizeof(ir_jump_dest));
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        uop_t *uop = &ir->uops[c];
+
+        if ((uop->type & UOP_TYPE_JUMP) && (uop->jump_dest_uop >= 0) && (uop->jump_dest_uop < ir->wr_pos))
+            ir_jump_dest[uop->jump_dest_uop] = 1;
+    }
+}
+
+/*Only full size integer registers are tracked; partial writes depend on the
+  previous version of the register, so their value is not known*/
+static int
+ir_reg_is_const_size(ir_reg_t ir_reg)
+{
+    return !ir_reg_is_invalid(ir_reg) && (IREG_GET_SIZE(ir_reg.reg) == IREG_SIZE_L) && reg_is_native_size(ir_reg);
+}
+
+static int
+ir_const_get(ir_reg_t ir_reg, uint32_t *val)
+{
+    int reg = IREG_GET_REG(ir_reg.reg);
+
+    if (!ir_reg_is_const_size(ir_reg) || !ir_const_valid[reg] || (ir_const_version[reg] != ir_reg.version))
+        return 0;
+
+    *val = ir_const_value[reg];
+    return 1;
+}
+
+/*A read of ir_reg has been replaced by its value. Temporaries that are no
+  longer read can go; emulated registers are left alone, as their last
+  version may still have to be written back*/
+static void
+ir_const_drop_read(ir_reg_t ir_reg)
+{
+    int            reg  = IREG_GET_REG(ir_reg.reg);
+    reg_version_t *regv = &reg_version[reg][ir_reg.version];
+
+    regv->refcount--;
+    if (!regv->refcount && (reg >= IREG_temp0) && !(regv->flags & (REG_FLAGS_REQUIRED | REG_FLAGS_DEAD)))
+        add_to_dead_list(regv, reg, ir_reg.version);
+}
+
+static int
+ir_uop_is(uop_t *uop, uint32_t type)
+{
+    return (uop->type & UOP_MASK) == (type & UOP_MASK);
+}
+
+/*Turn uOPs whose source register versions are known constants into their
+  immediate forms, and fold those whose result is then constant into a
+  UOP_MOV_IMM. Register to register moves of constants become UOP_MOV_IMM,
+  which the backend can store straight to memory if the value is not read
+  again. Only straight line code is considered; the known values are dropped
+  at barriers, which may change any emulated register, and at jump
+  destinations*/
+static void
+codegen_ir_fold_constants(ir_data_t *ir)
+{
+    memset(ir_const_valid, 0, sizeof(ir_const_valid));
+
+    for (int c = 0; c < ir->wr_pos; c++) {
+        uop_t   *uop = &ir->uops[c];
+        uint32_t val_a;
+        uint32_t val_b;
+
+        if ((uop->type & UOP_TYPE_BARRIER) || ir_jump_dest[c])
+            memset(ir_const_valid, 0, sizeof(ir_const_valid));
+
+        if (((uop->type & UOP_MASK) == UOP_INVALID) || ir_reg_is_invalid(uop->dest_reg_a))
+            continue;
+
+        if (ir_reg_is_const_size(uop->dest_reg_a)) {
+            if (ir_uop_is(uop, UOP_MOV) && ir_const_get(uop->src_reg_a, &val_a)) {
+                ir_const_drop_read(uop->src_reg_a);
+                uop->type      = UOP_MOV_IMM;
+                uop->src_reg_a = invalid_ir_reg;
+                uop->imm_data  = val_a;
+            } else if (ir_uop_is(uop, UOP_ADD) || ir_uop_is(uop, UOP_SUB) || ir_uop_is(uop, UOP_AND) ||
+                       ir_uop_is(uop, UOP_OR) || ir_uop_is(uop, UOP_XOR)) {
+                int commutative = !ir_uop_is(uop, UOP_SUB);
+
+                if (!ir_reg_is_const_size(uop->src_reg_a) || !ir_reg_is_const_size(uop->src_reg_b))
+                    goto record;
+
+                /*The backends expect the immediate forms to operate in place*/
+                if (ir_const_get(uop->src_reg_b, &val_b) && (IREG_GET_REG(uop->src_reg_a.reg) == IREG_GET_REG(uop->dest_reg_a.reg))) {
+                    ir_const_drop_read(uop->src_reg_b);
+                    uop->src_reg_b = invalid_ir_reg;
+                } else if (commutative && ir_const_get(uop->src_reg_a, &val_b) && (IREG_GET_REG(uop->src_reg_b.reg) == IREG_GET_REG(uop->dest_reg_a.reg))) {
+                    ir_const_drop_read(uop->src_reg_a);
+                    uop->src_reg_a = uop->src_reg_b;
+                    uop->src_reg_b = invalid_ir_reg;
+                } else
+                    goto record;
+
+                uop->imm_data = val_b;
+                if (ir_uop_is(uop, UOP_ADD))
+                    uop->type = UOP_ADD_IMM;
+                else if (ir_uop_is(uop, UOP_SUB))
+                    uop->type = UOP_SUB_IMM;
+                else if (ir_uop_is(uop, UOP_AND))
+                    uop->type = UOP_AND_IMM;
+                else if (ir_uop_is(uop, UOP_OR))
+                    uop->type = UOP_OR_IMM;
+                else
+                    uop->type = UOP_XOR_IMM;
+            }
+
+            if ((ir_uop_is(uop, UOP_ADD_IMM) || ir_uop_is(uop, UOP_SUB_IMM) || ir_uop_is(uop, UOP_AND_IMM) ||
+                 ir_uop_is(uop, UOP_OR_IMM) || ir_uop_is(uop, UOP_XOR_IMM)) &&
+                ir_const_get(uop->src_reg_a, &val_a)) {
+                val_b = (uint32_t) uop->imm_data;
+
+                if (ir_uop_is(uop, UOP_ADD_IMM))
+                    val_a += val_b;
+                else if (ir_uop_is(uop, UOP_SUB_IMM))
+                    val_a -= val_b;
+                else if (ir_uop_is(uop, UOP_AND_IMM))
+                    val_a &= val_b;
+                else if (ir_uop_is(uop, UOP_OR_IMM))
+                    val_a |= val_b;
+                else
+                    val_a ^= val_b;
+
+                ir_const_drop_read(uop->src_reg_a);
+                uop->type      = UOP_MOV_IMM;
+                uop->src_reg_a = invalid_ir_reg;
+                uop->imm_data  = val_a;
+            }
+        }
+
+record:
+        if (ir_uop_is(uop, UOP_MOV_IMM) && ir_reg_is_const_size(uop->dest_reg_a)) {
+            ir_const_valid[IREG_GET_REG(uop->dest_reg_a.reg)]   = 1;
+            ir_const_version[IREG_GET_REG(uop->dest_reg_a.reg)] = uop->dest_reg_a.version;
+            ir_const_value[IREG_GET_REG(uop->dest_reg_a.reg)]   = (uint32_t) uop->imm_data;
+        } else
+            ir_const_valid[IREG_GET_REG(uop->dest_reg_a.reg)] = 0;
+    }
+}
+
+/*Whether the lazy flags state described by this flags_op value leaves
+  flags_op1 and flags_op2 unused*/
+static int
+ir_flags_op_ignores_operands(uint32_t flags_op)
+{
+    return (flags_op == FLAGS_UNKNOWN) || (flags_op == FLAGS_ZN8) || (flags_op == FLAGS_ZN16) || (flags_op == FLAGS_ZN32);
+}
+
+/*flags_op1 and flags_op2 only mean anything for the flags_op value they were
+  written with. The last versions of them before a barrier or the end of the
+  block are required to be written back, but when flags_op has been set to an
+  operation that does not use them by then (eg an ADD followed by an AND),
+  nothing can read them, and if they are not read within the block either
+  they and the uOPs computing them can be dropped*/
+static void
+codegen_ir_drop_dead_flag_operands(ir_data_t *ir)
+{
+    static uint8_t needed[2][256];
+    int            op_version[2] = { -1, -1 };
+    int            flags_op_version = -1;
+    int            c;
+
+    memset(needed, 0, sizeof(needed));
+
+    for (c = 0; c <= ir->wr_pos; c++) {
+        uop_t *uop = (c < ir->wr_pos) ? &ir->uops[c] : NULL;
+
+        /*Barriers, jumps and the end of the block expose the current state*/
+        if (!uop || (uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER | UOP_TYPE_JUMP)) || ir_jump_dest[c]) {
+            int ignored = 0;
+
+            if (flags_op_version > 0) {
+                uop_t *flags_uop = &ir->uops[reg_version[IREG_flags_op][flags_op_version].parent_uop];
+
+                ignored = ir_uop_is(flags_uop, UOP_MOV_IMM) && ir_flags_op_ignores_operands((uint32_t) flags_uop->imm_data);
+            }
+
+            for (int op = 0; op < 2; op++) {
+                if (!ignored && (op_version[op] > 0))
+                    needed[op][op_version[op]] = 1;
+            }
+        }
+
+        if (!uop || ((uop->type & UOP_MASK) == UOP_INVALID) || ir_reg_is_invalid(uop->dest_reg_a))
+            continue;
+
+        switch (IREG_GET_REG(uop->dest_reg_a.reg)) {
+            case IREG_flags_op:
+                flags_op_version = uop->dest_reg_a.version;
+                break;
+            case IREG_flags_op1:
+                /*A partial write merges with the previous version*/
+                if (!reg_is_native_size(uop->dest_reg_a) && (op_version[0] > 0))
+                    needed[0][op_version[0]] = 1;
+                op_version[0] = uop->dest_reg_a.version;
+                break;
+            case IREG_flags_op2:
+                if (!reg_is_native_size(uop->dest_reg_a) && (op_version[1] > 0))
+                    needed[1][op_version[1]] = 1;
+                op_version[1] = uop->dest_reg_a.version;
+                break;
+            default:
+                break;
+        }
+    }
+
+    for (int op = 0; op < 2; op++) {
+        int reg = op ? IREG_flags_op2 : IREG_flags_op1;
+
+        for (c = 1; c <= reg_last_version[reg]; c++) {
+            reg_version_t *regv = &reg_version[reg][c];
+            uop_t         *uop  = &ir->uops[regv->parent_uop];
+
+            /*Versions that are not required are already on the dead list if
+              they are not read*/
+            if (needed[op][c] || regv->refcount || !(regv->flags & REG_FLAGS_REQUIRED) || (regv->flags & REG_FLAGS_DEAD))
+                continue;
+            if ((uop->type & (UOP_TYPE_BARRIER | UOP_TYPE_ORDER_BARRIER)) || !reg_is_native_size(uop->dest_reg_a))
+                continue;
+
+            regv->flags &= ~REG_FLAGS_REQUIRED;
+            add_to_dead_list(regv, reg, c);
+        }
+    }
+}
+
 void
 codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
 {
@@ -85,6 +330,9 @@ codegen_ir_compile(ir_data_t *ir, codeblock_t *block)
     }
 
     codegen_reg_mark_as_required();
+    ir_find_jump_dests(ir);
+    codegen_ir_fold_constants(ir);
+    codegen_ir_drop_dead_flag_operands(ir);
     codegen_reg_process_dead_list(ir);
     block_write_data = codeblock_allocator_get_ptr(block->head_mem_block);
     block_pos        = 0;
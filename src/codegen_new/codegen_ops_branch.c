@@ -110,7 +110,7 @@ static int
 ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (CF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = (CF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -120,21 +120,21 @@ ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
             return 0;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
 
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
 
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -143,48 +143,50 @@ ropJB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, CF_SET);
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, take_branch ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    return take_branch ? 1 : 0;
 }
 static int
 ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (!CF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = (!CF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Carry is always zero*/
+            if (take_branch)
+                return 1;
             uop_MOV_IMM(ir, IREG_pc, dest_addr);
             uop_JMP(ir, codegen_exit_rout);
             return 0;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
 
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
 
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JB_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -193,16 +195,16 @@ ropJNB_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, CF_SET);
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, take_branch ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    return take_branch ? 1 : 0;
 }
 
 static int
@@ -210,7 +212,7 @@ ropJE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
 {
     int jump_uop;
 
-    if (ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr)) {
+    if (ZF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr)) {
         if (!codegen_flags_changed || !flags_res_valid()) {
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
@@ -239,7 +241,7 @@ ropJNE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
 
-    if (!ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr)) {
+    if (!ZF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr)) {
         if (!codegen_flags_changed || !flags_res_valid()) {
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
             jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
@@ -269,33 +271,33 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((CF_SET() || ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = ((CF_SET() || ZF_SET()) && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Carry is always zero, so test zero only*/
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
             else
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
             break;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -303,7 +305,7 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (take_branch) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, CF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
@@ -316,7 +318,7 @@ ropJBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             }
             break;
     }
-    if (do_unroll) {
+    if (take_branch) {
         uop_MOV_IMM(ir, IREG_pc, next_pc);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
@@ -337,33 +339,33 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((!CF_SET() && !ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = ((!CF_SET() && !ZF_SET()) && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
         case FLAGS_ZN16:
         case FLAGS_ZN32:
             /*Carry is always zero, so test zero only*/
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_flags_res, 0);
             else
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_flags_res, 0);
             break;
 
         case FLAGS_SUB8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JBE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -371,7 +373,7 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (take_branch) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, CF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
@@ -384,7 +386,7 @@ ropJNBE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
             }
             break;
     }
-    if (do_unroll) {
+    if (take_branch) {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
         uop_MOV_IMM(ir, IREG_pc, next_pc);
@@ -405,7 +407,7 @@ static int
 ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (NF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = (NF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -416,7 +418,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_SAR8:
         case FLAGS_INC8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
@@ -430,7 +432,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_SAR16:
         case FLAGS_INC16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
@@ -444,7 +446,7 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_SAR32:
         case FLAGS_INC32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
@@ -453,22 +455,22 @@ ropJS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET);
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, take_branch ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    return take_branch ? 1 : 0;
 }
 static int
 ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = (!NF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = (!NF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
@@ -479,7 +481,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_SAR8:
         case FLAGS_INC8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
@@ -493,7 +495,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_SAR16:
         case FLAGS_INC16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
@@ -507,7 +509,7 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_SAR32:
         case FLAGS_INC32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
@@ -516,16 +518,16 @@ ropJNS_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         case FLAGS_UNKNOWN:
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET);
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_IMM_JZ_DEST(ir, IREG_temp0, 0);
             else
                 jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
             break;
     }
-    uop_MOV_IMM(ir, IREG_pc, do_unroll ? next_pc : dest_addr);
+    uop_MOV_IMM(ir, IREG_pc, take_branch ? next_pc : dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    return take_branch ? 1 : 0;
 }
 
 static int
@@ -557,24 +559,24 @@ static int
 ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = ((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = ((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
             /*V flag is always clear. Condition is true if N is set*/
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
             break;
         case FLAGS_ZN16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
             break;
         case FLAGS_ZN32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
@@ -582,21 +584,21 @@ ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
 
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -606,42 +608,42 @@ ropJL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t nex
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
             uop_CALL_FUNC_RESULT(ir, IREG_temp1, VF_SET_01);
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNZ_DEST(ir, IREG_temp0, IREG_temp1);
             else
                 jump_uop = uop_CMP_JZ_DEST(ir, IREG_temp0, IREG_temp1);
             break;
     }
-    if (do_unroll)
+    if (take_branch)
         uop_MOV_IMM(ir, IREG_pc, next_pc);
     else
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    return take_branch ? 1 : 0;
 }
 static int
 ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t next_pc)
 {
     int jump_uop;
-    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_ZN8:
             /*V flag is always clear. Condition is true if N is set*/
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_B);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_B);
             break;
         case FLAGS_ZN16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res_W);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res_W);
             break;
         case FLAGS_ZN32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_TEST_JNS_DEST(ir, IREG_flags_res);
             else
                 jump_uop = uop_TEST_JS_DEST(ir, IREG_flags_res);
@@ -649,21 +651,21 @@ ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JL_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -673,19 +675,19 @@ ropJNL_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
         default:
             uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
             uop_CALL_FUNC_RESULT(ir, IREG_temp1, VF_SET_01);
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JZ_DEST(ir, IREG_temp0, IREG_temp1);
             else
                 jump_uop = uop_CMP_JNZ_DEST(ir, IREG_temp0, IREG_temp1);
             break;
     }
-    if (do_unroll)
+    if (take_branch)
         uop_MOV_IMM(ir, IREG_pc, next_pc);
     else
         uop_MOV_IMM(ir, IREG_pc, dest_addr);
     uop_JMP(ir, codegen_exit_rout);
     uop_set_jump_dest(ir, jump_uop);
-    return do_unroll ? 1 : 0;
+    return take_branch ? 1 : 0;
 }
 
 static int
@@ -693,26 +695,26 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = (((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) || ZF_SET()) && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = (((NF_SET() ? 1 : 0) != (VF_SET() ? 1 : 0) || ZF_SET()) && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -720,7 +722,7 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (take_branch) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
@@ -735,7 +737,7 @@ ropJLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t ne
             }
             break;
     }
-    if (do_unroll) {
+    if (take_branch) {
         uop_MOV_IMM(ir, IREG_pc, next_pc);
         uop_JMP(ir, codegen_exit_rout);
         uop_set_jump_dest(ir, jump_uop);
@@ -756,26 +758,26 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 {
     int jump_uop;
     int jump_uop2 = -1;
-    int do_unroll = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && !ZF_SET() && codegen_can_unroll(block, ir, next_pc, dest_addr));
+    int take_branch = ((NF_SET() ? 1 : 0) == (VF_SET() ? 1 : 0) && !ZF_SET() && codegen_can_take_branch(block, ir, next_pc, dest_addr));
 
     switch (codegen_flags_changed ? cpu_state.flags_op : FLAGS_UNKNOWN) {
         case FLAGS_SUB8:
         case FLAGS_DEC8:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             else
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_B, IREG_flags_op2_B);
             break;
         case FLAGS_SUB16:
         case FLAGS_DEC16:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             else
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1_W, IREG_flags_op2_W);
             break;
         case FLAGS_SUB32:
         case FLAGS_DEC32:
-            if (do_unroll)
+            if (take_branch)
                 jump_uop = uop_CMP_JNLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
             else
                 jump_uop = uop_CMP_JLE_DEST(ir, IREG_flags_op1, IREG_flags_op2);
@@ -783,7 +785,7 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
 
         case FLAGS_UNKNOWN:
         default:
-            if (do_unroll) {
+            if (take_branch) {
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, ZF_SET);
                 jump_uop2 = uop_CMP_IMM_JNZ_DEST(ir, IREG_temp0, 0);
                 uop_CALL_FUNC_RESULT(ir, IREG_temp0, NF_SET_01);
@@ -798,7 +800,7 @@ ropJNLE_common(codeblock_t *block, ir_data_t *ir, uint32_t dest_addr, uint32_t n
             }
             break;
     }
-    if (do_unroll) {
+    if (take_branch) {
         if (jump_uop2 != -1)
             uop_set_jump_dest(ir, jump_uop2);
         uop_MOV_IMM(ir, IREG_pc, next_pc);
@@ -919,7 +921,7 @@ ropLOOP(codeblock_t *block, ir_data_t *ir, UNUSED(uint8_t opcode), UNUSED(uint32
     if (!(op_32 & 0x100))
         dest_addr &= 0xffff;
 
-    if (((op_32 & 0x200) ? ECX : CX) != 1 && codegen_can_unroll(block, ir, op_pc + 1, dest_addr)) {
+    if (((op_32 & 0x200) ? ECX : CX) != 1 && codegen_can_take_branch(block, ir, op_pc + 1, dest_addr)) {
         if (op_32 & 0x200) {
             uop_SUB_IMM(ir, IREG_ECX, IREG_ECX, 1);
             jump_uop = uop_CMP_IMM_JNZ_DEST(ir, IREG_ECX, 0);
@@ -929,7 +931,8 @@ ropLOOP(codeblock_t *block, ir_data_t *ir, UNUSED(uint8_t opcode), UNUSED(uint32
         }
         uop_MOV_IMM(ir, IREG_pc, op_pc + 1);
         ret_addr = dest_addr;
-        CPU_BLOCK_END();
+        if (!codegen_branch_followed)
+            CPU_BLOCK_END();
     } else {
         if (op_32 & 0x200) {
             uop_SUB_IMM(ir, IREG_ECX, IREG_ECX, 1);
@@ -125,3 +125,13 @@ codegen_can_unroll(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t
 
     return codegen_can_unroll_full(block, ir, next_pc, dest_addr);
 }
+
+int codegen_can_follow_branch(codeblock_t *block, uint32_t dest_addr);
+/*Whether compilation will carry on at the target of a taken branch, either
+  as an unrolled loop or as a followed hot exit. If so the not taken path
+  must be compiled as the side exit*/
+static inline int
+codegen_can_take_branch(codeblock_t *block, ir_data_t *ir, uint32_t next_pc, uint32_t dest_addr)
+{
+    return codegen_can_unroll(block, ir, next_pc, dest_addr) || codegen_can_follow_branch(block, dest_addr);
+}
@@ -25,6 +25,8 @@ ropJMP_r8(codeblock_t *block, ir_data_t *ir, UNUSED(uint8_t opcode), UNUSED(uint
 
     if (offset < 0)
         codegen_can_unroll(block, ir, op_pc + 1, dest_addr);
+    else
+        codegen_can_follow_branch(block, dest_addr);
     codegen_mark_code_present(block, cs + op_pc, 1);
     return dest_addr;
 }
@@ -38,6 +40,8 @@ ropJMP_r16(codeblock_t *block, ir_data_t *ir, UNUSED(uint8_t opcode), UNUSED(uin
 
     if (offset < 0)
         codegen_can_unroll(block, ir, op_pc + 1, dest_addr);
+    else
+        codegen_can_follow_branch(block, dest_addr);
     codegen_mark_code_present(block, cs + op_pc, 2);
     return dest_addr;
 }
@@ -49,6 +53,8 @@ ropJMP_r32(codeblock_t *block, ir_data_t *ir, UNUSED(uint8_t opcode), UNUSED(uin
 
     if (offset < 0)
         codegen_can_unroll(block, ir, op_pc + 1, dest_addr);
+    else
+        codegen_can_follow_branch(block, dest_addr);
     codegen_mark_code_present(block, cs + op_pc, 4);
     return dest_addr;
 }
@@ -410,6 +410,7 @@ load_machine(void)
 
     cpu_override             = ini_section_get_int(cat, "cpu_override", 0);
     cpu_override_interpreter = ini_section_get_int(cat, "cpu_override_interpreter", 0);
+    cpu_808x_fast            = !!ini_section_get_int(cat, "cpu_808x_fast", 0);
     cpu_f                    = NULL;
     p                        = ini_section_get_string(cat, "cpu_family", NULL);
     if (p) {
@@ -482,6 +483,7 @@ load_machine(void)
         mem_size = machine_get_max_ram(machine);
 
     cpu_use_dynarec = !!ini_section_get_int(cat, "cpu_use_dynarec", 0);
+    cpu_dynarec_cache = !!ini_section_get_int(cat, "cpu_dynarec_cache", 0);
     fpu_softfloat = !!ini_section_get_int(cat, "fpu_softfloat", 0);
     if ((fpu_type != FPU_NONE) && machine_has_flags(machine, MACHINE_SOFTFLOAT_ONLY))
         fpu_softfloat = 1;
@@ -546,6 +548,7 @@ load_video(void)
     xga_standalone_enabled           = !!ini_section_get_int(cat, "xga", 0);
     xga_active                       = xga_standalone_enabled;
     da2_standalone_enabled           = !!ini_section_get_int(cat, "da2", 0);
+    video_deferred_render            = !!ini_section_get_int(cat, "deferred_render", 0);
     show_second_monitors             = !!ini_section_get_int(cat, "show_second_monitors", 1);
     video_fullscreen_scale_maximized = !!ini_section_get_int(cat, "video_fullscreen_scale_maximized", 0);
 
@@ -1327,6 +1330,16 @@ load_hard_disks(void)
         p = ini_section_get_string(cat, temp, "none");
         hdd[c].audio_profile = hdd_audio_get_profile_by_internal_name(p);
 
+        /* Image write cache mode */
+        sprintf(temp, "hdd_%02i_cache_mode", c + 1);
+        p = ini_section_get_string(cat, temp, "writethrough");
+        if (!strcmp(p, "writeback"))
+            hdd[c].cache_mode = HDD_CACHE_WRITE_BACK;
+        else if (!strcmp(p, "mmap"))
+            hdd[c].cache_mode = HDD_CACHE_MMAP;
+        else
+            hdd[c].cache_mode = HDD_CACHE_WRITE_THROUGH;
+
         /* MFM/RLL */
         sprintf(temp, "hdd_%02i_mfm_channel", c + 1);
         if (hdd[c].bus_type == HDD_BUS_MFM)
@@ -1418,6 +1431,10 @@ load_hard_disks(void)
         p = ini_section_get_string(cat, temp, "");
         strncpy(hdd[c].vhd_parent, p, sizeof(hdd[c].vhd_parent) - 1);
 
+        sprintf(temp, "hdd_%02i_overlay", c + 1);
+        p = ini_section_get_string(cat, temp, "");
+        strncpy(hdd[c].overlay, p, sizeof(hdd[c].overlay) - 1);
+
         /* If disk is empty or invalid, mark it for deletion. */
         if (!hdd_is_valid(c)) {
             sprintf(temp, "hdd_%02i_parameters", c + 1);
@@ -1440,6 +1457,12 @@ load_hard_disks(void)
 
             sprintf(temp, "hdd_%02i_fn", c + 1);
             ini_section_delete_var(cat, temp);
+
+            sprintf(temp, "hdd_%02i_cache_mode", c + 1);
+            ini_section_delete_var(cat, temp);
+
+            sprintf(temp, "hdd_%02i_overlay", c + 1);
+            ini_section_delete_var(cat, temp);
         }
     }
 }
@@ -2229,6 +2252,7 @@ config_load(void)
         force_constant_mouse = 0;
 
         cpu_override_interpreter = 0;
+        cpu_808x_fast            = 0;
 
         fpu_type               = fpu_get_type(cpu_f, cpu, "none");
         gfxcard[0]             = video_get_video_from_internal_name("cga");
@@ -2641,6 +2665,10 @@ save_machine(void)
         ini_section_set_int(cat, "cpu_override_interpreter", cpu_override_interpreter);
     else
         ini_section_delete_var(cat, "cpu_override_interpreter");
+    if (cpu_808x_fast)
+        ini_section_set_int(cat, "cpu_808x_fast", cpu_808x_fast);
+    else
+        ini_section_delete_var(cat, "cpu_808x_fast");
 
     /* Downgrade compatibility with the previous CPU model system. */
     ini_section_delete_var(cat, "cpu_manufacturer");
@@ -2662,6 +2690,11 @@ save_machine(void)
 
     ini_section_set_int(cat, "cpu_use_dynarec", cpu_use_dynarec);
 
+    if (cpu_dynarec_cache == 0)
+        ini_section_delete_var(cat, "cpu_dynarec_cache");
+    else
+        ini_section_set_int(cat, "cpu_dynarec_cache", cpu_dynarec_cache);
+
     if (fpu_softfloat == 0)
         ini_section_delete_var(cat, "fpu_softfloat");
     else
@@ -2747,6 +2780,11 @@ save_video(void)
     else
         ini_section_set_int(cat, "da2", da2_standalone_enabled);
 
+    if (video_deferred_render == 0)
+        ini_section_delete_var(cat, "deferred_render");
+    else
+        ini_section_set_int(cat, "deferred_render", video_deferred_render);
+
     // TODO
     for (uint8_t i = 1; i < GFXCARD_MAX; i ++) {
         if (gfxcard[i] == 0)
@@ -3459,6 +3497,13 @@ save_hard_disks(void)
         } else
             ini_section_delete_var(cat, temp);
 
+        sprintf(temp, "hdd_%02i_overlay", c + 1);
+        if (hdd_is_valid(c) && hdd[c].overlay[0]) {
+            path_normalize(hdd[c].overlay);
+            ini_section_set_string(cat, temp, hdd[c].overlay);
+        } else
+            ini_section_delete_var(cat, temp);
+
         sprintf(temp, "hdd_%02i_speed", c + 1);
         if (!hdd_is_valid(c) ||
             ((hdd[c].bus_type != HDD_BUS_ESDI) && (hdd[c].bus_type != HDD_BUS_IDE) &&
@@ -3477,6 +3522,14 @@ save_hard_disks(void)
             else
                 ini_section_delete_var(cat, temp);
         }
+
+        sprintf(temp, "hdd_%02i_cache_mode", c + 1);
+        if (hdd_is_valid(c) && (hdd[c].cache_mode == HDD_CACHE_WRITE_BACK))
+            ini_section_set_string(cat, temp, "writeback");
+        else if (hdd_is_valid(c) && (hdd[c].cache_mode == HDD_CACHE_MMAP))
+            ini_section_set_string(cat, temp, "mmap");
+        else
+            ini_section_delete_var(cat, temp);
     }
 
     ini_delete_section_if_empty(config, cat);
@@ -221,6 +221,106 @@ fetch_ea_16_long(uint32_t rmdat)
 
 #include "386_ops.h"
 
+/*Decoded instruction cache for the 2386 interpreter. An instruction fetch here
+  goes through the page walk and the memory mapping every time, so the fetched
+  bytes, the instruction length and the handler are kept per linear address,
+  along with a host pointer to the code. An entry is dropped on every MMU cache
+  flush (paging changes, INVLPG, memory mapping changes, A20) and is checked
+  against the bytes in memory on every use, which takes care of self modifying
+  code and bus master writes. Prefixes still fetch the rest of the instruction
+  through the normal path.*/
+#define DECODE_CACHE_SIZE 4096
+#define DECODE_CACHE_MASK (DECODE_CACHE_SIZE - 1)
+
+typedef struct decode_entry_t {
+    uint32_t lin;
+    uint32_t gen;
+    uint8_t *ptr;
+    uint32_t fetchdat;
+    uint32_t mask;
+    OpFn     op;
+    uint16_t op32;
+    uint8_t  ol;
+    uint8_t  user;
+    uint8_t  misaligned;
+} decode_entry_t;
+
+static decode_entry_t decode_cache[DECODE_CACHE_SIZE];
+
+static __inline int
+decode_cache_usable(void)
+{
+#ifdef USE_GDBSTUB
+    return 0;
+#else
+    /* Pending paging changes and data breakpoints both need the real fetch. */
+    return !cpu_flush_pending && !(dr[7] & 0x000000ff);
+#endif
+}
+
+static __inline decode_entry_t *
+decode_cache_lookup(uint32_t addr)
+{
+    decode_entry_t *entry = &decode_cache[(addr ^ (addr >> 12)) & DECODE_CACHE_MASK];
+
+    if ((entry->lin != addr) || (entry->gen != decode_cache_gen) || (entry->op32 != cpu_state.op32) ||
+        (entry->user != (CPL == 3)) || !decode_cache_usable() || ((AS_U32(*entry->ptr) & entry->mask) != entry->fetchdat))
+        return NULL;
+
+    /* Charge the misaligned fetches the real read would have. */
+    if (entry->misaligned)
+        cycles -= entry->misaligned * timing_misaligned;
+
+    return entry;
+}
+
+static int
+decode_cache_misaligned(uint32_t addr, int width)
+{
+    if (width == 2)
+        return (addr & 1) && (!cpu_cyrix_alignment || ((addr & 7) == 7));
+
+    return (addr & 3) && (!cpu_cyrix_alignment || ((addr & 7) > 4));
+}
+
+static decode_entry_t *
+decode_cache_add(uint32_t addr, uint32_t fetch, int ol)
+{
+    decode_entry_t *entry;
+    uint8_t        *ptr;
+    uint32_t        mask = 0xffffffff;
+
+    if (((addr & 0xfff) > 0xffc) || !decode_cache_usable())
+        return NULL;
+
+    /* Over a 16-bit bus, the upper word is only fetched if the opcode needs it. */
+    if (cpu_16bitbus && (opcode_length[fetch & 0xff] <= 2))
+        mask = 0x0000ffff;
+
+    ptr = mem_fetch_ptr_2386(addr);
+    if (!ptr || ((AS_U32(*ptr) & mask) != fetch))
+        return NULL;
+
+    entry = &decode_cache[(addr ^ (addr >> 12)) & DECODE_CACHE_MASK];
+
+    entry->lin      = addr;
+    entry->gen      = decode_cache_gen;
+    entry->ptr      = ptr;
+    entry->fetchdat = fetch;
+    entry->mask     = mask;
+    entry->op       = x86_2386_opcodes[((fetch & 0xff) | cpu_state.op32) & 0x3ff];
+    entry->ol       = ol;
+    entry->op32     = cpu_state.op32;
+    entry->user     = (CPL == 3);
+
+    if (cpu_16bitbus)
+        entry->misaligned = decode_cache_misaligned(addr, 2) + ((mask == 0xffffffff) && decode_cache_misaligned(addr + 2, 2));
+    else
+        entry->misaligned = decode_cache_misaligned(addr, 4);
+
+    return entry;
+}
+
 void
 exec386_2386(int32_t cycs)
 {
@@ -243,7 +343,8 @@ exec386_2386(int32_t cycs)
         cycdiff       = 0;
         oldcyc        = cycles;
         while (cycdiff < cycle_period) {
-            int ins_fetch_fault = 0;
+            int             ins_fetch_fault = 0;
+            decode_entry_t *dentry;
             ins_cycles = cycles;
 
 #ifndef USE_NEW_DYNAREC
@@ -260,10 +361,19 @@ exec386_2386(int32_t cycs)
             cpu_state.ea_seg = &cpu_state.seg_ds;
             cpu_state.ssegs  = 0;
 
-            fetchdat = fastreadl_fetch(cs + cpu_state.pc);
-            ol = opcode_length[fetchdat & 0xff];
-            if ((ol == 3) && opcode_has_modrm[fetchdat & 0xff] && (((fetchdat >> 14) & 0x03) == 0x03))
-                ol = 2;
+            dentry = decode_cache_lookup(cs + cpu_state.pc);
+            if (dentry) {
+                fetchdat = dentry->fetchdat;
+                ol       = dentry->ol;
+            } else {
+                fetchdat = fastreadl_fetch(cs + cpu_state.pc);
+                ol = opcode_length[fetchdat & 0xff];
+                if ((ol == 3) && opcode_has_modrm[fetchdat & 0xff] && (((fetchdat >> 14) & 0x03) == 0x03))
+                    ol = 2;
+
+                if (!cpu_state.abrt)
+                    dentry = decode_cache_add(cs + cpu_state.pc, fetchdat, ol);
+            }
 
             if (is386)
                 ins_fetch_fault = cpu_386_check_instruction_fault();
@@ -292,8 +402,12 @@ exec386_2386(int32_t cycs)
                 cpu_state.pc++;
                 if (opcode == 0xf0)
                     in_lock = 1;
-                x86_2386_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                if (dentry)
+                    dentry->op(fetchdat);
+                else
+                    x86_2386_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
                 in_lock = 0;
+                CPU_COUNT_INSTRS(1);
                 if (x86_was_reset)
                     break;
             }
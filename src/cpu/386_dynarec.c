@@ -243,6 +243,88 @@ static uint64_t tsc_old     = 0;
 int32_t acycs = 0;
 #    endif
 
+#    ifdef USE_NEW_DYNAREC
+extern int mmuflush;
+
+/* The last block run, if it ended with nothing pending and with its successor
+   in the same page but not linked to it yet; the block found for that
+   successor by the next lookup is linked to it. */
+static uint16_t link_from    = BLOCK_INVALID;
+static uint32_t link_from_pc = BLOCK_PC_INVALID;
+static uint32_t link_to_pc   = BLOCK_PC_INVALID;
+
+/* Whether the next block can be run right away; anything that the loop in
+   exec386_dynarec() has to handle between two blocks stops the chain. */
+static __inline int
+dynarec_can_chain(int mmuflush_start)
+{
+#        ifdef USE_GDBSTUB
+    return 0;
+#        else
+    if ((cycles <= 0) || cpu_state.abrt || cpu_init || new_ne || trap || smi_line || cpu_end_block_after_ins)
+        return 0;
+    if ((nmi && nmi_enable && nmi_mask) || ((cpu_state.flags & I_FLAG) && pic.int_pending) || (cpu_state.flags & T_FLAG))
+        return 0;
+    if (cpu_force_interpreter || cpu_override_dynarec || !CACHE_ON())
+        return 0;
+
+    /* No change to the address translation, no interim timer processing,
+       and no timer due by the end of the block that just ran. */
+    return (mmuflush == mmuflush_start) && (tsc == tsc_old) &&
+           !TIMER_VAL_LESS_THAN_VAL(timer_target, tsc + (uint64_t) (cycles_old - cycles));
+#        endif
+}
+
+/* Find a compiled block linked from the given one that can run at the current
+   CS:EIP, applying the same checks as the lookup in exec386_dynarec_dyn(). As
+   it is in the same linear page as the block that just ran, and the address
+   translation has not changed, its physical address is known without walking
+   the page tables. */
+static __inline codeblock_t *
+dynarec_linked_block(codeblock_t *block)
+{
+    uint32_t pc   = cs + cpu_state.pc;
+    uint32_t phys = (block->phys & ~0xfff) | (pc & 0xfff);
+
+    for (uint8_t c = 0; c < 2; c++) {
+        codeblock_t *next = &codeblock[block->link[c]];
+
+        if (!block->link[c] || (next->pc != pc) || (next->_cs != cs) || (next->phys != phys))
+            continue;
+        if (((next->status ^ cpu_cur_status) & CPU_STATUS_FLAGS) || ((next->status & cpu_cur_status & CPU_STATUS_MASK) != (cpu_cur_status & CPU_STATUS_MASK)))
+            continue;
+        if (((next->flags & (CODEBLOCK_WAS_RECOMPILED | CODEBLOCK_IN_DIRTY_LIST)) != CODEBLOCK_WAS_RECOMPILED) || next->page_mask2 || (next->page_mask & *next->dirty_mask))
+            continue;
+        if ((next->flags & CODEBLOCK_STATIC_TOP) && (next->TOP != (cpu_state.TOP & 7)))
+            continue;
+
+        return next;
+    }
+
+    return NULL;
+}
+
+/* Note where a compiled block has left to. Once it has been leaving to the
+   same place further on in its page every time for a while, have it
+   recompiled to carry on there. */
+static __inline void
+dynarec_profile_exit(codeblock_t *block)
+{
+    uint32_t pc = cs + cpu_state.pc;
+
+    if (cpu_state.abrt || (block->flags & CODEBLOCK_BYTE_MASK) || block->page_mask2 || (block->nr_trace >= CODEBLOCK_MAX_TRACE))
+        return;
+    if ((pc <= block->pc) || ((pc ^ block->pc) & ~0xfff))
+        return;
+
+    if (pc != block->exit_pc) {
+        block->exit_pc    = pc;
+        block->exit_count = 0;
+    } else if (++block->exit_count == CODEBLOCK_TRACE_HOT)
+        codegen_block_add_trace(block, pc);
+}
+#    endif
+
 int
 codegen_mmx_enter(void)
 {
@@ -329,6 +411,7 @@ exec386_dynarec_int(void)
             cpu_state.eflags &= ~(RF_FLAG);
 #    endif
             x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+            CPU_COUNT_INSTRS(1);
         }
 
 #    ifndef USE_NEW_DYNAREC
@@ -403,6 +486,11 @@ exec386_dynarec_dyn(void)
     codeblock_t *block = codeblock_hash[hash];
 #    endif
     int valid_block = 0;
+#    ifdef USE_NEW_DYNAREC
+    uint16_t from = link_from;
+
+    link_from = BLOCK_INVALID;
+#    endif
 
 #    ifdef USE_NEW_DYNAREC
     if (!cpu_state.abrt)
@@ -513,6 +601,17 @@ exec386_dynarec_dyn(void)
     }
 
 #    ifdef USE_NEW_DYNAREC
+    if (!valid_block && !cpu_state.abrt) {
+        /* Compiled in an earlier session and still the same code; compile
+           it right away rather than interpreting it once first. */
+        codeblock_t *cached = codegen_cache_block_init(phys_addr);
+
+        if (cached) {
+            block       = cached;
+            valid_block = 1;
+        }
+    }
+
     if (valid_block && (block->flags & CODEBLOCK_WAS_RECOMPILED))
 #    else
     if (valid_block && block->was_recompiled)
@@ -522,7 +621,15 @@ exec386_dynarec_dyn(void)
 
 #    ifndef USE_NEW_DYNAREC
         codeblock_hash[hash] = block;
+#    else
+        int mmuflush_start = mmuflush;
+
+        if ((from != BLOCK_INVALID) && (codeblock[from].pc == link_from_pc) && (block->pc == link_to_pc) &&
+            !(codeblock[from].flags & CODEBLOCK_IN_DIRTY_LIST) && !block->page_mask2)
+            codegen_block_link(&codeblock[from], block);
+        block->flags |= CODEBLOCK_ACCESSED;
 #    endif
+        CPU_COUNT_INSTRS(block->ins);
         inrecomp = 1;
         code();
 #    ifdef USE_ACYCS
@@ -533,11 +640,39 @@ exec386_dynarec_dyn(void)
 #    ifndef USE_NEW_DYNAREC
         if (!use32)
             cpu_state.pc &= 0xffff;
+#    else
+        dynarec_profile_exit(block);
+
+        /* Keep running blocks that follow each other within the page for as
+           long as there is nothing to service in between. */
+        while (dynarec_can_chain(mmuflush_start) && !(((cs + cpu_state.pc) ^ block->pc) & ~0xfff)) {
+            codeblock_t *next = dynarec_linked_block(block);
+
+            if (next == NULL) {
+                link_from    = get_block_nr(block);
+                link_from_pc = block->pc;
+                link_to_pc   = cs + cpu_state.pc;
+                break;
+            }
+
+            block = next;
+            block->flags |= CODEBLOCK_ACCESSED;
+            code = (void *) &block->data[BLOCK_START];
+            CPU_COUNT_INSTRS(block->ins);
+            inrecomp = 1;
+            code();
+#        ifdef USE_ACYCS
+            acycs = 0;
+#        endif
+            inrecomp = 0;
+            dynarec_profile_exit(block);
+        }
 #    endif
     } else if (valid_block && !cpu_state.abrt) {
 #    ifdef USE_NEW_DYNAREC
         start_pc                 = cs + cpu_state.pc;
         const int max_block_size = (block->flags & CODEBLOCK_BYTE_MASK) ? ((128 - 25) - (start_pc & 0x3f)) : 1000;
+        int       block_end;
 #    else
         start_pc = cpu_state.pc;
 #    endif
@@ -577,8 +712,21 @@ exec386_dynarec_dyn(void)
                 cpu_state.pc++;
 
                 codegen_generate_call(opcode, x86_opcodes[(opcode | cpu_state.op32) & 0x3ff], fetchdat, cpu_state.pc, cpu_state.pc - 1);
+#    ifdef USE_NEW_DYNAREC
+                block_end = cpu_block_end;
+#    endif
 
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                CPU_COUNT_INSTRS(1);
+#    ifdef USE_NEW_DYNAREC
+                /* The branch just taken was compiled to continue at its
+                   target, so undo the block end its handler asked for. Any
+                   end set by the code generator itself still stands. */
+                if (codegen_branch_followed) {
+                    codegen_branch_followed = 0;
+                    cpu_block_end           = block_end;
+                }
+#    endif
 
                 if (x86_was_reset)
                     break;
@@ -629,8 +777,10 @@ exec386_dynarec_dyn(void)
 
         cpu_end_block_after_ins = 0;
 
-        if ((!cpu_state.abrt || (cpu_state.abrt & ABRT_EXPECTED)) && !new_ne && !x86_was_reset)
+        if ((!cpu_state.abrt || (cpu_state.abrt & ABRT_EXPECTED)) && !new_ne && !x86_was_reset) {
             codegen_block_end_recompile(block);
+            CPU_COUNT_BLOCK();
+        }
 
         if (x86_was_reset)
             codegen_reset();
@@ -681,6 +831,7 @@ exec386_dynarec_dyn(void)
                 cpu_state.pc++;
 
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                CPU_COUNT_INSTRS(1);
 
                 if (x86_was_reset)
                     break;
@@ -952,6 +1103,7 @@ exec386(int32_t cycs)
                 cpu_state.eflags &= ~(RF_FLAG);
 #endif
                 x86_opcodes[(opcode | cpu_state.op32) & 0x3ff](fetchdat);
+                CPU_COUNT_INSTRS(1);
                 if (x86_was_reset)
                     break;
             }
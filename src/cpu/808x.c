@@ -515,6 +515,84 @@ writememq(uint32_t s, uint32_t a, uint64_t v)
     writememl(s, a + 4, v >> 32);
 }
 
+/* Fast mode: instructions are fetched straight from memory rather than through
+   the prefetch queue, and the bytes at each instruction address are kept so
+   they do not have to go through the memory mapping again. Entries are dropped
+   by writes to their RAM page and by memory mapping changes. */
+#define DECODE_SIZE  4096
+#define DECODE_MASK  (DECODE_SIZE - 1)
+#define DECODE_BYTES 8
+/* The 1 MB address space plus the HMA. */
+#define DECODE_PAGES 0x110
+
+typedef struct decode_808x_t {
+    uint32_t addr;
+    uint32_t gen;
+    uint32_t page_gen;
+    int      page;
+    uint8_t  bytes[DECODE_BYTES];
+} decode_808x_t;
+
+static decode_808x_t  decode_808x[DECODE_SIZE];
+static uint32_t       decode_page_gen[DECODE_PAGES];
+static decode_808x_t *decode_cur = NULL;
+
+static void
+decode_808x_write(uint32_t first, uint32_t last)
+{
+    if (last >= DECODE_PAGES)
+        last = DECODE_PAGES - 1;
+
+    for (; first <= last; first++)
+        decode_page_gen[first]++;
+}
+
+/* Finds or sets up the entry for the instruction at addr. Instructions that
+   may cross a page or wrap around IP are not cached. */
+static decode_808x_t *
+decode_808x_lookup(uint32_t addr)
+{
+    decode_808x_t *entry = &decode_808x[(addr ^ (addr >> 12)) & DECODE_MASK];
+    uint8_t       *p;
+    int            page;
+
+    if ((entry->addr == addr) && (entry->gen == decode_cache_gen) &&
+        ((entry->page < 0) || (entry->page_gen == decode_page_gen[entry->page])))
+        return entry;
+
+    if ((cpu_state.pc > (0x10000 - DECODE_BYTES)) || ((addr & 0xfff) > (0x1000 - DECODE_BYTES)))
+        return NULL;
+
+    p = mem_code_ptr(addr, &page);
+    if (!p || (page >= DECODE_PAGES))
+        return NULL;
+
+    entry->addr = addr;
+    entry->gen  = decode_cache_gen;
+    entry->page = page;
+    if (page >= 0)
+        entry->page_gen = decode_page_gen[page];
+    memcpy(entry->bytes, p, DECODE_BYTES);
+
+    return entry;
+}
+
+/* Fetches a byte of the current instruction in fast mode. */
+static uint8_t
+decode_808x_fetchb(void)
+{
+    uint32_t offset = (cs + cpu_state.pc) - (decode_cur ? decode_cur->addr : 0);
+    uint8_t  ret;
+
+    if (decode_cur && (offset < DECODE_BYTES))
+        ret = decode_cur->bytes[offset];
+    else
+        ret = readmembf(cpu_state.pc);
+
+    cpu_state.pc = (cpu_state.pc + 1) & 0xffff;
+    return ret;
+}
+
 static void
 pfq_write(void)
 {
@@ -555,6 +633,9 @@ pfq_fetchb_common(void)
 {
     uint8_t temp;
 
+    if (cpu_808x_fast)
+        return decode_808x_fetchb();
+
     if (pfq_pos == 0) {
         /* Reset prefetch queue internal position. */
         pfq_ip = cpu_state.pc;
@@ -606,6 +687,13 @@ pfq_add(int c, int add)
 {
     int d;
 
+    if (cpu_808x_fast) {
+        /* No queue to fill, only keep the bus cycle position for refresh. */
+        if (c > 0)
+            biu_cycles = (biu_cycles + c) & 0x03;
+        return;
+    }
+
     if ((c <= 0) || (pfq_pos >= pfq_size))
         return;
 
@@ -675,6 +763,10 @@ reset_808x(int hard)
     clear_lock = 0;
     refresh    = 0;
     ovr_seg    = NULL;
+    decode_cur = NULL;
+
+    ram_code_write = cpu_808x_fast ? decode_808x_write : NULL;
+    decode_cache_flush();
 
     if (hard) {
         opseg[0]  = &es;
@@ -1948,6 +2040,8 @@ execx86(int cycs)
 
         if (!repeating) {
             cpu_state.oldpc = cpu_state.pc;
+            if (cpu_808x_fast)
+                decode_cur = decode_808x_lookup(cs + cpu_state.pc);
             opcode          = pfq_fetchb();
             handled         = 0;
             oldc            = cpu_state.flags & C_FLAG;
@@ -3845,6 +3939,8 @@ execx86(int cycs)
         }
 exec_completed:
         if (completed) {
+            CPU_COUNT_INSTRS(1);
+            decode_cur = NULL;
             repeating  = 0;
             ovr_seg    = NULL;
             in_rep     = 0;
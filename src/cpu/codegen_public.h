@@ -52,6 +52,23 @@
 extern void codegen_init(void);
 extern void codegen_flush(void);
 
+#ifdef USE_NEW_DYNAREC
+typedef struct codegen_stats_t {
+    uint64_t recompiles;    /*Blocks compiled*/
+    uint64_t evictions;     /*Blocks deleted to make room for new ones*/
+    uint64_t invalidations; /*Blocks thrown out by writes to their code*/
+    uint64_t traces;        /*Hot exits blocks were recompiled to follow*/
+} codegen_stats_t;
+
+/*Get and reset the code cache statistics*/
+extern void codegen_get_stats(codegen_stats_t *stats);
+extern void codegen_reset_stats(void);
+
+/*Load and save the on-disk block profile, if enabled*/
+extern void codegen_cache_load(void);
+extern void codegen_cache_save(void);
+#endif
+
 /*Current physical page of block being recompiled. -1 if no recompilation taking place */
 extern uint32_t recomp_page;
 extern int      codegen_in_recompile;
@@ -42,6 +42,7 @@
 #include <86box/pci.h>
 #include <86box/smram.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/gdbstub.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
@@ -194,6 +195,7 @@ int cpu_cyrix_alignment;
 int cpu_cpurst_on_sr;
 int cpu_use_exec = 0;
 int cpu_override_interpreter;
+int cpu_808x_fast;
 int CPUID;
 
 int is186;
@@ -258,6 +260,10 @@ uint8_t  _cache[2048];
 
 uint64_t cpu_CR4_mask;
 uint64_t tsc = 0;
+#ifdef USE_HEADLESS
+uint64_t cpu_instrs_executed = 0;
+uint64_t cpu_blocks_compiled = 0;
+#endif
 
 double cpu_dmulti;
 double cpu_busspeed;
@@ -1849,6 +1855,9 @@ cpu_set(void)
 
     cpu_use_exec = 0;
 
+    /* Set again by the 808x reset if its fast mode is in use. */
+    ram_code_write = NULL;
+
     if (is386) {
 #if defined(USE_DYNAREC) && !defined(USE_GDBSTUB)
         if (cpu_use_dynarec) {
@@ -4459,6 +4468,9 @@ x86_setopcodes_2386(const OpFn *opcodes, const OpFn *opcodes_0f)
 {
     x86_2386_opcodes    = opcodes;
     x86_2386_opcodes_0f = opcodes_0f;
+
+    /* The decoded instruction cache holds handlers from the old table. */
+    decode_cache_flush();
 }
 
 void
@@ -4505,3 +4517,64 @@ cpu_update_waitstates(void)
     if (cpu_s->rspeed <= 8000000)
         cpu_rom_prefetch_cycles = cpu_mem_prefetch_cycles;
 }
+
+void
+cpu_serialize(snapshot_t *snap)
+{
+    cpu_state_t state   = cpu_state;
+    uint64_t    new_tsc = tsc;
+
+    snapshot_section(snap, "cpu");
+
+    SNAPSHOT_VAR(snap, state);
+    SNAPSHOT_VAR(snap, fpu_state);
+    SNAPSHOT_VAR(snap, new_tsc);
+    SNAPSHOT_VAR(snap, msr);
+    SNAPSHOT_VAR(snap, cr2);
+    SNAPSHOT_VAR(snap, cr3);
+    SNAPSHOT_VAR(snap, cr4);
+    SNAPSHOT_VAR(snap, dr);
+    SNAPSHOT_VAR(snap, gdt);
+    SNAPSHOT_VAR(snap, ldt);
+    SNAPSHOT_VAR(snap, idt);
+    SNAPSHOT_VAR(snap, tr);
+    SNAPSHOT_VAR(snap, amd_efer);
+    SNAPSHOT_VAR(snap, star);
+    SNAPSHOT_VAR(snap, cs_msr);
+    SNAPSHOT_VAR(snap, esp_msr);
+    SNAPSHOT_VAR(snap, eip_msr);
+    SNAPSHOT_VAR(snap, ccr0);
+    SNAPSHOT_VAR(snap, ccr1);
+    SNAPSHOT_VAR(snap, ccr2);
+    SNAPSHOT_VAR(snap, ccr3);
+    SNAPSHOT_VAR(snap, ccr4);
+    SNAPSHOT_VAR(snap, ccr5);
+    SNAPSHOT_VAR(snap, ccr6);
+    SNAPSHOT_VAR(snap, ccr7);
+    SNAPSHOT_VAR(snap, cpu_cur_status);
+    SNAPSHOT_VAR(snap, use32);
+    SNAPSHOT_VAR(snap, stack32);
+    SNAPSHOT_VAR(snap, trap);
+    SNAPSHOT_VAR(snap, nmi);
+    SNAPSHOT_VAR(snap, nmi_mask);
+    SNAPSHOT_VAR(snap, nmi_enable);
+    SNAPSHOT_VAR(snap, smi_latched);
+    SNAPSHOT_VAR(snap, smm_in_hlt);
+    SNAPSHOT_VAR(snap, smi_block);
+    SNAPSHOT_VAR(snap, cpu_cache_int_enabled);
+    SNAPSHOT_VAR(snap, cpu_cache_ext_enabled);
+
+    if (snap->saving || snap->error)
+        return;
+
+    /* The effective address segment is a pointer into cpu_state itself. */
+    state.ea_seg = &cpu_state.seg_ds;
+    cpu_state    = state;
+
+    /* Move every timer along with the TSC, so the ones restored later by
+       the devices land at their saved absolute timestamps while the rest
+       keep their relative distance. */
+    timer_set_new_tsc(new_tsc);
+
+    cpu_update_waitstates();
+}
@@ -572,6 +572,7 @@ extern uint32_t olddslimitw;
 extern uint32_t oldsslimitw;
 extern uint32_t pccache;
 extern uint8_t *pccache2;
+extern uint32_t decode_cache_gen;
 
 extern double   bus_timing;
 extern double   isa_timing;
@@ -825,6 +826,18 @@ extern int  cpu_block_end;
 extern int  cpu_force_interpreter;
 extern int  cpu_override_dynarec;
 
+#ifdef USE_HEADLESS
+/* Deterministic execution counters for the headless runner. */
+extern uint64_t cpu_instrs_executed;
+extern uint64_t cpu_blocks_compiled;
+
+#    define CPU_COUNT_INSTRS(n) cpu_instrs_executed += (n)
+#    define CPU_COUNT_BLOCK()   cpu_blocks_compiled++
+#else
+#    define CPU_COUNT_INSTRS(n)
+#    define CPU_COUNT_BLOCK()
+#endif
+
 extern void mmx_init(void);
 extern void prefetch_flush(void);
 
@@ -841,6 +854,7 @@ extern int new_ne;
 
 extern int in_lock;
 extern int cpu_override_interpreter;
+extern int cpu_808x_fast;
 
 extern int is_lock_legal(uint32_t fetchdat);
 
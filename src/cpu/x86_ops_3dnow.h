@@ -40,14 +40,7 @@ opPAVGUSB(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->b[0] = (dst->b[0] + src.b[0] + 1) >> 1;
-    dst->b[1] = (dst->b[1] + src.b[1] + 1) >> 1;
-    dst->b[2] = (dst->b[2] + src.b[2] + 1) >> 1;
-    dst->b[3] = (dst->b[3] + src.b[3] + 1) >> 1;
-    dst->b[4] = (dst->b[4] + src.b[4] + 1) >> 1;
-    dst->b[5] = (dst->b[5] + src.b[5] + 1) >> 1;
-    dst->b[6] = (dst->b[6] + src.b[6] + 1) >> 1;
-    dst->b[7] = (dst->b[7] + src.b[7] + 1) >> 1;
+    mmx_pavgusb(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -61,8 +54,7 @@ opPF2ID(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->sl[0] = (int32_t) src.f[0];
-    dst->sl[1] = (int32_t) src.f[1];
+    mmx_pf2id(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -88,13 +80,10 @@ opPFACC(UNUSED(uint32_t fetchdat))
 {
     MMX_REG  src;
     MMX_REG *dst = MMX_GETREGP(cpu_reg);
-    float    tempf;
 
     MMX_GETSRC();
 
-    tempf     = dst->f[0] + dst->f[1];
-    dst->f[1] = src.f[0] + src.f[1];
-    dst->f[0] = tempf;
+    mmx_pfacc(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -105,13 +94,10 @@ opPFNACC(UNUSED(uint32_t fetchdat))
 {
     MMX_REG  src;
     MMX_REG *dst = MMX_GETREGP(cpu_reg);
-    float    tempf;
 
     MMX_GETSRC();
 
-    tempf     = dst->f[0] - dst->f[1];
-    dst->f[1] = src.f[0] - src.f[1];
-    dst->f[0] = tempf;
+    mmx_pfnacc(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -122,13 +108,10 @@ opPFPNACC(UNUSED(uint32_t fetchdat))
 {
     MMX_REG  src;
     MMX_REG *dst = MMX_GETREGP(cpu_reg);
-    float    tempf;
 
     MMX_GETSRC();
 
-    tempf     = dst->f[0] - dst->f[1];
-    dst->f[1] = src.f[0] + src.f[1];
-    dst->f[0] = tempf;
+    mmx_pfpnacc(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -162,8 +145,7 @@ opPFADD(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->f[0] += src.f[0];
-    dst->f[1] += src.f[1];
+    mmx_pfadd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -177,8 +159,7 @@ opPFCMPEQ(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->l[0] = (dst->f[0] == src.f[0]) ? 0xffffffff : 0;
-    dst->l[1] = (dst->f[1] == src.f[1]) ? 0xffffffff : 0;
+    mmx_pfcmpeq(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -192,8 +173,7 @@ opPFCMPGE(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->l[0] = (dst->f[0] >= src.f[0]) ? 0xffffffff : 0;
-    dst->l[1] = (dst->f[1] >= src.f[1]) ? 0xffffffff : 0;
+    mmx_pfcmpge(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -207,8 +187,7 @@ opPFCMPGT(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->l[0] = (dst->f[0] > src.f[0]) ? 0xffffffff : 0;
-    dst->l[1] = (dst->f[1] > src.f[1]) ? 0xffffffff : 0;
+    mmx_pfcmpgt(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -222,10 +201,7 @@ opPFMAX(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    if (src.f[0] > dst->f[0])
-        dst->f[0] = src.f[0];
-    if (src.f[1] > dst->f[1])
-        dst->f[1] = src.f[1];
+    mmx_pfmax(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -239,10 +215,7 @@ opPFMIN(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    if (src.f[0] < dst->f[0])
-        dst->f[0] = src.f[0];
-    if (src.f[1] < dst->f[1])
-        dst->f[1] = src.f[1];
+    mmx_pfmin(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -256,8 +229,7 @@ opPFMUL(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->f[0] *= src.f[0];
-    dst->f[1] *= src.f[1];
+    mmx_pfmul(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -369,8 +341,7 @@ opPFSUB(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->f[0] -= src.f[0];
-    dst->f[1] -= src.f[1];
+    mmx_pfsub(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -384,8 +355,7 @@ opPFSUBR(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->f[0] = src.f[0] - dst->f[0];
-    dst->f[1] = src.f[1] - dst->f[1];
+    mmx_pfsubr(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -399,8 +369,7 @@ opPI2FD(UNUSED(uint32_t fetchdat))
 
     MMX_GETSRC();
 
-    dst->f[0] = (float) src.sl[0];
-    dst->f[1] = (float) src.sl[1];
+    mmx_pi2fd(dst, &src);
 
     MMX_SETEXP(cpu_reg);
 
@@ -430,10 +399,7 @@ opPMULHRW(UNUSED(uint32_t fetchdat))
     if (cpu_mod == 3) {
         src = MMX_GETREG(cpu_rm);
 
-        dst->w[0] = (((int32_t) dst->sw[0] * (int32_t) src.sw[0]) + 0x8000) >> 16;
-        dst->w[1] = (((int32_t) dst->sw[1] * (int32_t) src.sw[1]) + 0x8000) >> 16;
-        dst->w[2] = (((int32_t) dst->sw[2] * (int32_t) src.sw[2]) + 0x8000) >> 16;
-        dst->w[3] = (((int32_t) dst->sw[3] * (int32_t) src.sw[3]) + 0x8000) >> 16;
+        mmx_pmulhrw(dst, &src);
         CLOCK_CYCLES(1);
     } else {
         SEG_CHECK_READ(cpu_state.ea_seg);
@@ -441,10 +407,7 @@ opPMULHRW(UNUSED(uint32_t fetchdat))
         src.l[1] = readmeml(easeg, cpu_state.eaaddr + 4);
         if (cpu_state.abrt)
             return 0;
-        dst->w[0] = ((int32_t) (dst->sw[0] * (int32_t) src.sw[0]) + 0x8000) >> 16;
-        dst->w[1] = ((int32_t) (dst->sw[1] * (int32_t) src.sw[1]) + 0x8000) >> 16;
-        dst->w[2] = ((int32_t) (dst->sw[2] * (int32_t) src.sw[2]) + 0x8000) >> 16;
-        dst->w[3] = ((int32_t) (dst->sw[3] * (int32_t) src.sw[3]) + 0x8000) >> 16;
+        mmx_pmulhrw(dst, &src);
         CLOCK_CYCLES(2);
     }
 
@@ -3,6 +3,8 @@
 #define USATB(val)     (((val) < 0) ? 0 : (((val) > 255) ? 255 : (val)))
 #define USATW(val)     (((val) < 0) ? 0 : (((val) > 65535) ? 65535 : (val)))
 
+#include "x86_ops_mmx_simd.h"
+
 #define MMX_GETREGP(r) MMP[r]
 #define MMX_GETREG(r)  *(MMP[r])
 
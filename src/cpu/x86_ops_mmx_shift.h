@@ -26,30 +26,19 @@ opPSxxW_imm(uint32_t fetchdat)
         case 0x10: /*PSRLW*/
             if (shift > 15)
                 dst->q = 0;
-            else {
-                dst->w[0] >>= shift;
-                dst->w[1] >>= shift;
-                dst->w[2] >>= shift;
-                dst->w[3] >>= shift;
-            }
+            else
+                mmx_psrlw(dst, shift);
             break;
         case 0x20: /*PSRAW*/
             if (shift > 15)
                 shift = 15;
-            dst->sw[0] >>= shift;
-            dst->sw[1] >>= shift;
-            dst->sw[2] >>= shift;
-            dst->sw[3] >>= shift;
+            mmx_psraw(dst, shift);
             break;
         case 0x30: /*PSLLW*/
             if (shift > 15)
                 dst->q = 0;
-            else {
-                dst->w[0] <<= shift;
-                dst->w[1] <<= shift;
-                dst->w[2] <<= shift;
-                dst->w[3] <<= shift;
-            }
+            else
+                mmx_psllw(dst, shift);
             break;
         default:
             cpu_state.pc = cpu_state.oldpc;
@@ -79,12 +68,8 @@ opPSLLW_a16(uint32_t fetchdat)
 
     if (shift > 15)
         dst->q = 0;
-    else {
-        dst->w[0] <<= shift;
-        dst->w[1] <<= shift;
-        dst->w[2] <<= shift;
-        dst->w[3] <<= shift;
-    }
+    else
+        mmx_psllw(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -106,12 +91,8 @@ opPSLLW_a32(uint32_t fetchdat)
 
     if (shift > 15)
         dst->q = 0;
-    else {
-        dst->w[0] <<= shift;
-        dst->w[1] <<= shift;
-        dst->w[2] <<= shift;
-        dst->w[3] <<= shift;
-    }
+    else
+        mmx_psllw(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -134,12 +115,8 @@ opPSRLW_a16(uint32_t fetchdat)
 
     if (shift > 15)
         dst->q = 0;
-    else {
-        dst->w[0] >>= shift;
-        dst->w[1] >>= shift;
-        dst->w[2] >>= shift;
-        dst->w[3] >>= shift;
-    }
+    else
+        mmx_psrlw(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -161,12 +138,8 @@ opPSRLW_a32(uint32_t fetchdat)
 
     if (shift > 15)
         dst->q = 0;
-    else {
-        dst->w[0] >>= shift;
-        dst->w[1] >>= shift;
-        dst->w[2] >>= shift;
-        dst->w[3] >>= shift;
-    }
+    else
+        mmx_psrlw(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -190,10 +163,7 @@ opPSRAW_a16(uint32_t fetchdat)
     if (shift > 15)
         shift = 15;
 
-    dst->sw[0] >>= shift;
-    dst->sw[1] >>= shift;
-    dst->sw[2] >>= shift;
-    dst->sw[3] >>= shift;
+    mmx_psraw(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -216,10 +186,7 @@ opPSRAW_a32(uint32_t fetchdat)
     if (shift > 15)
         shift = 15;
 
-    dst->sw[0] >>= shift;
-    dst->sw[1] >>= shift;
-    dst->sw[2] >>= shift;
-    dst->sw[3] >>= shift;
+    mmx_psraw(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -243,24 +210,19 @@ opPSxxD_imm(uint32_t fetchdat)
         case 0x10: /*PSRLD*/
             if (shift > 31)
                 dst->q = 0;
-            else {
-                dst->l[0] >>= shift;
-                dst->l[1] >>= shift;
-            }
+            else
+                mmx_psrld(dst, shift);
             break;
         case 0x20: /*PSRAD*/
             if (shift > 31)
                 shift = 31;
-            dst->sl[0] >>= shift;
-            dst->sl[1] >>= shift;
+            mmx_psrad(dst, shift);
             break;
         case 0x30: /*PSLLD*/
             if (shift > 31)
                 dst->q = 0;
-            else {
-                dst->l[0] <<= shift;
-                dst->l[1] <<= shift;
-            }
+            else
+                mmx_pslld(dst, shift);
             break;
         default:
             cpu_state.pc = cpu_state.oldpc;
@@ -290,10 +252,8 @@ opPSLLD_a16(uint32_t fetchdat)
 
     if (shift > 31)
         dst->q = 0;
-    else {
-        dst->l[0] <<= shift;
-        dst->l[1] <<= shift;
-    }
+    else
+        mmx_pslld(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -315,10 +275,8 @@ opPSLLD_a32(uint32_t fetchdat)
 
     if (shift > 31)
         dst->q = 0;
-    else {
-        dst->l[0] <<= shift;
-        dst->l[1] <<= shift;
-    }
+    else
+        mmx_pslld(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -341,10 +299,8 @@ opPSRLD_a16(uint32_t fetchdat)
 
     if (shift > 31)
         dst->q = 0;
-    else {
-        dst->l[0] >>= shift;
-        dst->l[1] >>= shift;
-    }
+    else
+        mmx_psrld(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -366,10 +322,8 @@ opPSRLD_a32(uint32_t fetchdat)
 
     if (shift > 31)
         dst->q = 0;
-    else {
-        dst->l[0] >>= shift;
-        dst->l[1] >>= shift;
-    }
+    else
+        mmx_psrld(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -393,8 +347,7 @@ opPSRAD_a16(uint32_t fetchdat)
     if (shift > 31)
         shift = 31;
 
-    dst->sl[0] >>= shift;
-    dst->sl[1] >>= shift;
+    mmx_psrad(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
@@ -417,8 +370,7 @@ opPSRAD_a32(uint32_t fetchdat)
     if (shift > 31)
         shift = 31;
 
-    dst->sl[0] >>= shift;
-    dst->sl[1] >>= shift;
+    mmx_psrad(dst, shift);
 
     MMX_SETEXP(cpu_reg);
 
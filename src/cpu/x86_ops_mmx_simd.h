@@ -0,0 +1,766 @@
+/* Packed integer and 3DNow! float kernels shared by the MMX and 3DNow!
+   handlers. Each kernel operates on a full 64-bit register, using SSE2 on
+   x86 hosts, NEON on ARM64 hosts and plain C everywhere else. The SIMD
+   versions give the same results as the C ones, including saturation and
+   the comparison/min/max behaviour with NaN operands.
+
+   The new dynarec does not generate code for some of these instructions
+   (PMULHRW, PAVGUSB, PFACC and friends, the shifts by register) and calls
+   the interpreter handlers for them, so these kernels are used there too. */
+#if defined __SSE2__ || defined __amd64__ || defined _M_X64 || (defined _M_IX86_FP && (_M_IX86_FP >= 2))
+#    define MMX_SIMD_SSE2
+#    include <emmintrin.h>
+#elif defined __aarch64__ || defined _M_ARM64
+#    define MMX_SIMD_NEON
+#    include <arm_neon.h>
+#endif
+
+#if defined MMX_SIMD_SSE2
+#    define MMX_LOAD(r)      _mm_loadl_epi64((const __m128i *) (r))
+#    define MMX_STORE(r, v)  _mm_storel_epi64((__m128i *) (r), (v))
+#    define MMX_LOADF(r)     _mm_castsi128_ps(MMX_LOAD(r))
+#    define MMX_STOREF(r, v) MMX_STORE(r, _mm_castps_si128(v))
+
+#    define MMX_SIMD_BINOP(name, op)                                  \
+        static __inline void                                          \
+        name(MMX_REG *dst, const MMX_REG *src)                        \
+        {                                                             \
+            MMX_STORE(dst, op(MMX_LOAD(dst), MMX_LOAD(src)));         \
+        }
+
+#    define MMX_SIMD_BINOPF(name, op)                                 \
+        static __inline void                                          \
+        name(MMX_REG *dst, const MMX_REG *src)                        \
+        {                                                             \
+            MMX_STOREF(dst, op(MMX_LOADF(dst), MMX_LOADF(src)));      \
+        }
+
+#    define MMX_SIMD_SHIFT(name, op)                                  \
+        static __inline void                                          \
+        name(MMX_REG *dst, int shift)                                 \
+        {                                                             \
+            MMX_STORE(dst, op(MMX_LOAD(dst), _mm_cvtsi32_si128(shift))); \
+        }
+
+MMX_SIMD_BINOP(mmx_paddb, _mm_add_epi8)
+MMX_SIMD_BINOP(mmx_paddw, _mm_add_epi16)
+MMX_SIMD_BINOP(mmx_paddd, _mm_add_epi32)
+MMX_SIMD_BINOP(mmx_paddsb, _mm_adds_epi8)
+MMX_SIMD_BINOP(mmx_paddsw, _mm_adds_epi16)
+MMX_SIMD_BINOP(mmx_paddusb, _mm_adds_epu8)
+MMX_SIMD_BINOP(mmx_paddusw, _mm_adds_epu16)
+MMX_SIMD_BINOP(mmx_psubb, _mm_sub_epi8)
+MMX_SIMD_BINOP(mmx_psubw, _mm_sub_epi16)
+MMX_SIMD_BINOP(mmx_psubd, _mm_sub_epi32)
+MMX_SIMD_BINOP(mmx_psubsb, _mm_subs_epi8)
+MMX_SIMD_BINOP(mmx_psubsw, _mm_subs_epi16)
+MMX_SIMD_BINOP(mmx_psubusb, _mm_subs_epu8)
+MMX_SIMD_BINOP(mmx_psubusw, _mm_subs_epu16)
+MMX_SIMD_BINOP(mmx_pmaddwd, _mm_madd_epi16)
+MMX_SIMD_BINOP(mmx_pmulhw, _mm_mulhi_epi16)
+MMX_SIMD_BINOP(mmx_pmullw, _mm_mullo_epi16)
+MMX_SIMD_BINOP(mmx_pavgusb, _mm_avg_epu8)
+MMX_SIMD_BINOP(mmx_pcmpeqb, _mm_cmpeq_epi8)
+MMX_SIMD_BINOP(mmx_pcmpeqw, _mm_cmpeq_epi16)
+MMX_SIMD_BINOP(mmx_pcmpeqd, _mm_cmpeq_epi32)
+MMX_SIMD_BINOP(mmx_pcmpgtb, _mm_cmpgt_epi8)
+MMX_SIMD_BINOP(mmx_pcmpgtw, _mm_cmpgt_epi16)
+MMX_SIMD_BINOP(mmx_pcmpgtd, _mm_cmpgt_epi32)
+MMX_SIMD_BINOP(mmx_punpcklbw, _mm_unpacklo_epi8)
+MMX_SIMD_BINOP(mmx_punpcklwd, _mm_unpacklo_epi16)
+
+MMX_SIMD_BINOPF(mmx_pfadd, _mm_add_ps)
+MMX_SIMD_BINOPF(mmx_pfsub, _mm_sub_ps)
+MMX_SIMD_BINOPF(mmx_pfmul, _mm_mul_ps)
+MMX_SIMD_BINOPF(mmx_pfcmpeq, _mm_cmpeq_ps)
+MMX_SIMD_BINOPF(mmx_pfcmpge, _mm_cmpge_ps)
+MMX_SIMD_BINOPF(mmx_pfcmpgt, _mm_cmpgt_ps)
+
+/*Shift counts are limited by the callers to the element size*/
+MMX_SIMD_SHIFT(mmx_psllw, _mm_sll_epi16)
+MMX_SIMD_SHIFT(mmx_psrlw, _mm_srl_epi16)
+MMX_SIMD_SHIFT(mmx_psraw, _mm_sra_epi16)
+MMX_SIMD_SHIFT(mmx_pslld, _mm_sll_epi32)
+MMX_SIMD_SHIFT(mmx_psrld, _mm_srl_epi32)
+MMX_SIMD_SHIFT(mmx_psrad, _mm_sra_epi32)
+
+static __inline void
+mmx_punpckhbw(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STORE(dst, _mm_srli_si128(_mm_unpacklo_epi8(MMX_LOAD(dst), MMX_LOAD(src)), 8));
+}
+
+static __inline void
+mmx_punpckhwd(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STORE(dst, _mm_srli_si128(_mm_unpacklo_epi16(MMX_LOAD(dst), MMX_LOAD(src)), 8));
+}
+
+static __inline void
+mmx_packsswb(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128i v = _mm_unpacklo_epi64(MMX_LOAD(dst), MMX_LOAD(src));
+
+    MMX_STORE(dst, _mm_packs_epi16(v, v));
+}
+
+static __inline void
+mmx_packuswb(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128i v = _mm_unpacklo_epi64(MMX_LOAD(dst), MMX_LOAD(src));
+
+    MMX_STORE(dst, _mm_packus_epi16(v, v));
+}
+
+static __inline void
+mmx_packssdw(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128i v = _mm_unpacklo_epi64(MMX_LOAD(dst), MMX_LOAD(src));
+
+    MMX_STORE(dst, _mm_packs_epi32(v, v));
+}
+
+/*The rounded product always fits in 16 bits, so the saturating pack is exact*/
+static __inline void
+mmx_pmulhrw(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128i a    = MMX_LOAD(dst);
+    __m128i b    = MMX_LOAD(src);
+    __m128i prod = _mm_unpacklo_epi16(_mm_mullo_epi16(a, b), _mm_mulhi_epi16(a, b));
+
+    prod = _mm_srai_epi32(_mm_add_epi32(prod, _mm_set1_epi32(0x8000)), 16);
+    MMX_STORE(dst, _mm_packs_epi32(prod, prod));
+}
+
+/*MAXPS/MINPS return the second operand if either is NaN, which with the
+  operands swapped matches the compare-and-replace of the C versions*/
+static __inline void
+mmx_pfmax(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STOREF(dst, _mm_max_ps(MMX_LOADF(src), MMX_LOADF(dst)));
+}
+
+static __inline void
+mmx_pfmin(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STOREF(dst, _mm_min_ps(MMX_LOADF(src), MMX_LOADF(dst)));
+}
+
+static __inline void
+mmx_pfsubr(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STOREF(dst, _mm_sub_ps(MMX_LOADF(src), MMX_LOADF(dst)));
+}
+
+static __inline void
+mmx_pfacc(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128 v = _mm_unpacklo_ps(MMX_LOADF(dst), MMX_LOADF(src));
+
+    MMX_STOREF(dst, _mm_add_ps(v, _mm_movehl_ps(v, v)));
+}
+
+static __inline void
+mmx_pfnacc(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128 v = _mm_unpacklo_ps(MMX_LOADF(dst), MMX_LOADF(src));
+
+    MMX_STOREF(dst, _mm_sub_ps(v, _mm_movehl_ps(v, v)));
+}
+
+static __inline void
+mmx_pfpnacc(MMX_REG *dst, const MMX_REG *src)
+{
+    __m128 v  = _mm_unpacklo_ps(MMX_LOADF(dst), MMX_LOADF(src));
+    __m128 v2 = _mm_movehl_ps(v, v);
+
+    MMX_STOREF(dst, _mm_move_ss(_mm_add_ps(v, v2), _mm_sub_ps(v, v2)));
+}
+
+static __inline void
+mmx_pi2fd(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STOREF(dst, _mm_cvtepi32_ps(MMX_LOAD(src)));
+}
+
+static __inline void
+mmx_pf2id(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_STORE(dst, _mm_cvttps_epi32(MMX_LOADF(src)));
+}
+
+#    undef MMX_SIMD_BINOP
+#    undef MMX_SIMD_BINOPF
+#    undef MMX_SIMD_SHIFT
+#elif defined MMX_SIMD_NEON
+#    define MMX_SIMD_BINOP(name, op, type, field)                                 \
+        static __inline void                                                      \
+        name(MMX_REG *dst, const MMX_REG *src)                                    \
+        {                                                                         \
+            vst1_##type(dst->field, op(vld1_##type(dst->field), vld1_##type(src->field))); \
+        }
+
+/*Comparisons return an unsigned mask of the element size*/
+#    define MMX_SIMD_CMP(name, op, type, field, mtype, mfield)                    \
+        static __inline void                                                      \
+        name(MMX_REG *dst, const MMX_REG *src)                                    \
+        {                                                                         \
+            vst1_##mtype(dst->mfield, op(vld1_##type(dst->field), vld1_##type(src->field))); \
+        }
+
+/*NEON shifts right by a negative count*/
+#    define MMX_SIMD_SHIFT(name, op, type, field, stype, sign)                    \
+        static __inline void                                                      \
+        name(MMX_REG *dst, int shift)                                             \
+        {                                                                         \
+            vst1_##type(dst->field, op(vld1_##type(dst->field), vdup_n_##stype(sign shift))); \
+        }
+
+static __inline int16x4_t
+mmx_neon_pmulhw(int16x4_t a, int16x4_t b)
+{
+    return vshrn_n_s32(vmull_s16(a, b), 16);
+}
+
+static __inline int32x2_t
+mmx_neon_pmaddwd(int16x4_t a, int16x4_t b)
+{
+    int32x4_t prod = vmull_s16(a, b);
+
+    return vpadd_s32(vget_low_s32(prod), vget_high_s32(prod));
+}
+
+MMX_SIMD_BINOP(mmx_paddb, vadd_u8, u8, b)
+MMX_SIMD_BINOP(mmx_paddw, vadd_u16, u16, w)
+MMX_SIMD_BINOP(mmx_paddd, vadd_u32, u32, l)
+MMX_SIMD_BINOP(mmx_paddsb, vqadd_s8, s8, sb)
+MMX_SIMD_BINOP(mmx_paddsw, vqadd_s16, s16, sw)
+MMX_SIMD_BINOP(mmx_paddusb, vqadd_u8, u8, b)
+MMX_SIMD_BINOP(mmx_paddusw, vqadd_u16, u16, w)
+MMX_SIMD_BINOP(mmx_psubb, vsub_u8, u8, b)
+MMX_SIMD_BINOP(mmx_psubw, vsub_u16, u16, w)
+MMX_SIMD_BINOP(mmx_psubd, vsub_u32, u32, l)
+MMX_SIMD_BINOP(mmx_psubsb, vqsub_s8, s8, sb)
+MMX_SIMD_BINOP(mmx_psubsw, vqsub_s16, s16, sw)
+MMX_SIMD_BINOP(mmx_psubusb, vqsub_u8, u8, b)
+MMX_SIMD_BINOP(mmx_psubusw, vqsub_u16, u16, w)
+MMX_SIMD_BINOP(mmx_pmulhw, mmx_neon_pmulhw, s16, sw)
+MMX_SIMD_BINOP(mmx_pmullw, vmul_s16, s16, sw)
+MMX_SIMD_BINOP(mmx_pavgusb, vrhadd_u8, u8, b)
+MMX_SIMD_BINOP(mmx_punpcklbw, vzip1_u8, u8, b)
+MMX_SIMD_BINOP(mmx_punpckhbw, vzip2_u8, u8, b)
+MMX_SIMD_BINOP(mmx_punpcklwd, vzip1_u16, u16, w)
+MMX_SIMD_BINOP(mmx_punpckhwd, vzip2_u16, u16, w)
+
+MMX_SIMD_BINOP(mmx_pfadd, vadd_f32, f32, f)
+MMX_SIMD_BINOP(mmx_pfsub, vsub_f32, f32, f)
+MMX_SIMD_BINOP(mmx_pfmul, vmul_f32, f32, f)
+MMX_SIMD_BINOP(mmx_pfacc, vpadd_f32, f32, f)
+
+MMX_SIMD_CMP(mmx_pcmpeqb, vceq_u8, u8, b, u8, b)
+MMX_SIMD_CMP(mmx_pcmpeqw, vceq_u16, u16, w, u16, w)
+MMX_SIMD_CMP(mmx_pcmpeqd, vceq_u32, u32, l, u32, l)
+MMX_SIMD_CMP(mmx_pcmpgtb, vcgt_s8, s8, sb, u8, b)
+MMX_SIMD_CMP(mmx_pcmpgtw, vcgt_s16, s16, sw, u16, w)
+MMX_SIMD_CMP(mmx_pcmpgtd, vcgt_s32, s32, sl, u32, l)
+MMX_SIMD_CMP(mmx_pfcmpeq, vceq_f32, f32, f, u32, l)
+MMX_SIMD_CMP(mmx_pfcmpge, vcge_f32, f32, f, u32, l)
+MMX_SIMD_CMP(mmx_pfcmpgt, vcgt_f32, f32, f, u32, l)
+
+/*Shift counts are limited by the callers to the element size*/
+MMX_SIMD_SHIFT(mmx_psllw, vshl_u16, u16, w, s16, +)
+MMX_SIMD_SHIFT(mmx_psrlw, vshl_u16, u16, w, s16, -)
+MMX_SIMD_SHIFT(mmx_psraw, vshl_s16, s16, sw, s16, -)
+MMX_SIMD_SHIFT(mmx_pslld, vshl_u32, u32, l, s32, +)
+MMX_SIMD_SHIFT(mmx_psrld, vshl_u32, u32, l, s32, -)
+MMX_SIMD_SHIFT(mmx_psrad, vshl_s32, s32, sl, s32, -)
+
+static __inline void
+mmx_pmaddwd(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_s32(dst->sl, mmx_neon_pmaddwd(vld1_s16(dst->sw), vld1_s16(src->sw)));
+}
+
+static __inline void
+mmx_pmulhrw(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_s16(dst->sw, vrshrn_n_s32(vmull_s16(vld1_s16(dst->sw), vld1_s16(src->sw)), 16));
+}
+
+static __inline void
+mmx_packsswb(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_s8(dst->sb, vqmovn_s16(vcombine_s16(vld1_s16(dst->sw), vld1_s16(src->sw))));
+}
+
+static __inline void
+mmx_packuswb(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_u8(dst->b, vqmovun_s16(vcombine_s16(vld1_s16(dst->sw), vld1_s16(src->sw))));
+}
+
+static __inline void
+mmx_packssdw(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_s16(dst->sw, vqmovn_s32(vcombine_s32(vld1_s32(dst->sl), vld1_s32(src->sl))));
+}
+
+/*FMAX/FMIN propagate NaNs, so select on a compare as the C versions do*/
+static __inline void
+mmx_pfmax(MMX_REG *dst, const MMX_REG *src)
+{
+    float32x2_t a = vld1_f32(dst->f);
+    float32x2_t b = vld1_f32(src->f);
+
+    vst1_f32(dst->f, vbsl_f32(vcgt_f32(b, a), b, a));
+}
+
+static __inline void
+mmx_pfmin(MMX_REG *dst, const MMX_REG *src)
+{
+    float32x2_t a = vld1_f32(dst->f);
+    float32x2_t b = vld1_f32(src->f);
+
+    vst1_f32(dst->f, vbsl_f32(vclt_f32(b, a), b, a));
+}
+
+static __inline void
+mmx_pfsubr(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_f32(dst->f, vsub_f32(vld1_f32(src->f), vld1_f32(dst->f)));
+}
+
+static __inline void
+mmx_pfnacc(MMX_REG *dst, const MMX_REG *src)
+{
+    float32x2_t a = vld1_f32(dst->f);
+    float32x2_t b = vld1_f32(src->f);
+
+    vst1_f32(dst->f, vsub_f32(vuzp1_f32(a, b), vuzp2_f32(a, b)));
+}
+
+static __inline void
+mmx_pfpnacc(MMX_REG *dst, const MMX_REG *src)
+{
+    float32x2_t a = vld1_f32(dst->f);
+    float32x2_t b = vld1_f32(src->f);
+    float32x2_t v = vuzp1_f32(a, b);
+    float32x2_t v2 = vuzp2_f32(a, b);
+
+    vst1_f32(dst->f, vcopy_lane_f32(vadd_f32(v, v2), 0, vsub_f32(v, v2), 0));
+}
+
+static __inline void
+mmx_pi2fd(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_f32(dst->f, vcvt_f32_s32(vld1_s32(src->sl)));
+}
+
+static __inline void
+mmx_pf2id(MMX_REG *dst, const MMX_REG *src)
+{
+    vst1_s32(dst->sl, vcvt_s32_f32(vld1_f32(src->f)));
+}
+
+#    undef MMX_SIMD_BINOP
+#    undef MMX_SIMD_CMP
+#    undef MMX_SIMD_SHIFT
+#else
+static __inline void
+mmx_paddb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] += src->b[c];
+}
+
+static __inline void
+mmx_paddw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] += src->w[c];
+}
+
+static __inline void
+mmx_paddd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] += src->l[0];
+    dst->l[1] += src->l[1];
+}
+
+static __inline void
+mmx_paddsb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->sb[c] = SSATB(dst->sb[c] + src->sb[c]);
+}
+
+static __inline void
+mmx_paddsw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->sw[c] = SSATW(dst->sw[c] + src->sw[c]);
+}
+
+static __inline void
+mmx_paddusb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] = USATB(dst->b[c] + src->b[c]);
+}
+
+static __inline void
+mmx_paddusw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] = USATW(dst->w[c] + src->w[c]);
+}
+
+static __inline void
+mmx_psubb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] -= src->b[c];
+}
+
+static __inline void
+mmx_psubw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] -= src->w[c];
+}
+
+static __inline void
+mmx_psubd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] -= src->l[0];
+    dst->l[1] -= src->l[1];
+}
+
+static __inline void
+mmx_psubsb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->sb[c] = SSATB(dst->sb[c] - src->sb[c]);
+}
+
+static __inline void
+mmx_psubsw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->sw[c] = SSATW(dst->sw[c] - src->sw[c]);
+}
+
+static __inline void
+mmx_psubusb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] = USATB(dst->b[c] - src->b[c]);
+}
+
+static __inline void
+mmx_psubusw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] = USATW(dst->w[c] - src->w[c]);
+}
+
+static __inline void
+mmx_pmaddwd(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 2; c++) {
+        if ((dst->l[c] == 0x80008000) && (src->l[c] == 0x80008000))
+            dst->l[c] = 0x80000000;
+        else
+            dst->sl[c] = ((int32_t) dst->sw[c * 2] * (int32_t) src->sw[c * 2]) + ((int32_t) dst->sw[c * 2 + 1] * (int32_t) src->sw[c * 2 + 1]);
+    }
+}
+
+static __inline void
+mmx_pmulhw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] = ((int32_t) dst->sw[c] * (int32_t) src->sw[c]) >> 16;
+}
+
+static __inline void
+mmx_pmullw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] *= src->w[c];
+}
+
+static __inline void
+mmx_pmulhrw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] = (((int32_t) dst->sw[c] * (int32_t) src->sw[c]) + 0x8000) >> 16;
+}
+
+static __inline void
+mmx_pavgusb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] = (dst->b[c] + src->b[c] + 1) >> 1;
+}
+
+static __inline void
+mmx_pcmpeqb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] = (dst->b[c] == src->b[c]) ? 0xff : 0;
+}
+
+static __inline void
+mmx_pcmpeqw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] = (dst->w[c] == src->w[c]) ? 0xffff : 0;
+}
+
+static __inline void
+mmx_pcmpeqd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] = (dst->l[0] == src->l[0]) ? 0xffffffff : 0;
+    dst->l[1] = (dst->l[1] == src->l[1]) ? 0xffffffff : 0;
+}
+
+static __inline void
+mmx_pcmpgtb(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 8; c++)
+        dst->b[c] = (dst->sb[c] > src->sb[c]) ? 0xff : 0;
+}
+
+static __inline void
+mmx_pcmpgtw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] = (dst->sw[c] > src->sw[c]) ? 0xffff : 0;
+}
+
+static __inline void
+mmx_pcmpgtd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] = (dst->sl[0] > src->sl[0]) ? 0xffffffff : 0;
+    dst->l[1] = (dst->sl[1] > src->sl[1]) ? 0xffffffff : 0;
+}
+
+static __inline void
+mmx_punpcklbw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 3; c >= 0; c--) {
+        dst->b[c * 2 + 1] = src->b[c];
+        dst->b[c * 2]     = dst->b[c];
+    }
+}
+
+static __inline void
+mmx_punpckhbw(MMX_REG *dst, const MMX_REG *src)
+{
+    for (int c = 0; c < 4; c++) {
+        dst->b[c * 2]     = dst->b[c + 4];
+        dst->b[c * 2 + 1] = src->b[c + 4];
+    }
+}
+
+static __inline void
+mmx_punpcklwd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->w[3] = src->w[1];
+    dst->w[2] = dst->w[1];
+    dst->w[1] = src->w[0];
+}
+
+static __inline void
+mmx_punpckhwd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->w[0] = dst->w[2];
+    dst->w[1] = src->w[2];
+    dst->w[2] = dst->w[3];
+    dst->w[3] = src->w[3];
+}
+
+static __inline void
+mmx_packsswb(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_REG dst2 = *dst;
+
+    for (int c = 0; c < 4; c++) {
+        dst->sb[c]     = SSATB(dst2.sw[c]);
+        dst->sb[c + 4] = SSATB(src->sw[c]);
+    }
+}
+
+static __inline void
+mmx_packuswb(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_REG dst2 = *dst;
+
+    for (int c = 0; c < 4; c++) {
+        dst->b[c]     = USATB(dst2.sw[c]);
+        dst->b[c + 4] = USATB(src->sw[c]);
+    }
+}
+
+static __inline void
+mmx_packssdw(MMX_REG *dst, const MMX_REG *src)
+{
+    MMX_REG dst2 = *dst;
+
+    dst->sw[0] = SSATW(dst2.sl[0]);
+    dst->sw[1] = SSATW(dst2.sl[1]);
+    dst->sw[2] = SSATW(src->sl[0]);
+    dst->sw[3] = SSATW(src->sl[1]);
+}
+
+/*Shift counts are limited by the callers to the element size*/
+static __inline void
+mmx_psllw(MMX_REG *dst, int shift)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] <<= shift;
+}
+
+static __inline void
+mmx_psrlw(MMX_REG *dst, int shift)
+{
+    for (int c = 0; c < 4; c++)
+        dst->w[c] >>= shift;
+}
+
+static __inline void
+mmx_psraw(MMX_REG *dst, int shift)
+{
+    for (int c = 0; c < 4; c++)
+        dst->sw[c] >>= shift;
+}
+
+static __inline void
+mmx_pslld(MMX_REG *dst, int shift)
+{
+    dst->l[0] <<= shift;
+    dst->l[1] <<= shift;
+}
+
+static __inline void
+mmx_psrld(MMX_REG *dst, int shift)
+{
+    dst->l[0] >>= shift;
+    dst->l[1] >>= shift;
+}
+
+static __inline void
+mmx_psrad(MMX_REG *dst, int shift)
+{
+    dst->sl[0] >>= shift;
+    dst->sl[1] >>= shift;
+}
+
+static __inline void
+mmx_pfadd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->f[0] += src->f[0];
+    dst->f[1] += src->f[1];
+}
+
+static __inline void
+mmx_pfsub(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->f[0] -= src->f[0];
+    dst->f[1] -= src->f[1];
+}
+
+static __inline void
+mmx_pfsubr(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->f[0] = src->f[0] - dst->f[0];
+    dst->f[1] = src->f[1] - dst->f[1];
+}
+
+static __inline void
+mmx_pfmul(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->f[0] *= src->f[0];
+    dst->f[1] *= src->f[1];
+}
+
+static __inline void
+mmx_pfmax(MMX_REG *dst, const MMX_REG *src)
+{
+    if (src->f[0] > dst->f[0])
+        dst->f[0] = src->f[0];
+    if (src->f[1] > dst->f[1])
+        dst->f[1] = src->f[1];
+}
+
+static __inline void
+mmx_pfmin(MMX_REG *dst, const MMX_REG *src)
+{
+    if (src->f[0] < dst->f[0])
+        dst->f[0] = src->f[0];
+    if (src->f[1] < dst->f[1])
+        dst->f[1] = src->f[1];
+}
+
+static __inline void
+mmx_pfcmpeq(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] = (dst->f[0] == src->f[0]) ? 0xffffffff : 0;
+    dst->l[1] = (dst->f[1] == src->f[1]) ? 0xffffffff : 0;
+}
+
+static __inline void
+mmx_pfcmpge(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] = (dst->f[0] >= src->f[0]) ? 0xffffffff : 0;
+    dst->l[1] = (dst->f[1] >= src->f[1]) ? 0xffffffff : 0;
+}
+
+static __inline void
+mmx_pfcmpgt(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->l[0] = (dst->f[0] > src->f[0]) ? 0xffffffff : 0;
+    dst->l[1] = (dst->f[1] > src->f[1]) ? 0xffffffff : 0;
+}
+
+static __inline void
+mmx_pfacc(MMX_REG *dst, const MMX_REG *src)
+{
+    float tempf = dst->f[0] + dst->f[1];
+
+    dst->f[1] = src->f[0] + src->f[1];
+    dst->f[0] = tempf;
+}
+
+static __inline void
+mmx_pfnacc(MMX_REG *dst, const MMX_REG *src)
+{
+    float tempf = dst->f[0] - dst->f[1];
+
+    dst->f[1] = src->f[0] - src->f[1];
+    dst->f[0] = tempf;
+}
+
+static __inline void
+mmx_pfpnacc(MMX_REG *dst, const MMX_REG *src)
+{
+    float tempf = dst->f[0] - dst->f[1];
+
+    dst->f[1] = src->f[0] + src->f[1];
+    dst->f[0] = tempf;
+}
+
+static __inline void
+mmx_pi2fd(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->f[0] = (float) src->sl[0];
+    dst->f[1] = (float) src->sl[1];
+}
+
+static __inline void
+mmx_pf2id(MMX_REG *dst, const MMX_REG *src)
+{
+    dst->sl[0] = (int32_t) src->f[0];
+    dst->sl[1] = (int32_t) src->f[1];
+}
+#endif
@@ -20,8 +20,10 @@
  *          Copyright 2016-2019 Miran Grca.
  *          Copyright 2018-2019 Fred N. van Kempen.
  */
+#include <float.h>
 #include <math.h>
 #include <fenv.h>
+#include <string.h>
 
 #if defined _M_X64 || defined __amd64__
 #        define X87_INLINE_ASM
@@ -1,3 +1,211 @@
+/* Host double fast path for FADD, FSUB, FMUL and FDIV.
+
+   The result and the exception flags are only taken from the host when they
+   are certain to be what softfloat would give under the current precision
+   and rounding control: both operands must be exact doubles, and the result
+   a normal double well inside the double exponent range. The exact error of
+   the host operation (TwoSum for add and subtract, an FMA for multiply and
+   divide) then tells whether the result was rounded and in which direction,
+   which gives the precision exception and C1. With 24-bit precision the host
+   result is rounded again, which gives the same result as rounding once as
+   long as the operands fit in 24 bits. Everything else, including NaNs,
+   infinities, denormals and results that would need 64-bit precision, goes
+   to softfloat as before. */
+#if defined(FLT_EVAL_METHOD) && (FLT_EVAL_METHOD == 0)
+#    define X87_SF_FAST
+#endif
+
+#ifdef X87_SF_FAST
+#    define X87_FAST_ADD 0
+#    define X87_FAST_MUL 1
+#    define X87_FAST_DIV 2
+
+/* Operands and results are kept between 2^-960 and 2^1000, so that neither
+   the error terms below nor the result can underflow or overflow. */
+#    define X87_FAST_EXP_MIN (-960)
+#    define X87_FAST_EXP_MAX 1000
+
+static __inline int
+x87_fast_to_double(floatx80 a, double *d)
+{
+    int      exp = (a.signExp & 0x7fff) - 0x3fff;
+    uint64_t bits;
+
+    if (!(a.signExp & 0x7fff) && !a.signif)
+        bits = 0;
+    else if ((exp < X87_FAST_EXP_MIN) || (exp > X87_FAST_EXP_MAX) || !(a.signif >> 63) || (a.signif & 0x7ff))
+        return 0;
+    else
+        bits = ((uint64_t) (exp + 1023) << 52) | ((a.signif >> 11) & 0x000fffffffffffffULL);
+
+    bits |= (uint64_t) (a.signExp & 0x8000) << 48;
+    memcpy(d, &bits, sizeof(double));
+    return 1;
+}
+
+static __inline floatx80
+x87_fast_from_bits(uint64_t bits)
+{
+    floatx80 r;
+    int      exp = (bits >> 52) & 0x7ff;
+
+    r.signExp = (bits >> 48) & 0x8000;
+    if (!exp)
+        r.signif = 0;
+    else {
+        r.signExp |= exp - 1023 + 0x3fff;
+        r.signif = 0x8000000000000000ULL | ((bits & 0x000fffffffffffffULL) << 11);
+    }
+
+    return r;
+}
+
+static __inline int
+x87_fast_op(floatx80 a, floatx80 b, int op, int negate_b, struct softfloat_status_t *status, floatx80 *result)
+{
+    int      nearest = (status->softfloat_roundingMode == softfloat_round_near_even);
+    int      prec    = status->extF80_roundingPrecision;
+    int      inexact;
+    int      round_up;
+    int      exp;
+    double   da;
+    double   db;
+    double   r;
+    double   t;
+    double   e = 0.0;
+    uint64_t bits;
+    uint64_t low;
+
+    if (!x87_fast_to_double(a, &da) || !x87_fast_to_double(b, &db))
+        return 0;
+
+    if (negate_b)
+        db = -db;
+
+    switch (op) {
+        case X87_FAST_ADD:
+            r = da + db;
+            /* The sign of an exact zero sum depends on the rounding mode. */
+            if ((r == 0.0) && !nearest)
+                return 0;
+            t = r - da;
+            e = (da - (r - t)) + (db - t);
+            break;
+        case X87_FAST_MUL:
+            r = da * db;
+            if (r != 0.0)
+                e = fma(da, db, -r);
+            break;
+        case X87_FAST_DIV:
+            if (db == 0.0)
+                return 0;
+            r = da / db;
+            /* The remainder has the sign of the error times that of the divisor. */
+            if (r != 0.0)
+                e = (db < 0.0) ? -fma(-r, db, da) : fma(-r, db, da);
+            break;
+        default:
+            return 0;
+    }
+
+    memcpy(&bits, &r, sizeof(double));
+    exp = (int) ((bits >> 52) & 0x7ff) - 1023;
+    if (r == 0.0) {
+        /* Only exact zeros, not products or quotients that underflowed. */
+        if ((op != X87_FAST_ADD) && (da != 0.0) && ((op == X87_FAST_DIV) || (db != 0.0)))
+            return 0;
+    } else if ((exp < X87_FAST_EXP_MIN) || (exp > X87_FAST_EXP_MAX))
+        return 0;
+
+    inexact  = (e != 0.0);
+    round_up = inexact && ((r < 0.0) != (e < 0.0));
+
+    switch (prec) {
+        case 32:
+            /* Double rounding through 53 bits is only harmless if the
+               operands themselves fit in 24 bits. */
+            if (inexact && ((a.signif | b.signif) & 0x000000ffffffffffULL))
+                return 0;
+            low = bits & 0x1fffffffULL;
+            if ((inexact || low) && !nearest)
+                return 0;
+            if (low) {
+                bits &= ~0x1fffffffULL;
+                inexact  = 1;
+                round_up = (low > 0x10000000ULL) || ((low == 0x10000000ULL) && (bits & 0x20000000ULL));
+                if (round_up)
+                    bits += 0x20000000ULL;
+            }
+            break;
+        case 64:
+            if (inexact && !nearest)
+                return 0;
+            break;
+        default:
+            if (inexact)
+                return 0;
+            break;
+    }
+
+    if (inexact) {
+        softfloat_raiseFlags(status, softfloat_flag_inexact);
+        if (round_up)
+            softfloat_setRoundingUp(status);
+    }
+
+    *result = x87_fast_from_bits(bits);
+    return 1;
+}
+#endif
+
+static __inline floatx80
+x87_sf_add(floatx80 a, floatx80 b, struct softfloat_status_t *status)
+{
+#ifdef X87_SF_FAST
+    floatx80 result;
+
+    if (x87_fast_op(a, b, X87_FAST_ADD, 0, status, &result))
+        return result;
+#endif
+    return extF80_add(a, b, status);
+}
+
+static __inline floatx80
+x87_sf_sub(floatx80 a, floatx80 b, struct softfloat_status_t *status)
+{
+#ifdef X87_SF_FAST
+    floatx80 result;
+
+    if (x87_fast_op(a, b, X87_FAST_ADD, 1, status, &result))
+        return result;
+#endif
+    return extF80_sub(a, b, status);
+}
+
+static __inline floatx80
+x87_sf_mul(floatx80 a, floatx80 b, struct softfloat_status_t *status)
+{
+#ifdef X87_SF_FAST
+    floatx80 result;
+
+    if (x87_fast_op(a, b, X87_FAST_MUL, 0, status, &result))
+        return result;
+#endif
+    return extF80_mul(a, b, status);
+}
+
+static __inline floatx80
+x87_sf_div(floatx80 a, floatx80 b, struct softfloat_status_t *status)
+{
+#ifdef X87_SF_FAST
+    floatx80 result;
+
+    if (x87_fast_op(a, b, X87_FAST_DIV, 0, status, &result))
+        return result;
+#endif
+    return extF80_div(a, b, status);
+}
+
 #define sf_FPU(name, optype, a_size, load_var, rw, use_var, is_nan, cycle_postfix)                                                                 \
     static int sf_FADD##name##_a##a_size(uint32_t fetchdat)                                                                                        \
     {                                                                                                                                              \
@@ -19,7 +227,7 @@
         status = i387cw_to_softfloat_status_word(i387_get_control_word());                                                                         \
         a      = FPU_read_regi(0);                                                                                                                 \
         if (!is_nan)                                                                                                                               \
-            result = extF80_add(a, use_var, &status);                                                                                              \
+            result = x87_sf_add(a, use_var, &status);                                                                                              \
                                                                                                                                                    \
         if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))                                                                          \
             FPU_save_regi(result, 0);                                                                                                              \
@@ -49,7 +257,7 @@ next_ins:
         status = i387cw_to_softfloat_status_word(i387_get_control_word());                                                                         \
         a      = FPU_read_regi(0);                                                                                                                 \
         if (!is_nan) {                                                                                                                             \
-            result = extF80_div(a, use_var, &status);                                                                                              \
+            result = x87_sf_div(a, use_var, &status);                                                                                              \
         }                                                                                                                                          \
         if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))                                                                          \
             FPU_save_regi(result, 0);                                                                                                              \
@@ -79,7 +287,7 @@ next_ins:
         status = i387cw_to_softfloat_status_word(i387_get_control_word());                                                                         \
         a      = FPU_read_regi(0);                                                                                                                 \
         if (!is_nan) {                                                                                                                             \
-            result = extF80_div(use_var, a, &status);                                                                                              \
+            result = x87_sf_div(use_var, a, &status);                                                                                              \
         }                                                                                                                                          \
         if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))                                                                          \
             FPU_save_regi(result, 0);                                                                                                              \
@@ -109,7 +317,7 @@ next_ins:
         status = i387cw_to_softfloat_status_word(i387_get_control_word());                                                                         \
         a      = FPU_read_regi(0);                                                                                                                 \
         if (!is_nan) {                                                                                                                             \
-            result = extF80_mul(a, use_var, &status);                                                                                              \
+            result = x87_sf_mul(a, use_var, &status);                                                                                              \
         }                                                                                                                                          \
         if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))                                                                          \
             FPU_save_regi(result, 0);                                                                                                              \
@@ -139,7 +347,7 @@ next_ins:
         status = i387cw_to_softfloat_status_word(i387_get_control_word());                                                                         \
         a      = FPU_read_regi(0);                                                                                                                 \
         if (!is_nan)                                                                                                                               \
-            result = extF80_sub(a, use_var, &status);                                                                                              \
+            result = x87_sf_sub(a, use_var, &status);                                                                                              \
                                                                                                                                                    \
         if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))                                                                          \
             FPU_save_regi(result, 0);                                                                                                              \
@@ -169,7 +377,7 @@ next_ins:
         status = i387cw_to_softfloat_status_word(i387_get_control_word());                                                                         \
         a      = FPU_read_regi(0);                                                                                                                 \
         if (!is_nan)                                                                                                                               \
-            result = extF80_sub(use_var, a, &status);                                                                                              \
+            result = x87_sf_sub(use_var, a, &status);                                                                                              \
                                                                                                                                                    \
         if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))                                                                          \
             FPU_save_regi(result, 0);                                                                                                              \
@@ -218,7 +426,7 @@ static int sf_FADD_st0_stj(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_add(a, b, &status);
+    result = x87_sf_add(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))
         FPU_save_regi(result, 0);
@@ -247,7 +455,7 @@ sf_FADD_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_add(a, b, &status);
+    result = x87_sf_add(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))
         FPU_save_regi(result, fetchdat & 7);
@@ -277,7 +485,7 @@ sf_FADDP_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_add(a, b, &status);
+    result = x87_sf_add(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -309,7 +517,7 @@ sf_FDIV_st0_stj(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_div(a, b, &status);
+    result = x87_sf_div(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))
         FPU_save_regi(result, 0);
@@ -339,7 +547,7 @@ sf_FDIV_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_div(a, b, &status);
+    result = x87_sf_div(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))
         FPU_save_regi(result, fetchdat & 7);
@@ -368,7 +576,7 @@ sf_FDIVP_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_div(a, b, &status);
+    result = x87_sf_div(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -400,7 +608,7 @@ sf_FDIVR_st0_stj(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_div(a, b, &status);
+    result = x87_sf_div(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))
         FPU_save_regi(result, 0);
@@ -429,7 +637,7 @@ sf_FDIVR_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_div(a, b, &status);
+    result = x87_sf_div(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0))
         FPU_save_regi(result, fetchdat & 7);
@@ -458,7 +666,7 @@ sf_FDIVRP_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_div(a, b, &status);
+    result = x87_sf_div(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -490,7 +698,7 @@ sf_FMUL_st0_stj(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_mul(a, b, &status);
+    result = x87_sf_mul(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, 0);
@@ -520,7 +728,7 @@ sf_FMUL_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_mul(a, b, &status);
+    result = x87_sf_mul(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -550,7 +758,7 @@ sf_FMULP_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_mul(a, b, &status);
+    result = x87_sf_mul(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -582,7 +790,7 @@ sf_FSUB_st0_stj(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_sub(a, b, &status);
+    result = x87_sf_sub(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, 0);
@@ -612,7 +820,7 @@ sf_FSUB_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_sub(a, b, &status);
+    result = x87_sf_sub(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -642,7 +850,7 @@ sf_FSUBP_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_sub(a, b, &status);
+    result = x87_sf_sub(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -674,7 +882,7 @@ sf_FSUBR_st0_stj(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(fetchdat & 7);
     b      = FPU_read_regi(0);
-    result = extF80_sub(a, b, &status);
+    result = x87_sf_sub(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, 0);
@@ -704,7 +912,7 @@ sf_FSUBR_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_sub(a, b, &status);
+    result = x87_sf_sub(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -734,7 +942,7 @@ sf_FSUBRP_sti_st0(uint32_t fetchdat)
     status = i387cw_to_softfloat_status_word(i387_get_control_word());
     a      = FPU_read_regi(0);
     b      = FPU_read_regi(fetchdat & 7);
-    result = extF80_sub(a, b, &status);
+    result = x87_sf_sub(a, b, &status);
 
     if (!FPU_exception(fetchdat, status.softfloat_exceptionFlags, 0)) {
         FPU_save_regi(result, fetchdat & 7);
@@ -54,6 +54,8 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/sound.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/ui.h>
 
 #define DEVICE_MAX 256 /* max # of devices */
@@ -349,6 +351,35 @@ device_reset_all(uint32_t match_flags)
     }
 }
 
+const char *
+snapshot_unsupported(void)
+{
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if ((devices[c] != NULL) && (devices[c]->serialize == NULL))
+            return devices[c]->name;
+    }
+
+    return NULL;
+}
+
+void
+device_serialize_all(snapshot_t *snap)
+{
+    for (uint16_t c = 0; c < DEVICE_MAX; c++) {
+        if (devices[c] == NULL)
+            continue;
+
+        /* The device list is rebuilt from the configuration on hard reset,
+           so the same device has to sit in the same slot on restore. */
+        snapshot_section(snap, devices[c]->internal_name ? devices[c]->internal_name : devices[c]->name);
+        if (snap->error)
+            return;
+
+        device_log("Serializing device: \"%s\"...\n", devices[c]->name);
+        devices[c]->serialize(device_priv[c], snap);
+    }
+}
+
 void *
 device_find_first_priv(uint32_t match_flags)
 {
@@ -38,6 +38,7 @@
 #include <86box/fdc.h>
 #include <86box/pci.h>
 #include <86box/keyboard.h>
+#include <86box/snapshot.h>
 
 #define STAT_PARITY        0x80
 #define STAT_RTIMEOUT      0x40
@@ -2866,6 +2867,54 @@ kbc_at_set_irq(int num, uint16_t irq, void *priv)
     dev->irq[num] = irq;
 }
 
+static void
+kbc_at_serialize(void *priv, snapshot_t *snap)
+{
+    atkbc_t *dev = (atkbc_t *) priv;
+    atkbc_t  tmp = *dev;
+
+    SNAPSHOT_VAR(snap, tmp);
+    SNAPSHOT_VAR(snap, fast_reset);
+
+    /* The devices behind the ports own priv and poll, the KBC owns the rest. */
+    for (int i = 0; i < 2; i++) {
+        if (kbc_at_ports[i] == NULL)
+            continue;
+
+        SNAPSHOT_VAR(snap, kbc_at_ports[i]->wantcmd);
+        SNAPSHOT_VAR(snap, kbc_at_ports[i]->dat);
+        SNAPSHOT_VAR(snap, kbc_at_ports[i]->out_new);
+    }
+
+    if (!snap->saving && !snap->error) {
+        uint8_t  enable[2] = { tmp.handler_enable[0], tmp.handler_enable[1] };
+        uint16_t base[2]   = { tmp.base_addr[0], tmp.base_addr[1] };
+
+        for (int i = 0; i < 2; i++)
+            kbc_at_port_handler(i, 0, 0x0000, dev);
+
+        tmp.kbc_poll_timer     = dev->kbc_poll_timer;
+        tmp.kbc_dev_poll_timer = dev->kbc_dev_poll_timer;
+        tmp.pulse_cb           = dev->pulse_cb;
+        memcpy(tmp.ports, dev->ports, sizeof(tmp.ports));
+        memcpy(tmp.handlers, dev->handlers, sizeof(tmp.handlers));
+        tmp.write_cmd_data_ven = dev->write_cmd_data_ven;
+        tmp.write_cmd_ven      = dev->write_cmd_ven;
+        tmp.handler_enable[0]  = 0;
+        tmp.handler_enable[1]  = 0;
+        *dev                   = tmp;
+
+        for (int i = 0; i < 2; i++)
+            kbc_at_port_handler(i, enable[i], base[i], dev);
+
+        kbc_at_do_poll = (dev->misc_flags & FLAG_PS2) ? kbc_at_poll_ps2 : kbc_at_poll_at;
+    }
+
+    snapshot_timer(snap, &dev->kbc_poll_timer);
+    snapshot_timer(snap, &dev->kbc_dev_poll_timer);
+    snapshot_timer(snap, &dev->pulse_cb);
+}
+
 static void *
 kbc_at_init(const device_t *info)
 {
@@ -3040,5 +3089,6 @@ const device_t kbc_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = kbc_at_serialize
 };
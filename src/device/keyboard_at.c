@@ -26,6 +26,8 @@
 #include <86box/keyboard.h>
 #include <86box/mouse.h>
 #include <86box/machine.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 
 #define FIFO_SIZE      16
 
@@ -6180,6 +6182,34 @@ keyboard_at_close(void *priv)
     free(dev);
 }
 
+static void
+keyboard_at_serialize(void *priv, snapshot_t *snap)
+{
+    atkbc_dev_t *dev = (atkbc_dev_t *) priv;
+    atkbc_dev_t  tmp = *dev;
+
+    SNAPSHOT_VAR(snap, tmp);
+    SNAPSHOT_VAR(snap, keyboard_mode);
+    SNAPSHOT_VAR(snap, keyboard_scan);
+    SNAPSHOT_VAR(snap, keyboard_set3_flags);
+    SNAPSHOT_VAR(snap, keyboard_set3_all_repeat);
+    SNAPSHOT_VAR(snap, keyboard_set3_all_break);
+    SNAPSHOT_VAR(snap, inv_cmd_response);
+    SNAPSHOT_VAR(snap, is_special);
+    SNAPSHOT_VAR(snap, bat_counter);
+
+    if (!snap->saving && !snap->error) {
+        tmp.name        = dev->name;
+        tmp.scan        = dev->scan;
+        tmp.process_cmd = dev->process_cmd;
+        tmp.execute_bat = dev->execute_bat;
+        tmp.port        = dev->port;
+        *dev            = tmp;
+
+        keyboard_at_set_scancode_set(dev);
+    }
+}
+
 static const device_config_t keyboard_at_config[] = {
   // clang-format off
     {
@@ -6242,7 +6272,8 @@ const device_t keyboard_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_at_config
+    .config        = keyboard_at_config,
+    .serialize     = keyboard_at_serialize
 };
 
 const device_t keyboard_ax_device = {
@@ -6256,7 +6287,8 @@ const device_t keyboard_ax_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = keyboard_at_serialize
 };
 
 const device_t keyboard_ps2_device = {
@@ -6270,7 +6302,8 @@ const device_t keyboard_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_ps2_config
+    .config        = keyboard_ps2_config,
+    .serialize     = keyboard_at_serialize
 };
 
 const device_t keyboard_ps55_device = {
@@ -6284,7 +6317,8 @@ const device_t keyboard_ps55_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = keyboard_at_serialize
 };
 
 const device_t keyboard_at_generic_device = {
@@ -6298,6 +6332,7 @@ const device_t keyboard_at_generic_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = keyboard_at_config
+    .config        = keyboard_at_config,
+    .serialize     = keyboard_at_serialize
 };
 
@@ -16,6 +16,7 @@
 #include <86box/device.h>
 #include <86box/dma.h>
 #include <86box/lpt.h>
+#include <86box/snapshot.h>
 #include <86box/pic.h>
 #include <86box/sound.h>
 #include <86box/prt_devs.h>
@@ -938,6 +939,42 @@ lpt_reset(void *priv)
     }
 }
 
+static void
+lpt_serialize(void *priv, snapshot_t *snap)
+{
+    lpt_t   *dev = (lpt_t *) priv;
+    lpt_t    tmp = *dev;
+    uint16_t addr;
+
+    if (!lpt_ports[dev->id].enabled)
+        return;
+
+    /* Printers and the like keep their own state outside the port. */
+    if (dev->dt->priv != NULL) {
+        pclog("Snapshot: parallel port %i has a device attached\n", dev->id + 1);
+        snap->error = 1;
+        return;
+    }
+
+    SNAPSHOT_VAR(snap, tmp);
+    fifo_serialize(dev->fifo, 16, snap);
+
+    if (!snap->saving && !snap->error) {
+        addr = tmp.addr;
+        lpt_port_remove(dev);
+
+        tmp.dt             = dev->dt;
+        tmp.fifo           = dev->fifo;
+        tmp.fifo_out_timer = dev->fifo_out_timer;
+        tmp.addr           = 0xffff;
+        *dev               = tmp;
+
+        lpt_port_setup(dev, addr);
+    }
+
+    snapshot_timer(snap, &dev->fifo_out_timer);
+}
+
 static void *
 lpt_init(const device_t *info)
 {
@@ -1046,5 +1083,6 @@ const device_t lpt_port_device = {
     .available     = NULL,
     .speed_changed = lpt_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = lpt_serialize
 };
@@ -34,6 +34,7 @@
 #include <86box/rom.h>
 #include <86box/fifo.h>
 #include <86box/serial.h>
+#include <86box/snapshot.h>
 #include <86box/mouse.h>
 
 serial_port_t com_ports[SERIAL_MAX];
@@ -938,6 +939,50 @@ serial_reset(void *priv)
     }
 }
 
+static void
+serial_serialize(void *priv, snapshot_t *snap)
+{
+    serial_t *dev = (serial_t *) priv;
+    serial_t  tmp = *dev;
+    uint16_t  base;
+
+    /* Disabled port, nothing behind it. */
+    if (dev->sd == NULL)
+        return;
+
+    /* Whatever is attached keeps its own state outside the UART. */
+    if ((dev->sd->priv != NULL) || (dev->sd->dev_write != NULL)) {
+        pclog("Snapshot: serial port %i has a device attached\n", dev->inst + 1);
+        snap->error = 1;
+        return;
+    }
+
+    SNAPSHOT_VAR(snap, tmp);
+    fifo_serialize(dev->rcvr_fifo, 64, snap);
+    fifo_serialize(dev->xmit_fifo, 64, snap);
+
+    if (!snap->saving && !snap->error) {
+        base = tmp.base_address;
+        serial_remove(dev);
+
+        tmp.rcvr_fifo      = dev->rcvr_fifo;
+        tmp.xmit_fifo      = dev->xmit_fifo;
+        tmp.transmit_timer = dev->transmit_timer;
+        tmp.timeout_timer  = dev->timeout_timer;
+        tmp.receive_timer  = dev->receive_timer;
+        tmp.sd             = dev->sd;
+        tmp.base_address   = dev->base_address;
+        *dev               = tmp;
+
+        if (base != dev->base_address)
+            serial_setup(dev, base, dev->irq);
+    }
+
+    snapshot_timer(snap, &dev->transmit_timer);
+    snapshot_timer(snap, &dev->timeout_timer);
+    snapshot_timer(snap, &dev->receive_timer);
+}
+
 static void *
 serial_init(const device_t *info)
 {
@@ -1041,7 +1086,8 @@ const device_t ns8250_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns8250_pcjr_3f8_device = {
@@ -1055,7 +1101,8 @@ const device_t ns8250_pcjr_3f8_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns8250_pcjr_2f8_device = {
@@ -1069,7 +1116,8 @@ const device_t ns8250_pcjr_2f8_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns16450_device = {
@@ -1083,7 +1131,8 @@ const device_t ns16450_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns16550_device = {
@@ -1097,7 +1146,8 @@ const device_t ns16550_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns16650_device = {
@@ -1111,7 +1161,8 @@ const device_t ns16650_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns16750_device = {
@@ -1125,7 +1176,8 @@ const device_t ns16750_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns16850_device = {
@@ -1139,7 +1191,8 @@ const device_t ns16850_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
 
 const device_t ns16950_device = {
@@ -1153,5 +1206,6 @@ const device_t ns16950_device = {
     .available     = NULL,
     .speed_changed = serial_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = serial_serialize
 };
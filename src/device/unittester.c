@@ -117,6 +117,8 @@ static bitmap_t *unittester_screen_buffer = NULL;
 
 static bool unittester_exit_enabled = true;
 
+void (*unittester_exit_func)(int code) = NULL;
+
 #ifdef ENABLE_UNITTESTER_LOG
 int unittester_do_log = ENABLE_UNITTESTER_LOG;
 
@@ -292,7 +294,10 @@ unittester_write(uint16_t port, uint8_t val, UNUSED(void *priv))
 
                         /* Exit somewhat quickly! */
                         unittester_log("[UT] Exit enabled, exiting with code %02X\n", unittester.exit_code);
-                        exit(unittester.exit_code);
+                        if (unittester_exit_func)
+                            unittester_exit_func(unittester.exit_code);
+                        else
+                            exit(unittester.exit_code);
 
                     } else {
                         /* No - report successful command completion and continue program execution */
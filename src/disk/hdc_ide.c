@@ -17,6 +17,7 @@
  */
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -46,6 +47,7 @@
 #include <86box/hdd.h>
 #include <86box/rdisk.h>
 #include <86box/version.h>
+#include <86box/snapshot.h>
 
 /* Bits of 'atastat' */
 #define ERR_STAT     0x01 /* Error */
@@ -96,6 +98,7 @@
 #define WIN_SETIDLE1                   0xe3
 #define WIN_CHECKPOWERMODE1            0xe5
 #define WIN_SLEEP1                     0xe6
+#define WIN_FLUSH_CACHE                0xe7
 #define WIN_IDENTIFY                   0xec /* Ask drive to identify itself */
 #define WIN_SET_FEATURES               0xef
 #define WIN_READ_NATIVE_MAX            0xf8
@@ -1916,6 +1919,7 @@ ide_writeb(uint16_t addr, uint8_t val, void *priv)
                 case WIN_SETIDLE1:          /* Idle */
                 case WIN_CHECKPOWERMODE1:
                 case WIN_SLEEP1:
+                case WIN_FLUSH_CACHE:
                     ide->tf->atastat = BSY_STAT;
                     ide_callback(ide);
                     break;
@@ -2272,6 +2276,7 @@ ide_callback(void *priv)
 {
     ide_t *         ide = (ide_t *) priv;
     const ide_bm_t *bm  = ide_boards[ide->board]->bm;
+    const uint8_t * mapped;
     int             chk_chs;
     int             ret;
     uint8_t         err = 0x00;
@@ -2344,6 +2349,18 @@ ide_callback(void *priv)
             ide_irq_raise(ide);
             break;
 
+        case WIN_FLUSH_CACHE:
+            if (ide->type != IDE_HDD)
+                err = ABRT_ERR;
+            else if (hdd_image_flush(ide->hdd_num) < 0) {
+                ide_log("IDE %i: Cache flush failed\n", ide->channel);
+                err = UNC_ERR;
+            } else {
+                ide->tf->atastat = DRDY_STAT | DSC_STAT;
+                ide_irq_raise(ide);
+            }
+            break;
+
         case WIN_READ:
         case WIN_READ_NORETRY:
             if (ide->type == IDE_ATAPI) {
@@ -2394,12 +2411,18 @@ ide_callback(void *priv)
 
                 ide->tf->pos = 0;
 
-                if (hdd_image_read(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0) {
+                /* Memory-mapped images are transferred straight from the mapping,
+                   which the bus master only reads from in this direction. */
+                mapped = hdd_image_get_ptr(ide->hdd_num, ide_get_sector(ide), ide->sector_pos);
+
+                if ((mapped == NULL) &&
+                    (hdd_image_read(ide->hdd_num, ide_get_sector(ide), ide->sector_pos, ide->sector_buffer) < 0)) {
                     ide_log("IDE %i: DMA read aborted (image read error)\n", ide->channel);
                     err = UNC_ERR;
                 } else if (!ide_boards[ide->board]->force_ata3 && bm->dma) {
                     /* We should not abort - we should simply wait for the host to start DMA. */
-                    ret = bm->dma(ide->sector_buffer, ide->sector_pos * 512, 0, 0, bm->priv);
+                    ret = bm->dma((mapped != NULL) ? (uint8_t *) mapped : ide->sector_buffer,
+                                  ide->sector_pos * 512, 0, 0, bm->priv);
                     if (ret == 2) {
                         /* Bus master DMA disabled, simply wait for the host to enable DMA. */
                         ide->tf->atastat = DRQ_STAT | DRDY_STAT | DSC_STAT;
@@ -3463,6 +3486,61 @@ mcide_close(void *priv)
     free(dev);
 }
 
+/* Everything that is not a pointer sits ahead of the buffers, in both the
+   board and the drive. The disk images themselves are not part of the
+   snapshot; they are flushed so that the state matches what is on disk. */
+static void
+ide_serialize_drive(snapshot_t *snap, ide_t *ide)
+{
+    if ((ide->type & ~IDE_SHADOW) == IDE_ATAPI) {
+        pclog("Snapshot: IDE channel %i has an ATAPI device\n", ide->channel);
+        snap->error = 1;
+        return;
+    }
+
+    if (snap->saving && (ide->type == IDE_HDD) && (ide->hdd_num != -1) && (hdd_image_flush(ide->hdd_num) < 0)) {
+        pclog("Snapshot: Could not flush hard disk %i\n", ide->hdd_num);
+        snap->error = 1;
+        return;
+    }
+
+    snapshot_io(snap, ide, offsetof(ide_t, buffer));
+    SNAPSHOT_VAR(snap, ide->interrupt_drq);
+    SNAPSHOT_VAR(snap, ide->pending_delay);
+    if (!(ide->type & IDE_SHADOW))
+        snapshot_io(snap, ide->tf, sizeof(ide_tf_t));
+    if (ide->buffer != NULL)
+        snapshot_io(snap, ide->buffer, 65536 * sizeof(uint16_t));
+    if (ide->sector_buffer != NULL)
+        snapshot_io(snap, ide->sector_buffer, 256 * 512);
+
+    snapshot_timer(snap, &ide->timer);
+}
+
+static void
+ide_serialize(UNUSED(void *priv), snapshot_t *snap)
+{
+    ide_board_t *dev;
+
+    for (int board = 0; board < 2; board++) {
+        dev = ide_boards[board];
+        if ((dev == NULL) || !dev->inited)
+            continue;
+
+        if (dev->bm != NULL) {
+            pclog("Snapshot: IDE board %i is a bus master\n", board);
+            snap->error = 1;
+            return;
+        }
+
+        snapshot_io(snap, dev, offsetof(ide_board_t, timer));
+        snapshot_timer(snap, &dev->timer);
+
+        for (int d = 0; (d < 2) && !snap->error; d++)
+            ide_serialize_drive(snap, ide_drives[(board << 1) + d]);
+    }
+}
+
 const device_t ide_isa_device = {
     .name          = "ISA PC/AT IDE Controller",
     .internal_name = "ide_isa",
@@ -3474,7 +3552,8 @@ const device_t ide_isa_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = ide_serialize
 };
 
 const device_t ide_isa_sec_device = {
@@ -3502,7 +3581,8 @@ const device_t ide_isa_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = ide_serialize
 };
 
 const device_t ide_vlb_device = {
@@ -3516,7 +3596,8 @@ const device_t ide_vlb_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = ide_serialize
 };
 
 const device_t ide_vlb_sec_device = {
@@ -3544,7 +3625,8 @@ const device_t ide_vlb_2ch_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = ide_serialize
 };
 
 const device_t ide_pci_device = {
@@ -24,7 +24,8 @@
 #include <time.h>
 #include <wchar.h>
 #include <errno.h>
-#ifdef __unix__
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
 #include <unistd.h>
 #endif
 #define HAVE_STDARG_H
@@ -32,6 +33,7 @@
 #include <86box/path.h>
 #include <86box/plat.h>
 #include <86box/random.h>
+#include <86box/thread.h>
 #include <86box/hdd.h>
 #include "minivhd/minivhd.h"
 #include "minivhd/internal.h"
@@ -41,19 +43,102 @@
 #define HDD_IMAGE_HDX 2
 #define HDD_IMAGE_VHD 3
 
+#if defined(__unix__) || defined(__APPLE__)
+#    define HDD_IMAGE_PIO  /* pread()/pwrite() are available. */
+#    define HDD_IMAGE_MMAP /* mmap() is available. */
+#endif
+
+/* Write-back cache geometry: 256 extents of 64 kB (128 sectors) each. */
+#define HDD_EXTENT_SHIFT   7
+#define HDD_EXTENT_SECTORS (1 << HDD_EXTENT_SHIFT)
+#define HDD_EXTENT_MASK    (HDD_EXTENT_SECTORS - 1)
+#define HDD_EXTENT_SIZE    (HDD_EXTENT_SECTORS << 9)
+#define HDD_EXTENTS        256
+#define HDD_EXTENT_HASH    512
+
+/* The worker starts writing back early once this many extents are dirty,
+   and otherwise flushes everything once the guest has stopped writing for
+   one worker period. */
+#define HDD_WB_HIGH_WATER  (HDD_EXTENTS / 2)
+#define HDD_WB_LOW_WATER   (HDD_EXTENTS / 8)
+#define HDD_WB_PERIOD_MS   500
+
+typedef struct hdd_extent_t {
+    uint32_t             index; /* Sector number >> HDD_EXTENT_SHIFT. */
+    uint32_t             seq;   /* Incremented on every write to the extent. */
+    uint64_t             valid[HDD_EXTENT_SECTORS / 64];
+    uint64_t             dirty[HDD_EXTENT_SECTORS / 64];
+    uint64_t             lru;
+    uint8_t             *data;
+    uint8_t              used;
+    struct hdd_extent_t *hash_next;
+} hdd_extent_t;
+
+typedef struct hdd_wb_cache_t {
+    hdd_extent_t  extents[HDD_EXTENTS];
+    hdd_extent_t *hash[HDD_EXTENT_HASH];
+    uint8_t      *data;
+    uint8_t      *wb_buf; /* Private copy of the extent being written back. */
+    uint64_t      lru_clock;
+    int           used;
+    int           dirty;
+    int           writes; /* Guest writes since the worker last woke up. */
+    volatile int  quit;
+
+    thread_t *thread;
+    event_t  *wake_event;
+    mutex_t  *mutex;    /* Protects the extents and the counters. */
+    mutex_t  *io_mutex; /* Serializes write-backs to the image file. */
+} hdd_wb_cache_t;
+
+/* Copy-on-write overlay: a small header, a map of which blocks of the base
+   image have been copied into the overlay, and the copied blocks. Blocks
+   are copied up whole on the first write, so reads only need the map. */
+#define HDD_OVL_MAGIC         "86BoxOVL"
+#define HDD_OVL_VERSION       1
+#define HDD_OVL_BLOCK_SECTORS 128
+#define HDD_OVL_BLOCK_SIZE    (HDD_OVL_BLOCK_SECTORS << 9)
+#define HDD_OVL_MAP_OFFSET    0x200
+
+typedef struct hdd_ovl_header_t {
+    char     magic[8];
+    uint32_t version;
+    uint32_t block_sectors;
+    uint32_t blocks;
+    uint32_t pad;
+    uint64_t sectors; /* Size of the base image, in sectors. */
+} hdd_ovl_header_t;
+
+typedef struct hdd_overlay_t {
+    FILE     *file;
+    uint32_t *map;    /* Overlay block number + 1, or 0 if the block is only in the base image. */
+    uint32_t  blocks;
+    uint32_t  used;   /* Number of blocks allocated in the overlay. */
+    uint64_t  data_offset;
+    uint8_t  *buffer; /* Copy-up buffer. */
+} hdd_overlay_t;
+
 typedef struct hdd_image_t {
-    FILE     *file; /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
-    MVHDMeta *vhd;  /* Used for HDD_IMAGE_VHD. */
-    uint32_t  base;
-    uint32_t  pos;
-    uint32_t  last_sector;
-    uint8_t   type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
-    uint8_t   loaded;
+    FILE           *file;  /* Used for HDD_IMAGE_RAW, HDD_IMAGE_HDI, and HDD_IMAGE_HDX. */
+    MVHDMeta       *vhd;   /* Used for HDD_IMAGE_VHD. */
+    hdd_overlay_t  *overlay; /* Copy-on-write overlay, NULL if writes go to the image. */
+    hdd_wb_cache_t *cache; /* Write-back cache, NULL in write-through mode. */
+    uint8_t        *map;   /* Mapping of the whole file in memory-mapped mode. */
+    uint64_t        map_size;
+#ifndef HDD_IMAGE_PIO
+    mutex_t        *file_mutex; /* Guards the stdio file position in write-back mode. */
+#endif
+    uint32_t        base;
+    uint32_t        pos;
+    uint32_t        last_sector;
+    uint8_t         type; /* HDD_IMAGE_RAW, HDD_IMAGE_HDI, HDD_IMAGE_HDX, or HDD_IMAGE_VHD */
+    uint8_t         loaded;
 } hdd_image_t;
 
 hdd_image_t hdd_images[HDD_NUM];
 
-static char  empty_sector[512];
+static char    empty_sector[512];
+static uint8_t zero_buffer[HDD_EXTENT_SIZE];
 #ifndef __unix__
 static char *empty_sector_1mb;
 #endif
@@ -140,6 +225,607 @@ image_is_vhd(const char *s, int check_signature)
         return 0;
 }
 
+/* Positional I/O on an image file, so that the write-back worker never has
+   to share a file position with the emulation thread. Returns the number of
+   bytes transferred, or -1 on error. */
+static int64_t
+hdd_file_io(FILE *fp, void *buf, uint32_t len, uint64_t offset, int write)
+{
+    int64_t done = 0;
+
+#ifdef HDD_IMAGE_PIO
+    int fd = fileno(fp);
+
+    while (done < len) {
+        ssize_t ret;
+
+        if (write)
+            ret = pwrite(fd, ((uint8_t *) buf) + done, len - done, (off_t) (offset + done));
+        else
+            ret = pread(fd, ((uint8_t *) buf) + done, len - done, (off_t) (offset + done));
+
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        } else if (ret == 0)
+            break;
+
+        done += ret;
+    }
+#else
+    if (fseeko64(fp, offset, SEEK_SET) == -1)
+        done = -1;
+    else if (write) {
+        done = fwrite(buf, 1, len, fp);
+        fflush(fp);
+    } else
+        done = fread(buf, 1, len, fp);
+#endif
+
+    return done;
+}
+
+static int64_t
+hdd_image_file_io(hdd_image_t *img, void *buf, uint32_t len, uint64_t offset, int write)
+{
+#ifdef HDD_IMAGE_PIO
+    return hdd_file_io(img->file, buf, len, offset, write);
+#else
+    int64_t ret;
+
+    if (img->file_mutex)
+        thread_wait_mutex(img->file_mutex);
+
+    ret = hdd_file_io(img->file, buf, len, offset, write);
+
+    if (img->file_mutex)
+        thread_release_mutex(img->file_mutex);
+
+    return ret;
+#endif
+}
+
+static __inline hdd_extent_t *
+hdd_wb_lookup(hdd_wb_cache_t *cache, uint32_t index)
+{
+    hdd_extent_t *ext = cache->hash[index % HDD_EXTENT_HASH];
+
+    while ((ext != NULL) && (ext->index != index))
+        ext = ext->hash_next;
+
+    return ext;
+}
+
+static __inline int
+hdd_wb_sector_set(const uint64_t *bits, uint32_t sector)
+{
+    return !!(bits[sector >> 6] & (1ULL << (sector & 63)));
+}
+
+static __inline int
+hdd_wb_is_dirty(const hdd_extent_t *ext)
+{
+    return !!(ext->dirty[0] | ext->dirty[1]);
+}
+
+/* Write the dirty sectors of an extent back to the image file, coalescing
+   runs of dirty sectors into single writes. The caller must hold io_mutex
+   and must not hold mutex. */
+static int
+hdd_wb_write_back(hdd_image_t *img, hdd_extent_t *ext)
+{
+    hdd_wb_cache_t *cache = img->cache;
+    uint64_t        dirty[HDD_EXTENT_SECTORS / 64];
+    uint32_t        index;
+    uint32_t        seq;
+    uint32_t        i = 0;
+    int             ret = 0;
+
+    thread_wait_mutex(cache->mutex);
+    if (!ext->used || !hdd_wb_is_dirty(ext)) {
+        thread_release_mutex(cache->mutex);
+        return 0;
+    }
+    index = ext->index;
+    seq   = ext->seq;
+    memcpy(dirty, ext->dirty, sizeof(dirty));
+    memcpy(cache->wb_buf, ext->data, HDD_EXTENT_SIZE);
+    thread_release_mutex(cache->mutex);
+
+    while (i < HDD_EXTENT_SECTORS) {
+        uint32_t start;
+        uint64_t offset;
+
+        if (!hdd_wb_sector_set(dirty, i)) {
+            i++;
+            continue;
+        }
+
+        start = i;
+        while ((i < HDD_EXTENT_SECTORS) && hdd_wb_sector_set(dirty, i))
+            i++;
+
+        offset = ((((uint64_t) index << HDD_EXTENT_SHIFT) + start) << 9) + img->base;
+        if (hdd_image_file_io(img, cache->wb_buf + (start << 9), (i - start) << 9, offset, 1) != ((i - start) << 9))
+            ret = -1;
+    }
+
+    thread_wait_mutex(cache->mutex);
+    /* If the guest has written to the extent in the meantime, leave it dirty
+       so that the newer data gets written on the next pass. */
+    if (!ret && ext->used && (ext->index == index) && (ext->seq == seq)) {
+        memset(ext->dirty, 0x00, sizeof(ext->dirty));
+        cache->dirty--;
+    }
+    thread_release_mutex(cache->mutex);
+
+    return ret;
+}
+
+/* Write back the least recently used dirty extent, returns 1 if one was
+   written back, 0 if there was none left, or -1 on a write error. */
+static int
+hdd_wb_write_back_oldest(hdd_image_t *img)
+{
+    hdd_wb_cache_t *cache  = img->cache;
+    hdd_extent_t   *oldest = NULL;
+    int             ret    = 0;
+
+    thread_wait_mutex(cache->io_mutex);
+
+    thread_wait_mutex(cache->mutex);
+    for (int i = 0; i < HDD_EXTENTS; i++) {
+        hdd_extent_t *ext = &cache->extents[i];
+
+        if (ext->used && hdd_wb_is_dirty(ext) && ((oldest == NULL) || (ext->lru < oldest->lru)))
+            oldest = ext;
+    }
+    thread_release_mutex(cache->mutex);
+
+    if (oldest != NULL) {
+        ret = 1;
+        if (hdd_wb_write_back(img, oldest) < 0) {
+            hdd_image_log("Hard disk image: Write-back error\n");
+            ret = -1;
+        }
+    }
+
+    thread_release_mutex(cache->io_mutex);
+
+    return ret;
+}
+
+/* Write back every dirty extent, stopping at the first write error so that
+   a failing host disk does not make us retry forever. Returns -1 on error. */
+static int
+hdd_wb_flush(hdd_image_t *img)
+{
+    int ret;
+
+    while ((ret = hdd_wb_write_back_oldest(img)) > 0)
+        ;
+
+    return ret;
+}
+
+static void
+hdd_wb_thread(void *priv)
+{
+    hdd_image_t    *img   = (hdd_image_t *) priv;
+    hdd_wb_cache_t *cache = img->cache;
+
+    while (!cache->quit) {
+        int idle;
+        int dirty;
+
+        thread_wait_event(cache->wake_event, HDD_WB_PERIOD_MS);
+        thread_reset_event(cache->wake_event);
+
+        thread_wait_mutex(cache->mutex);
+        idle          = !cache->writes;
+        cache->writes = 0;
+        dirty         = cache->dirty;
+        thread_release_mutex(cache->mutex);
+
+        if (idle || cache->quit)
+            hdd_wb_flush(img);
+        else if (dirty > HDD_WB_HIGH_WATER) {
+            while (dirty > HDD_WB_LOW_WATER) {
+                if (hdd_wb_write_back_oldest(img) <= 0)
+                    break;
+
+                thread_wait_mutex(cache->mutex);
+                dirty = cache->dirty;
+                thread_release_mutex(cache->mutex);
+            }
+        }
+    }
+}
+
+/* Find or allocate the extent for the given index. Called with mutex held
+   from the emulation thread; may temporarily drop it to write back a
+   victim. Returns NULL if the victim could not be written back, in which
+   case it is left in the cache, still dirty. */
+static hdd_extent_t *
+hdd_wb_get(hdd_image_t *img, uint32_t index)
+{
+    hdd_wb_cache_t *cache = img->cache;
+    hdd_extent_t   *ext   = hdd_wb_lookup(cache, index);
+    hdd_extent_t  **pp;
+
+    if (ext != NULL)
+        return ext;
+
+    if (cache->used < HDD_EXTENTS)
+        ext = &cache->extents[cache->used++];
+    else {
+        /* Prefer the least recently used clean extent, and only write back
+           a dirty one if there is no other choice. */
+        hdd_extent_t *clean = NULL;
+
+        for (int i = 0; i < HDD_EXTENTS; i++) {
+            hdd_extent_t *e = &cache->extents[i];
+
+            if (hdd_wb_is_dirty(e)) {
+                if ((ext == NULL) || (e->lru < ext->lru))
+                    ext = e;
+            } else if ((clean == NULL) || (e->lru < clean->lru))
+                clean = e;
+        }
+
+        if (clean != NULL)
+            ext = clean;
+        else {
+            int ret;
+
+            thread_release_mutex(cache->mutex);
+            thread_wait_mutex(cache->io_mutex);
+            ret = hdd_wb_write_back(img, ext);
+            thread_release_mutex(cache->io_mutex);
+            thread_wait_mutex(cache->mutex);
+
+            if (ret < 0) {
+                hdd_image_log("Hard disk image: Write-back error\n");
+                return NULL;
+            }
+        }
+
+        /* Unlink the victim from its hash chain. */
+        pp = &cache->hash[ext->index % HDD_EXTENT_HASH];
+        while (*pp != ext)
+            pp = &(*pp)->hash_next;
+        *pp = ext->hash_next;
+
+        if (hdd_wb_is_dirty(ext))
+            cache->dirty--;
+    }
+
+    memset(ext->valid, 0x00, sizeof(ext->valid));
+    memset(ext->dirty, 0x00, sizeof(ext->dirty));
+    ext->index     = index;
+    ext->used      = 1;
+    ext->hash_next = cache->hash[index % HDD_EXTENT_HASH];
+    cache->hash[index % HDD_EXTENT_HASH] = ext;
+
+    return ext;
+}
+
+static int
+hdd_wb_write(hdd_image_t *img, uint32_t sector, uint32_t count, const uint8_t *buffer)
+{
+    hdd_wb_cache_t *cache = img->cache;
+    int             wake;
+
+    thread_wait_mutex(cache->mutex);
+
+    while (count > 0) {
+        hdd_extent_t *ext   = hdd_wb_get(img, sector >> HDD_EXTENT_SHIFT);
+        uint32_t      first = sector & HDD_EXTENT_MASK;
+        uint32_t      num   = HDD_EXTENT_SECTORS - first;
+
+        if (ext == NULL) {
+            thread_release_mutex(cache->mutex);
+            return -1;
+        }
+
+        if (num > count)
+            num = count;
+
+        memcpy(ext->data + (first << 9), buffer, num << 9);
+
+        if (!hdd_wb_is_dirty(ext))
+            cache->dirty++;
+        for (uint32_t i = first; i < (first + num); i++) {
+            ext->valid[i >> 6] |= (1ULL << (i & 63));
+            ext->dirty[i >> 6] |= (1ULL << (i & 63));
+        }
+        ext->seq++;
+        ext->lru = cache->lru_clock++;
+
+        sector += num;
+        count -= num;
+        buffer += (num << 9);
+    }
+
+    cache->writes++;
+    wake = (cache->dirty > HDD_WB_HIGH_WATER);
+
+    thread_release_mutex(cache->mutex);
+
+    if (wake)
+        thread_set_event(cache->wake_event);
+
+    return 0;
+}
+
+/* Copy the cached sectors of the range over the buffer. Returns 1 if every
+   sector was cached. */
+static int
+hdd_wb_read(hdd_image_t *img, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_wb_cache_t *cache = img->cache;
+    int             all   = 1;
+
+    thread_wait_mutex(cache->mutex);
+
+    while (count > 0) {
+        const hdd_extent_t *ext   = hdd_wb_lookup(cache, sector >> HDD_EXTENT_SHIFT);
+        uint32_t            first = sector & HDD_EXTENT_MASK;
+        uint32_t            num   = HDD_EXTENT_SECTORS - first;
+
+        if (num > count)
+            num = count;
+
+        for (uint32_t i = first; i < (first + num); i++) {
+            if ((ext != NULL) && hdd_wb_sector_set(ext->valid, i))
+                memcpy(buffer + ((i - first) << 9), ext->data + (i << 9), 512);
+            else
+                all = 0;
+        }
+
+        sector += num;
+        count -= num;
+        buffer += (num << 9);
+    }
+
+    thread_release_mutex(cache->mutex);
+
+    return all;
+}
+
+/* Drop the cached copies of a range that is about to be written directly
+   to the image file. The caller must hold io_mutex. */
+static void
+hdd_wb_discard(hdd_image_t *img, uint32_t sector, uint32_t count)
+{
+    hdd_wb_cache_t *cache = img->cache;
+
+    thread_wait_mutex(cache->mutex);
+
+    while (count > 0) {
+        hdd_extent_t *ext   = hdd_wb_lookup(cache, sector >> HDD_EXTENT_SHIFT);
+        uint32_t      first = sector & HDD_EXTENT_MASK;
+        uint32_t      num   = HDD_EXTENT_SECTORS - first;
+
+        if (num > count)
+            num = count;
+
+        if (ext != NULL) {
+            int was_dirty = hdd_wb_is_dirty(ext);
+
+            for (uint32_t i = first; i < (first + num); i++) {
+                ext->valid[i >> 6] &= ~(1ULL << (i & 63));
+                ext->dirty[i >> 6] &= ~(1ULL << (i & 63));
+            }
+
+            if (was_dirty && !hdd_wb_is_dirty(ext))
+                cache->dirty--;
+        }
+
+        sector += num;
+        count -= num;
+    }
+
+    thread_release_mutex(cache->mutex);
+}
+
+static void
+hdd_wb_init(hdd_image_t *img)
+{
+    hdd_wb_cache_t *cache = (hdd_wb_cache_t *) calloc(1, sizeof(hdd_wb_cache_t));
+
+    cache->data   = (uint8_t *) malloc(HDD_EXTENTS * HDD_EXTENT_SIZE);
+    cache->wb_buf = (uint8_t *) malloc(HDD_EXTENT_SIZE);
+    if ((cache->data == NULL) || (cache->wb_buf == NULL))
+        fatal("hdd_wb_init(): Out of memory\n");
+
+    for (int i = 0; i < HDD_EXTENTS; i++)
+        cache->extents[i].data = cache->data + (i * HDD_EXTENT_SIZE);
+
+    cache->mutex      = thread_create_mutex();
+    cache->io_mutex   = thread_create_mutex();
+    cache->wake_event = thread_create_event();
+#ifndef HDD_IMAGE_PIO
+    img->file_mutex   = thread_create_mutex();
+#endif
+
+    /* Anything written through stdio while loading must be visible to the
+       positional I/O from here on. */
+    fflush(img->file);
+
+    img->cache    = cache;
+    cache->thread = thread_create(hdd_wb_thread, img);
+}
+
+static void
+hdd_wb_close(hdd_image_t *img)
+{
+    hdd_wb_cache_t *cache = img->cache;
+
+    if (cache == NULL)
+        return;
+
+    cache->quit = 1;
+    thread_set_event(cache->wake_event);
+    thread_wait(cache->thread);
+
+    if (hdd_wb_flush(img) < 0)
+        hdd_image_log("Hard disk image: Dirty data lost on close\n");
+
+    thread_destroy_event(cache->wake_event);
+    thread_close_mutex(cache->io_mutex);
+    thread_close_mutex(cache->mutex);
+#ifndef HDD_IMAGE_PIO
+    thread_close_mutex(img->file_mutex);
+    img->file_mutex = NULL;
+#endif
+
+    free(cache->wb_buf);
+    free(cache->data);
+    free(cache);
+    img->cache = NULL;
+}
+
+/* Map the whole image file so that sector accesses become plain copies from
+   and to the host page cache, which is then shared by every emulator
+   instance using the same image. */
+static int
+hdd_mmap_init(hdd_image_t *img, int read_only)
+{
+#ifdef HDD_IMAGE_MMAP
+    uint64_t size;
+    void    *map;
+
+    if (fseeko64(img->file, 0, SEEK_END) == -1)
+        return 0;
+    size = ftello64(img->file);
+    if ((size <= img->base) || (size > (uint64_t) SIZE_MAX))
+        return 0;
+
+    map = mmap(NULL, (size_t) size, PROT_READ | (read_only ? 0 : PROT_WRITE), MAP_SHARED,
+               fileno(img->file), 0);
+    if (map == MAP_FAILED)
+        return 0;
+
+    img->map      = (uint8_t *) map;
+    img->map_size = size;
+
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+static void
+hdd_mmap_close(hdd_image_t *img)
+{
+#ifdef HDD_IMAGE_MMAP
+    if (img->map == NULL)
+        return;
+
+    munmap(img->map, (size_t) img->map_size);
+    img->map      = NULL;
+    img->map_size = 0;
+#endif
+}
+
+/* Returns the number of whole sectors of the range that lie in the mapping. */
+static __inline uint32_t
+hdd_mmap_sectors(const hdd_image_t *img, uint32_t sector, uint32_t count)
+{
+    uint64_t offset = ((uint64_t) sector << 9) + img->base;
+    uint64_t avail;
+
+    if (offset >= img->map_size)
+        return 0;
+
+    avail = (img->map_size - offset) >> 9;
+    return (avail < count) ? (uint32_t) avail : count;
+}
+
+static void
+hdd_overlay_close(hdd_image_t *img)
+{
+    hdd_overlay_t *ovl = img->overlay;
+
+    if (ovl == NULL)
+        return;
+
+    if (ovl->file != NULL)
+        fclose(ovl->file);
+    free(ovl->buffer);
+    free(ovl->map);
+    free(ovl);
+    img->overlay = NULL;
+}
+
+/* Open the overlay file, creating an empty one if it does not exist yet. */
+static int
+hdd_overlay_open(uint8_t id, const char *fn)
+{
+    hdd_image_t     *img     = &hdd_images[id];
+    uint64_t         sectors = (uint64_t) img->last_sector + 1;
+    uint32_t         map_len;
+    hdd_ovl_header_t hdr;
+    hdd_overlay_t   *ovl;
+
+    ovl         = (hdd_overlay_t *) calloc(1, sizeof(hdd_overlay_t));
+    ovl->blocks = (uint32_t) ((sectors + HDD_OVL_BLOCK_SECTORS - 1) / HDD_OVL_BLOCK_SECTORS);
+    ovl->map    = (uint32_t *) calloc(ovl->blocks, sizeof(uint32_t));
+    ovl->buffer = (uint8_t *) malloc(HDD_OVL_BLOCK_SIZE);
+    img->overlay = ovl;
+
+    map_len          = ovl->blocks * sizeof(uint32_t);
+    ovl->data_offset = (HDD_OVL_MAP_OFFSET + map_len + 0xfff) & ~0xfffULL;
+
+    ovl->file = plat_fopen(fn, "rb+");
+    if (ovl->file != NULL) {
+        if ((hdd_file_io(ovl->file, &hdr, sizeof(hdr), 0, 0) != sizeof(hdr)) ||
+            memcmp(hdr.magic, HDD_OVL_MAGIC, 8) || (hdr.version != HDD_OVL_VERSION) ||
+            (hdr.block_sectors != HDD_OVL_BLOCK_SECTORS) || (hdr.blocks != ovl->blocks) ||
+            (hdr.sectors != sectors)) {
+            pclog("Hard disk image %i: Overlay '%s' does not match the image\n", id, fn);
+            hdd_overlay_close(img);
+            return 0;
+        }
+
+        if (hdd_file_io(ovl->file, ovl->map, map_len, HDD_OVL_MAP_OFFSET, 0) != map_len) {
+            hdd_overlay_close(img);
+            return 0;
+        }
+
+        for (uint32_t i = 0; i < ovl->blocks; i++) {
+            if (ovl->map[i] > ovl->used)
+                ovl->used = ovl->map[i];
+        }
+    } else {
+        ovl->file = plat_fopen(fn, "wb+");
+        if (ovl->file == NULL) {
+            hdd_overlay_close(img);
+            return 0;
+        }
+
+        memset(&hdr, 0x00, sizeof(hdr));
+        memcpy(hdr.magic, HDD_OVL_MAGIC, 8);
+        hdr.version       = HDD_OVL_VERSION;
+        hdr.block_sectors = HDD_OVL_BLOCK_SECTORS;
+        hdr.blocks        = ovl->blocks;
+        hdr.sectors       = sectors;
+
+        if ((hdd_file_io(ovl->file, &hdr, sizeof(hdr), 0, 1) != sizeof(hdr)) ||
+            (hdd_file_io(ovl->file, ovl->map, map_len, HDD_OVL_MAP_OFFSET, 1) != map_len)) {
+            hdd_overlay_close(img);
+            return 0;
+        }
+    }
+
+    hdd_image_log("Hard disk image %i: Overlay '%s' has %u of %u blocks in use\n",
+                  id, fn, ovl->used, ovl->blocks);
+
+    return 1;
+}
+
 void
 hdd_image_calc_chs(uint32_t *c, uint32_t *h, uint32_t *s, uint32_t size)
 {
@@ -248,8 +934,8 @@ hdd_image_init(void)
         memset(&hdd_images[i], 0, sizeof(hdd_image_t));
 }
 
-int
-hdd_image_load(int id)
+static int
+hdd_image_open(int id)
 {
     uint32_t sector_size = 512;
     uint32_t zero        = 0;
@@ -273,7 +959,10 @@ hdd_image_load(int id)
     hdd_images[id].base = 0;
 
     if (hdd_images[id].loaded) {
+        hdd_overlay_close(&hdd_images[id]);
         if (hdd_images[id].file) {
+            hdd_wb_close(&hdd_images[id]);
+            hdd_mmap_close(&hdd_images[id]);
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
         } else if (hdd_images[id].vhd) {
@@ -297,13 +986,13 @@ hdd_image_load(int id)
         memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
         goto fail_raw;
     }
-    hdd_images[id].file = plat_fopen(fn, "rb+");
+    hdd_images[id].file = plat_fopen(fn, hdd[id].overlay[0] ? "rb" : "rb+");
     if (hdd_images[id].file == NULL) {
         /* Failed to open existing hard disk image */
         if (errno == ENOENT) {
             /* Failed because it does not exist,
                so try to create new file */
-            if (hdd[id].wp) {
+            if (hdd[id].wp || hdd[id].overlay[0]) {
                 hdd_image_log("A write-protected image must exist\n");
                 memset(hdd[id].fn, 0, sizeof(hdd[id].fn));
                 goto fail_raw;
@@ -464,7 +1153,7 @@ fail_raw:
         } else if (is_vhd[1]) {
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
-            hdd_images[id].vhd  = mvhd_open(fn, (bool) 0, &vhd_error);
+            hdd_images[id].vhd  = mvhd_open(fn, (bool) !!hdd[id].overlay[0], &vhd_error);
             if (hdd_images[id].vhd == NULL) {
                 if (vhd_error == MVHD_ERR_FILE)
                     fatal("hdd_image_load(): VHD: Error opening VHD file '%s': %s\n", fn, strerror(mvhd_errno));
@@ -508,6 +1197,33 @@ fail_raw:
     return ret;
 }
 
+int
+hdd_image_load(int id)
+{
+    int ret = hdd_image_open(id);
+
+    if ((ret > 0) && (hdd_images[id].file != NULL)) {
+        /* All further accesses use positional I/O, make sure nothing written
+           while creating the image is left in the stdio buffers. */
+        fflush(hdd_images[id].file);
+
+        if ((hdd[id].cache_mode == HDD_CACHE_WRITE_BACK) && !hdd[id].wp && !hdd[id].overlay[0])
+            hdd_wb_init(&hdd_images[id]);
+        else if ((hdd[id].cache_mode == HDD_CACHE_MMAP) &&
+                 !hdd_mmap_init(&hdd_images[id], hdd[id].wp || hdd[id].overlay[0]))
+            hdd_image_log("Hard disk image %i: Unable to map image, using regular I/O\n", id);
+    }
+
+    /* With an overlay, the image itself was opened read-only and all writes
+       go to the overlay. */
+    if ((ret > 0) && hdd[id].overlay[0] && hdd_images[id].loaded &&
+        ((hdd_images[id].file != NULL) || (hdd_images[id].vhd != NULL)) &&
+        !hdd_overlay_open(id, hdd[id].overlay))
+        fatal("hdd_image_load(): Unable to open overlay '%s'\n", hdd[id].overlay);
+
+    return ret;
+}
+
 int
 hdd_image_seek(uint8_t id, uint32_t sector)
 {
@@ -525,11 +1241,12 @@ hdd_image_seek(uint8_t id, uint32_t sector)
     return 0;
 }
 
-int
-hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_read_base(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_read;
+    hdd_image_t *img = &hdd_images[id];
+    int          non_transferred_sectors;
+    int64_t      num_read;
 
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error = 0;
@@ -538,15 +1255,35 @@ hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         if (hdd_images[id].vhd->error)
             return -1;
     } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Read error during seek\n", id);
+        if (!img->file) {
+            hdd_image_log("Hard disk image %i: Read error, no file\n", id);
             return -1;
         }
 
-        num_read           = fread(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_read;
-        if ((num_read < count) && !feof(hdd_images[id].file))
-            return -1;
+        if (img->map != NULL) {
+            num_read = (int64_t) hdd_mmap_sectors(img, sector, count) << 9;
+            memcpy(buffer, img->map + ((uint64_t) sector << 9) + img->base, (size_t) num_read);
+            if (num_read < ((int64_t) count << 9))
+                memset(buffer + num_read, 0x00, ((size_t) count << 9) - num_read);
+        } else if ((img->cache != NULL) && hdd_wb_read(img, sector, count, buffer)) {
+            /* Only go to the file if part of the range is not in the cache. */
+            num_read = (int64_t) count << 9;
+        } else {
+            num_read = hdd_image_file_io(img, buffer, count << 9, ((uint64_t) sector << 9LL) + img->base, 0);
+            if (num_read < 0) {
+                hdd_image_log("Hard disk image %i: Read error\n", id);
+                return -1;
+            }
+
+            /* Sectors past the end of the file read as zeroes. */
+            if (num_read < ((int64_t) count << 9))
+                memset(buffer + num_read, 0x00, ((size_t) count << 9) - num_read);
+
+            if (img->cache != NULL)
+                (void) hdd_wb_read(img, sector, count, buffer);
+        }
+
+        img->pos = sector + (uint32_t) (num_read >> 9);
     }
 
     return 0;
@@ -581,11 +1318,12 @@ hdd_image_read_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+static int
+hdd_image_write_base(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
 {
-    int    non_transferred_sectors;
-    size_t num_write;
+    hdd_image_t *img = &hdd_images[id];
+    int          non_transferred_sectors;
+    int64_t      num_write;
 
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error = 0;
@@ -594,15 +1332,23 @@ hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
         if (hdd_images[id].vhd->error)
             return -1;
     } else {
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Write error during seek\n", id);
+        if (!img->file) {
+            hdd_image_log("Hard disk image %i: Write error, no file\n", id);
             return -1;
         }
 
-        num_write          = fwrite(buffer, 512, count, hdd_images[id].file);
-        hdd_images[id].pos = sector + num_write;
-        fflush(hdd_images[id].file);
-        if (num_write < count)
+        if (img->map != NULL) {
+            num_write = (int64_t) hdd_mmap_sectors(img, sector, count) << 9;
+            memcpy(img->map + ((uint64_t) sector << 9) + img->base, buffer, (size_t) num_write);
+        } else if (img->cache != NULL)
+            num_write = hdd_wb_write(img, sector, count, buffer) ? -1 : ((int64_t) count << 9);
+        else
+            num_write = hdd_image_file_io(img, buffer, count << 9, ((uint64_t) sector << 9LL) + img->base, 1);
+
+        if (num_write < 0)
+            num_write = 0;
+        img->pos = sector + (uint32_t) (num_write >> 9);
+        if (num_write < ((int64_t) count << 9))
             return -1;
     }
 
@@ -626,8 +1372,8 @@ hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
     return 0;
 }
 
-int
-hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
+static int
+hdd_image_zero_base(uint8_t id, uint32_t sector, uint32_t count)
 {
     if (hdd_images[id].type == HDD_IMAGE_VHD) {
         hdd_images[id].vhd->error   = 0;
@@ -636,23 +1382,49 @@ hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
         if (hdd_images[id].vhd->error)
             return -1;
     } else {
-        memset(empty_sector, 0, 512);
+        hdd_image_t *img = &hdd_images[id];
+        int          ret = 0;
 
-        if (!hdd_images[id].file || (fseeko64(hdd_images[id].file, ((uint64_t) (sector) << 9LL) + hdd_images[id].base, SEEK_SET) == -1)) {
-            hdd_image_log("Hard disk image %i: Zero error during seek\n", id);
+        if (!img->file) {
+            hdd_image_log("Hard disk image %i: Zero error, no file\n", id);
             return -1;
         }
 
-        for (uint32_t i = 0; i < count; i++) {
-            if (feof(hdd_images[id].file))
+        if (img->map != NULL) {
+            uint32_t num = hdd_mmap_sectors(img, sector, count);
+
+            memset(img->map + ((uint64_t) sector << 9) + img->base, 0x00, (size_t) num << 9);
+            img->pos = sector + num;
+            return (num < count) ? -1 : 0;
+        }
+
+        /* Zeroes go straight to the file, so drop any cached copies first
+           and keep the worker from writing them back behind our back. */
+        if (img->cache != NULL) {
+            thread_wait_mutex(img->cache->io_mutex);
+            hdd_wb_discard(img, sector, count);
+        }
+
+        for (uint32_t i = 0; i < count;) {
+            uint32_t num = count - i;
+
+            if (num > HDD_EXTENT_SECTORS)
+                num = HDD_EXTENT_SECTORS;
+
+            img->pos = sector + i;
+            if (hdd_image_file_io(img, zero_buffer, num << 9, ((uint64_t) (sector + i) << 9LL) + img->base, 1) != (num << 9)) {
+                ret = -1;
                 break;
+            }
 
-            hdd_images[id].pos = sector + i;
-            if (!fwrite(empty_sector, 512, 1, hdd_images[id].file))
-                return -1;
+            i += num;
         }
 
-        fflush(hdd_images[id].file);
+        if (img->cache != NULL)
+            thread_release_mutex(img->cache->io_mutex);
+
+        if (ret < 0)
+            return ret;
     }
 
     return 0;
@@ -674,6 +1446,207 @@ hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count)
     return 0;
 }
 
+static __inline uint64_t
+hdd_overlay_offset(const hdd_overlay_t *ovl, uint32_t block, uint32_t first)
+{
+    return ovl->data_offset + ((uint64_t) (ovl->map[block] - 1) * HDD_OVL_BLOCK_SIZE) + ((uint64_t) first << 9);
+}
+
+/* Allocate an overlay block, filled either with the data of a write that
+   covers the whole block or with a copy of the block from the base image.
+   The map entry is written last, so a crash never leaves it pointing at
+   unwritten data. */
+static int
+hdd_overlay_alloc(uint8_t id, uint32_t block, const uint8_t *data)
+{
+    hdd_overlay_t *ovl    = hdd_images[id].overlay;
+    uint32_t       sector = block * HDD_OVL_BLOCK_SECTORS;
+    uint32_t       num    = HDD_OVL_BLOCK_SECTORS;
+    uint32_t       entry  = ovl->used + 1;
+
+    if (data == NULL) {
+        if ((sector + num) > (hdd_images[id].last_sector + 1))
+            num = hdd_images[id].last_sector + 1 - sector;
+
+        memset(ovl->buffer, 0x00, HDD_OVL_BLOCK_SIZE);
+        if (hdd_image_read_base(id, sector, num, ovl->buffer) < 0)
+            return -1;
+
+        data = ovl->buffer;
+    }
+
+    if (hdd_file_io(ovl->file, (void *) data, HDD_OVL_BLOCK_SIZE,
+                    ovl->data_offset + ((uint64_t) ovl->used * HDD_OVL_BLOCK_SIZE), 1) != HDD_OVL_BLOCK_SIZE)
+        return -1;
+
+    if (hdd_file_io(ovl->file, &entry, sizeof(uint32_t), HDD_OVL_MAP_OFFSET + (block * sizeof(uint32_t)), 1) != sizeof(uint32_t))
+        return -1;
+
+    ovl->map[block] = entry;
+    ovl->used++;
+
+    return 0;
+}
+
+static int
+hdd_overlay_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    hdd_overlay_t *ovl = hdd_images[id].overlay;
+
+    while (count > 0) {
+        uint32_t block = sector / HDD_OVL_BLOCK_SECTORS;
+        uint32_t first = sector % HDD_OVL_BLOCK_SECTORS;
+        uint32_t num   = HDD_OVL_BLOCK_SECTORS - first;
+
+        if (block >= ovl->blocks)
+            return hdd_image_read_base(id, sector, count, buffer);
+
+        /* Extend the run over following blocks that live in the same place,
+           so that contiguous reads stay single reads. */
+        while ((num < count) && ((block + 1) < ovl->blocks)) {
+            uint32_t next = block + (first + num) / HDD_OVL_BLOCK_SECTORS;
+
+            if ((next >= ovl->blocks) || (ovl->map[block] ? (ovl->map[next] != (ovl->map[block] + (next - block))) : (ovl->map[next] != 0)))
+                break;
+
+            num += HDD_OVL_BLOCK_SECTORS;
+        }
+        if (num > count)
+            num = count;
+
+        if (ovl->map[block]) {
+            if (hdd_file_io(ovl->file, buffer, num << 9, hdd_overlay_offset(ovl, block, first), 0) != (num << 9))
+                return -1;
+        } else if (hdd_image_read_base(id, sector, num, buffer) < 0)
+            return -1;
+
+        sector += num;
+        count -= num;
+        buffer += (num << 9);
+    }
+
+    hdd_images[id].pos = sector;
+
+    return 0;
+}
+
+static int
+hdd_overlay_write(uint8_t id, uint32_t sector, uint32_t count, const uint8_t *buffer)
+{
+    hdd_overlay_t *ovl = hdd_images[id].overlay;
+
+    while (count > 0) {
+        uint32_t block = sector / HDD_OVL_BLOCK_SECTORS;
+        uint32_t first = sector % HDD_OVL_BLOCK_SECTORS;
+        uint32_t num   = HDD_OVL_BLOCK_SECTORS - first;
+
+        if (block >= ovl->blocks)
+            return -1;
+        if (num > count)
+            num = count;
+
+        if (ovl->map[block]) {
+            if (hdd_file_io(ovl->file, (void *) buffer, num << 9, hdd_overlay_offset(ovl, block, first), 1) != (num << 9))
+                return -1;
+        } else if (num == HDD_OVL_BLOCK_SECTORS) {
+            /* The write covers the whole block, it becomes the block data. */
+            if (hdd_overlay_alloc(id, block, buffer) < 0)
+                return -1;
+        } else if ((hdd_overlay_alloc(id, block, NULL) < 0) ||
+                   (hdd_file_io(ovl->file, (void *) buffer, num << 9, hdd_overlay_offset(ovl, block, first), 1) != (num << 9)))
+            return -1;
+
+        sector += num;
+        count -= num;
+        buffer += (num << 9);
+        hdd_images[id].pos = sector;
+    }
+
+    return 0;
+}
+
+int
+hdd_image_read(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_overlay_read(id, sector, count, buffer);
+
+    return hdd_image_read_base(id, sector, count, buffer);
+}
+
+int
+hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer)
+{
+    if (hdd_images[id].overlay != NULL)
+        return hdd_overlay_write(id, sector, count, buffer);
+
+    return hdd_image_write_base(id, sector, count, buffer);
+}
+
+int
+hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count)
+{
+    if (hdd_images[id].overlay != NULL) {
+        for (uint32_t i = 0; i < count;) {
+            uint32_t num = count - i;
+
+            if (num > HDD_EXTENT_SECTORS)
+                num = HDD_EXTENT_SECTORS;
+
+            if (hdd_overlay_write(id, sector + i, num, zero_buffer) < 0)
+                return -1;
+
+            i += num;
+        }
+
+        return 0;
+    }
+
+    return hdd_image_zero_base(id, sector, count);
+}
+
+/* Write back everything held in the write-back cache, used for the guest's
+   cache flush commands. Returns -1 if the data could not be written. */
+int
+hdd_image_flush(uint8_t id)
+{
+    if (!hdd_images[id].loaded)
+        return 0;
+
+    if (hdd_images[id].cache != NULL)
+        return hdd_wb_flush(&hdd_images[id]);
+    else if (hdd_images[id].vhd != NULL)
+        mvhd_flush(hdd_images[id].vhd);
+#ifdef HDD_IMAGE_MMAP
+    else if ((hdd_images[id].map != NULL) && msync(hdd_images[id].map, (size_t) hdd_images[id].map_size, MS_SYNC))
+        return -1;
+#endif
+
+    return 0;
+}
+
+/* Returns a pointer straight into the mapped image if the whole range is
+   mapped, so that bus master DMA can copy from the page cache to guest RAM
+   without an intermediate buffer, or NULL otherwise. */
+const uint8_t *
+hdd_image_get_ptr(uint8_t id, uint32_t sector, uint32_t count)
+{
+    const hdd_image_t *img = &hdd_images[id];
+
+    if (!img->loaded || (img->map == NULL) || (hdd_mmap_sectors(img, sector, count) != count))
+        return NULL;
+
+    /* Blocks that have been copied to the overlay must be read from there. */
+    if (img->overlay != NULL) {
+        for (uint32_t b = sector / HDD_OVL_BLOCK_SECTORS; b <= ((sector + count - 1) / HDD_OVL_BLOCK_SECTORS); b++) {
+            if ((b >= img->overlay->blocks) || img->overlay->map[b])
+                return NULL;
+        }
+    }
+
+    return img->map + ((uint64_t) sector << 9) + img->base;
+}
+
 uint32_t
 hdd_image_get_pos(uint8_t id)
 {
@@ -693,7 +1666,10 @@ hdd_image_unload(uint8_t id, UNUSED(int fn_preserve))
         return;
 
     if (hdd_images[id].loaded) {
+        hdd_overlay_close(&hdd_images[id]);
         if (hdd_images[id].file != NULL) {
+            hdd_wb_close(&hdd_images[id]);
+            hdd_mmap_close(&hdd_images[id]);
             fclose(hdd_images[id].file);
             hdd_images[id].file = NULL;
         } else if (hdd_images[id].vhd != NULL) {
@@ -716,7 +1692,10 @@ hdd_image_close(uint8_t id)
     if (!hdd_images[id].loaded)
         return;
 
+    hdd_overlay_close(&hdd_images[id]);
     if (hdd_images[id].file != NULL) {
+        hdd_wb_close(&hdd_images[id]);
+        hdd_mmap_close(&hdd_images[id]);
         fclose(hdd_images[id].file);
         hdd_images[id].file = NULL;
     } else if (hdd_images[id].vhd != NULL) {
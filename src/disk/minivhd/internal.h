@@ -61,10 +61,24 @@
 #define MVHD_START_TS          946684800
 
 
+/* Number of block sector bitmaps kept in memory. */
+#define MVHD_BITMAP_CACHE_SIZE 64
+
+typedef struct MVHDBitmapCacheEntry {
+    uint8_t* bitmap;
+    int      block;
+    bool     dirty;
+    uint32_t last_used;
+} MVHDBitmapCacheEntry;
+
 typedef struct MVHDSectorBitmap {
-    uint8_t* curr_bitmap;
-    int      sector_count;
-    int      curr_block;
+    uint8_t*              curr_bitmap;
+    int                   sector_count;
+    int                   curr_block;
+    MVHDBitmapCacheEntry* curr_entry;
+    uint32_t              use_count;
+    uint8_t*              cache_data;
+    MVHDBitmapCacheEntry  cache[MVHD_BITMAP_CACHE_SIZE];
 } MVHDSectorBitmap;
 
 typedef struct MVHDFooter {
@@ -121,6 +135,11 @@ struct MVHDMeta {
     MVHDFooter       footer;
     MVHDSparseHeader sparse;
     uint32_t*        block_offset;
+    struct {
+        bool     dirty;
+        uint32_t first;
+        uint32_t last;
+    } bat_dirty;
     int              sect_per_block;
     MVHDSectorBitmap bitmap;
     int (*read_sectors)(struct MVHDMeta*, uint32_t, int, void*);
@@ -390,6 +409,8 @@ int mvhd_sparse_diff_write(struct MVHDMeta* vhdm, uint32_t offset, int num_secto
  */
 int mvhd_noop_write(struct MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* in_buff);
 
+void mvhd_flush_metadata(struct MVHDMeta* vhdm);
+
 /**
  * \brief Save the contents of a VHD footer from a buffer to a struct
  * 
@@ -179,11 +179,11 @@ calc_sparse_values(MVHDMeta* vhdm)
 
 
 /**
- * \brief Allocate memory for a sector bitmap.
+ * \brief Allocate memory for the sector bitmap cache.
  *
  * Each data block is preceded by a sector bitmap. Each bit indicates whether the corresponding sector
  * is considered 'clean' or 'dirty' (for sparse VHD images), or whether to read from the parent or current
- * image (for differencing images).
+ * image (for differencing images). The bitmaps of the most recently used blocks are kept in memory.
  *
  * \param [in] vhdm MiniVHD data structure
  * \param [out] err this is populated with MVHD_ERR_MEM if the calloc fails
@@ -194,13 +194,22 @@ calc_sparse_values(MVHDMeta* vhdm)
 static int
 init_sector_bitmap(MVHDMeta* vhdm, MVHDError* err)
 {
-    vhdm->bitmap.curr_bitmap = calloc(vhdm->bitmap.sector_count, MVHD_SECTOR_SIZE);
-    if (vhdm->bitmap.curr_bitmap == NULL) {
+    int bm_size = vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE;
+
+    vhdm->bitmap.cache_data = calloc(MVHD_BITMAP_CACHE_SIZE, bm_size);
+    if (vhdm->bitmap.cache_data == NULL) {
         *err = MVHD_ERR_MEM;
         return -1;
     }
 
-    vhdm->bitmap.curr_block = -1;
+    for (int i = 0; i < MVHD_BITMAP_CACHE_SIZE; i++) {
+        vhdm->bitmap.cache[i].bitmap = vhdm->bitmap.cache_data + (i * bm_size);
+        vhdm->bitmap.cache[i].block  = -1;
+    }
+
+    vhdm->bitmap.curr_bitmap = NULL;
+    vhdm->bitmap.curr_entry  = NULL;
+    vhdm->bitmap.curr_block  = -1;
 
     return 0;
 }
@@ -595,8 +604,8 @@ cleanup_format_buff:
     vhdm->format_buffer.zero_data = NULL;
 
 cleanup_bitmap:
-    free(vhdm->bitmap.curr_bitmap);
-    vhdm->bitmap.curr_bitmap = NULL;
+    free(vhdm->bitmap.cache_data);
+    vhdm->bitmap.cache_data = NULL;
 
 cleanup_bat:
     free(vhdm->block_offset);
@@ -624,15 +633,18 @@ mvhd_close(MVHDMeta* vhdm)
     if (vhdm->parent != NULL)
         mvhd_close(vhdm->parent);
 
+    if (!vhdm->readonly)
+        mvhd_flush_metadata(vhdm);
+
     fclose(vhdm->f);
 
     if (vhdm->block_offset != NULL) {
         free(vhdm->block_offset);
         vhdm->block_offset = NULL;
     }
-    if (vhdm->bitmap.curr_bitmap != NULL) {
-        free(vhdm->bitmap.curr_bitmap);
-        vhdm->bitmap.curr_bitmap = NULL;
+    if (vhdm->bitmap.cache_data != NULL) {
+        free(vhdm->bitmap.cache_data);
+        vhdm->bitmap.cache_data = NULL;
     }
     if (vhdm->format_buffer.zero_data != NULL) {
         free(vhdm->format_buffer.zero_data);
@@ -692,6 +704,14 @@ mvhd_write_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors, void* in_bu
 }
 
 
+MVHDAPI void
+mvhd_flush(MVHDMeta* vhdm)
+{
+    if (!vhdm->readonly)
+        mvhd_flush_metadata(vhdm);
+}
+
+
 MVHDAPI int
 mvhd_format_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors)
 {
@@ -395,6 +395,17 @@ MVHDAPI int mvhd_write_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors,
  */
 MVHDAPI int mvhd_format_sectors(MVHDMeta* vhdm, uint32_t offset, int num_sectors);
 
+/**
+ * \brief Write cached metadata to the VHD file
+ *
+ * Sector bitmaps and block allocation table entries of dynamic and
+ * differencing images are written back lazily. This writes out everything
+ * still pending and flushes the file. mvhd_close() does this as well.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ */
+MVHDAPI void mvhd_flush(MVHDMeta* vhdm);
+
 #ifdef __cplusplus
 }
 #endif
@@ -85,11 +85,14 @@ check_sectors(uint32_t offset, int num_sectors, uint32_t total_sectors, int *tra
 bool
 mvhd_write_empty_sectors(FILE *f, int sector_count)
 {
-    uint8_t zero_bytes[MVHD_SECTOR_SIZE] = {0};
+    static const uint8_t zero_bytes[MVHD_SECTOR_SIZE * 64] = {0};
 
-    for (int i = 0; i < sector_count; i++) {
-        if (!fwrite(zero_bytes, sizeof zero_bytes, 1, f))
+    while (sector_count > 0) {
+        int count = (sector_count > 64) ? 64 : sector_count;
+
+        if (!fwrite(zero_bytes, MVHD_SECTOR_SIZE, count, f))
             return 0;
+        sector_count -= count;
     }
 
     fflush(f);
@@ -97,60 +100,183 @@ mvhd_write_empty_sectors(FILE *f, int sector_count)
 }
 
 /**
- * \brief Read the sector bitmap for a block.
+ * \brief Find the end of a run of sectors with the same bitmap state
+ *
+ * Whole bytes and 64-bit words are compared at once, so that fully
+ * allocated or fully sparse areas are skipped quickly.
+ *
+ * \param [in] bitmap The sector bitmap of a block
+ * \param [in] start The first sector of the run
+ * \param [in] end The sector after the last one to consider
  *
- * If the block is sparse, the sector bitmap in memory will be
- * zeroed. Otherwise, the sector bitmap is read from the VHD file.
+ * \return the sector after the last one with the same state as start
+ */
+static int
+bitmap_run_end(const uint8_t *bitmap, int start, int end)
+{
+    int      set  = !!VHD_TESTBIT(bitmap, start);
+    uint8_t  fill = set ? 0xff : 0x00;
+    uint64_t word;
+    int      s    = start + 1;
+
+    while ((s < end) && (s & 7)) {
+        if (!!VHD_TESTBIT(bitmap, s) != set)
+            return s;
+        s++;
+    }
+
+    while (((s + 64) <= end) && (s & 63)) {
+        if (bitmap[s >> 3] != fill)
+            break;
+        s += 8;
+    }
+
+    if (!(s & 63)) {
+        while ((s + 64) <= end) {
+            memcpy(&word, &bitmap[s >> 3], sizeof word);
+            if (word != (set ? ~0ULL : 0ULL))
+                break;
+            s += 64;
+        }
+    }
+
+    while (((s + 8) <= end) && (bitmap[s >> 3] == fill))
+        s += 8;
+
+    while ((s < end) && (!!VHD_TESTBIT(bitmap, s) == set))
+        s++;
+
+    return s;
+}
+
+/**
+ * \brief Write a cached sector bitmap to the VHD file
  *
  * \param [in] vhdm MiniVHD data structure
- * \param [in] blk The block for which to read the sector bitmap from
+ * \param [in] entry The cache entry to write
  */
 static void
-read_sect_bitmap(MVHDMeta *vhdm, int blk)
+write_sect_bitmap(MVHDMeta *vhdm, MVHDBitmapCacheEntry *entry)
 {
-    if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
-        mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
-        if (!fread(vhdm->bitmap.curr_bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1, vhdm->f))
-            vhdm->error = 1;
-    } else
-        memset(vhdm->bitmap.curr_bitmap, 0, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+    int64_t abs_offset = (int64_t)vhdm->block_offset[entry->block] * MVHD_SECTOR_SIZE;
+
+    if (mvhd_fseeko64(vhdm->f, abs_offset, SEEK_SET) == -1)
+        vhdm->error = 1;
+    if (!fwrite(entry->bitmap, MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count, vhdm->f))
+        vhdm->error = 1;
 
-    vhdm->bitmap.curr_block = blk;
+    entry->dirty = 0;
 }
 
 /**
- * \brief Write the current sector bitmap in memory to file
+ * \brief Make the sector bitmap for a block current.
+ *
+ * The bitmap is taken from the cache if present. Otherwise the least recently
+ * used cache entry is written back if needed and reused. If the block is sparse,
+ * the sector bitmap in memory will be zeroed. Otherwise, the sector bitmap is
+ * read from the VHD file.
  *
  * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block for which to read the sector bitmap from
  */
 static void
-write_curr_sect_bitmap(MVHDMeta* vhdm)
+read_sect_bitmap(MVHDMeta *vhdm, int blk)
 {
-    if (vhdm->bitmap.curr_block >= 0) {
-        int64_t abs_offset = (int64_t)vhdm->block_offset[vhdm->bitmap.curr_block] * MVHD_SECTOR_SIZE;
-        if (mvhd_fseeko64(vhdm->f, abs_offset, SEEK_SET) == -1)
-            vhdm->error = 1;
-        if (!fwrite(vhdm->bitmap.curr_bitmap, MVHD_SECTOR_SIZE, vhdm->bitmap.sector_count, vhdm->f))
-            vhdm->error = 1;
+    MVHDBitmapCacheEntry *entry = NULL;
+    MVHDBitmapCacheEntry *lru   = &vhdm->bitmap.cache[0];
+
+    if (vhdm->bitmap.curr_block == blk)
+        return;
+
+    for (int i = 0; i < MVHD_BITMAP_CACHE_SIZE; i++) {
+        if (vhdm->bitmap.cache[i].block == blk) {
+            entry = &vhdm->bitmap.cache[i];
+            break;
+        }
+        if (vhdm->bitmap.cache[i].last_used < lru->last_used)
+            lru = &vhdm->bitmap.cache[i];
+    }
+
+    if (entry == NULL) {
+        entry = lru;
+        if (entry->dirty)
+            write_sect_bitmap(vhdm, entry);
+
+        if (vhdm->block_offset[blk] != MVHD_SPARSE_BLK) {
+            mvhd_fseeko64(vhdm->f, (uint64_t)vhdm->block_offset[blk] * MVHD_SECTOR_SIZE, SEEK_SET);
+            if (!fread(entry->bitmap, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE, 1, vhdm->f))
+                vhdm->error = 1;
+        } else
+            memset(entry->bitmap, 0, vhdm->bitmap.sector_count * MVHD_SECTOR_SIZE);
+
+        entry->block = blk;
+        entry->dirty = 0;
     }
+
+    entry->last_used         = ++vhdm->bitmap.use_count;
+    vhdm->bitmap.curr_entry  = entry;
+    vhdm->bitmap.curr_bitmap = entry->bitmap;
+    vhdm->bitmap.curr_block  = blk;
 }
 
 /**
- * \brief Write block offset from memory into file
+ * \brief Write pending BAT entries from memory into file
+ *
+ * All entries between the first and last one changed since the last
+ * write are written with a single fwrite.
  *
  * \param [in] vhdm MiniVHD data structure
- * \param [in] blk The block for which to write the offset for
  */
 static void
-write_bat_entry(MVHDMeta *vhdm, int blk)
+write_bat_entries(MVHDMeta *vhdm)
 {
-    uint64_t table_offset = vhdm->sparse.bat_offset + ((uint64_t)blk * sizeof *vhdm->block_offset);
-    uint32_t offset = mvhd_to_be32(vhdm->block_offset[blk]);
+    uint32_t  count;
+    uint32_t *entries;
+
+    if (!vhdm->bat_dirty.dirty)
+        return;
+
+    count   = vhdm->bat_dirty.last - vhdm->bat_dirty.first + 1;
+    entries = malloc(count * sizeof *vhdm->block_offset);
+    if (entries == NULL) {
+        vhdm->error = 1;
+        return;
+    }
 
+    for (uint32_t i = 0; i < count; i++)
+        entries[i] = mvhd_to_be32(vhdm->block_offset[vhdm->bat_dirty.first + i]);
+
+    uint64_t table_offset = vhdm->sparse.bat_offset + ((uint64_t)vhdm->bat_dirty.first * sizeof *vhdm->block_offset);
     if (mvhd_fseeko64(vhdm->f, table_offset, SEEK_SET) == -1)
         vhdm->error = 1;
-    if (!fwrite(&offset, sizeof offset, 1, vhdm->f))
+    if (!fwrite(entries, count * sizeof *vhdm->block_offset, 1, vhdm->f))
         vhdm->error = 1;
+
+    free(entries);
+    vhdm->bat_dirty.dirty = 0;
+}
+
+/**
+ * \brief Write all dirty sector bitmaps and BAT entries to file
+ *
+ * Bitmaps are written before the BAT, so a block never becomes visible
+ * with a bitmap that has not been written yet.
+ *
+ * \param [in] vhdm MiniVHD data structure
+ */
+void
+mvhd_flush_metadata(MVHDMeta *vhdm)
+{
+    if ((vhdm->footer.disk_type != MVHD_TYPE_DIFF) && (vhdm->footer.disk_type != MVHD_TYPE_DYNAMIC))
+        return;
+
+    for (int i = 0; i < MVHD_BITMAP_CACHE_SIZE; i++) {
+        if (vhdm->bitmap.cache[i].dirty)
+            write_sect_bitmap(vhdm, &vhdm->bitmap.cache[i]);
+    }
+
+    write_bat_entries(vhdm);
+
     fflush(vhdm->f);
 }
 
@@ -163,7 +289,7 @@ write_bat_entry(MVHDMeta *vhdm, int blk)
  *
  * This function creates new, empty blocks, by replacing the footer at the end of the file
  * and then re-inserting the footer at the new file end. The BAT table entry for the
- * new block is updated with the new offset.
+ * new block is updated in memory, and written to the file by mvhd_flush_metadata().
  *
  * \param [in] vhdm MiniVHD data structure
  * \param [in] blk The block number to create
@@ -200,11 +326,9 @@ create_block(MVHDMeta *vhdm, int blk)
 
     uint32_t sect_offset = (uint32_t)(abs_offset / MVHD_SECTOR_SIZE);
     int blk_size_sectors = vhdm->sparse.block_sz / MVHD_SECTOR_SIZE;
-    if (!mvhd_write_empty_sectors(vhdm->f, vhdm->bitmap.sector_count + blk_size_sectors))
-        vhdm->error = 1;
-
-    /* Add a bit of padding. That's what Windows appears to do, although it's not strictly necessary... */
-    if (!mvhd_write_empty_sectors(vhdm->f, 5))
+    /* Add a bit of padding after the block. That's what Windows appears to do,
+       although it's not strictly necessary... */
+    if (!mvhd_write_empty_sectors(vhdm->f, vhdm->bitmap.sector_count + blk_size_sectors + 5))
         vhdm->error = 1;
 
     /* And we finish with the footer */
@@ -213,9 +337,33 @@ create_block(MVHDMeta *vhdm, int blk)
 
     /* We no longer have a sparse block. Update that BAT! */
     vhdm->block_offset[blk] = sect_offset;
-    write_bat_entry(vhdm, blk);
+    if (!vhdm->bat_dirty.dirty) {
+        vhdm->bat_dirty.first = vhdm->bat_dirty.last = blk;
+        vhdm->bat_dirty.dirty = 1;
+    } else if ((uint32_t) blk < vhdm->bat_dirty.first)
+        vhdm->bat_dirty.first = blk;
+    else if ((uint32_t) blk > vhdm->bat_dirty.last)
+        vhdm->bat_dirty.last = blk;
+}
 
-    fflush(vhdm->f);
+/**
+ * \brief Read sectors that are present in a block of a sparse or differencing VHD
+ *
+ * \param [in] vhdm MiniVHD data structure
+ * \param [in] blk The block to read from
+ * \param [in] sib The first sector in the block
+ * \param [in] count The number of sectors to read
+ * \param [out] buff The buffer to read into
+ */
+static void
+read_block_sectors(MVHDMeta *vhdm, int blk, int sib, int count, uint8_t *buff)
+{
+    int64_t addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) * MVHD_SECTOR_SIZE;
+
+    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+        vhdm->error = 1;
+    if (!fread(buff, (size_t) count * MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
+        vhdm->error = 1;
 }
 
 int
@@ -246,39 +394,34 @@ mvhd_sparse_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buf
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t* buff = (uint8_t*)out_buff;
-    int64_t addr = 0ULL;
-    uint32_t s = 0;
-    uint32_t ls = 0;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
-    ls = offset + transfer_sectors;
+    int end = 0;
+    int run = 0;
 
-    for (s = offset; s < ls; s++) {
+    while (s < ls) {
         blk = s / vhdm->sect_per_block;
         sib = s % vhdm->sect_per_block;
-        if (blk != prev_blk) {
-            prev_blk = blk;
-            if (vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(vhdm, blk);
-                if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                    vhdm->error = 1;
-            } else {
-                addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                       MVHD_SECTOR_SIZE;
-                if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                    vhdm->error = 1;
-            }
-        }
-
-        if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib)) {
-            if (!fread(buff, MVHD_SECTOR_SIZE, 1, vhdm->f) && !feof(vhdm->f))
-                vhdm->error = 1;
-        } else {
-            memset(buff, 0, MVHD_SECTOR_SIZE);
-            mvhd_fseeko64(vhdm->f, MVHD_SECTOR_SIZE, SEEK_CUR);
+        end = vhdm->sect_per_block;
+        if ((ls - s) < (uint32_t) (end - sib))
+            end = sib + (ls - s);
+
+        read_sect_bitmap(vhdm, blk);
+
+        /* Read each run of present sectors in one go, and zero-fill the gaps. */
+        while (sib < end) {
+            run = bitmap_run_end(vhdm->bitmap.curr_bitmap, sib, end) - sib;
+            if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib))
+                read_block_sectors(vhdm, blk, sib, run, buff);
+            else
+                memset(buff, 0, (size_t) run * MVHD_SECTOR_SIZE);
+
+            sib += run;
+            s += run;
+            buff += run * MVHD_SECTOR_SIZE;
         }
-        buff += MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
@@ -294,39 +437,42 @@ mvhd_diff_read(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *out_buff)
     check_sectors(offset, num_sectors, total_sectors, &transfer_sectors, &truncated_sectors);
 
     uint8_t *buff = (uint8_t*)out_buff;
-    MVHDMeta *curr_vhdm = vhdm;
-    uint32_t s = 0;
-    uint32_t ls = 0;
+    MVHDMeta *par_vhdm = vhdm->parent;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
     int blk = 0;
     int sib = 0;
-    ls = offset + transfer_sectors;
-
-    for (s = offset; s < ls; s++) {
-        while (curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) {
-            blk = s / curr_vhdm->sect_per_block;
-            sib = s % curr_vhdm->sect_per_block;
-            if (curr_vhdm->bitmap.curr_block != blk) {
-                read_sect_bitmap(curr_vhdm, blk);
+    int end = 0;
+    int run = 0;
+
+    while (s < ls) {
+        blk = s / vhdm->sect_per_block;
+        sib = s % vhdm->sect_per_block;
+        end = vhdm->sect_per_block;
+        if ((ls - s) < (uint32_t) (end - sib))
+            end = sib + (ls - s);
+
+        read_sect_bitmap(vhdm, blk);
+
+        /* Sectors present in this image are read from it directly, runs of
+           absent ones are passed on to the parent, which may in turn be a
+           differencing image. */
+        while (sib < end) {
+            run = bitmap_run_end(vhdm->bitmap.curr_bitmap, sib, end) - sib;
+            if (VHD_TESTBIT(vhdm->bitmap.curr_bitmap, sib))
+                read_block_sectors(vhdm, blk, sib, run, buff);
+            else {
+                par_vhdm->read_sectors(par_vhdm, s, run, buff);
+                if (par_vhdm->error) {
+                    par_vhdm->error = 0;
+                    vhdm->error = 1;
+                }
             }
-            if (!VHD_TESTBIT(curr_vhdm->bitmap.curr_bitmap, sib)) {
-                curr_vhdm = curr_vhdm->parent;
-            } else { break; }
-        }
 
-        /* We handle actual sector reading using the fixed or sparse functions,
-           as a differencing VHD is also a sparse VHD */
-        if ((curr_vhdm->footer.disk_type == MVHD_TYPE_DIFF) ||
-            (curr_vhdm->footer.disk_type == MVHD_TYPE_DYNAMIC))
-            mvhd_sparse_read(curr_vhdm, s, 1, buff);
-        else
-            mvhd_fixed_read(curr_vhdm, s, 1, buff);
-        if (curr_vhdm->error) {
-            curr_vhdm->error = 0;
-            vhdm->error = 1;
+            sib += run;
+            s += run;
+            buff += run * MVHD_SECTOR_SIZE;
         }
-
-        curr_vhdm = vhdm;
-        buff += MVHD_SECTOR_SIZE;
     }
 
     return truncated_sectors;
@@ -363,53 +509,45 @@ mvhd_sparse_diff_write(MVHDMeta *vhdm, uint32_t offset, int num_sectors, void *i
 
     uint8_t* buff = (uint8_t *) in_buff;
     int64_t addr = 0ULL;
-    uint32_t s = 0;
-    uint32_t ls = 0;
+    uint32_t s = offset;
+    uint32_t ls = offset + transfer_sectors;
     int blk = 0;
-    int prev_blk = -1;
     int sib = 0;
-    ls = offset + transfer_sectors;
+    int count = 0;
 
     if (offset < total_sectors) {
-        for (s = offset; s < ls; s++) {
+        while (s < ls) {
             blk = s / vhdm->sect_per_block;
             sib = s % vhdm->sect_per_block;
-            if (vhdm->bitmap.curr_block != blk && prev_blk >= 0) {
-                /* Write the sector bitmap for the previous block, before we replace it. */
-                write_curr_sect_bitmap(vhdm);
-            }
+            count = vhdm->sect_per_block - sib;
+            if ((ls - s) < (uint32_t) count)
+                count = ls - s;
 
             if (vhdm->block_offset[blk] == MVHD_SPARSE_BLK) {
                 /* "read" the sector bitmap first, before creating a new block, as the bitmap will be
                    zero either way */
                 read_sect_bitmap(vhdm, blk);
                 create_block(vhdm, blk);
-            }
-
-            if (blk != prev_blk) {
-                if (vhdm->bitmap.curr_block != blk) {
-                    read_sect_bitmap(vhdm, blk);
-                    if (mvhd_fseeko64(vhdm->f, (uint64_t)sib * MVHD_SECTOR_SIZE, SEEK_CUR) == -1)
-                        vhdm->error = 1;
-                } else {
-                    addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) *
-                           MVHD_SECTOR_SIZE;
-                    if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
-                        vhdm->error = 1;
-                }
-                prev_blk = blk;
-            }
+            } else
+                read_sect_bitmap(vhdm, blk);
 
-            if (!fwrite(buff, MVHD_SECTOR_SIZE, 1, vhdm->f))
+            addr = (((int64_t) vhdm->block_offset[blk]) + vhdm->bitmap.sector_count + sib) * MVHD_SECTOR_SIZE;
+            if (mvhd_fseeko64(vhdm->f, addr, SEEK_SET) == -1)
+                vhdm->error = 1;
+            if (!fwrite(buff, (size_t) count * MVHD_SECTOR_SIZE, 1, vhdm->f))
                 vhdm->error = 1;
-            VHD_SETBIT(vhdm->bitmap.curr_bitmap, sib);
-            buff += MVHD_SECTOR_SIZE;
+
+            /* The bitmap is written back when it leaves the cache, or when
+               the metadata is flushed. */
+            for (int i = sib; i < (sib + count); i++)
+                VHD_SETBIT(vhdm->bitmap.curr_bitmap, i);
+            vhdm->bitmap.curr_entry->dirty = 1;
+
+            s += count;
+            buff += count * MVHD_SECTOR_SIZE;
         }
     }
 
-    /* And write the sector bitmap for the last block we visited to disk */
-    write_curr_sect_bitmap(vhdm);
-
     fflush(vhdm->f);
 
     return truncated_sectors;
@@ -31,6 +31,8 @@
 #include <86box/io.h>
 #include <86box/pic.h>
 #include <86box/dma.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 dma_t   dma[8];
@@ -1114,6 +1116,29 @@ dma_set_at(uint8_t at)
     dma_at = at;
 }
 
+void
+dma_serialize(snapshot_t *snap)
+{
+    snapshot_section(snap, "dma");
+
+    SNAPSHOT_VAR(snap, dma);
+    SNAPSHOT_VAR(snap, dma_e);
+    SNAPSHOT_VAR(snap, dma_m);
+    SNAPSHOT_VAR(snap, dmaregs);
+    SNAPSHOT_VAR(snap, dma_wp);
+    SNAPSHOT_VAR(snap, dma_stat);
+    SNAPSHOT_VAR(snap, dma_stat_rq);
+    SNAPSHOT_VAR(snap, dma_stat_rq_pc);
+    SNAPSHOT_VAR(snap, dma_stat_adv_pend);
+    SNAPSHOT_VAR(snap, dma_command);
+    SNAPSHOT_VAR(snap, dma_req_is_soft);
+    SNAPSHOT_VAR(snap, dma_advanced);
+    SNAPSHOT_VAR(snap, dma_at);
+    SNAPSHOT_VAR(snap, dma_sg_base);
+    SNAPSHOT_VAR(snap, dma_mask);
+    SNAPSHOT_VAR(snap, dma_ps2);
+}
+
 void
 dma_reset(void)
 {
@@ -1867,17 +1892,29 @@ dma_mode(int channel)
 void
 dma_bm_read(uint32_t PhysAddress, uint8_t *DataRead, uint32_t TotalSize, int TransferSize)
 {
-    uint32_t n;
-    uint32_t n2;
-    uint8_t  bytes[4] = { 0, 0, 0, 0 };
+    uint32_t       n;
+    uint32_t       n2;
+    uint32_t       run = 0;
+    const uint8_t *p;
+    uint8_t        bytes[4] = { 0, 0, 0, 0 };
 
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
+    /* Do the divisible block, if there is one, copying runs of plain memory
+       at once and only going through the mappings for MMIO. */
+    for (uint32_t i = 0; i < n;) {
+        p = mem_get_phys_ptr(PhysAddress + i, n - i, &run, 0);
+        if (p != NULL)
+            run &= ~(TransferSize - 1);
+
+        if ((p != NULL) && run) {
+            memcpy(&(DataRead[i]), p, run);
+            i += run;
+        } else {
             mem_read_phys((void *) &(DataRead[i]), PhysAddress + i, TransferSize);
+            i += TransferSize;
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -1892,15 +1929,26 @@ dma_bm_write(uint32_t PhysAddress, const uint8_t *DataWrite, uint32_t TotalSize,
 {
     uint32_t n;
     uint32_t n2;
+    uint32_t run = 0;
+    uint8_t *p;
     uint8_t  bytes[4] = { 0, 0, 0, 0 };
 
     n  = TotalSize & ~(TransferSize - 1);
     n2 = TotalSize - n;
 
-    /* Do the divisible block, if there is one. */
-    if (n) {
-        for (uint32_t i = 0; i < n; i += TransferSize)
+    /* Do the divisible block, if there is one, see dma_bm_read(). */
+    for (uint32_t i = 0; i < n;) {
+        p = mem_get_phys_ptr(PhysAddress + i, n - i, &run, 1);
+        if (p != NULL)
+            run &= ~(TransferSize - 1);
+
+        if ((p != NULL) && run) {
+            memcpy(p, &(DataWrite[i]), run);
+            i += run;
+        } else {
             mem_write_phys((void *) &(DataWrite[i]), PhysAddress + i, TransferSize);
+            i += TransferSize;
+        }
     }
 
     /* Do the non-divisible block, if there is one. */
@@ -35,6 +35,7 @@
 #include <86box/ui.h>
 #include <86box/fdd.h>
 #include <86box/fdc.h>
+#include <86box/snapshot.h>
 #include <86box/fdc_ext.h>
 #include <86box/plat_fallthrough.h>
 #include <86box/plat_unused.h>
@@ -2521,6 +2522,35 @@ fdc_close(void *priv)
     free(fdc);
 }
 
+static void
+fdc_serialize(void *priv, snapshot_t *snap)
+{
+    fdc_t   *fdc  = (fdc_t *) priv;
+    fdc_t    tmp  = *fdc;
+    uint16_t base;
+
+    SNAPSHOT_VAR(snap, tmp);
+    fifo_serialize(fdc->fifo_p, 16, snap);
+
+    if (!snap->saving && !snap->error) {
+        base = tmp.base_address;
+        fdc_remove(fdc);
+
+        tmp.fifo_p         = fdc->fifo_p;
+        tmp.timer          = fdc->timer;
+        tmp.watchdog_timer = fdc->watchdog_timer;
+        *fdc               = tmp;
+
+        fdc_set_base(fdc, base);
+    }
+
+    snapshot_timer(snap, &fdc->timer);
+    if (fdc->flags & FDC_FLAG_PCJR)
+        snapshot_timer(snap, &fdc->watchdog_timer);
+
+    fdd_serialize(snap);
+}
+
 static void *
 fdc_init(const device_t *info)
 {
@@ -2585,7 +2615,8 @@ const device_t fdc_xt_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_sec_device = {
@@ -2599,7 +2630,8 @@ const device_t fdc_xt_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_ter_device = {
@@ -2613,7 +2645,8 @@ const device_t fdc_xt_ter_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_qua_device = {
@@ -2627,7 +2660,8 @@ const device_t fdc_xt_qua_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_t1x00_device = {
@@ -2641,7 +2675,8 @@ const device_t fdc_xt_t1x00_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_amstrad_device = {
@@ -2655,7 +2690,8 @@ const device_t fdc_xt_amstrad_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_tandy_device = {
@@ -2669,7 +2705,8 @@ const device_t fdc_xt_tandy_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_xt_umc_um8398_device = {
@@ -2683,7 +2720,8 @@ const device_t fdc_xt_umc_um8398_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_pcjr_device = {
@@ -2697,7 +2735,8 @@ const device_t fdc_pcjr_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_device = {
@@ -2711,7 +2750,8 @@ const device_t fdc_at_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_sec_device = {
@@ -2725,7 +2765,8 @@ const device_t fdc_at_sec_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_ter_device = {
@@ -2739,7 +2780,8 @@ const device_t fdc_at_ter_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_qua_device = {
@@ -2753,7 +2795,8 @@ const device_t fdc_at_qua_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_actlow_device = {
@@ -2767,7 +2810,8 @@ const device_t fdc_at_actlow_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_smc_661_device = {
@@ -2781,7 +2825,8 @@ const device_t fdc_at_smc_661_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_smc_device = {
@@ -2795,7 +2840,8 @@ const device_t fdc_at_smc_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_ali_device = {
@@ -2809,7 +2855,8 @@ const device_t fdc_at_ali_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_winbond_device = {
@@ -2823,7 +2870,8 @@ const device_t fdc_at_winbond_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_nsc_device = {
@@ -2837,7 +2885,8 @@ const device_t fdc_at_nsc_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_at_nsc_dp8473_device = {
@@ -2851,7 +2900,8 @@ const device_t fdc_at_nsc_dp8473_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_ps2_device = {
@@ -2866,7 +2916,8 @@ const device_t fdc_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
 
 const device_t fdc_ps2_mca_device = {
@@ -2881,5 +2932,6 @@ const device_t fdc_ps2_mca_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = fdc_serialize
 };
\ No newline at end of file
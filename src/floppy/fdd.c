@@ -42,6 +42,7 @@
 #include <86box/fdd_td0.h>
 #include <86box/fdc.h>
 #include <86box/fdd_audio.h>
+#include <86box/snapshot.h>
 
 /* Flags:
    Bit  0:  300 rpm supported;
@@ -951,6 +952,35 @@ fdd_stop(int drive)
         drives[drive].stop(drive);
 }
 
+/* The image formats keep their decoded track state to themselves, so only
+   empty drives are supported; the drive mechanics are stored regardless. */
+void
+fdd_serialize(snapshot_t *snap)
+{
+    for (int i = 0; i < FDD_NUM; i++) {
+        if (!drive_empty[i]) {
+            pclog("Snapshot: floppy drive %i has media inserted\n", i);
+            snap->error = 1;
+            return;
+        }
+    }
+
+    SNAPSHOT_VAR(snap, fdd);
+    SNAPSHOT_VAR(snap, fdd_pending);
+    SNAPSHOT_VAR(snap, bios_boot_status);
+    SNAPSHOT_VAR(snap, fdd_seek_in_progress);
+    SNAPSHOT_VAR(snap, fdd_changed);
+    SNAPSHOT_VAR(snap, motoron);
+
+    for (int i = 0; i < FDD_NUM; i++) {
+        if (!snap->saving && !fdd_seek_timer[i].callback)
+            timer_add(&fdd_seek_timer[i], fdd_seek_complete_callback, &drives[i], 0);
+
+        snapshot_timer(snap, &fdd_poll_time[i]);
+        snapshot_timer(snap, &fdd_seek_timer[i]);
+    }
+}
+
 void
 fdd_set_fdc(void *fdc)
 {
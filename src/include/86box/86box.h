@@ -167,6 +167,9 @@ extern char vm_name[1024];    /* (O) display name of the VM */
 extern uint8_t  instru_enabled;
 extern uint64_t instru_run_ms;
 #endif
+#ifdef USE_HEADLESS
+extern uint32_t bench_run_secs; /* (O) emulated seconds to run, 0 = until unittester exit */
+#endif
 
 #define window_x monitor_settings[0].mon_window_x
 #define window_y monitor_settings[0].mon_window_y
@@ -210,10 +213,12 @@ extern int      voodoo_enabled;             /* (C) video option */
 extern int      ibm8514_standalone_enabled; /* (C) video option */
 extern int      xga_standalone_enabled;     /* (C) video option */
 extern int      da2_standalone_enabled;     /* (C) video option */
+extern int      video_deferred_render;      /* (C) video option */
 extern uint32_t mem_size;                   /* (C) memory size (Installed on system board) */
 extern uint32_t isa_mem_size;               /* (C) memory size (ISA Memory Cards) */
 extern int      cpu;                        /* (C) cpu type */
 extern int      cpu_use_dynarec;            /* (C) cpu uses/needs Dyna */
+extern int      cpu_dynarec_cache;          /* (C) keep dynarec block profile on disk */
 extern int      fpu_type;                   /* (C) fpu type */
 extern int      fpu_softfloat;              /* (C) fpu uses softfloat */
 extern int      time_sync;                  /* (C) enable time sync */
@@ -65,6 +65,9 @@
 
 #define CD_BUF_SIZE              (16 * RAW_SECTOR_SIZE)
 
+/* Maximum number of raw (2448-byte) sectors fetched ahead in one read. */
+#define CD_PREFETCH_SECTORS      32
+
 #define DATA_TRACK               0x14
 #define AUDIO_TRACK              0x10
 
@@ -300,6 +303,9 @@ typedef struct cdrom_ops_t {
     int      (*is_empty)(const void *local);
     void     (*close)(void *local);
     void     (*load)(const void *local);
+    /* Optional, returns the number of consecutive sectors read. */
+    int      (*read_sectors)(const void *local, uint8_t *buffer,
+                             const uint32_t sector, const uint32_t count);
 } cdrom_ops_t;
 
 typedef struct cdrom {
@@ -345,6 +351,12 @@ typedef struct cdrom {
 
     int32_t            cdrom_sector_size;
 
+    /* Raw sectors fetched ahead by ops->read_sectors. */
+    uint32_t           prefetch_lba;
+    uint32_t           prefetch_count;
+    uint32_t           prefetch_end;
+    uint8_t           *prefetch_buffer;
+
     const cdrom_ops_t *ops;
 
     char              *image_history[CD_IMAGE_HISTORY];
@@ -463,6 +475,7 @@ extern uint8_t         cdrom_read_disc_info_toc(cdrom_t *dev, uint8_t *b,
                                                 const uint8_t track, const int type);
 extern int             cdrom_is_track_audio(cdrom_t *dev, const int sector, const int ismsf,
                                             int cdrom_sector_type, const uint8_t vendor_type);
+extern void            cdrom_read_ahead(cdrom_t *dev, const uint32_t lba, const uint32_t count);
 extern int             cdrom_readsector_raw(cdrom_t *dev, uint8_t *buffer, const int sector, const int ismsf,
                                             int cdrom_sector_type, const int cdrom_sector_flags,
                                             int *len, const uint8_t vendor_type);
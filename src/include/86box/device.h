@@ -155,6 +155,8 @@ typedef struct _device_config_ {
     const device_config_bios_t       bios[32];
 } device_config_t;
 
+struct snapshot_t;
+
 typedef struct _device_ {
     const char *name;
     const char *internal_name;
@@ -172,6 +174,10 @@ typedef struct _device_ {
     void (*force_redraw)(void *priv);
 
     const device_config_t *config;
+
+    /* Save or restore the device state, see snapshot.h. Devices without
+       this hook prevent the machine from being snapshotted. */
+    void (*serialize)(void *priv, struct snapshot_t *snap);
 } device_t;
 
 typedef struct device_context_t {
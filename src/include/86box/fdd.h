@@ -130,6 +130,9 @@ extern void fdd_set_boot_status(bios_boot_status_t status);
 extern void fdd_boot_status_reset(void);
 extern int fdd_is_post_complete(void);
 
+struct snapshot_t;
+extern void fdd_serialize(struct snapshot_t *snap);
+
 extern int      motorspin;
 extern uint64_t motoron[FDD_NUM];
 
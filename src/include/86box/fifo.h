@@ -80,4 +80,7 @@ extern void       fifo_reset_evt(void *priv);
 extern void       fifo_close(void *priv);
 extern void      *fifo_init(int len);
 
+struct snapshot_t;
+extern void       fifo_serialize(void *priv, int size, struct snapshot_t *snap);
+
 #endif /*FIFO_H*/
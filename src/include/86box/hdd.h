@@ -77,6 +77,12 @@ enum {
 };
 #endif
 
+enum {
+    HDD_CACHE_WRITE_THROUGH = 0,
+    HDD_CACHE_WRITE_BACK    = 1,
+    HDD_CACHE_MMAP          = 2
+};
+
 enum {
     HDD_OP_SEEK  = 0,
     HDD_OP_READ  = 2,
@@ -156,7 +162,10 @@ typedef struct hard_disk_t {
                                         Bit 1 = DMA supportd. */
     uint8_t            wp;           /* Disk has been mounted
                                         READ-ONLY */
-    uint8_t            pad;
+    uint8_t            cache_mode;   /* Image write cache mode,
+                                        HDD_CACHE_WRITE_THROUGH,
+                                        HDD_CACHE_WRITE_BACK or
+                                        HDD_CACHE_MMAP. */
     uint8_t            pad0;
 
     void              *priv;
@@ -164,6 +173,8 @@ typedef struct hard_disk_t {
     char               fn[MAX_IMAGE_PATH_LEN];     /* Name of current image file */
     /* Differential VHD parent file */
     char               vhd_parent[1280];
+    /* Copy-on-write overlay, all writes go here when set */
+    char               overlay[MAX_IMAGE_PATH_LEN];
 
     uint32_t           seek_pos;
     uint32_t           seek_len;
@@ -217,6 +228,8 @@ extern int      hdd_image_write(uint8_t id, uint32_t sector, uint32_t count, uin
 extern int      hdd_image_write_ex(uint8_t id, uint32_t sector, uint32_t count, uint8_t *buffer);
 extern int      hdd_image_zero(uint8_t id, uint32_t sector, uint32_t count);
 extern int      hdd_image_zero_ex(uint8_t id, uint32_t sector, uint32_t count);
+extern int      hdd_image_flush(uint8_t id);
+extern const uint8_t *hdd_image_get_ptr(uint8_t id, uint32_t sector, uint32_t count);
 extern uint32_t hdd_image_get_last_sector(uint8_t id);
 extern uint32_t hdd_image_get_pos(uint8_t id);
 extern uint8_t  hdd_image_get_type(uint8_t id);
@@ -300,6 +300,10 @@ extern int memspeed[11];
 
 extern uint8_t high_page; /* if a high (> 4 gb) page was detected */
 
+/* Second level TLB hits and misses (page table walks). */
+extern uint64_t mem_tlb_hits;
+extern uint64_t mem_tlb_misses;
+
 extern uint8_t *_mem_exec[MEM_MAPPINGS_NO];
 
 extern uint32_t pages_sz; /* #pages in table */
@@ -349,8 +353,10 @@ extern uint32_t readmemll_no_mmut_2386(uint32_t addr, uint32_t *a64);
 extern void     writememll_no_mmut_2386(uint32_t addr, uint32_t *a64, uint32_t val);
 
 extern void     do_mmutranslate_2386(uint32_t addr, uint32_t *a64, int num, int write);
+extern uint8_t *mem_fetch_ptr_2386(uint32_t addr);
 
 extern uint8_t *getpccache(uint32_t a);
+extern uint8_t *mem_code_ptr(uint32_t addr, int *page);
 extern uint64_t mmutranslatereal(uint32_t addr, int rw);
 extern uint32_t mmutranslatereal32(uint32_t addr, int rw);
 extern void     addreadlookup(uint32_t virt, uint32_t phys);
@@ -416,6 +422,7 @@ extern void     mem_writeb_phys(uint32_t addr, uint8_t val);
 extern void     mem_writew_phys(uint32_t addr, uint16_t val);
 extern void     mem_writel_phys(uint32_t addr, uint32_t val);
 extern void     mem_write_phys(void *src, uint32_t addr, int tranfer_size);
+extern uint8_t *mem_get_phys_ptr(uint32_t addr, uint32_t max_len, uint32_t *len, int write);
 
 extern uint8_t  mem_read_ram(uint32_t addr, void *priv);
 extern uint16_t mem_read_ramw(uint32_t addr, void *priv);
@@ -433,6 +440,16 @@ extern void     mem_write_ram_2gbl(uint32_t addr, uint32_t val, void *priv);
 
 extern int mem_addr_is_ram(uint32_t addr);
 
+/* Guest RAM dirty tracking, one bit per 4K page of the RAM block. */
+extern void     mem_dirty_clear(void);
+extern void     mem_dirty_set_all(void);
+extern int      mem_dirty_test(uint32_t page);
+extern uint32_t mem_dirty_next(uint32_t page);
+extern uint32_t mem_dirty_count(void);
+extern uint32_t mem_ram_pages(void);
+
+extern void (*ram_code_write)(uint32_t first, uint32_t last);
+
 extern uint64_t mmutranslate_noabrt(uint32_t addr, int rw);
 
 extern void mem_invalidate_range(uint32_t start_addr, uint32_t end_addr);
@@ -448,6 +465,8 @@ extern void flushmmucache(void);
 extern void flushmmucache_write(void);
 extern void flushmmucache_pc(void);
 extern void flushmmucache_nopc(void);
+extern void flushmmucache_page(uint32_t addr);
+extern void decode_cache_flush(void);
 
 extern void mem_debug_check_addr(uint32_t addr, int write);
 
@@ -151,6 +151,7 @@ extern void     plat_resize_request(int x, int y, int monitor_index);
 extern int      plat_language_code(char *langcode);
 extern void     plat_language_code_r(int id, char *outbuf, int len);
 extern void     plat_get_cpu_string(char *outbuf, uint8_t len);
+extern int      plat_get_cpu_count(void);
 #ifdef _WIN32
 extern void     plat_get_system_directory(char *outbuf);
 #endif
@@ -0,0 +1,87 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Definitions for the machine save state handler.
+ *
+ *          A snapshot is only valid for the exact build and machine
+ *          configuration it was taken with; it is restored on top of
+ *          a freshly hard reset machine, so that everything which is
+ *          derived from the configuration (device list, memory map
+ *          callbacks, timers) already exists and only its state has
+ *          to be brought back.
+ *
+ *          Only machines whose every device can serialize itself are
+ *          supported; the IBM AT with CGA, ISA IDE hard disks, empty
+ *          floppy drives and nothing attached to its serial and
+ *          parallel ports is the reference configuration.
+ *
+ *          A checkpoint is an incremental snapshot: it stores the full
+ *          CPU and device state, but only the RAM pages written since
+ *          the previous snapshot taken or loaded, which it names as its
+ *          parent. Loading a checkpoint loads its chain of parents first.
+ */
+#ifndef EMU_SNAPSHOT_H
+#define EMU_SNAPSHOT_H
+
+#define SNAPSHOT_MAGIC   "86BoxSNP"
+#define SNAPSHOT_VERSION 3
+
+typedef struct snapshot_t {
+    FILE    *fp;
+    int      saving; /* 1 = writing the state out, 0 = reading it back */
+    int      error;
+    int      incremental; /* only the dirty RAM pages are transferred */
+    uint64_t id;
+    uint64_t parent_id;   /* 0 for a full snapshot */
+    char     parent[1024];
+} snapshot_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Pending save/load requests, serviced by pc_run() between frames. */
+extern char snapshot_save_path[1024];
+extern char snapshot_load_path[1024];
+extern char snapshot_checkpoint_path[1024];
+/* Where to save the machine state on exit, if anywhere. */
+extern char snapshot_exit_path[1024];
+
+/* Transfer a block of state in the direction given by snap->saving. */
+extern void snapshot_io(snapshot_t *snap, void *data, size_t size);
+#define SNAPSHOT_VAR(snap, var) snapshot_io((snap), &(var), sizeof(var))
+
+/* Write or check a section marker, to catch layout mismatches early. */
+extern void snapshot_section(snapshot_t *snap, const char *tag);
+
+/* Save or restore a timer, keeping its place in the timer queue valid. */
+extern void snapshot_timer(snapshot_t *snap, pc_timer_t *timer);
+
+/* Returns the name of the first device which cannot be saved, if any. */
+extern const char *snapshot_unsupported(void);
+
+extern int snapshot_save(const char *fn);
+extern int snapshot_load(const char *fn);
+/* Incremental on top of the last snapshot taken or loaded, if any. */
+extern int snapshot_checkpoint(const char *fn);
+
+/* Called from pc_run() to service pending requests. */
+extern void snapshot_process(void);
+
+/* Per-subsystem state handlers. */
+extern void cpu_serialize(snapshot_t *snap);
+extern void mem_serialize(snapshot_t *snap);
+extern void pic_serialize(snapshot_t *snap);
+extern void dma_serialize(snapshot_t *snap);
+extern void device_serialize_all(snapshot_t *snap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /*EMU_SNAPSHOT_H*/
@@ -28,4 +28,7 @@ extern void speaker_init(void);
 extern void speaker_set_count(uint8_t new_m, int new_count);
 extern void speaker_update(void);
 
+struct snapshot_t;
+extern void speaker_serialize(struct snapshot_t *snap);
+
 #endif /*SOUND_SPEAKER_H*/
@@ -44,8 +44,19 @@ typedef struct pc_timer_t {
 
     struct pc_timer_t *prev;
     struct pc_timer_t *next;
+
+    int      heap_idx; /* Position in the timer heap (USE_TIMER_HEAP only). */
+    uint32_t heap_seq; /* Insertion order, used to break ties in the heap. */
 } pc_timer_t;
 
+/*Scheduler statistics, used to compare the list and heap backends.*/
+typedef struct timer_stats_t {
+    uint64_t inserts;      /* Number of timer_enable() calls. */
+    uint64_t insert_steps; /* List nodes walked or heap levels sifted. */
+    uint64_t queue_len;    /* Sum of the queue length seen at each insertion. */
+    uint64_t callbacks;    /* Number of timer callbacks run. */
+} timer_stats_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -66,6 +77,10 @@ extern void timer_process(void);
 extern void timer_close(void);
 extern void timer_init(void);
 
+/*Get and reset the scheduler statistics*/
+extern void timer_get_stats(timer_stats_t *stats);
+extern void timer_reset_stats(void);
+
 /*Add new timer. If start_timer is set, timer will be enabled with a zero
   timestamp - this is useful for permanently enabled timers*/
 extern void timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start_timer);
@@ -25,6 +25,9 @@ extern "C" {
 /* Global variables. */
 extern const device_t unittester_device;
 
+/* If set, called instead of exit() when the guest requests an exit. */
+extern void (*unittester_exit_func)(int code);
+
 /* Functions. */
 
 #ifdef __cplusplus
@@ -331,6 +331,9 @@ typedef struct svga_t {
     void *     priv_parent;
 
     void *     local;
+
+    /* Off-thread scanline renderer, NULL when lines are rendered inline. */
+    struct svga_deferred_t *deferred;
 } svga_t;
 
 extern void     ibm8514_set_poll(svga_t *svga);
@@ -407,6 +410,7 @@ uint32_t svga_mask_addr(uint32_t addr, svga_t *svga);
 uint32_t svga_mask_changedaddr(uint32_t addr, svga_t *svga);
 
 void svga_doblit(int wx, int wy, svga_t *svga);
+void svga_deferred_sync(svga_t *svga);
 void svga_set_poll(svga_t *svga);
 void svga_poll(void *priv);
 
@@ -27,7 +27,14 @@
 
 #define TEX_DIRTY_SHIFT 10
 
-#define TEX_CACHE_MAX   64
+#define TEX_CACHE_DEFAULT    128
+#define TEX_CACHE_ENTRY_SIZE ((256 * 256 + 256 * 256 + 128 * 128 + 64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2) * 4)
+
+/*Texture decodes are handed to a small pool of worker threads through a ring
+  of jobs; when the ring is full the FIFO thread decodes the texture itself*/
+#define TEX_DECODE_THREADS 2
+#define TEX_DECODE_QUEUE   16
+#define TEX_DECODE_MASK    (TEX_DECODE_QUEUE - 1)
 
 enum {
     VOODOO_1 = 0,
@@ -94,6 +101,12 @@ enum {
 #define PARAM_FULL(x)    ((voodoo->params_write_idx - voodoo->params_read_idx[x]) >= PARAM_SIZE)
 #define PARAM_EMPTY(x)   (voodoo->params_read_idx[x] == voodoo->params_write_idx)
 
+/*Triangles are rendered by a pool of render threads. The screen is split into
+  full width tiles of (1 << VOODOO_TILE_SHIFT) lines, which are dealt out to
+  the threads in turn*/
+#define VOODOO_MAX_RENDER_THREADS 32
+#define VOODOO_TILE_SHIFT         3
+
 typedef struct
 {
     uint32_t addr_type;
@@ -218,20 +231,51 @@ typedef struct voodoo_params_t {
     int aux_tiled;
     int row_width;
     int aux_row_width;
+
+    /*Lines covered by the triangle, after Y clipping. Set when the triangle is
+      queued, and used by the render threads to skip triangles that do not
+      touch any of their tiles*/
+    int bin_ystart;
+    int bin_yend;
 } voodoo_params_t;
 
 typedef struct texture_t {
     uint32_t   base;
     uint32_t   tLOD;
     ATOMIC_INT refcount;
-    ATOMIC_INT refcount_r[4];
+    ATOMIC_INT refcount_r[VOODOO_MAX_RENDER_THREADS];
     int        is16;
     uint32_t   palette_checksum;
     uint32_t   addr_start[4];
     uint32_t   addr_end[4];
     uint32_t  *data;
+    ATOMIC_INT decoded;
+    int        hash;
+    int        hash_next;
+    int        lru_prev;
+    int        lru_next;
 } texture_t;
 
+typedef struct voodoo_tex_job_t {
+    ATOMIC_INT busy;
+    int        tmu;
+    int        entry;
+    int        tformat;
+    int        lod_min;
+    int        lod_max;
+    uint32_t   tex_base[LOD_MAX + 2];
+    int        tex_w_mask[LOD_MAX + 2];
+    int        tex_h_mask[LOD_MAX + 2];
+    int        tex_shift[LOD_MAX + 2];
+    int        tex_lod[LOD_MAX + 2];
+    rgba_u     pal[256];
+} voodoo_tex_job_t;
+
+typedef struct voodoo_tex_decode_ctx_t {
+    struct voodoo_t *voodoo;
+    int              index;
+} voodoo_tex_decode_ctx_t;
+
 typedef struct vert_t {
     float sVx;
     float sVy;
@@ -256,6 +300,11 @@ typedef struct clip_t {
     int y_max;
 } clip_t;
 
+typedef struct voodoo_render_ctx_t {
+    struct voodoo_t *voodoo;
+    int              odd_even;
+} voodoo_render_ctx_t;
+
 typedef struct voodoo_t {
     mem_mapping_t mapping;
 
@@ -352,25 +401,25 @@ typedef struct voodoo_t {
     int    ncc_dirty[2];
 
     thread_t *fifo_thread;
-    thread_t *render_thread[4];
+    thread_t *render_thread[VOODOO_MAX_RENDER_THREADS];
     event_t  *wake_fifo_thread;
     event_t  *wake_main_thread;
     event_t  *fifo_not_full_event;
-    event_t  *render_not_full_event[4];
-    event_t  *wake_render_thread[4];
+    event_t  *render_not_full_event[VOODOO_MAX_RENDER_THREADS];
+    event_t  *wake_render_thread[VOODOO_MAX_RENDER_THREADS];
 
     int voodoo_busy;
-    int render_voodoo_busy[4];
+    int render_voodoo_busy[VOODOO_MAX_RENDER_THREADS];
 
-    int render_threads;
-    int odd_even_mask;
+    int                 render_threads;
+    voodoo_render_ctx_t render_ctx[VOODOO_MAX_RENDER_THREADS];
 
-    int pixel_count[4];
-    int texel_count[4];
+    int pixel_count[VOODOO_MAX_RENDER_THREADS];
+    int texel_count[VOODOO_MAX_RENDER_THREADS];
     int tri_count;
     int frame_count;
-    int pixel_count_old[4];
-    int texel_count_old[4];
+    int pixel_count_old[VOODOO_MAX_RENDER_THREADS];
+    int texel_count_old[VOODOO_MAX_RENDER_THREADS];
     int wr_count;
     int rd_count;
     int tex_count;
@@ -401,7 +450,7 @@ typedef struct voodoo_t {
     ATOMIC_INT   cmd_written_fifo_2;
 
     voodoo_params_t params_buffer[PARAM_SIZE];
-    ATOMIC_INT      params_read_idx[4];
+    ATOMIC_INT      params_read_idx[VOODOO_MAX_RENDER_THREADS];
     ATOMIC_INT      params_write_idx;
 
     uint32_t   cmdfifo_base;
@@ -648,15 +697,31 @@ typedef struct voodoo_t {
     uint8_t  thefilterb[256][256];
     uint16_t purpleline[256][3];
 
-    texture_t texture_cache[2][TEX_CACHE_MAX];
-    uint8_t   texture_present[2][16384];
-    int       texture_last_removed;
+    texture_t *texture_cache[2];
+    int       *texture_hash[2];
+    int        texture_lru_head[2];
+    int        texture_lru_tail[2];
+    int        texture_cache_size;
+    int        texture_hash_mask;
+    uint8_t    texture_present[2][16384];
+    mutex_t   *texture_cache_mutex; /*Guards the hash and LRU lists*/
+
+    voodoo_tex_job_t tex_jobs[TEX_DECODE_QUEUE];
+    int              tex_job_write_idx;
+    int              tex_job_read_idx;
+    mutex_t         *tex_job_mutex;
+    event_t         *wake_tex_decode_thread[TEX_DECODE_THREADS];
+    event_t         *tex_decoded_event;
+    thread_t        *tex_decode_thread[TEX_DECODE_THREADS];
+    uint8_t          tex_decode_thread_run;
+
+    voodoo_tex_decode_ctx_t tex_decode_ctx[TEX_DECODE_THREADS];
 
     uint32_t palette_checksum[2];
     int      palette_dirty[2];
 
     uint64_t time;
-    int      render_time[4];
+    int      render_time[VOODOO_MAX_RENDER_THREADS];
 
     int      force_blit_count;
     int      can_blit;
@@ -670,7 +735,7 @@ typedef struct voodoo_t {
     uint32_t launch_pending;
 
     uint8_t fifo_thread_run;
-    uint8_t render_thread_run[4];
+    uint8_t render_thread_run[VOODOO_MAX_RENDER_THREADS];
 
     uint8_t *vram;
     uint8_t *changedvram;
@@ -0,0 +1,721 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          AVX2 span renderer for the 3DFX Voodoo emulation.
+ *
+ *          Processes eight pixels per iteration. Texels are fetched one
+ *          pixel at a time through voodoo_tmu_fetch(), as the perspective
+ *          divide and LOD selection need 64-bit maths; the rest of the
+ *          pipeline is vectorised. Triangles using the TMU1 combine,
+ *          stipple, the alpha buffer or tiled buffers go through the
+ *          recompiler as before. Only included by vid_voodoo_render.c.
+ *
+ *
+ *
+ * Authors: Sarah Walker, <https://pcem-emulator.co.uk/>
+ *
+ *          Copyright 2008-2020 Sarah Walker.
+ */
+#ifndef VIDEO_VOODOO_SPAN_AVX2_H
+#define VIDEO_VOODOO_SPAN_AVX2_H
+
+#include <immintrin.h>
+
+#define VOODOO_AVX2 __attribute__((target("avx2")))
+
+static int voodoo_span_avx2_available = -1;
+
+static int
+voodoo_span_avx2_detect(void)
+{
+    if (voodoo_span_avx2_available == -1) {
+        __builtin_cpu_init();
+        voodoo_span_avx2_available = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+
+    return voodoo_span_avx2_available;
+}
+
+/*Returns non-zero if the triangle only uses pipeline features handled by
+  voodoo_span_avx2(). Needs to match the interpreter exactly*/
+static int
+voodoo_span_avx2_supported(voodoo_t *voodoo, voodoo_params_t *params)
+{
+    if (voodoo_span_avx2_available != 1)
+        return 0;
+
+    /*Only TMU0 sampling, which the interpreter does without the texture combine*/
+    if ((params->fbzColorPath & FBZCP_TEXTURE_ENABLED) && voodoo->dual_tmus && (params->textureMode[0] & TEXTUREMODE_LOCAL_MASK) != TEXTUREMODE_LOCAL)
+        return 0;
+    if (voodoo->trexInit1[0] & (1 << 18))
+        return 0;
+    if (a_sel == A_SEL_LFB)
+        return 0;
+    if (cca_localselect > CCA_LOCALSELECT_ITER_Z)
+        return 0;
+    if (cc_mselect > CC_MSELECT_TEXRGB || cca_mselect > CCA_MSELECT_TEX)
+        return 0;
+    if (cc_add == 3)
+        return 0;
+
+    if (params->fbzMode & (FBZ_STIPPLE | FBZ_ALPHA_ENABLE))
+        return 0;
+    if (params->col_tiled || params->aux_tiled || voodoo->params.col_tiled || voodoo->params.aux_tiled)
+        return 0;
+
+    return 1;
+}
+
+/*Same as the w_depth calculation in voodoo_half_triangle()*/
+static int32_t
+voodoo_avx2_w_depth(int64_t w)
+{
+    int32_t w_depth;
+
+    if (w & 0xffff00000000)
+        w_depth = 0;
+    else if (!(w & 0xffff0000))
+        w_depth = 0xf001;
+    else {
+        int exp  = voodoo_fls((uint16_t) ((uint32_t) w >> 16));
+        int mant = (~(uint32_t) w >> (19 - exp)) & 0xfff;
+        w_depth  = (exp << 12) + mant + 1;
+        if (w_depth > 0xffff)
+            w_depth = 0xffff;
+    }
+
+    return w_depth;
+}
+
+static VOODOO_AVX2 __m256i
+voodoo_avx2_clamp(__m256i v)
+{
+    return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), _mm256_set1_epi32(0xff));
+}
+
+static VOODOO_AVX2 __m256i
+voodoo_avx2_clamp16(__m256i v)
+{
+    return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), _mm256_set1_epi32(0xffff));
+}
+
+/*(a * b) / 255, for a and b in 0-255*/
+static VOODOO_AVX2 __m256i
+voodoo_avx2_mul255(__m256i a, __m256i b)
+{
+    __m256i v = _mm256_mullo_epi32(a, b);
+
+    return _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(v, _mm256_set1_epi32(1)), _mm256_srli_epi32(v, 8)), 8);
+}
+
+/*Returns the lanes where the comparison selected by op passes*/
+static VOODOO_AVX2 __m256i
+voodoo_avx2_compare(int op, __m256i a, __m256i b)
+{
+    const __m256i ones = _mm256_set1_epi32(-1);
+
+    switch (op) {
+        case DEPTHOP_NEVER:
+            return _mm256_setzero_si256();
+        case DEPTHOP_LESSTHAN:
+            return _mm256_cmpgt_epi32(b, a);
+        case DEPTHOP_EQUAL:
+            return _mm256_cmpeq_epi32(a, b);
+        case DEPTHOP_LESSTHANEQUAL:
+            return _mm256_xor_si256(_mm256_cmpgt_epi32(a, b), ones);
+        case DEPTHOP_GREATERTHAN:
+            return _mm256_cmpgt_epi32(a, b);
+        case DEPTHOP_NOTEQUAL:
+            return _mm256_xor_si256(_mm256_cmpeq_epi32(a, b), ones);
+        case DEPTHOP_GREATERTHANEQUAL:
+            return _mm256_xor_si256(_mm256_cmpgt_epi32(b, a), ones);
+        default:
+            return ones;
+    }
+}
+
+/*Looks up eight byte entries in a dither table. Gathers the aligned dword
+  holding each entry so the table is never read past its end*/
+static VOODOO_AVX2 __m256i
+voodoo_avx2_dither(const uint8_t *table, __m256i idx)
+{
+    __m256i dword = _mm256_i32gather_epi32((const int *) table, _mm256_andnot_si256(_mm256_set1_epi32(3), idx), 1);
+    __m256i shift = _mm256_slli_epi32(_mm256_and_si256(idx, _mm256_set1_epi32(3)), 3);
+
+    return _mm256_and_si256(_mm256_srlv_epi32(dword, shift), _mm256_set1_epi32(0xff));
+}
+
+/*Index of each pixel within a row of a dither table*/
+static VOODOO_AVX2 __m256i
+voodoo_avx2_dither_idx(voodoo_params_t *params, int x, int real_y)
+{
+    __m256i xpos = _mm256_add_epi32(_mm256_set1_epi32(x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+
+    if (dither2x2)
+        return _mm256_add_epi32(_mm256_set1_epi32((real_y & 1) << 1), _mm256_and_si256(xpos, _mm256_set1_epi32(1)));
+
+    return _mm256_add_epi32(_mm256_set1_epi32((real_y & 3) << 2), _mm256_and_si256(xpos, _mm256_set1_epi32(3)));
+}
+
+static VOODOO_AVX2 int
+voodoo_avx2_count(__m256i mask)
+{
+    return __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(mask)));
+}
+
+static VOODOO_AVX2 __m128i
+voodoo_avx2_pack16(__m256i v)
+{
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08));
+}
+
+static VOODOO_AVX2 void
+voodoo_avx2_store16(uint16_t *dst, __m256i v, __m256i mask)
+{
+    __m128i old    = _mm_loadu_si128((const __m128i *) dst);
+    __m128i mask16 = _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packs_epi32(mask, mask), 0x08));
+
+    _mm_storeu_si128((__m128i *) dst, _mm_blendv_epi8(old, voodoo_avx2_pack16(v), mask16));
+}
+
+/*Render up to eight pixels starting at x. iter and iter64 hold the iterators
+  for x. fb and aux point at the pixel for x, and must have room for eight
+  entries*/
+static VOODOO_AVX2 void
+voodoo_span_avx2_block(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, const int32_t *iter, const int64_t *iter64, int x, int real_y, int count, uint16_t *fb, uint16_t *aux)
+{
+    const __m256i lane        = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i zero        = _mm256_setzero_si256();
+    const __m256i ff          = _mm256_set1_epi32(0xff);
+    __m256i       live        = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), lane);
+    __m256i       ir          = _mm256_add_epi32(_mm256_set1_epi32(iter[0]), _mm256_mullo_epi32(lane, _mm256_set1_epi32(params->dRdX)));
+    __m256i       ig          = _mm256_add_epi32(_mm256_set1_epi32(iter[1]), _mm256_mullo_epi32(lane, _mm256_set1_epi32(params->dGdX)));
+    __m256i       ib          = _mm256_add_epi32(_mm256_set1_epi32(iter[2]), _mm256_mullo_epi32(lane, _mm256_set1_epi32(params->dBdX)));
+    __m256i       ia          = _mm256_add_epi32(_mm256_set1_epi32(iter[3]), _mm256_mullo_epi32(lane, _mm256_set1_epi32(params->dAdX)));
+    __m256i       z           = _mm256_add_epi32(_mm256_set1_epi32(iter[4]), _mm256_mullo_epi32(lane, _mm256_set1_epi32(params->dZdX)));
+    __m256i       iter_r      = voodoo_avx2_clamp(_mm256_srai_epi32(ir, 12));
+    __m256i       iter_g      = voodoo_avx2_clamp(_mm256_srai_epi32(ig, 12));
+    __m256i       iter_b      = voodoo_avx2_clamp(_mm256_srai_epi32(ib, 12));
+    __m256i       iter_a      = voodoo_avx2_clamp(_mm256_srai_epi32(ia, 12));
+    int           fog_sel     = params->fogMode & (FOG_Z | FOG_ALPHA);
+    int           w_fog       = (params->fogMode & FOG_ENABLE) && !(params->fogMode & FOG_CONSTANT) && (fog_sel == 0 || fog_sel == FOG_W);
+    int32_t       w_depth[8]  = { 0 };
+    int32_t       fog_lane[8] = { 0 };
+    __m256i       new_depth;
+    __m256i       tex_r, tex_g, tex_b, tex_a;
+    __m256i       clocal_r, clocal_g, clocal_b;
+    __m256i       cother_r, cother_g, cother_b;
+    __m256i       alocal, aother;
+    __m256i       src_r, src_g, src_b, src_a;
+    __m256i       msel_r, msel_g, msel_b, msel_a;
+    __m256i       colbfog_r, colbfog_g, colbfog_b;
+    int           live_bits;
+
+    voodoo->fbiPixelsIn += count;
+
+    if ((params->fbzMode & FBZ_W_BUFFER) || w_fog) {
+        for (int i = 0; i < count; i++) {
+            int64_t w = iter64[3] + params->dWdX * i;
+
+            w_depth[i] = voodoo_avx2_w_depth(w);
+            if (fog_sel == 0) {
+                int fog_idx = (w_depth[i] >> 10) & 0x3f;
+
+                fog_lane[i] = params->fogTable[fog_idx].fog + ((params->fogTable[fog_idx].dfog * ((w_depth[i] >> 2) & 0xff)) >> 10);
+            } else
+                fog_lane[i] = (w >> 32) & 0xff;
+        }
+    }
+
+    if (params->fbzMode & FBZ_W_BUFFER)
+        new_depth = _mm256_loadu_si256((const __m256i *) w_depth);
+    else
+        new_depth = voodoo_avx2_clamp16(_mm256_srai_epi32(z, 12));
+    if (params->fbzMode & FBZ_DEPTH_BIAS)
+        new_depth = voodoo_avx2_clamp16(_mm256_add_epi32(new_depth, _mm256_set1_epi32((int16_t) params->zaColor)));
+
+    if (params->fbzMode & FBZ_DEPTH_ENABLE) {
+        __m256i old_depth  = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) aux));
+        __m256i comp_depth = (params->fbzMode & FBZ_DEPTH_SOURCE) ? _mm256_set1_epi32(params->zaColor & 0xffff) : new_depth;
+        __m256i pass       = voodoo_avx2_compare(depth_op, comp_depth, old_depth);
+
+        voodoo->fbiZFuncFail += voodoo_avx2_count(_mm256_andnot_si256(pass, live));
+        live = _mm256_and_si256(live, pass);
+        if (_mm256_testz_si256(live, live))
+            return;
+    }
+
+    if (params->fbzColorPath & FBZCP_TEXTURE_ENABLED) {
+        int32_t tex[4][8] = { { 0 } };
+
+        live_bits = _mm256_movemask_ps(_mm256_castsi256_ps(live));
+        for (int i = 0; i < count; i++) {
+            if (!(live_bits & (1 << i)))
+                continue;
+
+            state->tmu0_s = iter64[0] + params->tmu[0].dSdX * i;
+            state->tmu0_t = iter64[1] + params->tmu[0].dTdX * i;
+            state->tmu0_w = iter64[2] + params->tmu[0].dWdX * i;
+            voodoo_tmu_fetch(voodoo, params, state, 0, x + i);
+
+            tex[0][i] = state->tex_r[0];
+            tex[1][i] = state->tex_g[0];
+            tex[2][i] = state->tex_b[0];
+            tex[3][i] = state->tex_a[0];
+        }
+
+        tex_r = _mm256_loadu_si256((const __m256i *) tex[0]);
+        tex_g = _mm256_loadu_si256((const __m256i *) tex[1]);
+        tex_b = _mm256_loadu_si256((const __m256i *) tex[2]);
+        tex_a = _mm256_loadu_si256((const __m256i *) tex[3]);
+    } else {
+        tex_r = _mm256_set1_epi32(state->tex_r[0]);
+        tex_g = _mm256_set1_epi32(state->tex_g[0]);
+        tex_b = _mm256_set1_epi32(state->tex_b[0]);
+        tex_a = _mm256_set1_epi32(state->tex_a[0]);
+    }
+
+    if (cc_localselect_override) {
+        __m256i sel = _mm256_cmpgt_epi32(_mm256_and_si256(tex_a, _mm256_set1_epi32(0x80)), zero);
+
+        clocal_r = _mm256_blendv_epi8(iter_r, _mm256_set1_epi32((params->color0 >> 16) & 0xff), sel);
+        clocal_g = _mm256_blendv_epi8(iter_g, _mm256_set1_epi32((params->color0 >> 8) & 0xff), sel);
+        clocal_b = _mm256_blendv_epi8(iter_b, _mm256_set1_epi32(params->color0 & 0xff), sel);
+    } else if (cc_localselect) {
+        clocal_r = _mm256_set1_epi32((params->color0 >> 16) & 0xff);
+        clocal_g = _mm256_set1_epi32((params->color0 >> 8) & 0xff);
+        clocal_b = _mm256_set1_epi32(params->color0 & 0xff);
+    } else {
+        clocal_r = iter_r;
+        clocal_g = iter_g;
+        clocal_b = iter_b;
+    }
+
+    switch (_rgb_sel) {
+        case CC_LOCALSELECT_ITER_RGB:
+            cother_r = iter_r;
+            cother_g = iter_g;
+            cother_b = iter_b;
+            break;
+        case CC_LOCALSELECT_TEX:
+            cother_r = tex_r;
+            cother_g = tex_g;
+            cother_b = tex_b;
+            break;
+        case CC_LOCALSELECT_COLOR1:
+            cother_r = _mm256_set1_epi32((params->color1 >> 16) & 0xff);
+            cother_g = _mm256_set1_epi32((params->color1 >> 8) & 0xff);
+            cother_b = _mm256_set1_epi32(params->color1 & 0xff);
+            break;
+        default: /*Linear frame buffer, not used by triangles*/
+            cother_r = cother_g = cother_b = zero;
+            break;
+    }
+
+    if (params->fbzMode & FBZ_CHROMAKEY) {
+        __m256i key = _mm256_and_si256(_mm256_cmpeq_epi32(cother_r, _mm256_set1_epi32(params->chromaKey_r)),
+                                       _mm256_and_si256(_mm256_cmpeq_epi32(cother_g, _mm256_set1_epi32(params->chromaKey_g)),
+                                                        _mm256_cmpeq_epi32(cother_b, _mm256_set1_epi32(params->chromaKey_b))));
+
+        voodoo->fbiChromaFail += voodoo_avx2_count(_mm256_and_si256(key, live));
+        live = _mm256_andnot_si256(key, live);
+        if (_mm256_testz_si256(live, live))
+            return;
+    }
+
+    switch (cca_localselect) {
+        case CCA_LOCALSELECT_ITER_A:
+            alocal = iter_a;
+            break;
+        case CCA_LOCALSELECT_COLOR0:
+            alocal = _mm256_set1_epi32((params->color0 >> 24) & 0xff);
+            break;
+        default:
+            alocal = voodoo_avx2_clamp(_mm256_srai_epi32(z, 20));
+            break;
+    }
+
+    switch (a_sel) {
+        case A_SEL_ITER_A:
+            aother = iter_a;
+            break;
+        case A_SEL_TEX:
+            aother = tex_a;
+            break;
+        default:
+            aother = _mm256_set1_epi32((params->color1 >> 24) & 0xff);
+            break;
+    }
+
+    if (params->fbzMode & FBZ_ALPHA_MASK) {
+        live = _mm256_and_si256(live, _mm256_cmpeq_epi32(_mm256_and_si256(aother, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+        if (_mm256_testz_si256(live, live))
+            return;
+    }
+
+    src_r = cc_zero_other ? zero : cother_r;
+    src_g = cc_zero_other ? zero : cother_g;
+    src_b = cc_zero_other ? zero : cother_b;
+    src_a = cca_zero_other ? zero : aother;
+
+    if (cc_sub_clocal) {
+        src_r = _mm256_sub_epi32(src_r, clocal_r);
+        src_g = _mm256_sub_epi32(src_g, clocal_g);
+        src_b = _mm256_sub_epi32(src_b, clocal_b);
+    }
+    if (cca_sub_clocal)
+        src_a = _mm256_sub_epi32(src_a, alocal);
+
+    switch (cc_mselect) {
+        case CC_MSELECT_CLOCAL:
+            msel_r = clocal_r;
+            msel_g = clocal_g;
+            msel_b = clocal_b;
+            break;
+        case CC_MSELECT_AOTHER:
+            msel_r = msel_g = msel_b = aother;
+            break;
+        case CC_MSELECT_ALOCAL:
+            msel_r = msel_g = msel_b = alocal;
+            break;
+        case CC_MSELECT_TEX:
+            msel_r = msel_g = msel_b = tex_a;
+            break;
+        case CC_MSELECT_TEXRGB:
+            msel_r = tex_r;
+            msel_g = tex_g;
+            msel_b = tex_b;
+            break;
+        default:
+            msel_r = msel_g = msel_b = zero;
+            break;
+    }
+
+    switch (cca_mselect) {
+        case CCA_MSELECT_ALOCAL:
+        case CCA_MSELECT_ALOCAL2:
+            msel_a = alocal;
+            break;
+        case CCA_MSELECT_AOTHER:
+            msel_a = aother;
+            break;
+        case CCA_MSELECT_TEX:
+            msel_a = tex_a;
+            break;
+        default:
+            msel_a = zero;
+            break;
+    }
+
+    if (!cc_reverse_blend) {
+        msel_r = _mm256_xor_si256(msel_r, ff);
+        msel_g = _mm256_xor_si256(msel_g, ff);
+        msel_b = _mm256_xor_si256(msel_b, ff);
+    }
+    if (!cca_reverse_blend)
+        msel_a = _mm256_xor_si256(msel_a, ff);
+
+    src_r = _mm256_srai_epi32(_mm256_mullo_epi32(src_r, _mm256_add_epi32(msel_r, _mm256_set1_epi32(1))), 8);
+    src_g = _mm256_srai_epi32(_mm256_mullo_epi32(src_g, _mm256_add_epi32(msel_g, _mm256_set1_epi32(1))), 8);
+    src_b = _mm256_srai_epi32(_mm256_mullo_epi32(src_b, _mm256_add_epi32(msel_b, _mm256_set1_epi32(1))), 8);
+    src_a = _mm256_srai_epi32(_mm256_mullo_epi32(src_a, _mm256_add_epi32(msel_a, _mm256_set1_epi32(1))), 8);
+
+    if (cc_add == CC_ADD_CLOCAL) {
+        src_r = _mm256_add_epi32(src_r, clocal_r);
+        src_g = _mm256_add_epi32(src_g, clocal_g);
+        src_b = _mm256_add_epi32(src_b, clocal_b);
+    } else if (cc_add == CC_ADD_ALOCAL) {
+        src_r = _mm256_add_epi32(src_r, alocal);
+        src_g = _mm256_add_epi32(src_g, alocal);
+        src_b = _mm256_add_epi32(src_b, alocal);
+    }
+    if (cca_add)
+        src_a = _mm256_add_epi32(src_a, alocal);
+
+    src_r = voodoo_avx2_clamp(src_r);
+    src_g = voodoo_avx2_clamp(src_g);
+    src_b = voodoo_avx2_clamp(src_b);
+    src_a = voodoo_avx2_clamp(src_a);
+
+    if (cc_invert_output) {
+        src_r = _mm256_xor_si256(src_r, ff);
+        src_g = _mm256_xor_si256(src_g, ff);
+        src_b = _mm256_xor_si256(src_b, ff);
+    }
+    if (cca_invert_output)
+        src_a = _mm256_xor_si256(src_a, ff);
+
+    colbfog_r = src_r;
+    colbfog_g = src_g;
+    colbfog_b = src_b;
+
+    if (params->fogMode & FOG_ENABLE) {
+        if (params->fogMode & FOG_CONSTANT) {
+            src_r = _mm256_add_epi32(src_r, _mm256_set1_epi32(params->fogColor.r));
+            src_g = _mm256_add_epi32(src_g, _mm256_set1_epi32(params->fogColor.g));
+            src_b = _mm256_add_epi32(src_b, _mm256_set1_epi32(params->fogColor.b));
+        } else {
+            __m256i fog_r = (params->fogMode & FOG_ADD) ? zero : _mm256_set1_epi32(params->fogColor.r);
+            __m256i fog_g = (params->fogMode & FOG_ADD) ? zero : _mm256_set1_epi32(params->fogColor.g);
+            __m256i fog_b = (params->fogMode & FOG_ADD) ? zero : _mm256_set1_epi32(params->fogColor.b);
+            __m256i fog_a;
+
+            if (!(params->fogMode & FOG_MULT)) {
+                fog_r = _mm256_sub_epi32(fog_r, src_r);
+                fog_g = _mm256_sub_epi32(fog_g, src_g);
+                fog_b = _mm256_sub_epi32(fog_b, src_b);
+            }
+
+            switch (fog_sel) {
+                case FOG_Z:
+                    fog_a = _mm256_and_si256(_mm256_srai_epi32(z, 20), ff);
+                    break;
+                case FOG_ALPHA:
+                    fog_a = iter_a;
+                    break;
+                default: /*Fog table or W, worked out per pixel above*/
+                    fog_a = _mm256_loadu_si256((const __m256i *) fog_lane);
+                    break;
+            }
+            fog_a = _mm256_add_epi32(fog_a, _mm256_set1_epi32(1));
+
+            fog_r = _mm256_srai_epi32(_mm256_mullo_epi32(fog_r, fog_a), 8);
+            fog_g = _mm256_srai_epi32(_mm256_mullo_epi32(fog_g, fog_a), 8);
+            fog_b = _mm256_srai_epi32(_mm256_mullo_epi32(fog_b, fog_a), 8);
+
+            if (params->fogMode & FOG_MULT) {
+                src_r = fog_r;
+                src_g = fog_g;
+                src_b = fog_b;
+            } else {
+                src_r = _mm256_add_epi32(src_r, fog_r);
+                src_g = _mm256_add_epi32(src_g, fog_g);
+                src_b = _mm256_add_epi32(src_b, fog_b);
+            }
+        }
+
+        src_r = voodoo_avx2_clamp(src_r);
+        src_g = voodoo_avx2_clamp(src_g);
+        src_b = voodoo_avx2_clamp(src_b);
+    }
+
+    if (params->alphaMode & 1) {
+        __m256i pass = voodoo_avx2_compare(alpha_func, src_a, _mm256_set1_epi32(a_ref));
+
+        voodoo->fbiAFuncFail += voodoo_avx2_count(_mm256_andnot_si256(pass, live));
+        live = _mm256_and_si256(live, pass);
+        if (_mm256_testz_si256(live, live))
+            return;
+    }
+
+    if (params->alphaMode & (1 << 4)) {
+        /*No alpha buffer on this path, so destination alpha is always 0xff*/
+        __m256i dat       = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) fb));
+        __m256i dest_r    = _mm256_and_si256(_mm256_srli_epi32(dat, 8), _mm256_set1_epi32(0xf8));
+        __m256i dest_g    = _mm256_and_si256(_mm256_srli_epi32(dat, 3), _mm256_set1_epi32(0xfc));
+        __m256i dest_b    = _mm256_and_si256(_mm256_slli_epi32(dat, 3), _mm256_set1_epi32(0xf8));
+        __m256i dest_a    = ff;
+        __m256i newdest_r = zero;
+        __m256i newdest_g = zero;
+        __m256i newdest_b = zero;
+        __m256i sat;
+
+        dest_r = _mm256_or_si256(dest_r, _mm256_srli_epi32(dest_r, 5));
+        dest_g = _mm256_or_si256(dest_g, _mm256_srli_epi32(dest_g, 6));
+        dest_b = _mm256_or_si256(dest_b, _mm256_srli_epi32(dest_b, 5));
+
+        if (dithersub && voodoo->dithersub_enabled) {
+            __m256i idx = voodoo_avx2_dither_idx(params, x, real_y);
+
+            if (dither2x2) {
+                dest_r = voodoo_avx2_dither(&dithersub_rb2x2[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(dest_r, 2), idx));
+                dest_g = voodoo_avx2_dither(&dithersub_g2x2[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(dest_g, 2), idx));
+                dest_b = voodoo_avx2_dither(&dithersub_rb2x2[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(dest_b, 2), idx));
+            } else {
+                dest_r = voodoo_avx2_dither(&dithersub_rb[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(dest_r, 4), idx));
+                dest_g = voodoo_avx2_dither(&dithersub_g[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(dest_g, 4), idx));
+                dest_b = voodoo_avx2_dither(&dithersub_rb[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(dest_b, 4), idx));
+            }
+        }
+
+        switch (dest_afunc) {
+            case AFUNC_ASRC_ALPHA:
+                newdest_r = voodoo_avx2_mul255(dest_r, src_a);
+                newdest_g = voodoo_avx2_mul255(dest_g, src_a);
+                newdest_b = voodoo_avx2_mul255(dest_b, src_a);
+                break;
+            case AFUNC_A_COLOR:
+                newdest_r = voodoo_avx2_mul255(dest_r, src_r);
+                newdest_g = voodoo_avx2_mul255(dest_g, src_g);
+                newdest_b = voodoo_avx2_mul255(dest_b, src_b);
+                break;
+            case AFUNC_ADST_ALPHA:
+                newdest_r = voodoo_avx2_mul255(dest_r, dest_a);
+                newdest_g = voodoo_avx2_mul255(dest_g, dest_a);
+                newdest_b = voodoo_avx2_mul255(dest_b, dest_a);
+                break;
+            case AFUNC_AONE:
+                newdest_r = dest_r;
+                newdest_g = dest_g;
+                newdest_b = dest_b;
+                break;
+            case AFUNC_AOMSRC_ALPHA:
+                newdest_r = voodoo_avx2_mul255(dest_r, _mm256_sub_epi32(ff, src_a));
+                newdest_g = voodoo_avx2_mul255(dest_g, _mm256_sub_epi32(ff, src_a));
+                newdest_b = voodoo_avx2_mul255(dest_b, _mm256_sub_epi32(ff, src_a));
+                break;
+            case AFUNC_AOM_COLOR:
+                newdest_r = voodoo_avx2_mul255(dest_r, _mm256_sub_epi32(ff, src_r));
+                newdest_g = voodoo_avx2_mul255(dest_g, _mm256_sub_epi32(ff, src_g));
+                newdest_b = voodoo_avx2_mul255(dest_b, _mm256_sub_epi32(ff, src_b));
+                break;
+            case AFUNC_AOMDST_ALPHA:
+                newdest_r = voodoo_avx2_mul255(dest_r, _mm256_sub_epi32(ff, dest_a));
+                newdest_g = voodoo_avx2_mul255(dest_g, _mm256_sub_epi32(ff, dest_a));
+                newdest_b = voodoo_avx2_mul255(dest_b, _mm256_sub_epi32(ff, dest_a));
+                break;
+            case AFUNC_ACOLORBEFOREFOG:
+                newdest_r = voodoo_avx2_mul255(dest_r, colbfog_r);
+                newdest_g = voodoo_avx2_mul255(dest_g, colbfog_g);
+                newdest_b = voodoo_avx2_mul255(dest_b, colbfog_b);
+                break;
+            default:
+                break;
+        }
+
+        switch (src_afunc) {
+            case AFUNC_AZERO:
+                src_r = src_g = src_b = zero;
+                break;
+            case AFUNC_ASRC_ALPHA:
+                src_r = voodoo_avx2_mul255(src_r, src_a);
+                src_g = voodoo_avx2_mul255(src_g, src_a);
+                src_b = voodoo_avx2_mul255(src_b, src_a);
+                break;
+            case AFUNC_A_COLOR:
+                src_r = voodoo_avx2_mul255(src_r, dest_r);
+                src_g = voodoo_avx2_mul255(src_g, dest_g);
+                src_b = voodoo_avx2_mul255(src_b, dest_b);
+                break;
+            case AFUNC_ADST_ALPHA:
+                src_r = voodoo_avx2_mul255(src_r, dest_a);
+                src_g = voodoo_avx2_mul255(src_g, dest_a);
+                src_b = voodoo_avx2_mul255(src_b, dest_a);
+                break;
+            case AFUNC_AOMSRC_ALPHA:
+                src_r = voodoo_avx2_mul255(src_r, _mm256_sub_epi32(ff, src_a));
+                src_g = voodoo_avx2_mul255(src_g, _mm256_sub_epi32(ff, src_a));
+                src_b = voodoo_avx2_mul255(src_b, _mm256_sub_epi32(ff, src_a));
+                break;
+            case AFUNC_AOM_COLOR:
+                src_r = voodoo_avx2_mul255(src_r, _mm256_sub_epi32(ff, dest_r));
+                src_g = voodoo_avx2_mul255(src_g, _mm256_sub_epi32(ff, dest_g));
+                src_b = voodoo_avx2_mul255(src_b, _mm256_sub_epi32(ff, dest_b));
+                break;
+            case AFUNC_AOMDST_ALPHA:
+                src_r = voodoo_avx2_mul255(src_r, _mm256_sub_epi32(ff, dest_a));
+                src_g = voodoo_avx2_mul255(src_g, _mm256_sub_epi32(ff, dest_a));
+                src_b = voodoo_avx2_mul255(src_b, _mm256_sub_epi32(ff, dest_a));
+                break;
+            case AFUNC_ASATURATE:
+                sat   = _mm256_min_epi32(src_a, _mm256_sub_epi32(ff, dest_a));
+                src_r = voodoo_avx2_mul255(dest_r, sat);
+                src_g = voodoo_avx2_mul255(dest_g, sat);
+                src_b = voodoo_avx2_mul255(dest_b, sat);
+                break;
+            default:
+                break;
+        }
+
+        src_r = voodoo_avx2_clamp(_mm256_add_epi32(src_r, newdest_r));
+        src_g = voodoo_avx2_clamp(_mm256_add_epi32(src_g, newdest_g));
+        src_b = voodoo_avx2_clamp(_mm256_add_epi32(src_b, newdest_b));
+    }
+
+    if (dither) {
+        __m256i idx = voodoo_avx2_dither_idx(params, x, real_y);
+
+        if (dither2x2) {
+            src_r = voodoo_avx2_dither(&dither_rb2x2[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(src_r, 2), idx));
+            src_g = voodoo_avx2_dither(&dither_g2x2[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(src_g, 2), idx));
+            src_b = voodoo_avx2_dither(&dither_rb2x2[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(src_b, 2), idx));
+        } else {
+            src_r = voodoo_avx2_dither(&dither_rb[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(src_r, 4), idx));
+            src_g = voodoo_avx2_dither(&dither_g[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(src_g, 4), idx));
+            src_b = voodoo_avx2_dither(&dither_rb[0][0][0], _mm256_add_epi32(_mm256_slli_epi32(src_b, 4), idx));
+        }
+    } else {
+        src_r = _mm256_srli_epi32(src_r, 3);
+        src_g = _mm256_srli_epi32(src_g, 2);
+        src_b = _mm256_srli_epi32(src_b, 3);
+    }
+
+    if (params->fbzMode & FBZ_RGB_WMASK)
+        voodoo_avx2_store16(fb, _mm256_or_si256(src_b, _mm256_or_si256(_mm256_slli_epi32(src_g, 5), _mm256_slli_epi32(src_r, 11))), live);
+    if ((params->fbzMode & (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE)) == (FBZ_DEPTH_WMASK | FBZ_DEPTH_ENABLE))
+        voodoo_avx2_store16(aux, new_depth, live);
+
+    live_bits = _mm256_movemask_ps(_mm256_castsi256_ps(live));
+    voodoo->fbiPixelsOut += __builtin_popcount(live_bits);
+}
+
+/*Render the span from x to x2 inclusive. state holds the iterators for x, and
+  pixels are processed in ascending order whichever way the span runs*/
+static VOODOO_AVX2 void
+voodoo_span_avx2(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int x, int x2, int real_y, uint16_t *fb_mem, uint16_t *aux_mem)
+{
+    int     start = (x < x2) ? x : x2;
+    int     end   = (x < x2) ? x2 : x;
+    int     dx    = start - x;
+    int32_t iter[5];
+    int64_t iter64[4];
+
+    iter[0] = state->ir + params->dRdX * dx;
+    iter[1] = state->ig + params->dGdX * dx;
+    iter[2] = state->ib + params->dBdX * dx;
+    iter[3] = state->ia + params->dAdX * dx;
+    iter[4] = state->z + params->dZdX * dx;
+
+    iter64[0] = state->tmu0_s + params->tmu[0].dSdX * dx;
+    iter64[1] = state->tmu0_t + params->tmu[0].dTdX * dx;
+    iter64[2] = state->tmu0_w + params->tmu[0].dWdX * dx;
+    iter64[3] = state->w + params->dWdX * dx;
+
+    for (int px = start; px <= end; px += 8) {
+        int count = end + 1 - px;
+
+        if (count >= 8)
+            voodoo_span_avx2_block(voodoo, params, state, iter, iter64, px, real_y, 8, &fb_mem[px], &aux_mem[px]);
+        else {
+            /*Work on a copy for the tail, so no memory past the span is touched*/
+            uint16_t fb_tmp[8]  = { 0 };
+            uint16_t aux_tmp[8] = { 0 };
+
+            memcpy(fb_tmp, &fb_mem[px], count * 2);
+            if (params->fbzMode & FBZ_DEPTH_ENABLE)
+                memcpy(aux_tmp, &aux_mem[px], count * 2);
+            voodoo_span_avx2_block(voodoo, params, state, iter, iter64, px, real_y, count, fb_tmp, aux_tmp);
+            memcpy(&fb_mem[px], fb_tmp, count * 2);
+            if (params->fbzMode & FBZ_DEPTH_ENABLE)
+                memcpy(&aux_mem[px], aux_tmp, count * 2);
+        }
+
+        iter[0] += params->dRdX * 8;
+        iter[1] += params->dGdX * 8;
+        iter[2] += params->dBdX * 8;
+        iter[3] += params->dAdX * 8;
+        iter[4] += params->dZdX * 8;
+
+        iter64[0] += params->tmu[0].dSdX * 8;
+        iter64[1] += params->tmu[0].dTdX * 8;
+        iter64[2] += params->tmu[0].dWdX * 8;
+        iter64[3] += params->dWdX * 8;
+    }
+}
+
+#endif /*VIDEO_VOODOO_SPAN_AVX2_H*/
@@ -38,6 +38,8 @@
 #include <86box/plat.h>
 #include <86box/rom.h>
 #include <86box/gdbstub.h>
+#include <86box/timer.h>
+#include <86box/snapshot.h>
 #ifdef USE_DYNAREC
 #    include "codegen_public.h"
 #else
@@ -81,6 +83,7 @@ uint32_t biosaddr;
 
 uint32_t pccache;
 uint8_t *pccache2;
+uint32_t decode_cache_gen = 1;
 
 int        readlnext;
 int        readlookup[256];
@@ -112,6 +115,34 @@ int mem_a20_state = 0;
 
 int mmuflush = 0;
 
+/* Second level TLB, sitting between the readlookup/writelookup rings and the
+   page table walk. Entries hold the physical page, the combined U/S and R/W
+   bits and whether the page is already dirty; permissions are checked again
+   on every hit, so CPL, WP and cpl_override changes need no flush, and
+   anything that would fault or has to set the dirty bit goes to the walk. */
+#define TLB2_SETS 1024
+#define TLB2_WAYS 4
+
+#define TLB2_USER  0x04
+#define TLB2_WRITE 0x02
+#define TLB2_DIRTY 0x40
+#define TLB2_LARGE 0x80
+
+typedef struct tlb2_entry_t {
+    uint32_t virt;
+    uint32_t gen;
+    uint64_t phys;
+    uint32_t flags;
+} tlb2_entry_t;
+
+static tlb2_entry_t tlb2[TLB2_SETS][TLB2_WAYS];
+static uint8_t      tlb2_next[TLB2_SETS];
+static uint32_t     tlb2_gen   = 1;
+static int          tlb2_large = 0;
+
+uint64_t mem_tlb_hits   = 0;
+uint64_t mem_tlb_misses = 0;
+
 #ifdef USE_NEW_DYNAREC
 uint64_t *byte_dirty_mask;
 uint64_t *byte_code_present_mask;
@@ -138,6 +169,8 @@ static mem_state_t    _mem_state[MEM_MAPPINGS_NO];
 static uint32_t       remap_start_addr;
 static uint32_t       remap_start_addr2;
 static size_t ram_size = 0;
+static uint64_t *ram_dirty = NULL;
+static uint32_t ram_dirty_pages = 0;
 
 #ifdef ENABLE_MEM_LOG
 int mem_do_log = ENABLE_MEM_LOG;
@@ -157,6 +190,110 @@ mem_log(const char *fmt, ...)
 #    define mem_log(fmt, ...)
 #endif
 
+/* If set, called with the first and last 4K RAM page of every write that
+   goes through mem_dirty_ptr(), so code pre-decoded from RAM can be dropped. */
+void (*ram_code_write)(uint32_t first, uint32_t last) = NULL;
+
+/* Mark the 4K RAM pages covered by a host pointer as dirty; pointers that
+   are not into RAM (ROM, video memory, etc.) are ignored. */
+static __inline void
+mem_dirty_ptr(const uint8_t *p, uint32_t len)
+{
+    uint32_t first;
+    uint32_t last;
+
+    if (((ram_dirty == NULL) && (ram_code_write == NULL)) || (p < ram) || (p >= (ram + ram_size)))
+        return;
+
+    first = (uint32_t) ((p - ram) >> 12);
+    last  = (uint32_t) ((p - ram + len - 1) >> 12);
+
+    if (ram_code_write != NULL)
+        ram_code_write(first, last);
+
+    if (ram_dirty == NULL)
+        return;
+
+    if (last >= ram_dirty_pages)
+        last = ram_dirty_pages - 1;
+
+    for (; first <= last; first++)
+        ram_dirty[first >> 6] |= (uint64_t) 1 << (first & 63);
+}
+
+void
+mem_dirty_clear(void)
+{
+    if (ram_dirty == NULL)
+        return;
+
+    memset(ram_dirty, 0x00, ((ram_dirty_pages + 63) >> 6) * sizeof(uint64_t));
+
+    /* Writes through an already installed direct write lookup never reach
+       the slow path, so drop them all to have the next write to each page
+       mark it again. */
+    flushmmucache_write();
+}
+
+void
+mem_dirty_set_all(void)
+{
+    if (ram_dirty != NULL)
+        memset(ram_dirty, 0xff, ((ram_dirty_pages + 63) >> 6) * sizeof(uint64_t));
+}
+
+int
+mem_dirty_test(uint32_t page)
+{
+    if ((ram_dirty == NULL) || (page >= ram_dirty_pages))
+        return 0;
+
+    return !!(ram_dirty[page >> 6] & ((uint64_t) 1 << (page & 63)));
+}
+
+/* Return the first dirty page at or after the given one, or the number of
+   RAM pages if there is none. */
+uint32_t
+mem_dirty_next(uint32_t page)
+{
+    uint64_t word;
+
+    if (ram_dirty == NULL)
+        return ram_dirty_pages;
+
+    while (page < ram_dirty_pages) {
+        word = ram_dirty[page >> 6] >> (page & 63);
+        if (!word) {
+            page = (page | 63) + 1;
+            continue;
+        }
+        while (!(word & 1)) {
+            word >>= 1;
+            page++;
+        }
+        return (page < ram_dirty_pages) ? page : ram_dirty_pages;
+    }
+
+    return ram_dirty_pages;
+}
+
+uint32_t
+mem_dirty_count(void)
+{
+    uint32_t count = 0;
+
+    for (uint32_t c = mem_dirty_next(0); c < ram_dirty_pages; c = mem_dirty_next(c + 1))
+        count++;
+
+    return count;
+}
+
+uint32_t
+mem_ram_pages(void)
+{
+    return ram_dirty_pages;
+}
+
 int
 mem_addr_is_ram(uint32_t addr)
 {
@@ -189,8 +326,99 @@ resetreadlookup(void)
     high_page  = 0;
 }
 
+static void
+tlb2_flush(void)
+{
+    /* Entries from older generations are dead; only clear them for real
+       when the counter wraps around. */
+    if (++tlb2_gen == 0) {
+        memset(tlb2, 0x00, sizeof(tlb2));
+        tlb2_gen = 1;
+    }
+    tlb2_large = 0;
+}
+
+static void
+tlb2_flush_page(uint32_t addr)
+{
+    tlb2_entry_t *set = tlb2[(addr >> 12) & (TLB2_SETS - 1)];
+
+    /* A large page is held as one entry per 4K page touched. */
+    if (tlb2_large) {
+        tlb2_flush();
+        return;
+    }
+
+    for (int c = 0; c < TLB2_WAYS; c++) {
+        if ((set[c].gen == tlb2_gen) && (set[c].virt == (addr & ~0xfff)))
+            set[c].gen = 0;
+    }
+}
+
+static __inline int
+tlb2_lookup(uint32_t addr, int rw, uint64_t *phys)
+{
+    tlb2_entry_t *set = tlb2[(addr >> 12) & (TLB2_SETS - 1)];
+
+    for (int c = 0; c < TLB2_WAYS; c++) {
+        const tlb2_entry_t *entry = &set[c];
+
+        if ((entry->gen != tlb2_gen) || (entry->virt != (addr & ~0xfff)))
+            continue;
+
+        /* Let the walk deal with faults and with setting the dirty bit. */
+        if ((CPL == 3) && !cpl_override && !(entry->flags & TLB2_USER))
+            break;
+        if (rw && ((entry->flags & (TLB2_WRITE | TLB2_DIRTY)) != (TLB2_WRITE | TLB2_DIRTY)))
+            break;
+
+        *phys = entry->phys | (addr & 0xfff);
+        mem_tlb_hits++;
+        return 1;
+    }
+
+    mem_tlb_misses++;
+    return 0;
+}
+
+static __inline void
+tlb2_add(uint32_t addr, uint64_t phys, uint32_t flags)
+{
+    uint32_t      index = (addr >> 12) & (TLB2_SETS - 1);
+    tlb2_entry_t *entry = NULL;
+
+    for (int c = 0; c < TLB2_WAYS; c++) {
+        if ((tlb2[index][c].gen == tlb2_gen) && (tlb2[index][c].virt == (addr & ~0xfff))) {
+            entry = &tlb2[index][c];
+            break;
+        }
+    }
+    if (entry == NULL) {
+        entry            = &tlb2[index][tlb2_next[index]];
+        tlb2_next[index] = (tlb2_next[index] + 1) & (TLB2_WAYS - 1);
+    }
+
+    entry->virt  = addr & ~0xfff;
+    entry->gen   = tlb2_gen;
+    entry->phys  = phys & ~0xfffULL;
+    entry->flags = flags;
+
+    if (flags & TLB2_LARGE)
+        tlb2_large = 1;
+}
+
+/* Entries of the 2386 decoded instruction cache are only valid for the
+   generation they were made in; zero never is one, to keep empty entries
+   from matching. */
 void
-flushmmucache(void)
+decode_cache_flush(void)
+{
+    if (++decode_cache_gen == 0)
+        decode_cache_gen = 1;
+}
+
+static void
+flushmmucache_lookups(void)
 {
     for (uint16_t c = 0; c < 256; c++) {
         if (readlookup[c] != (int) 0xffffffff) {
@@ -203,6 +431,15 @@ flushmmucache(void)
             writelookup[c]               = 0xffffffff;
         }
     }
+
+    decode_cache_flush();
+}
+
+void
+flushmmucache(void)
+{
+    flushmmucache_lookups();
+    tlb2_flush();
     mmuflush++;
 
     pccache  = (uint32_t) 0xffffffff;
@@ -230,6 +467,7 @@ void
 flushmmucache_pc(void)
 {
     mmuflush++;
+    decode_cache_flush();
 
     pccache  = (uint32_t) 0xffffffff;
     pccache2 = (uint8_t *) 0xffffffff;
@@ -242,17 +480,18 @@ flushmmucache_pc(void)
 void
 flushmmucache_nopc(void)
 {
-    for (uint16_t c = 0; c < 256; c++) {
-        if (readlookup[c] != (int) 0xffffffff) {
-            readlookup2[readlookup[c]] = LOOKUP_INV;
-            readlookup[c]              = 0xffffffff;
-        }
-        if (writelookup[c] != (int) 0xffffffff) {
-            page_lookup[writelookup[c]]  = NULL;
-            writelookup2[writelookup[c]] = LOOKUP_INV;
-            writelookup[c]               = 0xffffffff;
-        }
-    }
+    flushmmucache_lookups();
+    tlb2_flush();
+    mmuflush++;
+}
+
+/* INVLPG: only the one translation has to go from the second level TLB. */
+void
+flushmmucache_page(uint32_t addr)
+{
+    flushmmucache_lookups();
+    tlb2_flush_page(addr);
+    mmuflush++;
 }
 
 void
@@ -322,6 +561,7 @@ mmutranslatereal_normal(uint32_t addr, int rw)
         uint64_t page = temp & ~0x3fffff;
         if (cpu_features & CPU_FEATURE_PSE36)
             page |= (uint64_t) (temp & 0x1e000) << 19;
+        tlb2_add(addr, page + (addr & 0x3fffff), (temp & (TLB2_USER | TLB2_WRITE | TLB2_DIRTY)) | (rw ? TLB2_DIRTY : 0) | TLB2_LARGE);
         return page + (addr & 0x3fffff);
     }
 
@@ -342,6 +582,7 @@ mmutranslatereal_normal(uint32_t addr, int rw)
     rammap(addr2) |= 0x20;
     rammap((temp2 & ~0xfff) + ((addr >> 10) & 0xffc)) |= (rw ? 0x60 : 0x20);
 
+    tlb2_add(addr, temp & ~0xfff, (temp3 & (TLB2_USER | TLB2_WRITE)) | (temp & TLB2_DIRTY) | (rw ? TLB2_DIRTY : 0));
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
 
@@ -404,6 +645,8 @@ mmutranslatereal_pae(uint32_t addr, int rw)
         }
         rammap64(addr3) |= (rw ? 0x60 : 0x20);
 
+        tlb2_add(addr, ((temp & ~0x1fffffULL) + (addr & 0x1fffffULL)) & 0x000000ffffffffffULL,
+                 (temp & (TLB2_USER | TLB2_WRITE | TLB2_DIRTY)) | (rw ? TLB2_DIRTY : 0) | TLB2_LARGE);
         return ((temp & ~0x1fffffULL) + (addr & 0x1fffffULL)) & 0x000000ffffffffffULL;
     }
 
@@ -425,16 +668,22 @@ mmutranslatereal_pae(uint32_t addr, int rw)
     rammap64(addr3) |= 0x20;
     rammap64(addr4) |= (rw ? 0x60 : 0x20);
 
+    tlb2_add(addr, temp & 0x000000fffffff000ULL, (temp3 & (TLB2_USER | TLB2_WRITE)) | (temp & TLB2_DIRTY) | (rw ? TLB2_DIRTY : 0));
     return ((temp & ~0xfffULL) + ((uint64_t) (addr & 0xfff))) & 0x000000ffffffffffULL;
 }
 
 uint64_t
 mmutranslatereal(uint32_t addr, int rw)
 {
+    uint64_t phys;
+
     /* Fast path to return invalid without any call if an exception has occurred beforehand. */
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    if (tlb2_lookup(addr, rw, &phys))
+        return phys;
+
     if (cr4 & CR4_PAE)
         return mmutranslatereal_pae(addr, rw);
     else
@@ -538,10 +787,15 @@ mmutranslate_noabrt_pae(uint32_t addr, int rw)
 uint64_t
 mmutranslate_noabrt(uint32_t addr, int rw)
 {
+    uint64_t phys;
+
     /* Fast path to return invalid without any call if an exception has occurred beforehand. */
     if (cpu_state.abrt)
         return 0xffffffffffffffffULL;
 
+    if (tlb2_lookup(addr, rw, &phys))
+        return phys;
+
     if (cr4 & CR4_PAE)
         return mmutranslate_noabrt_pae(addr, rw);
     else
@@ -619,7 +873,8 @@ addwritelookup(uint32_t virt, uint32_t phys)
 #endif
         page_lookup[virt >> 12]  = &pages[phys >> 12];
     } else {
-
+        /* Writes through this lookup bypass us until the next flush. */
+        mem_dirty_ptr(&ram[phys & ~0xfff], 1);
         writelookup2[virt >> 12] = (uintptr_t) &ram[(uintptr_t) (phys & ~0xFFF) - (uintptr_t) (virt & ~0xfff)];
     }
 
@@ -663,6 +918,35 @@ getpccache(uint32_t a)
     return (uint8_t *) &ff_pccache;
 }
 
+/* Host pointer to the code at physical address addr, for pre-decoding. *page
+   is set to the RAM page the code is in, whose writes are then reported
+   through ram_code_write, or to -1 for ROM, which can not be written. Code
+   anywhere else, or where the read and exec views of memory differ, can not
+   be pre-decoded and NULL is returned. */
+uint8_t *
+mem_code_ptr(uint32_t addr, int *page)
+{
+    const mem_mapping_t *map;
+    uint8_t             *p;
+
+    addr &= rammask;
+
+    map = read_mapping[addr >> MEM_GRANULARITY_BITS];
+    if (!map || !map->exec || (_mem_exec[addr >> MEM_GRANULARITY_BITS] != (map->exec + ((addr & MEM_GRANULARITY_BASE) - map->base))))
+        return NULL;
+
+    p = &_mem_exec[addr >> MEM_GRANULARITY_BITS][addr & MEM_GRANULARITY_MASK];
+
+    if ((p >= ram) && (p < (ram + ram_size)))
+        *page = (int) ((p - ram) >> 12);
+    else if ((map->flags & MEM_MAPPING_IS_ROM) && !map->write_b && !map->write_w && !map->write_l)
+        *page = -1;
+    else
+        return NULL;
+
+    return p;
+}
+
 uint8_t
 read_mem_b(uint32_t addr)
 {
@@ -1696,9 +1980,10 @@ mem_writeb_phys(uint32_t addr, uint8_t val)
     mem_logical_addr = 0xffffffff;
 
     if (map) {
-        if (cpu_use_exec && map->exec)
+        if (cpu_use_exec && map->exec) {
             map->exec[(addr - map->base) & map->mask] = val;
-        else if (map->write_b)
+            mem_dirty_ptr(&map->exec[(addr - map->base) & map->mask], 1);
+        } else if (map->write_b)
             map->write_b(addr, val, map->priv);
     }
 }
@@ -1714,6 +1999,7 @@ mem_writew_phys(uint32_t addr, uint16_t val)
     if (cpu_use_exec && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->exec)) {
         p  = (uint16_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
+        mem_dirty_ptr((uint8_t *) p, 2);
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_HBOUND) && (map && map->write_w))
         map->write_w(addr, val, map->priv);
     else {
@@ -1733,6 +2019,7 @@ mem_writel_phys(uint32_t addr, uint32_t val)
     if (cpu_use_exec && ((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->exec)) {
         p  = (uint32_t *) &(map->exec[(addr - map->base) & map->mask]);
         *p = val;
+        mem_dirty_ptr((uint8_t *) p, 4);
     } else if (((addr & MEM_GRANULARITY_MASK) <= MEM_GRANULARITY_QBOUND) && (map && map->write_l))
         map->write_l(addr, val, map->priv);
     else {
@@ -1760,6 +2047,39 @@ mem_write_phys(void *src, uint32_t addr, int transfer_size)
     }
 }
 
+/* Return a host pointer to the plain memory backing the physical address,
+   along with how many bytes (at most max_len) can be accessed through it
+   without leaving the granule, or NULL if it is MMIO or unmapped. */
+uint8_t *
+mem_get_phys_ptr(uint32_t addr, uint32_t max_len, uint32_t *len, int write)
+{
+    mem_mapping_t *map = write ? write_mapping_bus[addr >> MEM_GRANULARITY_BITS] :
+                                 read_mapping_bus[addr >> MEM_GRANULARITY_BITS];
+    uint32_t       offset;
+    uint32_t       run;
+
+    mem_logical_addr = 0xffffffff;
+
+    if (!cpu_use_exec || !map || !map->exec || !max_len)
+        return NULL;
+
+    run = MEM_GRANULARITY_SIZE - (addr & MEM_GRANULARITY_MASK);
+    if (run > max_len)
+        run = max_len;
+
+    /* Refuse runs that would wrap around the end of the mapping's mask. */
+    offset = (addr - map->base) & map->mask;
+    if (((offset + run - 1) & map->mask) != (offset + run - 1))
+        return NULL;
+
+    /* The caller is about to write through the pointer behind our back. */
+    if (write)
+        mem_dirty_ptr(&(map->exec[offset]), run);
+
+    *len = run;
+    return &(map->exec[offset]);
+}
+
 uint8_t
 mem_read_ram(uint32_t addr, UNUSED(void *priv))
 {
@@ -1892,6 +2212,7 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t byte_mask   = (uint64_t) 1 << (addr & PAGE_BYTE_MASK_MASK);
 
         page->mem[addr & 0xfff] = val;
+        mem_dirty_ptr(&page->mem[addr & 0xfff], 1);
         page->dirty_mask |= mask;
         if ((page->code_present_mask & mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
@@ -1919,6 +2240,7 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
         if ((addr & 0xf) == 0xf)
             mask |= (mask << 1);
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_ptr(&page->mem[addr & 0xfff], 2);
         page->dirty_mask |= mask;
         if ((page->code_present_mask & mask) && !page_in_evict_list(page))
             page_add_to_evict_list(page);
@@ -1954,6 +2276,7 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
         if ((addr & 0xf) >= 0xd)
             mask |= (mask << 1);
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_ptr(&page->mem[addr & 0xfff], 4);
         page->dirty_mask |= mask;
         page->byte_dirty_mask[byte_offset] |= byte_mask;
         if (!page_in_evict_list(page) && ((page->code_present_mask & mask) || (page->byte_code_present_mask[byte_offset] & byte_mask)))
@@ -1982,6 +2305,7 @@ mem_write_ramb_page(uint32_t addr, uint8_t val, page_t *page)
         uint64_t mask = (uint64_t) 1 << ((addr >> PAGE_MASK_SHIFT) & PAGE_MASK_MASK);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         page->mem[addr & 0xfff] = val;
+        mem_dirty_ptr(&page->mem[addr & 0xfff], 1);
     }
 }
 
@@ -2001,6 +2325,7 @@ mem_write_ramw_page(uint32_t addr, uint16_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint16_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_ptr(&page->mem[addr & 0xfff], 2);
     }
 }
 
@@ -2020,6 +2345,7 @@ mem_write_raml_page(uint32_t addr, uint32_t val, page_t *page)
             mask |= (mask << 1);
         page->dirty_mask[(addr >> PAGE_MASK_INDEX_SHIFT) & PAGE_MASK_INDEX_MASK] |= mask;
         *(uint32_t *) &page->mem[addr & 0xfff] = val;
+        mem_dirty_ptr(&page->mem[addr & 0xfff], 4);
     }
 }
 #endif
@@ -2037,8 +2363,10 @@ mem_write_ram(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 1);
+    }
 }
 
 void
@@ -2051,8 +2379,10 @@ mem_write_ramw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 2);
+    }
 }
 
 void
@@ -2065,8 +2395,10 @@ mem_write_raml(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[addr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 4);
+    }
 }
 
 static uint8_t
@@ -2131,8 +2463,10 @@ mem_write_remapped(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 1);
+    }
 }
 
 static void
@@ -2143,8 +2477,10 @@ mem_write_remappedw(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 2);
+    }
 }
 
 static void
@@ -2155,8 +2491,10 @@ mem_write_remappedl(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 4);
+    }
 }
 
 static void
@@ -2167,8 +2505,10 @@ mem_write_remapped2(uint32_t addr, uint8_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramb_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 1);
+    }
 }
 
 static void
@@ -2179,8 +2519,10 @@ mem_write_remappedw2(uint32_t addr, uint16_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_ramw_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint16_t *) &ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 2);
+    }
 }
 
 static void
@@ -2191,8 +2533,10 @@ mem_write_remappedl2(uint32_t addr, uint32_t val, UNUSED(void *priv))
     if (cpu_use_exec) {
         addwritelookup(mem_logical_addr, addr);
         mem_write_raml_page(addr, val, &pages[oldaddr >> 12]);
-    } else
+    } else {
         *(uint32_t *) &ram[addr] = val;
+        mem_dirty_ptr(&ram[addr], 4);
+    }
 }
 
 void
@@ -2731,6 +3075,7 @@ void
 mem_zero(void)
 {
     memset(ram, 0x00, ram_size + 16);
+    mem_dirty_set_all();
 }
 
 /* Reset the memory state. */
@@ -2776,6 +3121,13 @@ mem_reset(void)
     }
     memset(ram, 0x00, ram_size + 16);
 
+    /* Everything counts as changed until the first checkpoint is taken. */
+    if (ram_dirty != NULL)
+        free(ram_dirty);
+    ram_dirty_pages = (uint32_t) ((ram_size + 0xfff) >> 12);
+    ram_dirty       = (uint64_t *) malloc(((ram_dirty_pages + 63) >> 6) * sizeof(uint64_t));
+    mem_dirty_set_all();
+
     /*
      * Allocate the page table based on how much RAM we have.
      * We re-allocate the table on each (hard) reset, as the
@@ -3101,6 +3453,112 @@ mem_reset_page_blocks(void)
     }
 }
 
+/* An incremental snapshot only carries the pages written since the previous
+   checkpoint, preceded by the dirty bitmap itself; the rest of RAM has been
+   brought back by loading the parent snapshots first. */
+static void
+mem_serialize_dirty(snapshot_t *snap)
+{
+    uint32_t  words = (ram_dirty_pages + 63) >> 6;
+    uint64_t *map   = ram_dirty;
+    uint32_t  len;
+
+    if (!snap->saving)
+        map = (uint64_t *) calloc(words, sizeof(uint64_t));
+
+    snapshot_io(snap, map, words * sizeof(uint64_t));
+
+    for (uint32_t c = 0; (c < ram_dirty_pages) && !snap->error; c++) {
+        if (!(map[c >> 6] & ((uint64_t) 1 << (c & 63))))
+            continue;
+
+        len = (uint32_t) MIN(ram_size - ((size_t) c << 12), 0x1000);
+        snapshot_io(snap, &ram[(size_t) c << 12], len);
+    }
+
+    if (!snap->saving)
+        free(map);
+}
+
+void
+mem_serialize(snapshot_t *snap)
+{
+    mem_mapping_t *map;
+    uint32_t       count      = 0;
+    uint32_t       saved_size = (uint32_t) ram_size;
+
+    snapshot_section(snap, "mem");
+
+    SNAPSHOT_VAR(snap, saved_size);
+    if (!snap->saving && (saved_size != (uint32_t) ram_size))
+        snap->error = 1;
+    if (snap->error)
+        return;
+
+    if (snap->incremental)
+        mem_serialize_dirty(snap);
+    else
+        snapshot_io(snap, ram, ram_size);
+    SNAPSHOT_VAR(snap, _mem_state);
+    SNAPSHOT_VAR(snap, _mem_wp);
+    SNAPSHOT_VAR(snap, _mem_wp_bus);
+    SNAPSHOT_VAR(snap, remap_start_addr);
+    SNAPSHOT_VAR(snap, remap_start_addr2);
+    SNAPSHOT_VAR(snap, shadowbios);
+    SNAPSHOT_VAR(snap, shadowbios_write);
+    SNAPSHOT_VAR(snap, mem_a20_key);
+    SNAPSHOT_VAR(snap, mem_a20_alt);
+    SNAPSHOT_VAR(snap, mem_a20_state);
+
+    /* The mappings themselves are created by the machine and its devices, in
+       the same order every time, so only their placement is stored. Shadow RAM
+       mappings point their exec pointer into RAM, which is stored as an offset
+       as RAM moves between runs. */
+    for (map = base_mapping; map != NULL; map = map->next)
+        count++;
+    saved_size = count;
+    SNAPSHOT_VAR(snap, saved_size);
+    if (!snap->saving && (saved_size != count))
+        snap->error = 1;
+
+    for (map = base_mapping; (map != NULL) && !snap->error; map = map->next) {
+        int      enable = map->enable;
+        uint32_t base   = map->base;
+        uint32_t size   = map->size;
+        uint32_t mask   = map->mask;
+        uint32_t flags  = map->flags;
+        int64_t  exec   = -1;
+
+        if ((map->exec != NULL) && (map->exec >= ram) && (map->exec < (ram + ram_size)))
+            exec = map->exec - ram;
+
+        SNAPSHOT_VAR(snap, enable);
+        SNAPSHOT_VAR(snap, base);
+        SNAPSHOT_VAR(snap, size);
+        SNAPSHOT_VAR(snap, mask);
+        SNAPSHOT_VAR(snap, flags);
+        SNAPSHOT_VAR(snap, exec);
+
+        if (!snap->saving) {
+            map->enable = enable;
+            map->base   = base;
+            map->size   = size;
+            map->mask   = mask;
+            map->flags  = flags;
+            if (exec >= 0)
+                map->exec = ram + exec;
+        }
+    }
+
+    if (snap->saving || snap->error)
+        return;
+
+    mem_a20_recalc();
+    mem_mapping_recalc(0x00000000ULL, (uint64_t) addr_space_size << 12);
+    mem_reset_page_blocks();
+    flushmmucache();
+}
+
 void
 mem_a20_recalc(void)
 {
@@ -271,6 +271,34 @@ mmutranslate_noabrt_2386(uint32_t addr, int rw)
     return (uint64_t) ((temp & ~0xfff) + (addr & 0xfff));
 }
 
+/* Host address of the code at addr for the decoded instruction cache, or NULL
+   if it is not in memory that can be read directly. Only used right after a
+   fetch from addr went through, so the translation can not fault here. The
+   cache is only filled when the read and the exec views of the page agree,
+   so reading the bytes from here gives what the read handler would. */
+uint8_t *
+mem_fetch_ptr_2386(uint32_t addr)
+{
+    mem_mapping_t *map;
+    uint64_t       a = (uint64_t) addr;
+
+    if (cr0 >> 31) {
+        a = mmutranslate_noabrt_2386(addr, 0);
+
+        if (a > 0xffffffffULL)
+            return NULL;
+    }
+
+    a &= rammask;
+
+    map = read_mapping[a >> MEM_GRANULARITY_BITS];
+
+    if (!map || !map->exec || (_mem_exec[a >> MEM_GRANULARITY_BITS] != (map->exec + ((a & MEM_GRANULARITY_BASE) - map->base))))
+        return NULL;
+
+    return &_mem_exec[a >> MEM_GRANULARITY_BITS][a & MEM_GRANULARITY_MASK];
+}
+
 uint8_t
 readmembl_2386(uint32_t addr)
 {
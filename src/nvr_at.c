@@ -232,6 +232,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/rom.h>
 #include <86box/device.h>
@@ -1263,6 +1264,30 @@ nvr_at_close(void *priv)
         nvr_at_inited = 0;
 }
 
+static void
+nvr_at_serialize(void *priv, snapshot_t *snap)
+{
+    nvr_t   *nvr   = (nvr_t *) priv;
+    local_t *local = (local_t *) nvr->data;
+    local_t  tmp   = *local;
+
+    SNAPSHOT_VAR(snap, nvr->onesec_cnt);
+    SNAPSHOT_VAR(snap, nvr->regs);
+    SNAPSHOT_VAR(snap, tmp);
+    snapshot_io(snap, local->lock, nvr->size);
+
+    if (!snap->saving && !snap->error) {
+        tmp.lock         = local->lock;
+        tmp.update_timer = local->update_timer;
+        tmp.rtc_timer    = local->rtc_timer;
+        *local           = tmp;
+    }
+
+    snapshot_timer(snap, &nvr->onesec_time);
+    snapshot_timer(snap, &local->update_timer);
+    snapshot_timer(snap, &local->rtc_timer);
+}
+
 const device_t at_nvr_old_device = {
     .name          = "PC/AT NVRAM (No century)",
     .internal_name = "at_nvr_old",
@@ -1274,7 +1299,8 @@ const device_t at_nvr_old_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t at_nvr_device = {
@@ -1288,7 +1314,8 @@ const device_t at_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t at_mb_nvr_device = {
@@ -1302,7 +1329,8 @@ const device_t at_mb_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t ps_nvr_device = {
@@ -1316,7 +1344,8 @@ const device_t ps_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t amstrad_nvr_device = {
@@ -1330,7 +1359,8 @@ const device_t amstrad_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t ibmat_nvr_device = {
@@ -1344,7 +1374,8 @@ const device_t ibmat_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t piix4_nvr_device = {
@@ -1358,7 +1389,8 @@ const device_t piix4_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t ps_no_nmi_nvr_device = {
@@ -1372,7 +1404,8 @@ const device_t ps_no_nmi_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t amstrad_no_nmi_nvr_device = {
@@ -1386,7 +1419,8 @@ const device_t amstrad_no_nmi_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t ami_1992_nvr_device = {
@@ -1400,7 +1434,8 @@ const device_t ami_1992_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t ami_1994_nvr_device = {
@@ -1414,7 +1449,8 @@ const device_t ami_1994_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t ami_1995_nvr_device = {
@@ -1428,7 +1464,8 @@ const device_t ami_1995_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t via_nvr_device = {
@@ -1442,7 +1479,8 @@ const device_t via_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t p6rp4_nvr_device = {
@@ -1456,7 +1494,8 @@ const device_t p6rp4_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t amstrad_megapc_nvr_device = {
@@ -1470,7 +1509,8 @@ const device_t amstrad_megapc_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t martin_nvr_device = {
@@ -1484,7 +1524,8 @@ const device_t martin_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
 
 const device_t elt_nvr_device = {
@@ -1498,5 +1539,6 @@ const device_t elt_nvr_device = {
     .available     = NULL,
     .speed_changed = nvr_at_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = nvr_at_serialize
 };
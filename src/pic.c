@@ -31,6 +31,7 @@
 #include <86box/pci.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/device.h>
 #include <86box/apm.h>
@@ -278,6 +279,37 @@ pic_reset(void)
     pic_pci = 0;
 }
 
+static void
+pic_serialize_one(snapshot_t *snap, pic_t *dev)
+{
+    pic_t tmp = *dev;
+
+    SNAPSHOT_VAR(snap, tmp);
+
+    if (!snap->saving && !snap->error) {
+        memcpy(tmp.slaves, dev->slaves, sizeof(tmp.slaves));
+        *dev = tmp;
+    }
+}
+
+void
+pic_serialize(snapshot_t *snap)
+{
+    snapshot_section(snap, "pic");
+
+    pic_serialize_one(snap, &pic);
+    pic_serialize_one(snap, &pic2);
+    SNAPSHOT_VAR(snap, shadow);
+    SNAPSHOT_VAR(snap, elcr_enabled);
+    SNAPSHOT_VAR(snap, pic_pci);
+    SNAPSHOT_VAR(snap, kbd_latch);
+    SNAPSHOT_VAR(snap, mouse_latch);
+    SNAPSHOT_VAR(snap, smi_irq_mask);
+    SNAPSHOT_VAR(snap, smi_irq_status);
+    SNAPSHOT_VAR(snap, latched_irqs);
+    snapshot_timer(snap, &pic_timer);
+}
+
 void
 pic_set_shadow(int sh)
 {
@@ -32,6 +32,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/pit_fast.h>
 #include <86box/ppi.h>
@@ -962,6 +963,27 @@ pit_init(const device_t *info)
     return dev;
 }
 
+static void
+pit_serialize(void *priv, snapshot_t *snap)
+{
+    pit_t *dev = (pit_t *) priv;
+    pit_t  tmp = *dev;
+
+    SNAPSHOT_VAR(snap, tmp);
+
+    if (!snap->saving && !snap->error) {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            tmp.counters[i].load_func = dev->counters[i].load_func;
+            tmp.counters[i].out_func  = dev->counters[i].out_func;
+        }
+        tmp.callback_timer = dev->callback_timer;
+        tmp.dev_priv       = dev->dev_priv;
+        *dev               = tmp;
+    }
+
+    snapshot_timer(snap, &dev->callback_timer);
+}
+
 const device_t i8253_device = {
     .name          = "Intel 8253/8253-5 Programmable Interval Timer",
     .internal_name = "i8253",
@@ -973,7 +995,8 @@ const device_t i8253_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pit_serialize
 };
 
 const device_t i8253_ext_io_device = {
@@ -987,7 +1010,8 @@ const device_t i8253_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pit_serialize
 };
 
 const device_t i8254_device = {
@@ -1001,7 +1025,8 @@ const device_t i8254_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pit_serialize
 };
 
 const device_t i8254_sec_device = {
@@ -1015,7 +1040,8 @@ const device_t i8254_sec_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pit_serialize
 };
 
 const device_t i8254_ext_io_device = {
@@ -1029,7 +1055,8 @@ const device_t i8254_ext_io_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pit_serialize
 };
 
 const device_t i8254_ps2_device = {
@@ -1043,7 +1070,8 @@ const device_t i8254_ps2_device = {
     .available     = NULL,
     .speed_changed = pit_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pit_serialize
 };
 
 pit_t *
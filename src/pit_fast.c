@@ -32,6 +32,7 @@
 #include <86box/nmi.h>
 #include <86box/pic.h>
 #include <86box/timer.h>
+#include <86box/snapshot.h>
 #include <86box/pit.h>
 #include <86box/pit_fast.h>
 #include <86box/ppi.h>
@@ -741,6 +742,29 @@ pitf_init(const device_t *info)
     return dev;
 }
 
+static void
+pitf_serialize(void *priv, snapshot_t *snap)
+{
+    pitf_t *dev = (pitf_t *) priv;
+    pitf_t  tmp = *dev;
+
+    SNAPSHOT_VAR(snap, tmp);
+
+    if (!snap->saving && !snap->error) {
+        for (int i = 0; i < NUM_COUNTERS; i++) {
+            tmp.counters[i].timer     = dev->counters[i].timer;
+            tmp.counters[i].load_func = dev->counters[i].load_func;
+            tmp.counters[i].out_func  = dev->counters[i].out_func;
+            tmp.counters[i].priv      = dev->counters[i].priv;
+        }
+        tmp.dev_priv = dev->dev_priv;
+        *dev         = tmp;
+    }
+
+    for (int i = 0; i < NUM_COUNTERS; i++)
+        snapshot_timer(snap, &dev->counters[i].timer);
+}
+
 const device_t i8253_fast_device = {
     .name          = "Intel 8253/8253-5 Programmable Interval Timer",
     .internal_name = "i8253_fast",
@@ -752,7 +776,8 @@ const device_t i8253_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pitf_serialize
 };
 
 const device_t i8254_fast_device = {
@@ -766,7 +791,8 @@ const device_t i8254_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pitf_serialize
 };
 
 const device_t i8254_sec_fast_device = {
@@ -780,7 +806,8 @@ const device_t i8254_sec_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pitf_serialize
 };
 
 const device_t i8254_ext_io_fast_device = {
@@ -794,7 +821,8 @@ const device_t i8254_ext_io_fast_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pitf_serialize
 };
 
 const device_t i8254_ps2_fast_device = {
@@ -808,7 +836,8 @@ const device_t i8254_ps2_fast_device = {
     .available     = NULL,
     .speed_changed = pitf_speed_changed,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = pitf_serialize
 };
 
 const pit_intf_t pit_fast_intf = {
@@ -36,6 +36,7 @@
 #include <86box/port_6x.h>
 #include <86box/plat_unused.h>
 #include <86box/random.h>
+#include <86box/snapshot.h>
 
 #define PS2_REFRESH_TIME (16 * TIMER_USEC)
 
@@ -171,6 +172,21 @@ port_6x_close(void *priv)
     free(dev);
 }
 
+/* Port 61h is the only owner of the PPI latch and the speaker gate. */
+static void
+port_6x_serialize(void *priv, snapshot_t *snap)
+{
+    port_6x_t *dev = (port_6x_t *) priv;
+
+    SNAPSHOT_VAR(snap, dev->refresh);
+    SNAPSHOT_VAR(snap, ppi);
+    SNAPSHOT_VAR(snap, ppispeakon);
+    speaker_serialize(snap);
+
+    if (dev->flags & PORT_6X_EXT_REF)
+        snapshot_timer(snap, &dev->refresh_timer);
+}
+
 void *
 port_6x_init(const device_t *info)
 {
@@ -213,7 +229,8 @@ const device_t port_6x_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = port_6x_serialize
 };
 
 const device_t port_6x_xi8088_device = {
@@ -227,7 +244,8 @@ const device_t port_6x_xi8088_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = port_6x_serialize
 };
 
 const device_t port_6x_ps2_device = {
@@ -241,7 +259,8 @@ const device_t port_6x_ps2_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = port_6x_serialize
 };
 
 const device_t port_6x_olivetti_device = {
@@ -255,5 +274,6 @@ const device_t port_6x_olivetti_device = {
     .available     = NULL,
     .speed_changed = NULL,
     .force_redraw  = NULL,
-    .config        = NULL
+    .config        = NULL,
+    .serialize     = port_6x_serialize
 };
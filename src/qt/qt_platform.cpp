@@ -215,6 +215,14 @@ plat_timer_read(void)
     return elapsed_timer.elapsed();
 }
 
+int
+plat_get_cpu_count(void)
+{
+    int count = std::thread::hardware_concurrency();
+
+    return (count > 0) ? count : 1;
+}
+
 FILE *
 plat_fopen(const char *path, const char *mode)
 {
@@ -43,6 +43,8 @@ const int DataBus                = Qt::UserRole;
 const int DataBusChannel         = Qt::UserRole + 1;
 const int DataBusPrevious        = Qt::UserRole + 2;
 const int DataBusChannelPrevious = Qt::UserRole + 3;
+const int DataCacheMode          = Qt::UserRole + 4;
+const int DataOverlay            = Qt::UserRole + 5;
 
 QIcon hard_disk_icon;
 
@@ -88,6 +90,8 @@ addRow(QAbstractItemModel *model, hard_disk_t *hd)
     model->setData(busIndex, hd->bus_type, DataBusPrevious);
     model->setData(busIndex, hd->channel, DataBusChannel);
     model->setData(busIndex, hd->channel, DataBusChannelPrevious);
+    model->setData(busIndex, hd->cache_mode, DataCacheMode);
+    model->setData(busIndex, QString::fromUtf8(hd->overlay), DataOverlay);
     Harddrives::busTrackClass->device_track(1, DEV_HDD, hd->bus_type, hd->channel);
     auto    filenameIndex = model->index(row, ColumnFilename);
     QString fileName      = hd->fn;
@@ -167,6 +171,7 @@ SettingsHarddisks::save()
         auto idx            = model->index(i, ColumnBus);
         hdd[i].bus_type     = idx.data(DataBus).toUInt();
         hdd[i].channel      = idx.data(DataBusChannel).toUInt();
+        hdd[i].cache_mode   = idx.data(DataCacheMode).toUInt();
         hdd[i].tracks       = idx.siblingAtColumn(ColumnCylinders).data().toUInt();
         hdd[i].hpc          = idx.siblingAtColumn(ColumnHeads).data().toUInt();
         hdd[i].spt          = idx.siblingAtColumn(ColumnSectors).data().toUInt();
@@ -175,6 +180,8 @@ SettingsHarddisks::save()
 
         QByteArray fileName = idx.siblingAtColumn(ColumnFilename).data(Qt::UserRole).toString().toUtf8();
         strncpy(hdd[i].fn, fileName.data(), sizeof(hdd[i].fn) - 1);
+        QByteArray overlay = idx.data(DataOverlay).toString().toUtf8();
+        strncpy(hdd[i].overlay, overlay.data(), sizeof(hdd[i].overlay) - 1);
         hdd[i].priv = nullptr;
     }
 }
@@ -1057,6 +1057,10 @@ scsi_cdrom_read_data(scsi_cdrom_t *dev, const int msf, const int type, const int
         scsi_cdrom_lba_out_of_range(dev);
         ret = -1;
     } else {
+        /* Let the image fetch the rest of the transfer in bulk. */
+        if (!msf && !vendor_type && ((type & 0x0f) < 0x08))
+            cdrom_read_ahead(dev->drv, dev->sector_pos, dev->sector_len);
+
         ret = 1;
         for (int i = 0; (i < num) && (ret > 0) && (dev->sector_len > 0); i++) {
             ret = cdrom_readsector_raw(dev->drv, dev->buffer + dev->buffer_pos,
@@ -66,6 +66,7 @@ const uint8_t scsi_disk_command_flags[0x100] = {
     [0x2a ... 0x2b] = IMPLEMENTED | CHECK_READY,
     [0x2e]          = IMPLEMENTED | CHECK_READY,
     [0x2f]          = IMPLEMENTED | CHECK_READY | SCSI_ONLY,
+    [0x35]          = IMPLEMENTED | CHECK_READY,
     [0x41]          = IMPLEMENTED | CHECK_READY,
     [0x55]          = IMPLEMENTED,
     [0x5a]          = IMPLEMENTED,
@@ -1018,6 +1019,15 @@ scsi_disk_command(scsi_common_t *sc, const uint8_t *cdb)
             scsi_disk_command_complete(dev);
             break;
 
+        case GPCMD_SYNCHRONIZE_CACHE:
+            if (hdd_image_flush(dev->id) < 0) {
+                scsi_disk_write_error(dev);
+                break;
+            }
+            scsi_disk_set_phase(dev, SCSI_PHASE_STATUS);
+            scsi_disk_command_complete(dev);
+            break;
+
         case GPCMD_REZERO_UNIT:
             dev->sector_pos = dev->sector_len = 0;
 
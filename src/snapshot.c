@@ -0,0 +1,395 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Machine save state handler.
+ *
+ *          The file starts with a header identifying the build and the
+ *          machine configuration, followed by the CPU, memory, PIC and
+ *          DMA state, and then by one section per device, in device
+ *          list order. Every section starts with a tag so that a file
+ *          that does not match the running machine is rejected before
+ *          garbage is loaded into it.
+ *
+ *          Checkpoints only carry the RAM pages changed since their
+ *          parent, so that taking one every few seconds stays cheap;
+ *          each file records its own id and its parent's, so that a
+ *          chain with a replaced link in it is refused.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wchar.h>
+#define HAVE_STDARG_H
+#include <86box/86box.h>
+#include <86box/version.h>
+#include "cpu.h"
+#include <86box/machine.h>
+#include <86box/mem.h>
+#include <86box/timer.h>
+#include <86box/plat.h>
+#include <86box/snapshot.h>
+
+char snapshot_save_path[1024] = { '\0' };
+char snapshot_load_path[1024] = { '\0' };
+char snapshot_exit_path[1024] = { '\0' };
+char snapshot_checkpoint_path[1024] = { '\0' };
+
+/* The snapshot that the current RAM contents are relative to. */
+static uint64_t snapshot_last_id = 0;
+static char     snapshot_last_path[1024] = { '\0' };
+
+#ifdef ENABLE_SNAPSHOT_LOG
+int snapshot_do_log = ENABLE_SNAPSHOT_LOG;
+
+static void
+snapshot_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (snapshot_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define snapshot_log(fmt, ...)
+#endif
+
+void
+snapshot_io(snapshot_t *snap, void *data, size_t size)
+{
+    if (snap->error || !size)
+        return;
+
+    if (snap->saving) {
+        if (fwrite(data, 1, size, snap->fp) != size)
+            snap->error = 1;
+    } else if (fread(data, 1, size, snap->fp) != size)
+        snap->error = 1;
+}
+
+void
+snapshot_section(snapshot_t *snap, const char *tag)
+{
+    char    buf[256];
+    uint8_t len = (uint8_t) MIN(strlen(tag), sizeof(buf) - 1);
+
+    if (snap->error)
+        return;
+
+    if (snap->saving) {
+        SNAPSHOT_VAR(snap, len);
+        snapshot_io(snap, (void *) tag, len);
+        return;
+    }
+
+    memset(buf, 0x00, sizeof(buf));
+    SNAPSHOT_VAR(snap, len);
+    snapshot_io(snap, buf, len);
+    if (!snap->error && strncmp(buf, tag, sizeof(buf))) {
+        pclog("Snapshot: expected section \"%s\", found \"%s\"\n", tag, buf);
+        snap->error = 1;
+    }
+}
+
+void
+snapshot_timer(snapshot_t *snap, pc_timer_t *timer)
+{
+    uint64_t ts_integer = timer->ts_integer;
+    uint32_t ts_frac    = timer->ts_frac;
+    int      flags      = timer->flags & (TIMER_ENABLED | TIMER_SPLIT);
+    double   period     = timer->period;
+
+    SNAPSHOT_VAR(snap, ts_integer);
+    SNAPSHOT_VAR(snap, ts_frac);
+    SNAPSHOT_VAR(snap, flags);
+    SNAPSHOT_VAR(snap, period);
+
+    if (snap->saving || snap->error)
+        return;
+
+    timer_disable(timer);
+
+    timer->ts_integer = ts_integer;
+    timer->ts_frac    = ts_frac;
+    timer->period     = period;
+    timer->flags      = (timer->flags & ~TIMER_SPLIT) | (flags & TIMER_SPLIT);
+
+    if (flags & TIMER_ENABLED)
+        timer_enable(timer);
+}
+
+static void
+snapshot_string(snapshot_t *snap, const char *what, const char *str)
+{
+    char buf[128];
+
+    memset(buf, 0x00, sizeof(buf));
+    strncpy(buf, str, sizeof(buf) - 1);
+    SNAPSHOT_VAR(snap, buf);
+
+    if (!snap->saving && !snap->error && strcmp(buf, str)) {
+        pclog("Snapshot: %s mismatch (file: \"%s\", running: \"%s\")\n", what, buf, str);
+        snap->error = 1;
+    }
+}
+
+static void
+snapshot_header(snapshot_t *snap)
+{
+    char     magic[8];
+    uint32_t version = SNAPSHOT_VERSION;
+    uint32_t size    = mem_size;
+
+    memcpy(magic, SNAPSHOT_MAGIC, sizeof(magic));
+    SNAPSHOT_VAR(snap, magic);
+    SNAPSHOT_VAR(snap, version);
+    if (!snap->saving && !snap->error &&
+        (memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) || (version != SNAPSHOT_VERSION))) {
+        pclog("Snapshot: not a snapshot file, or an unsupported version\n");
+        snap->error = 1;
+    }
+
+    /* The state layout is tied to the build that wrote it. */
+    snapshot_string(snap, "build", EMU_VERSION_FULL);
+    snapshot_string(snap, "machine", machine_get_internal_name());
+    snapshot_string(snap, "CPU", cpu_s->name);
+
+    SNAPSHOT_VAR(snap, size);
+    if (!snap->saving && !snap->error && (size != mem_size)) {
+        pclog("Snapshot: memory size mismatch (file: %u KB, running: %u KB)\n", size, mem_size);
+        snap->error = 1;
+    }
+
+    SNAPSHOT_VAR(snap, snap->id);
+    SNAPSHOT_VAR(snap, snap->parent_id);
+    SNAPSHOT_VAR(snap, snap->parent);
+    snap->parent[sizeof(snap->parent) - 1] = '\0';
+    snap->incremental = (snap->parent_id != 0);
+}
+
+static uint64_t
+snapshot_new_id(void)
+{
+    static uint32_t counter = 0;
+    uint64_t        id;
+
+    id = ((uint64_t) time(NULL) << 32) ^ ((uint64_t) plat_get_ticks() << 16) ^ ++counter;
+
+    return id ? id : 1;
+}
+
+static void
+snapshot_serialize(snapshot_t *snap)
+{
+    snapshot_header(snap);
+    cpu_serialize(snap);
+    mem_serialize(snap);
+    pic_serialize(snap);
+    dma_serialize(snap);
+    device_serialize_all(snap);
+    snapshot_section(snap, "end");
+}
+
+static int
+snapshot_check(void)
+{
+    const char *dev;
+
+    /* The 808x core keeps its prefetch queue and bus state private. */
+    if (!is286) {
+        pclog("Snapshot: 8088/8086 class CPUs are not supported\n");
+        return 0;
+    }
+
+    dev = snapshot_unsupported();
+    if (dev != NULL) {
+        pclog("Snapshot: device \"%s\" cannot save its state\n", dev);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int
+snapshot_write(const char *fn, int incremental)
+{
+    snapshot_t snap = { 0 };
+
+    if (!snapshot_check())
+        return 0;
+
+    snap.fp = plat_fopen(fn, "wb");
+    if (snap.fp == NULL) {
+        pclog("Snapshot: unable to create \"%s\"\n", fn);
+        return 0;
+    }
+    snap.saving = 1;
+    snap.id     = snapshot_new_id();
+    if (incremental) {
+        snap.parent_id = snapshot_last_id;
+        strncpy(snap.parent, snapshot_last_path, sizeof(snap.parent) - 1);
+    }
+
+    snapshot_serialize(&snap);
+
+    fclose(snap.fp);
+
+    if (snap.error) {
+        pclog("Snapshot: error writing \"%s\"\n", fn);
+        plat_remove((char *) fn);
+        return 0;
+    }
+
+    /* The next checkpoint only has to store what changes from here on. */
+    snapshot_last_id = snap.id;
+    memset(snapshot_last_path, 0x00, sizeof(snapshot_last_path));
+    strncpy(snapshot_last_path, fn, sizeof(snapshot_last_path) - 1);
+    mem_dirty_clear();
+
+    snapshot_log("Snapshot: saved to \"%s\"%s\n", fn, incremental ? " (incremental)" : "");
+    return 1;
+}
+
+int
+snapshot_save(const char *fn)
+{
+    return snapshot_write(fn, 0);
+}
+
+int
+snapshot_checkpoint(const char *fn)
+{
+    return snapshot_write(fn, snapshot_last_id != 0);
+}
+
+/* Read just the header of a snapshot file, to follow a chain of checkpoints. */
+static int
+snapshot_peek(const char *fn, snapshot_t *snap)
+{
+    memset(snap, 0x00, sizeof(snapshot_t));
+
+    snap->fp = plat_fopen(fn, "rb");
+    if (snap->fp == NULL) {
+        pclog("Snapshot: unable to open \"%s\"\n", fn);
+        return 0;
+    }
+
+    snapshot_header(snap);
+    fclose(snap->fp);
+    snap->fp = NULL;
+
+    return !snap->error;
+}
+
+int
+snapshot_load(const char *fn)
+{
+    snapshot_t snap;
+    char     (*chain)[1024] = NULL;
+    uint64_t  *ids          = NULL;
+    int        count        = 0;
+    int        ret          = 0;
+
+    if (!snapshot_check())
+        return 0;
+
+    /* Walk the chain of parents back to the full snapshot it starts from,
+       rejecting it before touching the machine if any link is missing,
+       does not match the machine, or was replaced after its children were
+       taken. */
+    memset(&snap, 0x00, sizeof(snap));
+    strncpy(snap.parent, fn, sizeof(snap.parent) - 1);
+    do {
+        chain = realloc(chain, (count + 1) * sizeof(*chain));
+        ids   = realloc(ids, (count + 2) * sizeof(*ids));
+        memcpy(chain[count], snap.parent, sizeof(chain[count]));
+
+        if (!snapshot_peek(chain[count], &snap))
+            goto done;
+        if (count && (snap.id != ids[count])) {
+            pclog("Snapshot: \"%s\" is not the parent its checkpoint was taken on\n", chain[count]);
+            goto done;
+        }
+        ids[count++] = snap.id;
+        ids[count]   = snap.parent_id;
+    } while (snap.parent_id);
+
+    /* Start from a freshly reset machine, so that everything derived from the
+       configuration is back in its initial place, then load the chain oldest
+       first; every link restores the whole machine state on top of the
+       previous one, along with the RAM pages it changed. This runs from
+       pc_run(), between frames, so the reset can be done right away. */
+    pc_reset_hard_close();
+    pc_reset_hard_init();
+
+    while (count--) {
+        memset(&snap, 0x00, sizeof(snap));
+        snap.fp = plat_fopen(chain[count], "rb");
+        if (snap.fp == NULL) {
+            snap.error = 1;
+            break;
+        }
+
+        snapshot_serialize(&snap);
+        fclose(snap.fp);
+
+        if (!snap.error && (snap.id != ids[count]))
+            snap.error = 1;
+        if (snap.error)
+            break;
+    }
+
+#ifdef USE_DYNAREC
+    /* Whatever was compiled belongs to the memory contents we replaced. */
+    codegen_reset();
+#endif
+
+    if (snap.error) {
+        pclog("Snapshot: error loading \"%s\", resetting the machine\n", fn);
+        pc_reset_hard();
+        snapshot_last_id = 0;
+        goto done;
+    }
+
+    snapshot_last_id = snap.id;
+    memset(snapshot_last_path, 0x00, sizeof(snapshot_last_path));
+    strncpy(snapshot_last_path, fn, sizeof(snapshot_last_path) - 1);
+    mem_dirty_clear();
+
+    snapshot_log("Snapshot: loaded from \"%s\"\n", fn);
+    ret = 1;
+
+done:
+    free(chain);
+    free(ids);
+    return ret;
+}
+
+void
+snapshot_process(void)
+{
+    if (snapshot_load_path[0] != '\0') {
+        snapshot_load(snapshot_load_path);
+        snapshot_load_path[0] = '\0';
+    }
+
+    if (snapshot_save_path[0] != '\0') {
+        snapshot_save(snapshot_save_path);
+        snapshot_save_path[0] = '\0';
+    }
+
+    if (snapshot_checkpoint_path[0] != '\0') {
+        snapshot_checkpoint(snapshot_checkpoint_path);
+        snapshot_checkpoint_path[0] = '\0';
+    }
+}
@@ -0,0 +1,77 @@
+/*
+ * 86Box    A hypervisor and IBM PC system emulator that specializes in
+ *          running old operating systems and software designed for IBM
+ *          PC systems and compatibles from 1981 through fairly recent
+ *          system designs based on the PCI bus.
+ *
+ *          This file is part of the 86Box distribution.
+ *
+ *          Null audio output, used by the headless runner. All
+ *          buffers handed to it are discarded.
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include <86box/86box.h>
+#include <86box/sound.h>
+#include <86box/plat_unused.h>
+
+void
+closeal(void)
+{
+    //
+}
+
+void
+inital(void)
+{
+    //
+}
+
+void
+givealbuffer(UNUSED(const void *buf))
+{
+    //
+}
+
+void
+givealbuffer_music(UNUSED(const void *buf))
+{
+    //
+}
+
+void
+givealbuffer_wt(UNUSED(const void *buf))
+{
+    //
+}
+
+void
+givealbuffer_cd(UNUSED(const void *buf))
+{
+    //
+}
+
+void
+givealbuffer_midi(UNUSED(const void *buf), UNUSED(const uint32_t size))
+{
+    //
+}
+
+void
+givealbuffer_fdd(UNUSED(const void *buf), UNUSED(const uint32_t size))
+{
+    //
+}
+
+void
+givealbuffer_hdd(UNUSED(const void *buf), UNUSED(const uint32_t size))
+{
+    //
+}
+
+void
+al_set_midi(UNUSED(const int freq), UNUSED(const int buf_size))
+{
+    //
+}
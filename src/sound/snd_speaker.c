@@ -23,6 +23,7 @@
 #include <86box/timer.h>
 #include <86box/pit.h>
 #include <86box/snd_speaker.h>
+#include <86box/snapshot.h>
 #include <86box/sound.h>
 #include <86box/plat_unused.h>
 
@@ -106,6 +107,19 @@ speaker_get_buffer(int32_t *buffer, int len, UNUSED(void *priv))
     speaker_pos = 0;
 }
 
+void
+speaker_serialize(snapshot_t *snap)
+{
+    SNAPSHOT_VAR(snap, speaker_gated);
+    SNAPSHOT_VAR(snap, speaker_enable);
+    SNAPSHOT_VAR(snap, was_speaker_enable);
+    SNAPSHOT_VAR(snap, gated);
+    SNAPSHOT_VAR(snap, speakval);
+    SNAPSHOT_VAR(snap, speakon);
+    SNAPSHOT_VAR(snap, speaker_mode);
+    SNAPSHOT_VAR(snap, speaker_count);
+}
+
 void
 speaker_init(void)
 {
@@ -1,7 +1,11 @@
+#include <stdarg.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wchar.h>
+#define HAVE_STDARG_H
 #include <86box/86box.h>
 #include "cpu.h"
 #include <86box/timer.h>
@@ -10,15 +14,202 @@
 uint64_t TIMER_USEC;
 uint64_t timer_target;
 
+#ifdef USE_TIMER_HEAP
+/*Enabled timers are stored in a 4-ary min-heap, with the first timer to expire
+  at index 0. Timers with equal timestamps are ordered newest first, matching
+  the insertion order of the sorted list.*/
+#    define TIMER_HEAP_ARITY 4
+
+static pc_timer_t **timer_heap      = NULL;
+static int          timer_heap_size = 0;
+static uint32_t     timer_heap_seq  = 0;
+#else
 /*Enabled timers are stored in a linked list, with the first timer to expire at
   the head.*/
 pc_timer_t *timer_head = NULL;
+#endif
+
+/* Number of enabled timers. */
+static int timer_count = 0;
+
+static timer_stats_t timer_stats;
 
 /* Are we initialized? */
 int timer_inited = 0;
 
 static void timer_advance_ex(pc_timer_t *timer, int start);
 
+#ifdef ENABLE_TIMER_LOG
+int timer_do_log = ENABLE_TIMER_LOG;
+
+static void
+timer_log(const char *fmt, ...)
+{
+    va_list ap;
+
+    if (timer_do_log) {
+        va_start(ap, fmt);
+        pclog_ex(fmt, ap);
+        va_end(ap);
+    }
+}
+#else
+#    define timer_log(fmt, ...)
+#endif
+
+#ifdef USE_TIMER_HEAP
+/*True if timer a has to run before timer b*/
+static __inline int
+timer_heap_less(pc_timer_t *a, pc_timer_t *b)
+{
+    int64_t diff = (int64_t) (a->ts_integer - b->ts_integer);
+
+    if (diff == 0)
+        return (int32_t) (a->heap_seq - b->heap_seq) > 0;
+
+    return diff < 0;
+}
+
+static __inline void
+timer_heap_place(pc_timer_t *timer, int idx)
+{
+    timer_heap[idx] = timer;
+    timer->heap_idx = idx;
+}
+
+static void
+timer_heap_sift_up(int idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (idx > 0) {
+        int parent = (idx - 1) / TIMER_HEAP_ARITY;
+
+        if (!timer_heap_less(timer, timer_heap[parent]))
+            break;
+
+        timer_heap_place(timer_heap[parent], idx);
+        idx = parent;
+        timer_stats.insert_steps++;
+    }
+
+    timer_heap_place(timer, idx);
+}
+
+static void
+timer_heap_sift_down(int idx)
+{
+    pc_timer_t *timer = timer_heap[idx];
+
+    while (1) {
+        int first = (idx * TIMER_HEAP_ARITY) + 1;
+        int last  = first + TIMER_HEAP_ARITY;
+        int min   = idx;
+        pc_timer_t *min_timer = timer;
+
+        if (first >= timer_count)
+            break;
+        if (last > timer_count)
+            last = timer_count;
+
+        for (int i = first; i < last; i++) {
+            if (timer_heap_less(timer_heap[i], min_timer)) {
+                min       = i;
+                min_timer = timer_heap[i];
+            }
+        }
+
+        if (min == idx)
+            break;
+
+        timer_heap_place(min_timer, idx);
+        idx = min;
+    }
+
+    timer_heap_place(timer, idx);
+}
+
+static void
+timer_heap_remove(pc_timer_t *timer)
+{
+    int         idx  = timer->heap_idx;
+    pc_timer_t *last = timer_heap[--timer_count];
+
+    timer_heap[timer_count] = NULL;
+
+    if (last != timer) {
+        timer_heap_place(last, idx);
+        if ((idx > 0) && timer_heap_less(last, timer_heap[(idx - 1) / TIMER_HEAP_ARITY]))
+            timer_heap_sift_up(idx);
+        else
+            timer_heap_sift_down(idx);
+    }
+
+    timer->heap_idx = -1;
+}
+
+void
+timer_enable(pc_timer_t *timer)
+{
+    if (timer->flags & TIMER_ENABLED)
+        timer_disable(timer);
+
+    if (timer_count == timer_heap_size) {
+        timer_heap_size = timer_heap_size ? (timer_heap_size << 1) : 64;
+        timer_heap      = (pc_timer_t **) realloc(timer_heap, timer_heap_size * sizeof(pc_timer_t *));
+        if (timer_heap == NULL)
+            fatal("timer_enable - out of memory\n");
+    }
+
+    timer_stats.inserts++;
+    timer_stats.queue_len += timer_count;
+
+    timer->flags |= TIMER_ENABLED;
+    timer->heap_seq = timer_heap_seq++;
+
+    timer_heap[timer_count] = timer;
+    timer_heap_sift_up(timer_count++);
+
+    if (timer->heap_idx == 0)
+        timer_target = timer->ts_integer;
+}
+
+void
+timer_disable(pc_timer_t *timer)
+{
+    if (!timer_inited || (timer == NULL) || !(timer->flags & TIMER_ENABLED))
+        return;
+
+    if ((timer->heap_idx < 0) || (timer->heap_idx >= timer_count) ||
+        (timer_heap[timer->heap_idx] != timer)) {
+        uint32_t *p = NULL;
+        *p = 5;    /* Crash deliberately. */
+        fatal("timer_disable(): Attempting to disable a timer not in the "
+              "heap incorrectly marked as enabled\n");
+    }
+
+    timer->flags &= ~TIMER_ENABLED;
+    timer->in_callback = 0;
+
+    timer_heap_remove(timer);
+}
+
+static __inline pc_timer_t *
+timer_first(void)
+{
+    return timer_count ? timer_heap[0] : NULL;
+}
+
+static void
+timer_remove_head(void)
+{
+    if (timer_count) {
+        pc_timer_t *timer = timer_heap[0];
+        timer_heap_remove(timer);
+        timer->flags &= ~TIMER_ENABLED;
+    }
+}
+#else
 void
 timer_enable(pc_timer_t *timer)
 {
@@ -32,6 +223,10 @@ timer_enable(pc_timer_t *timer)
 
     timer->flags |= TIMER_ENABLED;
 
+    timer_stats.inserts++;
+    timer_stats.queue_len += timer_count;
+    timer_count++;
+
     /*List currently empty - add to head*/
     if (!timer_head) {
         timer_head = timer;
@@ -43,6 +238,8 @@ timer_enable(pc_timer_t *timer)
     timer_node = timer_head;
 
     while (1) {
+        timer_stats.insert_steps++;
+
         /*
            Timer expires before timer_node.
            Add to list in front of timer_node
@@ -89,6 +286,7 @@ timer_disable(pc_timer_t *timer)
 
     timer->flags &= ~TIMER_ENABLED;
     timer->in_callback = 0;
+    timer_count--;
 
     if (timer->prev)
         timer->prev->next = timer->next;
@@ -99,6 +297,12 @@ timer_disable(pc_timer_t *timer)
     timer->prev = timer->next = NULL;
 }
 
+static __inline pc_timer_t *
+timer_first(void)
+{
+    return timer_head;
+}
+
 static void
 timer_remove_head(void)
 {
@@ -108,19 +312,21 @@ timer_remove_head(void)
         timer_head->prev = NULL;
         timer->next = timer->prev = NULL;
         timer->flags &= ~TIMER_ENABLED;
+        timer_count--;
     }
 }
+#endif
 
 void
 timer_process(void)
 {
     int num = 0;
 
-    if (!timer_head)
+    if (!timer_first())
         return;
 
     while (1) {
-        pc_timer_t *timer = timer_head;
+        pc_timer_t *timer = timer_first();
 
         if (!TIMER_LESS_THAN_VAL(timer, (uint64_t) tsc))
             break;
@@ -139,17 +345,38 @@ timer_process(void)
             timer->in_callback = 1;
             timer->callback(timer->priv);
             timer->in_callback = 0;
+            timer_stats.callbacks++;
         }
 
         num++;
     }
 
-    timer_target = timer_head->ts_integer;
+    timer_target = timer_first()->ts_integer;
+}
+
+void
+timer_get_stats(timer_stats_t *stats)
+{
+    *stats = timer_stats;
+}
+
+void
+timer_reset_stats(void)
+{
+    memset(&timer_stats, 0x00, sizeof(timer_stats_t));
 }
 
 void
 timer_close(void)
 {
+#ifdef USE_TIMER_HEAP
+    /* Detach all timers from the heap so that timers that are not in
+       malloc'd structs don't look enabled on the next initialization. */
+    for (int i = 0; i < timer_count; i++) {
+        timer_heap[i]->heap_idx = -1;
+        timer_heap[i]           = NULL;
+    }
+#else
     pc_timer_t *t = timer_head;
     pc_timer_t *r;
 
@@ -158,11 +385,22 @@ timer_close(void)
        to timers that may be in malloc'd structs. */
     while (t != NULL) {
         r       = t;
+        t       = r->next;
         r->prev = r->next = NULL;
-        t                 = r->next;
     }
 
     timer_head = NULL;
+#endif
+
+    if (timer_stats.inserts)
+        timer_log("Timer: %" PRIu64 " insertions, average queue length %.2f, "
+                  "average insertion cost %.2f steps, %" PRIu64 " callbacks\n",
+                  timer_stats.inserts,
+                  (double) timer_stats.queue_len / (double) timer_stats.inserts,
+                  (double) timer_stats.insert_steps / (double) timer_stats.inserts,
+                  timer_stats.callbacks);
+
+    timer_count = 0;
 
     timer_inited = 0;
 }
@@ -173,6 +411,8 @@ timer_init(void)
     timer_target = 0ULL;
     tsc          = 0;
 
+    timer_reset_stats();
+
     /* Initialise the CPU-independent timer */
     rivatimer_init();
 
@@ -189,6 +429,7 @@ timer_add(pc_timer_t *timer, void (*callback)(void *priv), void *priv, int start
     timer->priv        = priv;
     timer->flags       = 0;
     timer->prev        = timer->next = NULL;
+    timer->heap_idx    = -1;
     if (start_timer)
         timer_set_delay_u64(timer, 0);
 }
@@ -273,20 +514,31 @@ timer_set_new_tsc(uint64_t new_tsc)
         update_tsc();
 #endif
 
-    if (!timer_head) {
+    if (!timer_first()) {
         tsc = new_tsc;
         return;
     }
 
-    timer = timer_head;
-    timer_target = new_tsc + (int64_t)(timer_get_ts_int(timer_head) - (uint64_t)tsc);
+    timer = timer_first();
+    timer_target = new_tsc + (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
+
+    /* Every timer moves by the same offset, so the queue order is kept. */
+#ifdef USE_TIMER_HEAP
+    for (int i = 0; i < timer_count; i++) {
+        int64_t offset_from_current_tsc;
 
+        timer = timer_heap[i];
+        offset_from_current_tsc = (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
+        timer->ts_integer = new_tsc + offset_from_current_tsc;
+    }
+#else
     while (timer) {
         int64_t offset_from_current_tsc = (int64_t)(timer_get_ts_int(timer) - (uint64_t)tsc);
         timer->ts_integer = new_tsc + offset_from_current_tsc;
 
         timer = timer->next;
     }
+#endif
 
     tsc = new_tsc;
 }
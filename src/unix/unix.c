@@ -49,6 +49,14 @@
 #include <86box/video.h>
 #include <86box/ui.h>
 #include <86box/gdbstub.h>
+#include <86box/snapshot.h>
+#ifdef USE_DYNAREC
+#    include "codegen_public.h"
+#endif
+#ifdef USE_HEADLESS
+#    include <86box/machine.h>
+#    include <86box/unittester.h>
+#endif
 
 #define __USE_GNU 1 /* shouldn't be done, yet it is */
 #include <pthread.h>
@@ -479,6 +487,12 @@ plat_get_ticks(void)
     return (uint32_t) (plat_get_ticks_common() / 1000);
 }
 
+int
+plat_get_cpu_count(void)
+{
+    return SDL_GetCPUCount();
+}
+
 void
 plat_remove(char *path)
 {
@@ -1104,6 +1118,9 @@ unix_executeLine(char *line)
                 "carteject <id> - eject cartridge from drive <id>.\n"
                 "moeject <id> - eject image from MO drive <id>.\n\n"
                 "hardreset - hard reset the emulated system.\n"
+                "savestate <filename> - save the machine state to <filename>.\n"
+                "loadstate <filename> - restore the machine state from <filename>.\n"
+                "checkpoint <filename> - save only what changed since the last save or load to <filename>.\n"
                 "pause - pause the the emulated system.\n"
                 "screenshot - save a screenshot.\n"
                 "fullscreen - toggle fullscreen.\n"
@@ -1156,6 +1173,12 @@ unix_executeLine(char *line)
             printf("%s", dopause ? "Paused.\n" : "Unpaused.\n");
         } else if (strncasecmp(xargv[0], "hardreset", 9) == 0) {
             pc_reset_hard();
+        } else if (strncasecmp(xargv[0], "savestate", 9) == 0 && cmdargc >= 2) {
+            strncpy(snapshot_save_path, xargv[1], sizeof(snapshot_save_path) - 1);
+        } else if (strncasecmp(xargv[0], "loadstate", 9) == 0 && cmdargc >= 2) {
+            strncpy(snapshot_load_path, xargv[1], sizeof(snapshot_load_path) - 1);
+        } else if (strncasecmp(xargv[0], "checkpoint", 10) == 0 && cmdargc >= 2) {
+            strncpy(snapshot_checkpoint_path, xargv[1], sizeof(snapshot_checkpoint_path) - 1);
         } else if (strncasecmp(xargv[0], "cdload", 6) == 0 && cmdargc >= 3) {
             uint8_t id;
             bool    err = false;
@@ -1329,6 +1352,99 @@ monitor_thread(UNUSED(void *param))
 #endif
 }
 
+#ifdef USE_HEADLESS
+static volatile int bench_exit_code = -1;
+
+static void
+bench_unittester_exit(int code)
+{
+    bench_exit_code = code;
+}
+
+/* Run the machine without a window for bench_run_secs emulated seconds, or
+   until the unit tester device requests an exit, then report the counters
+   as JSON on stdout. Emulated time is counted in pc_run() slices, so the
+   instruction and block counts are reproducible for a given configuration. */
+static int
+headless_run(void)
+{
+    timer_stats_t stats;
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_stats_t cg_stats;
+#endif
+    uint64_t      slice_ms = force_10ms ? 10 : 1;
+    uint64_t      emu_ms   = 0;
+    uint64_t      start;
+    double        host_secs;
+    double        mips;
+
+    unittester_exit_func = bench_unittester_exit;
+
+    blitmtx = SDL_CreateMutex();
+    if (!blitmtx) {
+        fprintf(stderr, "Failed to create blit mutex: %s", SDL_GetError());
+        return -1;
+    }
+    mousemutex = SDL_CreateMutex();
+    timer_freq = SDL_GetPerformanceFrequency();
+
+    pc_reset_hard_init();
+    timer_reset_stats();
+    mem_tlb_hits   = 0;
+    mem_tlb_misses = 0;
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_reset_stats();
+#endif
+    is_quit = 0;
+
+    start = plat_timer_read();
+    while ((bench_exit_code < 0) && (!bench_run_secs || (emu_ms < ((uint64_t) bench_run_secs * 1000ULL)))) {
+        pc_run();
+        emu_ms += slice_ms;
+    }
+    host_secs = (double) (plat_timer_read() - start) / (double) timer_freq;
+
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    codegen_get_stats(&cg_stats);
+#endif
+    timer_get_stats(&stats);
+    mips = (host_secs > 0.0) ? ((double) cpu_instrs_executed / host_secs / 1000000.0) : 0.0;
+
+    printf("{\n"
+           "  \"machine\": \"%s\",\n"
+           "  \"cpu\": \"%s\",\n"
+           "  \"emulated_ms\": %" PRIu64 ",\n"
+           "  \"host_ms\": %.3f,\n"
+           "  \"instructions\": %" PRIu64 ",\n"
+           "  \"blocks_compiled\": %" PRIu64 ",\n"
+           "  \"timer_callbacks\": %" PRIu64 ",\n"
+           "  \"tlb_hits\": %" PRIu64 ",\n"
+           "  \"tlb_misses\": %" PRIu64 ",\n",
+           machine_get_internal_name(), cpu_s->name, emu_ms, host_secs * 1000.0,
+           cpu_instrs_executed, cpu_blocks_compiled, stats.callbacks, mem_tlb_hits, mem_tlb_misses);
+#if defined(USE_DYNAREC) && defined(USE_NEW_DYNAREC)
+    printf("  \"recompiles\": %" PRIu64 ",\n"
+           "  \"evictions\": %" PRIu64 ",\n"
+           "  \"invalidations\": %" PRIu64 ",\n"
+           "  \"traces\": %" PRIu64 ",\n",
+           cg_stats.recompiles, cg_stats.evictions, cg_stats.invalidations, cg_stats.traces);
+#endif
+    printf("  \"mips\": %.3f,\n"
+           "  \"exit_code\": %i\n"
+           "}\n",
+           mips, bench_exit_code);
+    fflush(stdout);
+
+    pc_close(NULL);
+
+    SDL_DestroyMutex(blitmtx);
+    SDL_DestroyMutex(mousemutex);
+    SDL_Quit();
+
+    return (bench_exit_code < 0) ? 0 : bench_exit_code;
+}
+#endif
+
 extern int gfxcard[GFXCARD_MAX];
 int
 main(int argc, char **argv)
@@ -1350,6 +1466,9 @@ main(int argc, char **argv)
 
     for (uint8_t i = 1; i < GFXCARD_MAX; i++)
         gfxcard[i]  = 0;
+#ifdef USE_HEADLESS
+    return headless_run();
+#endif
     eventthread = SDL_ThreadID();
     blitmtx     = SDL_CreateMutex();
     if (!blitmtx) {
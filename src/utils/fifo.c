@@ -13,6 +13,7 @@
  *          Copyright 2023-2025 Miran Grca.
  */
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -26,6 +27,10 @@
 #define HAVE_STDARG_H
 #include <86box/86box.h>
 #include <86box/fifo.h>
+#ifndef FIFO_STANDALONE
+#    include <86box/timer.h>
+#    include <86box/snapshot.h>
+#endif
 #endif
 
 #ifdef ENABLE_FIFO_LOG
@@ -513,6 +518,19 @@ fifo_close(void *priv)
     free(priv);
 }
 
+#ifndef FIFO_STANDALONE
+/* Everything up to the owner pointer and event callbacks, then the data. */
+void
+fifo_serialize(void *priv, int size, snapshot_t *snap)
+{
+    fifo_t *fifo = (fifo_t *) priv;
+
+    snapshot_io(snap, fifo, offsetof(fifo_t, priv));
+    snapshot_io(snap, fifo->tag, sizeof(fifo->tag));
+    snapshot_io(snap, fifo->buf, size);
+}
+#endif
+
 void *
 fifo_init(int len)
 {
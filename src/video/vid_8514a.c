@@ -3657,6 +3657,7 @@ ibm8514_render_overscan_right(ibm8514_t *dev, svga_t *svga)
 void
 ibm8514_set_poll(svga_t *svga)
 {
+    svga_deferred_sync(svga);
     timer_set_callback(&svga->timer, ibm8514_poll);
 }
 
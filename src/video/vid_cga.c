@@ -33,6 +33,7 @@
 #include <86box/video.h>
 #include <86box/vid_cga.h>
 #include <86box/vid_cga_comp.h>
+#include <86box/snapshot.h>
 #include <86box/plat_unused.h>
 
 #define CGA_RGB       0
@@ -833,6 +834,28 @@ cga_speed_changed(void *priv)
     cga_recalctimings(cga);
 }
 
+static void
+cga_serialize(void *priv, snapshot_t *snap)
+{
+    cga_t *cga = (cga_t *) priv;
+    cga_t  tmp = *cga;
+
+    SNAPSHOT_VAR(snap, tmp);
+    snapshot_io(snap, cga->vram, DEVICE_VRAM);
+
+    if (!snap->saving && !snap->error) {
+        tmp.mapping = cga->mapping;
+        tmp.timer   = cga->timer;
+        tmp.vram    = cga->vram;
+        *cga        = tmp;
+
+        update_cga16_color(cga->cgamode);
+        cga->fullchange = changeframecount;
+    }
+
+    snapshot_timer(snap, &cga->timer);
+}
+
 // clang-format off
 const device_config_t cga_config[] = {
     {
@@ -943,7 +966,8 @@ const device_t cga_device = {
     .available     = NULL,
     .speed_changed = cga_speed_changed,
     .force_redraw  = NULL,
-    .config        = cga_config
+    .config        = cga_config,
+    .serialize     = cga_serialize
 };
 
 const device_t cga_pravetz_device = {
@@ -957,5 +981,6 @@ const device_t cga_pravetz_device = {
     .available     = NULL,
     .speed_changed = cga_speed_changed,
     .force_redraw  = NULL,
-    .config        = cga_config
+    .config        = cga_config,
+    .serialize     = cga_serialize
 };
@@ -75,9 +75,13 @@ static int dither[4][4] = {
 #define RB_SIZE 256
 #define RB_MASK (RB_SIZE - 1)
 
-#define RB_ENTRIES (virge->s3d_write_idx - virge->s3d_read_idx)
-#define RB_FULL (RB_ENTRIES == RB_SIZE)
-#define RB_EMPTY (!RB_ENTRIES)
+#define RB_ENTRIES(c) (virge->s3d_write_idx - virge->s3d_read_idx[c])
+#define RB_FULL(c) (RB_ENTRIES(c) == RB_SIZE)
+#define RB_EMPTY(c) (!RB_ENTRIES(c))
+
+#define VIRGE_MAX_RENDER_THREADS 16
+/*Each render thread owns full width bands of 8 lines, assigned round robin*/
+#define VIRGE_BAND_SHIFT 3
 
 #define FIFO_SIZE 65536
 #define FIFO_MASK (FIFO_SIZE - 1)
@@ -189,6 +193,12 @@ typedef struct s3d_t {
     uint8_t fog_b;
 } s3d_t;
 
+typedef struct virge_render_ctx_t {
+    struct virge_t *virge;
+    int             thread;
+    int             pixel_count;
+} virge_render_ctx_t;
+
 typedef struct virge_t {
     mem_mapping_t linear_mapping;
     mem_mapping_t mmio_mapping;
@@ -219,13 +229,14 @@ typedef struct virge_t {
     int dithering_enabled;
     int memory_size;
 
-    int pixel_count;
     int tri_count;
 
-    thread_t *render_thread;
-    event_t  *wake_render_thread;
-    event_t  *wake_main_thread;
-    event_t  *not_full_event;
+    int                render_threads;
+    virge_render_ctx_t render_ctx[VIRGE_MAX_RENDER_THREADS];
+    thread_t          *render_thread[VIRGE_MAX_RENDER_THREADS];
+    event_t           *wake_render_thread[VIRGE_MAX_RENDER_THREADS];
+    event_t           *wake_main_thread;
+    event_t           *not_full_event[VIRGE_MAX_RENDER_THREADS];
 
     uint32_t hwc_fg_col;
     uint32_t hwc_bg_col;
@@ -291,9 +302,10 @@ typedef struct virge_t {
     s3d_t s3d_tri;
 
     s3d_t      s3d_buffer[RB_SIZE];
-    ATOMIC_INT s3d_read_idx;
+    ATOMIC_INT s3d_read_idx[VIRGE_MAX_RENDER_THREADS];
     ATOMIC_INT s3d_write_idx;
-    ATOMIC_INT s3d_busy;
+    ATOMIC_INT s3d_busy[VIRGE_MAX_RENDER_THREADS];
+    atomic_int s3d_done_pending; /*Triangles rendered since the last S3D_DONE*/
 
     struct {
         uint32_t pri_ctrl;
@@ -392,6 +404,17 @@ wake_fifo_thread(virge_t *virge)
     thread_set_event(virge->wake_fifo_thread);
 }
 
+static __inline int
+s3_virge_render_busy(virge_t *virge)
+{
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (!RB_EMPTY(c) || virge->s3d_busy[c])
+            return 1;
+    }
+
+    return 0;
+}
+
 static virge_t *reset_state = NULL;
 
 static video_timings_t timing_diamond_stealth3d_2000_pci = { .type = VIDEO_PCI, .write_b = 2, .write_w = 2, .write_l = 3, .read_b = 28, .read_w = 28, .read_l = 45 };
@@ -1204,7 +1227,7 @@ s3_virge_mmio_read(uint32_t addr, void *priv)
             return ret;
         case 0x8505:
             ret = 0xc0;
-            if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+            if (s3_virge_render_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                 ret |= 0x10;
             else
                 ret |= 0x30;
@@ -1252,7 +1275,7 @@ s3_virge_mmio_read_w(uint32_t addr, void *priv)
     switch (addr & 0xfffe) {
         case 0x8504:
             ret = 0xc000;
-            if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+            if (s3_virge_render_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                 ret |= 0x1000;
             else
                 ret |= 0x3000;
@@ -1355,7 +1378,7 @@ s3_virge_mmio_read_l(uint32_t addr, void *priv)
 
         case 0x8504:
             ret = 0x0000c000;
-            if (virge->s3d_busy || virge->virge_busy || !FIFO_EMPTY)
+            if (s3_virge_render_busy(virge) || virge->virge_busy || !FIFO_EMPTY)
                 ret |= 0x00001000;
             else
                 ret |= 0x00003000;
@@ -3422,9 +3445,9 @@ skip_line:
         g = (val & 0xff00) >> 8;   \
         r = (val & 0xff0000) >> 16
 
-#define RGB15(r, g, b, dest)                        \
+#define RGB15(r, g, b, x, y, dest)                  \
         if (virge->dithering_enabled) {             \
-                int add = dither[_y & 3][_x & 3];   \
+                int add = dither[(y) & 3][(x) & 3]; \
                 int _r = (r > 248) ? 248 : r + add; \
                 int _g = (g > 248) ? 248 : g + add; \
                 int _b = (b > 248) ? 248 : b + add; \
@@ -3480,6 +3503,7 @@ typedef struct s3d_state_t {
     int32_t x2;
 
     int y;
+    int persp_shift;
 
     rgba_t dest_rgba;
 } s3d_state_t;
@@ -3492,525 +3516,146 @@ typedef struct s3d_texture_state_t {
     int32_t v;
 } s3d_texture_state_t;
 
-static void (*tex_read)(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out);
-static void (*tex_sample)(s3d_state_t *state);
-static void (*dest_pixel)(s3d_state_t *state);
-
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 
-static int _x;
-static int _y;
-
-static void
-tex_ARGB1555(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    out->r = ((val & 0x7c00) >> 7) | ((val & 0x7000) >> 12);
-    out->g = ((val & 0x03e0) >> 2) | ((val & 0x0380) >> 7);
-    out->b = ((val & 0x001f) << 3) | ((val & 0x001c) >> 2);
-    out->a = (val & 0x8000) ? 0xff : 0;
-}
-
-static void
-tex_ARGB1555_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    if (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000)
-        val = state->tex_bdr_clr;
-
-    out->r = ((val & 0x7c00) >> 7) | ((val & 0x7000) >> 12);
-    out->g = ((val & 0x03e0) >> 2) | ((val & 0x0380) >> 7);
-    out->b = ((val & 0x001f) << 3) | ((val & 0x001c) >> 2);
-    out->a = (val & 0x8000) ? 0xff : 0;
-}
-
-static void
-tex_ARGB4444(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    out->r = ((val & 0x0f00) >> 4) | ((val & 0x0f00) >> 8);
-    out->g = (val & 0x00f0) | ((val & 0x00f0) >> 4);
-    out->b = ((val & 0x000f) << 4) | (val & 0x000f);
-    out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
-}
-
-static void
-tex_ARGB4444_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                 (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint16_t val = state->texture[texture_state->level][offset];
-
-    if (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000)
-        val = state->tex_bdr_clr;
+/*The texture format, sampling mode and lighting mode are constants in each
+  tri_* instance below, so every combination gets its own inner loop with no
+  indirect calls per pixel*/
+#if defined(__GNUC__) || defined(__clang__)
+#    define S3D_INLINE __attribute__((always_inline)) static __inline
+#else
+#    define S3D_INLINE static __inline
+#endif
 
-    out->r = ((val & 0x0f00) >> 4) | ((val & 0x0f00) >> 8);
-    out->g = (val & 0x00f0) | ((val & 0x00f0) >> 4);
-    out->b = ((val & 0x000f) << 4) | (val & 0x000f);
-    out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
-}
+enum {
+    TEX_ARGB8888 = 0,
+    TEX_ARGB4444,
+    TEX_ARGB1555,
+    TEX_FORMATS
+};
 
-static void
-tex_ARGB8888(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
-{
-    int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
-                  (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint32_t val = ((uint32_t *)state->texture[texture_state->level])[offset];
+#define TEX_SAMPLE_PERSP  1
+#define TEX_SAMPLE_MIPMAP 2
+#define TEX_SAMPLE_FILTER 4
+#define TEX_SAMPLE_MODES  8
 
-    out->r = (val >> 16) & 0xff;
-    out->g = (val >> 8) & 0xff;
-    out->b = val & 0xff;
-    out->a = (val >> 24) & 0xff;
-}
+enum {
+    DEST_LIT_TEXTURE_REFLECTION = 0,
+    DEST_LIT_TEXTURE_MODULATE,
+    DEST_TEXTURE_DECAL, /*Also unlit texture*/
+    DEST_TEXTURE_MODES,
+    DEST_GOURAUD_SHADED = DEST_TEXTURE_MODES
+};
 
-static void
-tex_ARGB8888_nowrap(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out)
+S3D_INLINE void
+tex_read(s3d_state_t *state, s3d_texture_state_t *texture_state, rgba_t *out, const int format)
 {
     int offset = ((texture_state->u & 0x7fc0000) >> texture_state->texture_shift) +
                  (((texture_state->v & 0x7fc0000) >> texture_state->texture_shift) << texture_state->level);
-    uint32_t val = ((uint32_t *)state->texture[texture_state->level])[offset];
-
-    if (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000)
-        val = state->tex_bdr_clr;
-
-    out->r = (val >> 16) & 0xff;
-    out->g = (val >> 8) & 0xff;
-    out->b = val & 0xff;
-    out->a = (val >> 24) & 0xff;
-}
-
-static void
-tex_sample_normal(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = state->u + state->tbu;
-    texture_state.v             = state->v + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_normal_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_mipmap(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = state->u + state->tbu;
-    texture_state.v             = state->v + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_mipmap_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (texture_state.u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (texture_state.v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = state->u + state->tbu;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = state->u + state->tbu + tex_offset;
-    texture_state.v = state->v + state->tbv + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_persp_normal(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_persp_normal_filter(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-    int32_t             u;
-    int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_persp_normal_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
-
-static void
-tex_sample_persp_normal_filter_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-    int32_t             u;
-    int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
-
-    texture_state.level         = state->max_d;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
-
-static void
-tex_sample_persp_mipmap(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
+    uint32_t val;
 
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
+    if (format == TEX_ARGB8888)
+        val = ((uint32_t *) state->texture[texture_state->level])[offset];
+    else
+        val = state->texture[texture_state->level][offset];
 
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
+    if (!(state->cmd_set & CMD_SET_TWE) && (((texture_state->u | texture_state->v) & 0xf8000000) == 0xf8000000))
+        val = (format == TEX_ARGB8888) ? state->tex_bdr_clr : (state->tex_bdr_clr & 0xffff);
 
-    tex_read(state, &texture_state, &state->dest_rgba);
+    switch (format) {
+        case TEX_ARGB8888:
+            out->r = (val >> 16) & 0xff;
+            out->g = (val >> 8) & 0xff;
+            out->b = val & 0xff;
+            out->a = (val >> 24) & 0xff;
+            break;
+        case TEX_ARGB4444:
+            out->r = ((val & 0x0f00) >> 4) | ((val & 0x0f00) >> 8);
+            out->g = (val & 0x00f0) | ((val & 0x00f0) >> 4);
+            out->b = ((val & 0x000f) << 4) | (val & 0x000f);
+            out->a = ((val & 0xf000) >> 8) | ((val & 0xf000) >> 12);
+            break;
+        default:
+            out->r = ((val & 0x7c00) >> 7) | ((val & 0x7000) >> 12);
+            out->g = ((val & 0x03e0) >> 2) | ((val & 0x0380) >> 7);
+            out->b = ((val & 0x001f) << 3) | ((val & 0x001c) >> 2);
+            out->a = (val & 0x8000) ? 0xff : 0;
+            break;
+    }
 }
 
-static void
-tex_sample_persp_mipmap_filter(s3d_state_t *state)
+S3D_INLINE void
+tex_sample(s3d_state_t *state, const int format, const int mode)
 {
     s3d_texture_state_t texture_state;
-    int32_t             w = 0;
     int32_t             u;
     int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
 
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (12 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (12 + state->max_d)) + state->tbv;
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
-}
+    if (mode & TEX_SAMPLE_PERSP) {
+        int32_t w = 0;
 
-static void
-tex_sample_persp_mipmap_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
+        if (state->w)
+            w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
 
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
+        u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (state->persp_shift + state->max_d)) + state->tbu;
+        v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (state->persp_shift + state->max_d)) + state->tbv;
+    } else {
+        u = state->u + state->tbu;
+        v = state->v + state->tbv;
+    }
 
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
+    if (mode & TEX_SAMPLE_MIPMAP) {
+        texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
+        if (texture_state.level < 0)
+            texture_state.level = 0;
+    } else
+        texture_state.level = state->max_d;
     texture_state.texture_shift = 18 + (9 - texture_state.level);
-    texture_state.u             = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    texture_state.v             = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
-
-    tex_read(state, &texture_state, &state->dest_rgba);
-}
 
-static void
-tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
-{
-    s3d_texture_state_t texture_state;
-    int32_t             w = 0;
-    int32_t             u;
-    int32_t             v;
-    int                 tex_offset;
-    rgba_t              tex_samples[4];
-    int                 du;
-    int                 dv;
-    int                 d[4];
-
-    if (state->w)
-        w = (int32_t) (((1ULL << 27) << 19) / (int64_t) state->w);
-
-    u = (int32_t) (((int64_t) state->u * (int64_t) w) >> (8 + state->max_d)) + state->tbu;
-    v = (int32_t) (((int64_t) state->v * (int64_t) w) >> (8 + state->max_d)) + state->tbv;
-
-    texture_state.level = (state->d < 0) ? state->max_d : state->max_d - ((state->d >> 27) & 0xf);
-    if (texture_state.level < 0)
-        texture_state.level = 0;
-    texture_state.texture_shift = 18 + (9 - texture_state.level);
-    tex_offset                  = 1 << texture_state.texture_shift;
-
-    texture_state.u = u;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[0]);
-    du = (u >> (texture_state.texture_shift - 8)) & 0xff;
-    dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v;
-    tex_read(state, &texture_state, &tex_samples[1]);
-
-    texture_state.u = u;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[2]);
-
-    texture_state.u = u + tex_offset;
-    texture_state.v = v + tex_offset;
-    tex_read(state, &texture_state, &tex_samples[3]);
-
-    d[0] = (256 - du) * (256 - dv);
-    d[1] = du * (256 - dv);
-    d[2] = (256 - du) * dv;
-    d[3] = du * dv;
-
-    state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
-                          tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
-    state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
-                          tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
-    state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
-                          tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
-    state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
-                          tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
+    if (mode & TEX_SAMPLE_FILTER) {
+        int    tex_offset = 1 << texture_state.texture_shift;
+        rgba_t tex_samples[4];
+        int    du;
+        int    dv;
+        int    d[4];
+
+        texture_state.u = u;
+        texture_state.v = v;
+        tex_read(state, &texture_state, &tex_samples[0], format);
+        du = (u >> (texture_state.texture_shift - 8)) & 0xff;
+        dv = (v >> (texture_state.texture_shift - 8)) & 0xff;
+
+        texture_state.u = u + tex_offset;
+        texture_state.v = v;
+        tex_read(state, &texture_state, &tex_samples[1], format);
+
+        texture_state.u = u;
+        texture_state.v = v + tex_offset;
+        tex_read(state, &texture_state, &tex_samples[2], format);
+
+        texture_state.u = u + tex_offset;
+        texture_state.v = v + tex_offset;
+        tex_read(state, &texture_state, &tex_samples[3], format);
+
+        d[0] = (256 - du) * (256 - dv);
+        d[1] = du * (256 - dv);
+        d[2] = (256 - du) * dv;
+        d[3] = du * dv;
+
+        state->dest_rgba.r = (tex_samples[0].r * d[0] + tex_samples[1].r * d[1] +
+                              tex_samples[2].r * d[2] + tex_samples[3].r * d[3]) >> 16;
+        state->dest_rgba.g = (tex_samples[0].g * d[0] + tex_samples[1].g * d[1] +
+                              tex_samples[2].g * d[2] + tex_samples[3].g * d[3]) >> 16;
+        state->dest_rgba.b = (tex_samples[0].b * d[0] + tex_samples[1].b * d[1] +
+                              tex_samples[2].b * d[2] + tex_samples[3].b * d[3]) >> 16;
+        state->dest_rgba.a = (tex_samples[0].a * d[0] + tex_samples[1].a * d[1] +
+                              tex_samples[2].a * d[2] + tex_samples[3].a * d[3]) >> 16;
+    } else {
+        texture_state.u = u;
+        texture_state.v = v;
+        tex_read(state, &texture_state, &state->dest_rgba, format);
+    }
 }
 
 #define CLAMP(x)                      \
@@ -4045,77 +3690,83 @@ tex_sample_persp_mipmap_filter_375(s3d_state_t *state)
             b = 0xff;      \
     } while (0)
 
-static void
-dest_pixel_gouraud_shaded_triangle(s3d_state_t *state)
+S3D_INLINE void
+dest_pixel(s3d_state_t *state, const int format, const int mode, const int lighting)
 {
-    state->dest_rgba.r = state->r >> 7;
-    CLAMP(state->dest_rgba.r);
+    int r;
+    int g;
+    int b;
+    int a;
 
-    state->dest_rgba.g = state->g >> 7;
-    CLAMP(state->dest_rgba.g);
+    switch (lighting) {
+        case DEST_GOURAUD_SHADED:
+            state->dest_rgba.r = state->r >> 7;
+            CLAMP(state->dest_rgba.r);
 
-    state->dest_rgba.b = state->b >> 7;
-    CLAMP(state->dest_rgba.b);
+            state->dest_rgba.g = state->g >> 7;
+            CLAMP(state->dest_rgba.g);
 
-    state->dest_rgba.a = state->a >> 7;
-    CLAMP(state->dest_rgba.a);
-}
+            state->dest_rgba.b = state->b >> 7;
+            CLAMP(state->dest_rgba.b);
 
-static void
-dest_pixel_unlit_texture_triangle(s3d_state_t *state)
-{
-    tex_sample(state);
+            state->dest_rgba.a = state->a >> 7;
+            CLAMP(state->dest_rgba.a);
+            break;
 
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a = state->a >> 7;
-}
+        case DEST_TEXTURE_DECAL:
+            tex_sample(state, format, mode);
 
-static void
-dest_pixel_lit_texture_decal(s3d_state_t *state)
-{
-    tex_sample(state);
+            if (state->cmd_set & CMD_SET_ABC_SRC)
+                state->dest_rgba.a = state->a >> 7;
+            break;
 
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a = state->a >> 7;
-}
+        case DEST_LIT_TEXTURE_REFLECTION:
+            tex_sample(state, format, mode);
 
-static void
-dest_pixel_lit_texture_reflection(s3d_state_t *state)
-{
-    tex_sample(state);
+            state->dest_rgba.r += (state->r >> 7);
+            state->dest_rgba.g += (state->g >> 7);
+            state->dest_rgba.b += (state->b >> 7);
+            if (state->cmd_set & CMD_SET_ABC_SRC)
+                state->dest_rgba.a += (state->a >> 7);
 
-    state->dest_rgba.r += (state->r >> 7);
-    state->dest_rgba.g += (state->g >> 7);
-    state->dest_rgba.b += (state->b >> 7);
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a += (state->a >> 7);
+            CLAMP_RGBA(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, state->dest_rgba.a);
+            break;
 
-    CLAMP_RGBA(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, state->dest_rgba.a);
-}
+        case DEST_LIT_TEXTURE_MODULATE:
+            r = state->r >> 7;
+            g = state->g >> 7;
+            b = state->b >> 7;
+            a = state->a >> 7;
 
-static void
-dest_pixel_lit_texture_modulate(s3d_state_t *state)
-{
-    int r = state->r >> 7;
-    int g = state->g >> 7;
-    int b = state->b >> 7;
-    int a = state->a >> 7;
+            tex_sample(state, format, mode);
 
-    tex_sample(state);
+            CLAMP_RGBA(r, g, b, a);
 
-    CLAMP_RGBA(r, g, b, a);
+            state->dest_rgba.r = ((state->dest_rgba.r) * r) >> 8;
+            state->dest_rgba.g = ((state->dest_rgba.g) * g) >> 8;
+            state->dest_rgba.b = ((state->dest_rgba.b) * b) >> 8;
 
-    state->dest_rgba.r = ((state->dest_rgba.r) * r) >> 8;
-    state->dest_rgba.g = ((state->dest_rgba.g) * g) >> 8;
-    state->dest_rgba.b = ((state->dest_rgba.b) * b) >> 8;
+            if (state->cmd_set & CMD_SET_ABC_SRC)
+                state->dest_rgba.a = a;
+            break;
 
-    if (state->cmd_set & CMD_SET_ABC_SRC)
-        state->dest_rgba.a = a;
+        default:
+            break;
+    }
 }
 
-static void
-tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2)
+/*Render thread responsible for the given line*/
+static __inline int
+s3_virge_band_thread(virge_t *virge, int y)
+{
+    return (int) (((unsigned int) y >> VIRGE_BAND_SHIFT) % (unsigned int) virge->render_threads);
+}
+
+S3D_INLINE void
+tri(virge_render_ctx_t *ctx, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2,
+    const int format, const int mode, const int lighting)
 {
+    virge_t *virge   = ctx->virge;
     uint8_t *vram    = virge->svga.vram;
     int      x_dir   = s3d_tri->tlr ? 1 : -1;
     int      use_z   = !(s3d_tri->cmd_set & CMD_SET_ZB_MODE);
@@ -4124,6 +3775,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
     uint32_t dest_offset;
     uint32_t z_offset;
 
+
     dest_offset = s3d_tri->dest_base + (state->y * s3d_tri->dest_str);
     z_offset    = s3d_tri->z_base + (state->y * s3d_tri->z_str);
 
@@ -4148,8 +3800,8 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
             state->x1 += (dx1 * diff_y);
             state->x2 += (dx2 * diff_y);
             state->y -= diff_y;
-            dest_offset -= s3d_tri->dest_str;
-            z_offset -= s3d_tri->z_str;
+            dest_offset -= (s3d_tri->dest_str * diff_y);
+            z_offset -= (s3d_tri->z_str * diff_y);
             y_count -= diff_y;
         }
         if ((state->y - y_count) < s3d_tri->clip_t)
@@ -4161,6 +3813,9 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
         int      xe = (state->x2 + ((1 << 20) - 1)) >> 20;
         uint32_t z  = (state->base_z > 0) ? (state->base_z << 1) : 0;
 
+        if ((virge->render_threads > 1) && (s3_virge_band_thread(virge, state->y) != ctx->thread))
+            goto tri_skip_line;
+
         if (x_dir < 0) {
             x--;
             xe--;
@@ -4246,9 +3901,6 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 int      update = 1;
                 uint16_t src_z  = 0;
 
-                _x = x;
-                _y = state->y;
-
                 if (use_z) {
                     src_z = Z_READ(z_addr);
                     Z_CLIP(src_z, z >> 16);
@@ -4257,7 +3909,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 if (update) {
                     uint32_t dest_col;
 
-                    dest_pixel(state);
+                    dest_pixel(state, format, mode, lighting);
 
                     if (s3d_tri->cmd_set & CMD_SET_FE) {
                         int a              = state->a >> 7;
@@ -4296,7 +3948,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                             /*Not implemented yet*/
                             break;
                         case 1: /*16 bpp*/
-                            RGB15(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, dest_col);
+                            RGB15(state->dest_rgba.r, state->dest_rgba.g, state->dest_rgba.b, x, state->y, dest_col);
                             *(uint16_t *) &vram[dest_addr] = dest_col;
                             break;
                         case 2: /*24 bpp*/
@@ -4322,7 +3974,7 @@ tri(virge_t *virge, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int
                 state->w += s3d_tri->TdWdX;
                 dest_addr += x_offset;
                 z_addr += xz_offset;
-                virge->pixel_count++;
+                ctx->pixel_count++;
             }
         }
 
@@ -4344,12 +3996,66 @@ tri_skip_line:
     }
 }
 
+typedef void (*tri_func_t)(virge_render_ctx_t *ctx, s3d_t *s3d_tri, s3d_state_t *state, int yc, int32_t dx1, int32_t dx2);
+
+#define TRI_FUNC(format, mode, lighting)                                                      \
+    static void                                                                               \
+    tri_##format##_##mode##_##lighting(virge_render_ctx_t *ctx, s3d_t *s3d_tri,               \
+                                       s3d_state_t *state, int yc, int32_t dx1, int32_t dx2)  \
+    {                                                                                         \
+        tri(ctx, s3d_tri, state, yc, dx1, dx2, format, mode, lighting);                       \
+    }
+
+#define TRI_FUNC_LIGHTING(format, mode) \
+    TRI_FUNC(format, mode, 0)           \
+    TRI_FUNC(format, mode, 1)           \
+    TRI_FUNC(format, mode, 2)
+
+#define TRI_FUNC_MODE(format)     \
+    TRI_FUNC_LIGHTING(format, 0)  \
+    TRI_FUNC_LIGHTING(format, 1)  \
+    TRI_FUNC_LIGHTING(format, 2)  \
+    TRI_FUNC_LIGHTING(format, 3)  \
+    TRI_FUNC_LIGHTING(format, 4)  \
+    TRI_FUNC_LIGHTING(format, 5)  \
+    TRI_FUNC_LIGHTING(format, 6)  \
+    TRI_FUNC_LIGHTING(format, 7)
+
+/*Indexed by TEX_ARGB*, TEX_SAMPLE_* and DEST_* respectively*/
+TRI_FUNC_MODE(0)
+TRI_FUNC_MODE(1)
+TRI_FUNC_MODE(2)
+/*Untextured, the texture format and sampling mode are unused*/
+TRI_FUNC(0, 0, 3)
+
+#define TRI_ENTRY_LIGHTING(format, mode) \
+    { tri_##format##_##mode##_0, tri_##format##_##mode##_1, tri_##format##_##mode##_2 }
+
+#define TRI_ENTRY_MODE(format)                                                   \
+    {                                                                            \
+        TRI_ENTRY_LIGHTING(format, 0), TRI_ENTRY_LIGHTING(format, 1),           \
+        TRI_ENTRY_LIGHTING(format, 2), TRI_ENTRY_LIGHTING(format, 3),           \
+        TRI_ENTRY_LIGHTING(format, 4), TRI_ENTRY_LIGHTING(format, 5),           \
+        TRI_ENTRY_LIGHTING(format, 6), TRI_ENTRY_LIGHTING(format, 7)            \
+    }
+
+static const tri_func_t tri_textured[TEX_FORMATS][TEX_SAMPLE_MODES][DEST_TEXTURE_MODES] = {
+    TRI_ENTRY_MODE(0),
+    TRI_ENTRY_MODE(1),
+    TRI_ENTRY_MODE(2)
+};
+
 static int tex_size[8] = { 4 * 2, 2 * 2, 2 * 2, 1 * 2, 2 / 1, 2 / 1, 1 * 2, 1 * 2 };
 
 static void
-s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
+s3_virge_triangle(virge_render_ctx_t *ctx, s3d_t *s3d_tri)
 {
+    virge_t    *virge = ctx->virge;
     s3d_state_t state;
+    tri_func_t  tri_func;
+    int         format;
+    int         mode;
+    int         lighting;
 
     uint32_t tex_base;
     int      c;
@@ -4385,19 +4091,19 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
 
     switch ((s3d_tri->cmd_set >> 27) & 0xf) {
         case 0:
-            dest_pixel = dest_pixel_gouraud_shaded_triangle;
+            lighting = DEST_GOURAUD_SHADED;
             break;
         case 1:
         case 5:
             switch ((s3d_tri->cmd_set >> 15) & 0x3) {
                 case 0:
-                    dest_pixel = dest_pixel_lit_texture_reflection;
+                    lighting = DEST_LIT_TEXTURE_REFLECTION;
                     break;
                 case 1:
-                    dest_pixel = dest_pixel_lit_texture_modulate;
+                    lighting = DEST_LIT_TEXTURE_MODULATE;
                     break;
                 case 2:
-                    dest_pixel = dest_pixel_lit_texture_decal;
+                    lighting = DEST_TEXTURE_DECAL;
                     break;
                 default:
                     return;
@@ -4405,126 +4111,181 @@ s3_virge_triangle(virge_t *virge, s3d_t *s3d_tri)
             break;
         case 2:
         case 6:
-            dest_pixel = dest_pixel_unlit_texture_triangle;
+            lighting = DEST_TEXTURE_DECAL;
             break;
         default:
             return;
     }
 
-    switch (((s3d_tri->cmd_set >> 12) & 7) | ((s3d_tri->cmd_set & (1 << 29)) ? 8 : 0)) {
-        case 0:
-        case 1:
-            tex_sample = tex_sample_mipmap;
-            break;
-        case 2:
-        case 3:
-            tex_sample = virge->bilinear_enabled ? tex_sample_mipmap_filter : tex_sample_mipmap;
-            break;
-        case 4:
-        case 5:
-            tex_sample = tex_sample_normal;
-            break;
-        case 6:
-        case 7:
-            tex_sample = virge->bilinear_enabled ? tex_sample_normal_filter : tex_sample_normal;
-            break;
-        case (0 | 8):
-        case (1 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_mipmap_375;
-            else
-                tex_sample = tex_sample_persp_mipmap;
-            break;
-        case (2 | 8):
-        case (3 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter_375 :
-                                                       tex_sample_persp_mipmap_375;
-            else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_mipmap_filter :
-                                                       tex_sample_persp_mipmap;
-            break;
-        case (4 | 8):
-        case (5 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = tex_sample_persp_normal_375;
-            else
-                tex_sample = tex_sample_persp_normal;
-            break;
-        case (6 | 8):
-        case (7 | 8):
-            if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter_375 :
-                                                       tex_sample_persp_normal_375;
-            else
-                tex_sample = virge->bilinear_enabled ? tex_sample_persp_normal_filter :
-                                                       tex_sample_persp_normal;
-            break;
-    }
+    mode = (s3d_tri->cmd_set & (1 << 29)) ? TEX_SAMPLE_PERSP : 0;
+    if (!(s3d_tri->cmd_set & (4 << 12)))
+        mode |= TEX_SAMPLE_MIPMAP;
+    if ((s3d_tri->cmd_set & (2 << 12)) && virge->bilinear_enabled)
+        mode |= TEX_SAMPLE_FILTER;
+
+    if ((virge->chip == S3_VIRGEDX) || (virge->chip >= S3_VIRGEGX2))
+        state.persp_shift = 8;
+    else
+        state.persp_shift = 12;
 
     switch ((s3d_tri->cmd_set >> 5) & 7) {
         case 0:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB8888 : tex_ARGB8888_nowrap;
+            format = TEX_ARGB8888;
             break;
         case 1:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB4444 : tex_ARGB4444_nowrap;
-            break;
-        case 2:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            format = TEX_ARGB4444;
             break;
         default:
-            tex_read = (s3d_tri->cmd_set & CMD_SET_TWE) ? tex_ARGB1555 : tex_ARGB1555_nowrap;
+            format = TEX_ARGB1555;
             break;
     }
 
+    if (lighting == DEST_GOURAUD_SHADED)
+        tri_func = tri_0_0_3;
+    else
+        tri_func = tri_textured[format][mode][lighting];
+
     state.y  = s3d_tri->tys;
     state.x1 = s3d_tri->txs;
     state.x2 = s3d_tri->txend01;
-    tri(virge, s3d_tri, &state, s3d_tri->ty01, s3d_tri->TdXdY02, s3d_tri->TdXdY01);
+    tri_func(ctx, s3d_tri, &state, s3d_tri->ty01, s3d_tri->TdXdY02, s3d_tri->TdXdY01);
     state.x2 = s3d_tri->txend12;
-    tri(virge, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
-
-    virge->tri_count++;
+    tri_func(ctx, s3d_tri, &state, s3d_tri->ty12, s3d_tri->TdXdY02, s3d_tri->TdXdY12);
 
     end_time = plat_timer_read();
 
     virge_time += end_time - start_time;
 }
 
+/*Returns non-zero if any line of the triangle falls in a band rendered by
+  this thread*/
+static int
+s3_virge_triangle_in_bands(virge_render_ctx_t *ctx, s3d_t *s3d_tri)
+{
+    virge_t *virge = ctx->virge;
+    int      last  = (int) s3d_tri->tys;
+    int      first = last - (s3d_tri->ty01 + s3d_tri->ty12) + 1;
+
+    if (virge->render_threads == 1)
+        return 1;
+    if (first > last)
+        return 0;
+    if (first < 0)
+        return 1;
+
+    first >>= VIRGE_BAND_SHIFT;
+    last >>= VIRGE_BAND_SHIFT;
+    if ((last - first) >= (virge->render_threads - 1))
+        return 1;
+
+    for (int band = first; band <= last; band++) {
+        if ((band % virge->render_threads) == ctx->thread)
+            return 1;
+    }
+
+    return 0;
+}
+
 static void
 render_thread(void *param)
 {
-    virge_t *virge = (virge_t *) param;
+    virge_render_ctx_t *ctx    = (virge_render_ctx_t *) param;
+    virge_t            *virge  = ctx->virge;
+    int                 thread = ctx->thread;
 
     while (virge->render_thread_run) {
-        thread_wait_event(virge->wake_render_thread, -1);
-        thread_reset_event(virge->wake_render_thread);
-        virge->s3d_busy = 1;
-        while (!RB_EMPTY) {
-            s3_virge_triangle(virge, &virge->s3d_buffer[virge->s3d_read_idx & RB_MASK]);
-            virge->s3d_read_idx++;
-
-            if (RB_ENTRIES == RB_MASK)
-                thread_set_event(virge->not_full_event);
+        thread_wait_event(virge->wake_render_thread[thread], -1);
+        thread_reset_event(virge->wake_render_thread[thread]);
+        virge->s3d_busy[thread] = 1;
+        if (!RB_EMPTY(thread))
+            atomic_store(&virge->s3d_done_pending, 1);
+        while (!RB_EMPTY(thread)) {
+            s3d_t *s3d_tri = &virge->s3d_buffer[virge->s3d_read_idx[thread] & RB_MASK];
+
+            if (s3_virge_triangle_in_bands(ctx, s3d_tri))
+                s3_virge_triangle(ctx, s3d_tri);
+            virge->s3d_read_idx[thread]++;
+
+            if (RB_ENTRIES(thread) == RB_MASK)
+                thread_set_event(virge->not_full_event[thread]);
         }
-        virge->s3d_busy = 0;
-        virge->subsys_stat |= INT_S3D_DONE;
-        virge->irq_pending++;
+        virge->s3d_busy[thread] = 0;
+        atomic_thread_fence(memory_order_seq_cst);
+        /*Once every thread is idle the interrupt is raised. Several threads
+          can see that at the same time, so only the one that claims the
+          pending completion raises it*/
+        if (!s3_virge_render_busy(virge) && atomic_exchange(&virge->s3d_done_pending, 0)) {
+            virge->subsys_stat |= INT_S3D_DONE;
+            virge->irq_pending++;
+        }
+    }
+}
+
+static void
+s3_virge_render_threads_init(virge_t *virge)
+{
+    if (!virge->render_threads)
+        virge->render_threads = plat_get_cpu_count();
+    if (virge->render_threads < 1)
+        virge->render_threads = 1;
+    else if (virge->render_threads > VIRGE_MAX_RENDER_THREADS)
+        virge->render_threads = VIRGE_MAX_RENDER_THREADS;
+
+    virge->render_thread_run = 1;
+    virge->wake_main_thread  = thread_create_event();
+    for (int c = 0; c < virge->render_threads; c++) {
+        virge->render_ctx[c].virge  = virge;
+        virge->render_ctx[c].thread = c;
+
+        virge->wake_render_thread[c] = thread_create_event();
+        virge->not_full_event[c]     = thread_create_event();
+        virge->render_thread[c]      = thread_create(render_thread, &virge->render_ctx[c]);
+    }
+}
+
+static void
+s3_virge_render_threads_close(virge_t *virge)
+{
+    virge->render_thread_run = 0;
+    for (int c = 0; c < virge->render_threads; c++) {
+        thread_set_event(virge->wake_render_thread[c]);
+        thread_wait(virge->render_thread[c]);
+        thread_destroy_event(virge->not_full_event[c]);
+        thread_destroy_event(virge->wake_render_thread[c]);
+    }
+    thread_destroy_event(virge->wake_main_thread);
+}
+
+static int
+s3_virge_render_full(virge_t *virge)
+{
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (RB_FULL(c))
+            return 1;
     }
+
+    return 0;
 }
 
 static void
 queue_triangle(virge_t *virge)
 {
-    if (RB_FULL) {
-        thread_reset_event(virge->not_full_event);
-        if (RB_FULL)
-            thread_wait_event(virge->not_full_event, -1); /*Wait for room in ringbuffer*/
+    while (s3_virge_render_full(virge)) {
+        for (int c = 0; c < virge->render_threads; c++)
+            thread_reset_event(virge->not_full_event[c]);
+        for (int c = 0; c < virge->render_threads; c++) {
+            if (RB_FULL(c))
+                thread_wait_event(virge->not_full_event[c], -1); /*Wait for room in ringbuffer*/
+        }
     }
     virge->s3d_buffer[virge->s3d_write_idx & RB_MASK] = virge->s3d_tri;
     virge->s3d_write_idx++;
-    if (!virge->s3d_busy)
-        thread_set_event(virge->wake_render_thread); /*Wake up render thread if moving from idle*/
+    virge->tri_count++;
+
+    for (int c = 0; c < virge->render_threads; c++) {
+        if (!virge->s3d_busy[c] || (RB_ENTRIES(c) < 4))
+            thread_set_event(virge->wake_render_thread[c]); /*Wake up render thread if moving from idle*/
+    }
 }
 
 static void
@@ -5314,9 +5075,11 @@ s3_virge_reset(void *priv)
         dev->virge_busy       = 0;
         dev->fifo_write_idx   = 0;
         dev->fifo_read_idx    = 0;
-        dev->s3d_busy         = 0;
+        for (int c = 0; c < dev->render_threads; c++) {
+            dev->s3d_busy[c]     = 0;
+            dev->s3d_read_idx[c] = 0;
+        }
         dev->s3d_write_idx    = 0;
-        dev->s3d_read_idx     = 0;
         reset_state->pci_slot = dev->pci_slot;
 
         *dev = *reset_state;
@@ -5334,6 +5097,7 @@ s3_virge_init(const device_t *info)
 
     virge->bilinear_enabled  = device_get_config_int("bilinear");
     virge->dithering_enabled = device_get_config_int("dithering");
+    virge->render_threads    = device_get_config_int("render_threads");
     if (virge->type >= S3_VIRGE_GX2)
         virge->memory_size = 4;
     else
@@ -5567,11 +5331,7 @@ s3_virge_init(const device_t *info)
 
     virge->svga.force_old_addr = 1;
 
-    virge->render_thread_run  = 1;
-    virge->wake_render_thread = thread_create_event();
-    virge->wake_main_thread   = thread_create_event();
-    virge->not_full_event     = thread_create_event();
-    virge->render_thread      = thread_create(render_thread, virge);
+    s3_virge_render_threads_init(virge);
 
     virge->fifo_thread_run     = 1;
     virge->wake_fifo_thread    = thread_create_event();
@@ -5592,12 +5352,7 @@ s3_virge_close(void *priv)
 {
     virge_t *virge = (virge_t *) priv;
 
-    virge->render_thread_run = 0;
-    thread_set_event(virge->wake_render_thread);
-    thread_wait(virge->render_thread);
-    thread_destroy_event(virge->not_full_event);
-    thread_destroy_event(virge->wake_main_thread);
-    thread_destroy_event(virge->wake_render_thread);
+    s3_virge_render_threads_close(virge);
 
     virge->fifo_thread_run = 0;
     thread_set_event(virge->wake_fifo_thread);
@@ -5745,6 +5500,25 @@ static const device_config_t s3_virge_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5797,6 +5571,25 @@ static const device_config_t s3_virge_stb_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5850,6 +5643,25 @@ static const device_config_t s3_virge_357_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
@@ -5904,6 +5716,25 @@ static const device_config_t s3_trio3d2x_config[] = {
         .selection      = { { 0 } },
         .bios           = { { 0 } }
     },
+    {
+        .name           = "render_threads",
+        .description    = "Render threads",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
     { .name = "", .description = "", .type = CONFIG_END }
     // clang-format on
 };
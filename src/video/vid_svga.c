@@ -35,6 +35,7 @@
 #include <86box/mem.h>
 #include <86box/rom.h>
 #include <86box/plat.h>
+#include <86box/thread.h>
 #include <86box/ui.h>
 #include <86box/video.h>
 #include <86box/vid_8514a.h>
@@ -43,8 +44,9 @@
 #include <86box/vid_svga_render.h>
 #include <86box/vid_xga_device.h>
 
-void svga_doblit(int wx, int wy, svga_t *svga);
-void svga_poll(void *priv);
+void     svga_doblit(int wx, int wy, svga_t *svga);
+void     svga_poll(void *priv);
+uint32_t svga_conv_16to32(struct svga_t *svga, uint16_t color, uint8_t bpp);
 
 svga_t *svga_8514;
 
@@ -97,6 +99,8 @@ svga_set_override(svga_t *svga, int val)
     xga_t     *xga = (xga_t *) svga->xga;
     uint8_t    ret_poll = 0;
 
+    svga_deferred_sync(svga);
+
     if (svga->override && !val)
         svga->fullchange = svga->monitor->mon_changeframecount;
 
@@ -1214,6 +1218,7 @@ svga_recalctimings(svga_t *svga)
             int x_add   = enable_overscan ? svga->monitor->mon_overscan_x : 0;
             int y_start = enable_overscan ? 0 : (svga->monitor->mon_overscan_y >> 1);
             int x_start = enable_overscan ? 0 : (svga->monitor->mon_overscan_x >> 1);
+            svga_deferred_sync(svga);
             video_wait_for_buffer_monitor(svga->monitor_index);
             memset(svga->monitor->target_buffer->dat, 0, (size_t) svga->monitor->target_buffer->w * svga->monitor->target_buffer->h * 4);
             video_blit_memtoscreen_monitor(x_start, y_start, svga->monitor->mon_xsize + x_add, svga->monitor->mon_ysize + y_add, svga->monitor_index);
@@ -1281,6 +1286,213 @@ svga_recalctimings(svga_t *svga)
     }
 }
 
+/* Lines latched by svga_poll() and waiting for the render thread. */
+#define SVGA_RENDER_QUEUE_SIZE 512
+#define SVGA_RENDER_QUEUE_MASK (SVGA_RENDER_QUEUE_SIZE - 1)
+#define SVGA_RENDER_WAKE_LINES 16
+
+typedef struct svga_render_line_t {
+    int      displine;
+    int      y_add;
+    int      x_add;
+    int      scrollcache;
+    int      scanline;
+    int      draw;
+    uint32_t memaddr;
+} svga_render_line_t;
+
+typedef struct svga_deferred_t {
+    /* Copy of the CRTC/DAC state the queued lines are rendered with. */
+    svga_t svga;
+    int    latched;
+
+    svga_render_line_t line[SVGA_RENDER_QUEUE_SIZE];
+    ATOMIC_INT         read_idx;
+    ATOMIC_INT         write_idx;
+    ATOMIC_INT         busy;
+    ATOMIC_INT         run;
+
+    thread_t *thread;
+    event_t  *wake_event;
+    event_t  *idle_event;
+} svga_deferred_t;
+
+/* Only the packed direct color renderers are handed to the render thread,
+   everything else depends on too much live CRTC/attribute state. */
+static int
+svga_render_deferrable(svga_t *svga)
+{
+    if ((svga->render != svga_render_15bpp_lowres) && (svga->render != svga_render_15bpp_highres) &&
+        (svga->render != svga_render_16bpp_lowres) && (svga->render != svga_render_16bpp_highres) &&
+        (svga->render != svga_render_24bpp_lowres) && (svga->render != svga_render_24bpp_highres) &&
+        (svga->render != svga_render_32bpp_lowres) && (svga->render != svga_render_32bpp_highres) &&
+        (svga->render != svga_render_ABGR8888_highres) && (svga->render != svga_render_RGBA8888_highres))
+        return 0;
+
+    return (svga->conv_16to32 == svga_conv_16to32);
+}
+
+/* Returns non-zero if a raster effect changed state the latched copy renders with. */
+static int
+svga_deferred_state_changed(svga_t *svga, svga_t *latched)
+{
+    if ((svga->render != latched->render) || (svga->hdisp != latched->hdisp) ||
+        (svga->left_overscan != latched->left_overscan) || (svga->overscan_color != latched->overscan_color) ||
+        (svga->scrblank != latched->scrblank) || (svga->vram_display_mask != latched->vram_display_mask) ||
+        (svga->force_old_addr != latched->force_old_addr) || (svga->remap_func != latched->remap_func) ||
+        (svga->remap_required != latched->remap_required) || (svga->lut_map != latched->lut_map))
+        return 1;
+
+    return svga->lut_map && memcmp(svga->pallook, latched->pallook, 256 * sizeof(uint32_t));
+}
+
+static void
+svga_render_thread(void *priv)
+{
+    svga_deferred_t    *deferred = (svga_deferred_t *) priv;
+    svga_t             *svga     = &deferred->svga;
+    svga_render_line_t *line;
+
+    while (deferred->run) {
+        thread_set_event(deferred->idle_event);
+        thread_wait_event(deferred->wake_event, -1);
+        thread_reset_event(deferred->wake_event);
+        deferred->busy = 1;
+
+        while (deferred->read_idx != deferred->write_idx) {
+            line = &deferred->line[deferred->read_idx & SVGA_RENDER_QUEUE_MASK];
+
+            svga->displine = line->displine;
+            svga->y_add    = line->y_add;
+            svga->scanline = line->scanline;
+            svga->memaddr  = line->memaddr;
+
+            if (line->draw) {
+                svga->x_add       = line->x_add;
+                svga->scrollcache = line->scrollcache;
+                svga->render(svga);
+            }
+
+            svga->x_add = svga->left_overscan;
+            svga_render_overscan_left(svga);
+            svga_render_overscan_right(svga);
+
+            deferred->read_idx++;
+        }
+
+        deferred->busy = 0;
+    }
+}
+
+/* Waits until the render thread has drawn every queued line, so the emulation
+   thread can touch the target buffer or the latched copy again. */
+void
+svga_deferred_sync(svga_t *svga)
+{
+    svga_deferred_t *deferred = svga->deferred;
+
+    if (deferred == NULL)
+        return;
+
+    while (deferred->read_idx != deferred->write_idx) {
+        thread_reset_event(deferred->idle_event);
+        thread_set_event(deferred->wake_event);
+        thread_wait_event(deferred->idle_event, 1);
+    }
+}
+
+/* Latches the current line for the render thread instead of drawing it,
+   returns 0 if the line has to be rendered inline. */
+static int
+svga_deferred_queue_line(svga_t *svga)
+{
+    svga_deferred_t    *deferred = svga->deferred;
+    svga_render_line_t *line;
+    uint32_t            changed_addr;
+    uint32_t            page;
+    uint32_t            last_page;
+
+    if (svga->override || svga->hwcursor_on || svga->dac_hwcursor_on || svga->overlay_on || !svga_render_deferrable(svga))
+        return 0;
+
+    if (!deferred->latched || svga_deferred_state_changed(svga, &deferred->svga)) {
+        svga_deferred_sync(svga);
+        memcpy(&deferred->svga, svga, sizeof(svga_t));
+        /* Dirty tracking is done here, the copy always draws what it is given. */
+        deferred->svga.fullchange = 1;
+        deferred->latched         = 1;
+    }
+
+    while ((deferred->write_idx - deferred->read_idx) >= SVGA_RENDER_QUEUE_SIZE) {
+        thread_reset_event(deferred->idle_event);
+        thread_set_event(deferred->wake_event);
+        thread_wait_event(deferred->idle_event, 1);
+    }
+
+    line = &deferred->line[deferred->write_idx & SVGA_RENDER_QUEUE_MASK];
+
+    line->displine    = svga->displine;
+    line->y_add       = svga->y_add;
+    line->x_add       = svga->x_add;
+    line->scrollcache = svga->scrollcache;
+    line->scanline    = svga->scanline;
+    line->memaddr     = svga->memaddr;
+    line->draw        = svga->fullchange;
+
+    if (!line->draw) {
+        /* Same pages the renderers check, changedvram gets cleared before the line is drawn. */
+        changed_addr = svga->force_old_addr ? svga->memaddr : svga->remap_func(svga, svga->memaddr);
+        last_page    = (svga->vram_mask >> 12) + 1;
+        for (page = changed_addr >> 12; (page <= ((changed_addr >> 12) + 2)) && (page <= last_page); page++)
+            line->draw |= svga->changedvram[page];
+    }
+
+    if (line->draw && ((svga->displine + svga->y_add) >= 0)) {
+        if (svga->firstline_draw == 2000)
+            svga->firstline_draw = svga->displine;
+        svga->lastline_draw = svga->displine;
+    }
+
+    deferred->write_idx++;
+    if (!deferred->busy && !(deferred->write_idx & (SVGA_RENDER_WAKE_LINES - 1)))
+        thread_set_event(deferred->wake_event);
+
+    svga->x_add = svga->left_overscan - svga->scrollcache;
+
+    return 1;
+}
+
+static void
+svga_deferred_init(svga_t *svga)
+{
+    svga_deferred_t *deferred = calloc(1, sizeof(svga_deferred_t));
+
+    deferred->run        = 1;
+    deferred->wake_event = thread_create_event();
+    deferred->idle_event = thread_create_event();
+    deferred->thread     = thread_create(svga_render_thread, deferred);
+
+    svga->deferred = deferred;
+}
+
+static void
+svga_deferred_close(svga_t *svga)
+{
+    svga_deferred_t *deferred = svga->deferred;
+
+    svga_deferred_sync(svga);
+
+    deferred->run = 0;
+    thread_set_event(deferred->wake_event);
+    thread_wait(deferred->thread);
+
+    thread_destroy_event(deferred->wake_event);
+    thread_destroy_event(deferred->idle_event);
+
+    free(deferred);
+    svga->deferred = NULL;
+}
+
 static void
 svga_do_render(svga_t *svga)
 {
@@ -1292,6 +1504,8 @@ svga_do_render(svga_t *svga)
 
     if (!svga->override) {
         svga->render_line_offset = svga->start_retrace_latch - svga->crtc[0x4];
+        if ((svga->deferred != NULL) && svga_deferred_queue_line(svga))
+            return;
         svga->render(svga);
     }
 
@@ -1560,6 +1774,12 @@ svga_poll(void *priv)
 
             wx = x;
 
+            if (svga->deferred != NULL) {
+                /* Every line of the frame has to be in the buffer before it is blitted. */
+                svga_deferred_sync(svga);
+                svga->deferred->latched = 0;
+            }
+
             if (!svga->override) {
                 if (svga->vertical_linedbl) {
                     wy = (svga->lastline - svga->firstline) << 1;
@@ -1763,12 +1983,19 @@ svga_init(const device_t *info, svga_t *svga, void *priv, int memsize,
 
     svga->map8            = svga->pallook;
 
+    svga->deferred = NULL;
+    if (video_deferred_render)
+        svga_deferred_init(svga);
+
     return 0;
 }
 
 void
 svga_close(svga_t *svga)
 {
+    if (svga->deferred != NULL)
+        svga_deferred_close(svga);
+
     free(svga->changedvram);
     free(svga->vram);
 
@@ -1128,7 +1128,7 @@ banshee_status(banshee_t *banshee)
     int           fifo_entries = FIFO_ENTRIES;
     int           swap_count   = voodoo->swap_count;
     int           written      = voodoo->cmd_written + voodoo->cmd_written_fifo;
-    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2) || voodoo->render_voodoo_busy[0] || voodoo->render_voodoo_busy[1] || voodoo->render_voodoo_busy[2] || voodoo->render_voodoo_busy[3] || voodoo->voodoo_busy;
+    int           busy         = (written - voodoo->cmd_read) || (voodoo->cmdfifo_depth_rd != voodoo->cmdfifo_depth_wr) || (voodoo->cmdfifo_depth_rd_2 != voodoo->cmdfifo_depth_wr_2) || voodoo_render_busy(voodoo) || voodoo->voodoo_busy;
     uint32_t      ret          = 0;
 
     if (fifo_entries < 0x20)
@@ -3884,14 +3884,35 @@ static const device_config_t banshee_sgram_config[] = {
         .description    = "Render threads",
         .type           = CONFIG_SELECTION,
         .default_string = NULL,
-        .default_int    = 2,
+        .default_int    = 0,
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = "32",   .value = 32 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "texture_cache_size",
+        .description    = "Texture cache size",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 128,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "64 textures",  .value = 64  },
+            { .description = "128 textures", .value = 128 },
+            { .description = "256 textures", .value = 256 },
+            { .description = "512 textures", .value = 512 },
+            { .description = ""                           }
         },
         .bios           = { { 0 } }
     },
@@ -3961,14 +3982,35 @@ static const device_config_t banshee_sgram_16mbonly_config[] = {
         .description    = "Render threads",
         .type           = CONFIG_SELECTION,
         .default_string = NULL,
-        .default_int    = 2,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = "32",   .value = 32 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "texture_cache_size",
+        .description    = "Texture cache size",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 128,
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "64 textures",  .value = 64  },
+            { .description = "128 textures", .value = 128 },
+            { .description = "256 textures", .value = 256 },
+            { .description = "512 textures", .value = 512 },
+            { .description = ""                           }
         },
         .bios           = { { 0 } }
     },
@@ -4038,14 +4080,35 @@ static const device_config_t banshee_sdram_config[] = {
         .description    = "Render threads",
         .type           = CONFIG_SELECTION,
         .default_string = NULL,
-        .default_int    = 2,
+        .default_int    = 0,
+        .file_filter    = NULL,
+        .spinner        = { 0 },
+        .selection      = {
+            { .description = "Auto", .value = 0  },
+            { .description = "1",    .value = 1  },
+            { .description = "2",    .value = 2  },
+            { .description = "4",    .value = 4  },
+            { .description = "8",    .value = 8  },
+            { .description = "16",   .value = 16 },
+            { .description = "32",   .value = 32 },
+            { .description = ""                  }
+        },
+        .bios           = { { 0 } }
+    },
+    {
+        .name           = "texture_cache_size",
+        .description    = "Texture cache size",
+        .type           = CONFIG_SELECTION,
+        .default_string = NULL,
+        .default_int    = 128,
         .file_filter    = NULL,
         .spinner        = { 0 },
         .selection      = {
-            { .description = "1", .value = 1 },
-            { .description = "2", .value = 2 },
-            { .description = "4", .value = 4 },
-            { .description = ""              }
+            { .description = "64 textures",  .value = 64  },
+            { .description = "128 textures", .value = 128 },
+            { .description = "256 textures", .value = 256 },
+            { .description = "512 textures", .value = 512 },
+            { .description = ""                           }
         },
         .bios           = { { 0 } }
     },
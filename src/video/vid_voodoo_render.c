@@ -661,6 +661,18 @@ voodoo_tmu_fetch_and_blend(voodoo_t *voodoo, voodoo_params_t *params, voodoo_sta
 int voodoo_recomp = 0;
 #endif
 
+#if !defined NO_CODEGEN && (defined __amd64__ || defined __i386__) && (defined __GNUC__ || defined __clang__)
+#    define VOODOO_SPAN_AVX2
+#    include <86box/vid_voodoo_span_avx2.h>
+#endif
+
+/*Render thread responsible for the given line*/
+static __inline int
+voodoo_tile_thread(voodoo_t *voodoo, int y)
+{
+    return (int) (((unsigned int) y >> VOODOO_TILE_SHIFT) % (unsigned int) voodoo->render_threads);
+}
+
 static void
 voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *state, int ystart, int yend, int odd_even)
 {
@@ -693,6 +705,9 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
     int texels;
 #ifndef NO_CODEGEN
     uint8_t (*voodoo_draw)(voodoo_state_t * state, voodoo_params_t * params, int x, int real_y);
+#endif
+#ifdef VOODOO_SPAN_AVX2
+    int span_avx2 = voodoo->use_recompiler && voodoo_span_avx2_supported(voodoo, params);
 #endif
     int y_diff   = SLI_ENABLED ? 2 : 1;
     int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
@@ -782,7 +797,12 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         }
     }
 #ifndef NO_CODEGEN
+#    ifdef VOODOO_SPAN_AVX2
+    /*The AVX2 path renders every line, so don't compile a block for it*/
+    if (voodoo->use_recompiler && !span_avx2)
+#    else
     if (voodoo->use_recompiler)
+#    endif
         voodoo_draw = voodoo_get_block(voodoo, params, state, odd_even);
     else
         voodoo_draw = NULL;
@@ -827,13 +847,8 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         else
             real_y >>= 4;
 
-        if (SLI_ENABLED) {
-            if (((real_y >> 1) & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        } else {
-            if ((real_y & voodoo->odd_even_mask) != odd_even)
-                goto next_line;
-        }
+        if ((voodoo->render_threads > 1) && (voodoo_tile_thread(voodoo, SLI_ENABLED ? (real_y >> 1) : real_y) != odd_even))
+            goto next_line;
 
         start_x = x;
 
@@ -933,6 +948,15 @@ voodoo_half_triangle(voodoo_t *voodoo, voodoo_params_t *params, voodoo_state_t *
         state->texel_count = 0;
         state->x           = x;
         state->x2          = x2;
+#ifdef VOODOO_SPAN_AVX2
+        if (span_avx2) {
+            int count = ((x2 > x) ? (x2 - x) : (x - x2)) + 1;
+
+            voodoo_span_avx2(voodoo, params, state, x, x2, real_y, fb_mem, aux_mem);
+            voodoo->pixel_count[odd_even] += count;
+            voodoo->texel_count[odd_even] += texels * count;
+        } else
+#endif
 #ifndef NO_CODEGEN
         if (voodoo->use_recompiler && voodoo_draw) {
             voodoo_draw(state, params, x, real_y);
@@ -1426,9 +1450,6 @@ next_line:
         state->xstart += state->dx1;
         state->xend += state->dx2;
     }
-
-    voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
-    voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
 }
 
 void
@@ -1448,8 +1469,6 @@ voodoo_triangle(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
 
     state.dx1 = state.dx2 = 0;
 
-    voodoo->tri_count++;
-
     dx = 8 - (params->vertexAx & 0xf);
     if ((params->vertexAx & 0xf) > 8)
         dx += 16;
@@ -1583,10 +1602,54 @@ voodoo_render_log("voodoo_triangle %i %i %i : vA %f, %f  vB %f, %f  vC %f, %f f
     voodoo_half_triangle(voodoo, params, &state, vertexAy_adjusted, vertexCy_adjusted, odd_even);
 }
 
+/*Returns non-zero if any line of the triangle falls in a tile rendered by this
+  thread. Lines above the top of the screen are not binned, so the triangle is
+  always rendered in that case*/
+static int
+voodoo_triangle_in_tiles(voodoo_t *voodoo, voodoo_params_t *params, int odd_even)
+{
+    int y_origin = (voodoo->type >= VOODOO_BANSHEE) ? voodoo->y_origin_swap : (voodoo->v_disp - 1);
+    int first;
+    int last;
+
+    if (voodoo->render_threads == 1)
+        return 1;
+    if (params->bin_yend <= params->bin_ystart)
+        return 0;
+
+    if (params->fbzMode & (1 << 17)) {
+        first = y_origin - (params->bin_yend - 1);
+        last  = y_origin - params->bin_ystart;
+    } else {
+        first = params->bin_ystart;
+        last  = params->bin_yend - 1;
+    }
+    if (SLI_ENABLED) {
+        first >>= 1;
+        last >>= 1;
+    }
+    if (first < 0)
+        return 1;
+
+    first >>= VOODOO_TILE_SHIFT;
+    last >>= VOODOO_TILE_SHIFT;
+    if ((last - first) >= (voodoo->render_threads - 1))
+        return 1;
+
+    for (int tile = first; tile <= last; tile++) {
+        if ((tile % voodoo->render_threads) == odd_even)
+            return 1;
+    }
+
+    return 0;
+}
+
 static void
-render_thread(void *param, int odd_even)
+voodoo_render_thread(void *param)
 {
-    voodoo_t *voodoo = (voodoo_t *) param;
+    voodoo_render_ctx_t *ctx      = (voodoo_render_ctx_t *) param;
+    voodoo_t            *voodoo   = ctx->voodoo;
+    int                  odd_even = ctx->odd_even;
 
     while (voodoo->render_thread_run[odd_even]) {
         thread_set_event(voodoo->render_not_full_event[odd_even]);
@@ -1599,7 +1662,16 @@ render_thread(void *param, int odd_even)
             uint64_t         end_time;
             voodoo_params_t *params = &voodoo->params_buffer[voodoo->params_read_idx[odd_even] & PARAM_MASK];
 
-            voodoo_triangle(voodoo, params, odd_even);
+            if (voodoo_triangle_in_tiles(voodoo, params, odd_even)) {
+                voodoo_wait_for_texture(voodoo, 0, params->tex_entry[0]);
+                if (voodoo->dual_tmus)
+                    voodoo_wait_for_texture(voodoo, 1, params->tex_entry[1]);
+
+                voodoo_triangle(voodoo, params, odd_even);
+            }
+
+            voodoo->texture_cache[0][params->tex_entry[0]].refcount_r[odd_even]++;
+            voodoo->texture_cache[1][params->tex_entry[1]].refcount_r[odd_even]++;
 
             voodoo->params_read_idx[odd_even]++;
 
@@ -1615,57 +1687,106 @@ render_thread(void *param, int odd_even)
 }
 
 void
-voodoo_render_thread_1(void *param)
+voodoo_render_threads_init(voodoo_t *voodoo)
 {
-    render_thread(param, 0);
+#ifdef VOODOO_SPAN_AVX2
+    voodoo_span_avx2_detect();
+#endif
+    if (!voodoo->render_threads)
+        voodoo->render_threads = plat_get_cpu_count();
+    if (voodoo->render_threads < 1)
+        voodoo->render_threads = 1;
+    else if (voodoo->render_threads > VOODOO_MAX_RENDER_THREADS)
+        voodoo->render_threads = VOODOO_MAX_RENDER_THREADS;
+
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_ctx[c].voodoo   = voodoo;
+        voodoo->render_ctx[c].odd_even = c;
+
+        voodoo->wake_render_thread[c]    = thread_create_event();
+        voodoo->render_not_full_event[c] = thread_create_event();
+        voodoo->render_thread_run[c]     = 1;
+        voodoo->render_thread[c]         = thread_create(voodoo_render_thread, &voodoo->render_ctx[c]);
+    }
 }
+
 void
-voodoo_render_thread_2(void *param)
+voodoo_render_threads_close(voodoo_t *voodoo)
 {
-    render_thread(param, 1);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        voodoo->render_thread_run[c] = 0;
+        thread_set_event(voodoo->wake_render_thread[c]);
+        thread_wait(voodoo->render_thread[c]);
+        thread_destroy_event(voodoo->wake_render_thread[c]);
+        thread_destroy_event(voodoo->render_not_full_event[c]);
+    }
 }
-void
-voodoo_render_thread_3(void *param)
+
+static int
+voodoo_render_full(voodoo_t *voodoo)
 {
-    render_thread(param, 2);
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_FULL(c))
+            return 1;
+    }
+
+    return 0;
 }
-void
-voodoo_render_thread_4(void *param)
+
+/*Work out which lines the triangle covers, in the same way as
+  voodoo_triangle() and voodoo_half_triangle() do*/
+static void
+voodoo_bin_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
-    render_thread(param, 3);
+    int vertexAy = params->vertexAy & 0xffff;
+    int vertexCy = params->vertexCy & 0xffff;
+
+    if (vertexAy & 0x8000)
+        vertexAy |= ~0xffff;
+    if (vertexCy & 0x8000)
+        vertexCy |= ~0xffff;
+
+    params->bin_ystart = (vertexAy + 7) >> 4;
+    params->bin_yend   = (vertexCy + 7) >> 4;
+
+    if (params->fbzMode & 1) {
+        if (params->bin_ystart < params->clipLowY)
+            params->bin_ystart = params->clipLowY;
+        if (params->bin_yend >= params->clipHighY)
+            params->bin_yend = params->clipHighY;
+    }
 }
 
 void
 voodoo_queue_triangle(voodoo_t *voodoo, voodoo_params_t *params)
 {
     voodoo_params_t *params_new = &voodoo->params_buffer[voodoo->params_write_idx & PARAM_MASK];
-
-    while (PARAM_FULL(0) || (voodoo->render_threads >= 2 && PARAM_FULL(1)) || (voodoo->render_threads == 4 && (PARAM_FULL(2) || PARAM_FULL(3)))) {
-        thread_reset_event(voodoo->render_not_full_event[0]);
-        if (voodoo->render_threads >= 2)
-            thread_reset_event(voodoo->render_not_full_event[1]);
-        if (voodoo->render_threads == 4) {
-            thread_reset_event(voodoo->render_not_full_event[2]);
-            thread_reset_event(voodoo->render_not_full_event[3]);
+    int              wake       = 0;
+
+    while (voodoo_render_full(voodoo)) {
+        for (int c = 0; c < voodoo->render_threads; c++)
+            thread_reset_event(voodoo->render_not_full_event[c]);
+        for (int c = 0; c < voodoo->render_threads; c++) {
+            if (PARAM_FULL(c))
+                thread_wait_event(voodoo->render_not_full_event[c], -1); /*Wait for room in ringbuffer*/
         }
-        if (PARAM_FULL(0))
-            thread_wait_event(voodoo->render_not_full_event[0], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads >= 2 && PARAM_FULL(1))
-            thread_wait_event(voodoo->render_not_full_event[1], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(2))
-            thread_wait_event(voodoo->render_not_full_event[2], -1); /*Wait for room in ringbuffer*/
-        if (voodoo->render_threads == 4 && PARAM_FULL(3))
-            thread_wait_event(voodoo->render_not_full_event[3], -1); /*Wait for room in ringbuffer*/
     }
 
     voodoo_use_texture(voodoo, params, 0);
     if (voodoo->dual_tmus)
         voodoo_use_texture(voodoo, params, 1);
 
+    voodoo_bin_triangle(voodoo, params);
+
     memcpy(params_new, params, sizeof(voodoo_params_t));
 
     voodoo->params_write_idx++;
+    voodoo->tri_count++;
 
-    if (PARAM_ENTRIES(0) < 4 || (voodoo->render_threads >= 2 && PARAM_ENTRIES(1) < 4) || (voodoo->render_threads == 4 && (PARAM_ENTRIES(2) < 4 || PARAM_ENTRIES(3) < 4)))
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (PARAM_ENTRIES(c) < 4)
+            wake = 1;
+    }
+    if (wake)
         voodoo_wake_render_thread(voodoo);
 }
@@ -237,168 +237,198 @@ voodoo_recalc_tex3(voodoo_t *voodoo, int tmu)
 
 #define makergba(r, g, b, a) ((b) | ((g) << 8) | ((r) << 16) | ((a) << 24))
 
-void
-voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
+/*A cache entry is still in use until every render thread has retired all the
+  triangles that referenced it, and its decode has finished*/
+static int
+voodoo_texture_in_use(voodoo_t *voodoo, int tmu, int entry)
 {
-    int      c;
-    int      lod_min;
-    int      lod_max;
-    uint32_t addr = 0;
-    uint32_t addr_end;
-    uint32_t palette_checksum;
+    if (!voodoo->texture_cache[tmu][entry].decoded)
+        return 1;
 
-    lod_min = (params->tLOD[tmu] >> 2) & 15;
-    lod_max = (params->tLOD[tmu] >> 8) & 15;
+    for (int c = 0; c < voodoo->render_threads; c++) {
+        if (voodoo->texture_cache[tmu][entry].refcount != voodoo->texture_cache[tmu][entry].refcount_r[c])
+            return 1;
+    }
 
-    if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88) {
-        if (voodoo->palette_dirty[tmu]) {
-            palette_checksum = 0;
+    return 0;
+}
 
-            for (c = 0; c < 256; c++)
-                palette_checksum ^= voodoo->palette[tmu][c].u;
+static __inline int
+voodoo_texture_hash(voodoo_t *voodoo, uint32_t base, uint32_t tLOD, uint32_t palette_checksum)
+{
+    uint32_t hash = (base >> 3) ^ (tLOD * 0x9e3779b1) ^ palette_checksum;
 
-            voodoo->palette_checksum[tmu] = palette_checksum;
-            voodoo->palette_dirty[tmu]    = 0;
-        } else
-            palette_checksum = voodoo->palette_checksum[tmu];
-    } else
-        palette_checksum = 0;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        addr = params->texBaseAddr1[tmu];
-    else
-        addr = params->texBaseAddr[tmu];
+    return hash & voodoo->texture_hash_mask;
+}
 
-    /*Try to find texture in cache*/
-    for (c = 0; c < TEX_CACHE_MAX; c++) {
-        if (voodoo->texture_cache[tmu][c].base == addr && voodoo->texture_cache[tmu][c].tLOD == (params->tLOD[tmu] & 0xf00fff) && voodoo->texture_cache[tmu][c].palette_checksum == palette_checksum) {
-            params->tex_entry[tmu] = c;
-            voodoo->texture_cache[tmu][c].refcount++;
-            return;
-        }
-    }
+static void
+voodoo_texture_hash_remove(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *cache = voodoo->texture_cache[tmu];
+    int       *prev;
 
-    /*Texture not found, search for unused texture*/
-    do {
-        for (c = 0; c < TEX_CACHE_MAX; c++) {
-            voodoo->texture_last_removed++;
-            voodoo->texture_last_removed &= (TEX_CACHE_MAX - 1);
-            if (voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[0] && (voodoo->render_threads == 1 || voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount == voodoo->texture_cache[tmu][voodoo->texture_last_removed].refcount_r[1]))
-                break;
-        }
-        if (c == TEX_CACHE_MAX)
-            voodoo_wait_for_render_thread_idle(voodoo);
-    } while (c == TEX_CACHE_MAX);
-    if (c == TEX_CACHE_MAX)
-        fatal("Texture cache full!\n");
+    if (cache[entry].hash == -1)
+        return;
 
-    c = voodoo->texture_last_removed;
+    prev = &voodoo->texture_hash[tmu][cache[entry].hash];
+    while (*prev != entry)
+        prev = &cache[*prev].hash_next;
+    *prev = cache[entry].hash_next;
 
-    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr1[tmu];
+    cache[entry].hash      = -1;
+    cache[entry].hash_next = -1;
+}
+
+static void
+voodoo_texture_hash_insert(voodoo_t *voodoo, int tmu, int entry, int hash)
+{
+    voodoo->texture_cache[tmu][entry].hash      = hash;
+    voodoo->texture_cache[tmu][entry].hash_next = voodoo->texture_hash[tmu][hash];
+    voodoo->texture_hash[tmu][hash]             = entry;
+}
+
+static void
+voodoo_texture_lru_unlink(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *cache = voodoo->texture_cache[tmu];
+
+    if (cache[entry].lru_prev != -1)
+        cache[cache[entry].lru_prev].lru_next = cache[entry].lru_next;
+    else
+        voodoo->texture_lru_head[tmu] = cache[entry].lru_next;
+    if (cache[entry].lru_next != -1)
+        cache[cache[entry].lru_next].lru_prev = cache[entry].lru_prev;
     else
-        voodoo->texture_cache[tmu][c].base = params->texBaseAddr[tmu];
-    voodoo->texture_cache[tmu][c].tLOD = params->tLOD[tmu] & 0xf00fff;
+        voodoo->texture_lru_tail[tmu] = cache[entry].lru_prev;
+}
 
-    lod_min = (params->tLOD[tmu] >> 2) & 15;
-    lod_max = (params->tLOD[tmu] >> 8) & 15;
-#if 0
-    voodoo_texture_log("  add new texture to %i tformat=%i %08x LOD=%i-%i tmu=%i\n", c, voodoo->params.tformat[tmu], params->texBaseAddr[tmu], lod_min, lod_max, tmu);
-#endif
-    lod_min = MIN(lod_min, 8);
-    lod_max = MIN(lod_max, 8);
-    for (int lod = lod_min; lod <= lod_max; lod++) {
-        uint32_t     *base     = &voodoo->texture_cache[tmu][c].data[texture_offset[lod]];
-        uint32_t      tex_addr = params->tex_base[tmu][lod] & voodoo->texture_mask;
-        int           x;
-        int           y;
-        int           shift = 8 - params->tex_lod[tmu][lod];
-        const rgba_u *pal;
+/*Move entry to the most recently used end of the list*/
+static void
+voodoo_texture_lru_touch(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *cache = voodoo->texture_cache[tmu];
 
-#if 0
-        voodoo_texture_log("  LOD %i : %08x - %08x %i %i,%i\n", lod, params->tex_base[tmu][lod] & voodoo->texture_mask, addr, voodoo->params.tformat[tmu], voodoo->params.tex_w_mask[tmu][lod],voodoo->params.tex_h_mask[tmu][lod]);
-#endif
+    if (voodoo->texture_lru_head[tmu] == entry)
+        return;
+
+    voodoo_texture_lru_unlink(voodoo, tmu, entry);
+    cache[entry].lru_prev = -1;
+    cache[entry].lru_next = voodoo->texture_lru_head[tmu];
+    cache[voodoo->texture_lru_head[tmu]].lru_prev = entry;
+    voodoo->texture_lru_head[tmu]                 = entry;
+}
+
+/*Move entry to the least recently used end of the list, so it is reused first*/
+static void
+voodoo_texture_lru_discard(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *cache = voodoo->texture_cache[tmu];
 
-        switch (params->tformat[tmu]) {
+    if (voodoo->texture_lru_tail[tmu] == entry)
+        return;
+
+    voodoo_texture_lru_unlink(voodoo, tmu, entry);
+    cache[entry].lru_next = -1;
+    cache[entry].lru_prev = voodoo->texture_lru_tail[tmu];
+    cache[voodoo->texture_lru_tail[tmu]].lru_next = entry;
+    voodoo->texture_lru_tail[tmu]                 = entry;
+}
+
+static void
+voodoo_decode_texture(voodoo_t *voodoo, voodoo_tex_job_t *job)
+{
+    uint8_t       *tex_mem = voodoo->tex_mem[job->tmu];
+    const rgba_u  *pal     = job->pal;
+    uint32_t      *data    = voodoo->texture_cache[job->tmu][job->entry].data;
+
+    for (int lod = job->lod_min; lod <= job->lod_max; lod++) {
+        uint32_t *base     = &data[texture_offset[lod]];
+        uint32_t  tex_addr = job->tex_base[lod] & voodoo->texture_mask;
+        int       x;
+        int       y;
+        int       shift = 8 - job->tex_lod[lod];
+
+        switch (job->tformat) {
             case TEX_RGB332:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         base[x] = makergba(rgb332[dat].r, rgb332[dat].g, rgb332[dat].b, 0xff);
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_Y4I2Q2:
-                pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_A8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         base[x] = makergba(dat, dat, dat, dat);
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_I8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         base[x] = makergba(dat, dat, dat, 0xff);
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_AI8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         base[x] = makergba((dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0x0f) | ((dat << 4) & 0xf0), (dat & 0xf0) | ((dat >> 4) & 0x0f));
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_PAL8:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         base[x] = makergba(pal[dat].rgba.r, pal[dat].rgba.g, pal[dat].rgba.b, 0xff);
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_APAL8:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint8_t dat = voodoo->tex_mem[tmu][(tex_addr + x) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint8_t dat = tex_mem[(tex_addr + x) & voodoo->texture_mask];
 
                         int r = ((pal[dat].rgba.r & 3) << 6) | ((pal[dat].rgba.g & 0xf0) >> 2) | (pal[dat].rgba.r & 3);
                         int g = ((pal[dat].rgba.g & 0xf) << 4) | ((pal[dat].rgba.b & 0xc0) >> 4) | ((pal[dat].rgba.g & 0xf) >> 2);
@@ -407,136 +437,323 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
 
                         base[x] = makergba(r, g, b, a);
                     }
-                    tex_addr += (1 << voodoo->params.tex_shift[tmu][lod]);
+                    tex_addr += (1 << job->tex_shift[lod]);
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_ARGB8332:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(rgb332[dat & 0xff].r, rgb332[dat & 0xff].g, rgb332[dat & 0xff].b, dat >> 8);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_A8Y4I2Q2:
-                pal = voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_R5G6B5:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(rgb565[dat].r, rgb565[dat].g, rgb565[dat].b, 0xff);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_ARGB1555:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(argb1555[dat].r, argb1555[dat].g, argb1555[dat].b, argb1555[dat].a);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_ARGB4444:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(argb4444[dat].r, argb4444[dat].g, argb4444[dat].b, argb4444[dat].a);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_A8I8:
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(dat & 0xff, dat & 0xff, dat & 0xff, dat >> 8);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             case TEX_APAL88:
-                pal = voodoo->palette[tmu];
-                for (y = 0; y < voodoo->params.tex_h_mask[tmu][lod] + 1; y++) {
-                    for (x = 0; x < voodoo->params.tex_w_mask[tmu][lod] + 1; x++) {
-                        uint16_t dat = *(uint16_t *) &voodoo->tex_mem[tmu][(tex_addr + x * 2) & voodoo->texture_mask];
+                for (y = 0; y < job->tex_h_mask[lod] + 1; y++) {
+                    for (x = 0; x < job->tex_w_mask[lod] + 1; x++) {
+                        uint16_t dat = *(uint16_t *) &tex_mem[(tex_addr + x * 2) & voodoo->texture_mask];
 
                         base[x] = makergba(pal[dat & 0xff].rgba.r, pal[dat & 0xff].rgba.g, pal[dat & 0xff].rgba.b, dat >> 8);
                     }
-                    tex_addr += (1 << (voodoo->params.tex_shift[tmu][lod] + 1));
+                    tex_addr += (1 << (job->tex_shift[lod] + 1));
                     base += (1 << shift);
                 }
                 break;
 
             default:
-                fatal("Unknown texture format %i\n", params->tformat[tmu]);
+                fatal("Unknown texture format %i\n", job->tformat);
         }
     }
+}
+
+static void
+voodoo_tex_decode_thread(void *param)
+{
+    voodoo_tex_decode_ctx_t *ctx    = (voodoo_tex_decode_ctx_t *) param;
+    voodoo_t                *voodoo = ctx->voodoo;
 
-    voodoo->texture_cache[tmu][c].is16 = voodoo->params.tformat[tmu] & 8;
+    while (voodoo->tex_decode_thread_run) {
+        thread_wait_event(voodoo->wake_tex_decode_thread[ctx->index], -1);
+        thread_reset_event(voodoo->wake_tex_decode_thread[ctx->index]);
 
-    if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88)
-        voodoo->texture_cache[tmu][c].palette_checksum = palette_checksum;
+        while (1) {
+            voodoo_tex_job_t *job = NULL;
+
+            thread_wait_mutex(voodoo->tex_job_mutex);
+            if (voodoo->tex_job_read_idx != voodoo->tex_job_write_idx)
+                job = &voodoo->tex_jobs[voodoo->tex_job_read_idx++ & TEX_DECODE_MASK];
+            thread_release_mutex(voodoo->tex_job_mutex);
+
+            if (!job)
+                break;
+
+            voodoo_decode_texture(voodoo, job);
+            voodoo->texture_cache[job->tmu][job->entry].decoded = 1;
+            job->busy                                            = 0;
+            thread_set_event(voodoo->tex_decoded_event);
+        }
+    }
+}
+
+/*Called by the render threads before sampling from a texture that may still
+  be in the decode queue*/
+void
+voodoo_wait_for_texture(voodoo_t *voodoo, int tmu, int entry)
+{
+    texture_t *texture = &voodoo->texture_cache[tmu][entry];
+
+    while (!texture->decoded) {
+        thread_reset_event(voodoo->tex_decoded_event);
+        if (!texture->decoded)
+            thread_wait_event(voodoo->tex_decoded_event, 1);
+    }
+}
+
+static void
+voodoo_wait_for_texture_decode_idle(voodoo_t *voodoo)
+{
+    for (int c = 0; c < TEX_DECODE_QUEUE; c++) {
+        while (voodoo->tex_jobs[c].busy) {
+            thread_reset_event(voodoo->tex_decoded_event);
+            if (voodoo->tex_jobs[c].busy)
+                thread_wait_event(voodoo->tex_decoded_event, 1);
+        }
+    }
+}
+
+/*Pick the least recently used entry that is no longer referenced. Called with
+  texture_cache_mutex held, which is dropped while waiting for the renderer*/
+static int
+voodoo_texture_find_free(voodoo_t *voodoo, int tmu)
+{
+    while (1) {
+        for (int c = voodoo->texture_lru_tail[tmu]; c != -1; c = voodoo->texture_cache[tmu][c].lru_prev) {
+            if (!voodoo_texture_in_use(voodoo, tmu, c))
+                return c;
+        }
+
+        thread_release_mutex(voodoo->texture_cache_mutex);
+        voodoo_wait_for_render_thread_idle(voodoo);
+        voodoo_wait_for_texture_decode_idle(voodoo);
+        thread_wait_mutex(voodoo->texture_cache_mutex);
+    }
+}
+
+void
+voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
+{
+    voodoo_tex_job_t  local_job;
+    voodoo_tex_job_t *job;
+    texture_t        *texture;
+    int               c;
+    int               hash;
+    int               lod_min;
+    int               lod_max;
+    uint32_t          addr = 0;
+    uint32_t          addr_end;
+    uint32_t          tLOD;
+    uint32_t          palette_checksum;
+
+    lod_min = (params->tLOD[tmu] >> 2) & 15;
+    lod_max = (params->tLOD[tmu] >> 8) & 15;
+
+    if (params->tformat[tmu] == TEX_PAL8 || params->tformat[tmu] == TEX_APAL8 || params->tformat[tmu] == TEX_APAL88) {
+        if (voodoo->palette_dirty[tmu]) {
+            palette_checksum = 0;
+
+            for (c = 0; c < 256; c++)
+                palette_checksum ^= voodoo->palette[tmu][c].u;
+
+            voodoo->palette_checksum[tmu] = palette_checksum;
+            voodoo->palette_dirty[tmu]    = 0;
+        } else
+            palette_checksum = voodoo->palette_checksum[tmu];
+    } else
+        palette_checksum = 0;
+
+    if ((voodoo->params.tLOD[tmu] & LOD_SPLIT) && (voodoo->params.tLOD[tmu] & LOD_ODD) && (voodoo->params.tLOD[tmu] & LOD_TMULTIBASEADDR))
+        addr = params->texBaseAddr1[tmu];
     else
-        voodoo->texture_cache[tmu][c].palette_checksum = 0;
+        addr = params->texBaseAddr[tmu];
+    tLOD = params->tLOD[tmu] & 0xf00fff;
+
+    thread_wait_mutex(voodoo->texture_cache_mutex);
+
+    /*Try to find texture in cache*/
+    hash = voodoo_texture_hash(voodoo, addr, tLOD, palette_checksum);
+    for (c = voodoo->texture_hash[tmu][hash]; c != -1; c = voodoo->texture_cache[tmu][c].hash_next) {
+        texture = &voodoo->texture_cache[tmu][c];
+
+        if (texture->base == addr && texture->tLOD == tLOD && texture->palette_checksum == palette_checksum) {
+            voodoo_texture_lru_touch(voodoo, tmu, c);
+            params->tex_entry[tmu] = c;
+            texture->refcount++;
+            thread_release_mutex(voodoo->texture_cache_mutex);
+            return;
+        }
+    }
+
+    /*Texture not found, replace the least recently used texture*/
+    c       = voodoo_texture_find_free(voodoo, tmu);
+    texture = &voodoo->texture_cache[tmu][c];
+
+    voodoo_texture_hash_remove(voodoo, tmu, c);
+    voodoo_texture_hash_insert(voodoo, tmu, c, hash);
+    voodoo_texture_lru_touch(voodoo, tmu, c);
+
+    if (!texture->data)
+        texture->data = malloc(TEX_CACHE_ENTRY_SIZE);
+
+    texture->base             = addr;
+    texture->tLOD             = tLOD;
+    texture->palette_checksum = palette_checksum;
+    texture->is16             = voodoo->params.tformat[tmu] & 8;
+
+#if 0
+    voodoo_texture_log("  add new texture to %i tformat=%i %08x LOD=%i-%i tmu=%i\n", c, voodoo->params.tformat[tmu], params->texBaseAddr[tmu], lod_min, lod_max, tmu);
+#endif
+    lod_min = MIN(lod_min, 8);
+    lod_max = MIN(lod_max, 8);
+
+    /*Snapshot everything the decode needs, as the registers and palette may
+      change before a worker thread gets to it*/
+    job = &voodoo->tex_jobs[voodoo->tex_job_write_idx & TEX_DECODE_MASK];
+    if (job->busy)
+        job = &local_job;
+
+    job->tmu     = tmu;
+    job->entry   = c;
+    job->tformat = params->tformat[tmu];
+    job->lod_min = lod_min;
+    job->lod_max = lod_max;
+    for (int lod = lod_min; lod <= lod_max; lod++) {
+        job->tex_base[lod]   = params->tex_base[tmu][lod];
+        job->tex_w_mask[lod] = params->tex_w_mask[tmu][lod];
+        job->tex_h_mask[lod] = params->tex_h_mask[tmu][lod];
+        job->tex_shift[lod]  = params->tex_shift[tmu][lod];
+        job->tex_lod[lod]    = params->tex_lod[tmu][lod];
+    }
+    switch (params->tformat[tmu]) {
+        case TEX_Y4I2Q2:
+        case TEX_A8Y4I2Q2:
+            memcpy(job->pal, voodoo->ncc_lookup[tmu][(voodoo->params.textureMode[tmu] & TEXTUREMODE_NCC_SEL) ? 1 : 0], sizeof(job->pal));
+            break;
+        case TEX_PAL8:
+        case TEX_APAL8:
+        case TEX_APAL88:
+            memcpy(job->pal, voodoo->palette[tmu], sizeof(job->pal));
+            break;
+        default:
+            break;
+    }
+
+    if (job == &local_job) {
+        voodoo_decode_texture(voodoo, job);
+        texture->decoded = 1;
+    } else {
+        texture->decoded = 0;
+        job->busy        = 1;
+
+        thread_wait_mutex(voodoo->tex_job_mutex);
+        voodoo->tex_job_write_idx++;
+        thread_release_mutex(voodoo->tex_job_mutex);
+        for (uint8_t c = 0; c < TEX_DECODE_THREADS; c++)
+            thread_set_event(voodoo->wake_tex_decode_thread[c]);
+    }
 
     if (lod_min == 0) {
-        voodoo->texture_cache[tmu][c].addr_start[0] = voodoo->params.tex_base[tmu][0];
-        voodoo->texture_cache[tmu][c].addr_end[0]   = voodoo->params.tex_end[tmu][0];
+        texture->addr_start[0] = voodoo->params.tex_base[tmu][0];
+        texture->addr_end[0]   = voodoo->params.tex_end[tmu][0];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[0] = voodoo->texture_cache[tmu][c].addr_end[0] = 0;
+        texture->addr_start[0] = texture->addr_end[0] = 0;
 
     if (lod_min <= 1 && lod_max >= 1) {
-        voodoo->texture_cache[tmu][c].addr_start[1] = voodoo->params.tex_base[tmu][1];
-        voodoo->texture_cache[tmu][c].addr_end[1]   = voodoo->params.tex_end[tmu][1];
+        texture->addr_start[1] = voodoo->params.tex_base[tmu][1];
+        texture->addr_end[1]   = voodoo->params.tex_end[tmu][1];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[1] = voodoo->texture_cache[tmu][c].addr_end[1] = 0;
+        texture->addr_start[1] = texture->addr_end[1] = 0;
 
     if (lod_min <= 2 && lod_max >= 2) {
-        voodoo->texture_cache[tmu][c].addr_start[2] = voodoo->params.tex_base[tmu][2];
-        voodoo->texture_cache[tmu][c].addr_end[2]   = voodoo->params.tex_end[tmu][2];
+        texture->addr_start[2] = voodoo->params.tex_base[tmu][2];
+        texture->addr_end[2]   = voodoo->params.tex_end[tmu][2];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[2] = voodoo->texture_cache[tmu][c].addr_end[2] = 0;
+        texture->addr_start[2] = texture->addr_end[2] = 0;
 
     if (lod_max >= 3) {
-        voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->params.tex_base[tmu][(lod_min > 3) ? lod_min : 3];
-        voodoo->texture_cache[tmu][c].addr_end[3]   = voodoo->params.tex_end[tmu][(lod_max < 8) ? lod_max : 8];
+        texture->addr_start[3] = voodoo->params.tex_base[tmu][(lod_min > 3) ? lod_min : 3];
+        texture->addr_end[3]   = voodoo->params.tex_end[tmu][(lod_max < 8) ? lod_max : 8];
     } else
-        voodoo->texture_cache[tmu][c].addr_start[3] = voodoo->texture_cache[tmu][c].addr_end[3] = 0;
+        texture->addr_start[3] = texture->addr_end[3] = 0;
 
     for (uint8_t d = 0; d < 4; d++) {
-        addr     = voodoo->texture_cache[tmu][c].addr_start[d];
-        addr_end = voodoo->texture_cache[tmu][c].addr_end[d];
+        addr     = texture->addr_start[d];
+        addr_end = texture->addr_end[d];
 
         if (addr_end != 0) {
             for (; addr <= addr_end; addr += (1 << TEX_DIRTY_SHIFT))
@@ -545,19 +762,24 @@ voodoo_use_texture(voodoo_t *voodoo, voodoo_params_t *params, int tmu)
     }
 
     params->tex_entry[tmu] = c;
-    voodoo->texture_cache[tmu][c].refcount++;
+    texture->refcount++;
+
+    thread_release_mutex(voodoo->texture_cache_mutex);
 }
 
+/*Can be called from the CPU thread (Banshee AGP moves) as well as the FIFO
+  thread, so the cache lists are only touched with texture_cache_mutex held*/
 void
 flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
 {
     int wait_for_idle = 0;
 
+    thread_wait_mutex(voodoo->texture_cache_mutex);
     memset(voodoo->texture_present[tmu], 0, sizeof(voodoo->texture_present[0]));
 #if 0
     voodoo_texture_log("Evict %08x %i\n", dirty_addr, sizeof(voodoo->texture_present));
 #endif
-    for (uint8_t c = 0; c < TEX_CACHE_MAX; c++) {
+    for (int c = 0; c < voodoo->texture_cache_size; c++) {
         if (voodoo->texture_cache[tmu][c].base != -1) {
             for (uint8_t d = 0; d < 4; d++) {
                 int addr_start = voodoo->texture_cache[tmu][c].addr_start[d];
@@ -574,10 +796,12 @@ flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
                         voodoo_texture_log("  Evict texture %i %08x\n", c, voodoo->texture_cache[tmu][c].base);
 #endif
 
-                        if (voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[0] || (voodoo->render_threads == 2 && voodoo->texture_cache[tmu][c].refcount != voodoo->texture_cache[tmu][c].refcount_r[1]))
+                        if (voodoo_texture_in_use(voodoo, tmu, c))
                             wait_for_idle = 1;
 
                         voodoo->texture_cache[tmu][c].base = -1;
+                        voodoo_texture_hash_remove(voodoo, tmu, c);
+                        voodoo_texture_lru_discard(voodoo, tmu, c);
                     } else {
                         for (; addr_start <= addr_end; addr_start += (1 << TEX_DIRTY_SHIFT))
                             voodoo->texture_present[tmu][(addr_start & voodoo->texture_mask) >> TEX_DIRTY_SHIFT] = 1;
@@ -586,8 +810,74 @@ flush_texture_cache(voodoo_t *voodoo, uint32_t dirty_addr, int tmu)
             }
         }
     }
-    if (wait_for_idle)
+    thread_release_mutex(voodoo->texture_cache_mutex);
+
+    if (wait_for_idle) {
         voodoo_wait_for_render_thread_idle(voodoo);
+        voodoo_wait_for_texture_decode_idle(voodoo);
+    }
+}
+
+void
+voodoo_texture_cache_init(voodoo_t *voodoo)
+{
+    if (voodoo->texture_cache_size < 64)
+        voodoo->texture_cache_size = TEX_CACHE_DEFAULT;
+    voodoo->texture_hash_mask = (voodoo->texture_cache_size * 2) - 1;
+
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        voodoo->texture_cache[tmu] = calloc(voodoo->texture_cache_size, sizeof(texture_t));
+        voodoo->texture_hash[tmu]  = malloc((voodoo->texture_hash_mask + 1) * sizeof(int));
+
+        for (int c = 0; c <= voodoo->texture_hash_mask; c++)
+            voodoo->texture_hash[tmu][c] = -1;
+
+        for (int c = 0; c < voodoo->texture_cache_size; c++) {
+            voodoo->texture_cache[tmu][c].base      = -1; /*invalid*/
+            voodoo->texture_cache[tmu][c].decoded   = 1;
+            voodoo->texture_cache[tmu][c].hash      = -1;
+            voodoo->texture_cache[tmu][c].hash_next = -1;
+            voodoo->texture_cache[tmu][c].lru_prev  = c - 1;
+            voodoo->texture_cache[tmu][c].lru_next  = (c == (voodoo->texture_cache_size - 1)) ? -1 : (c + 1);
+        }
+        voodoo->texture_lru_head[tmu] = 0;
+        voodoo->texture_lru_tail[tmu] = voodoo->texture_cache_size - 1;
+    }
+
+    voodoo->tex_job_mutex         = thread_create_mutex();
+    voodoo->texture_cache_mutex   = thread_create_mutex();
+    voodoo->tex_decoded_event     = thread_create_event();
+    voodoo->tex_decode_thread_run = 1;
+    /*Each worker has its own wake event, as a worker resets it after waking
+      and would otherwise swallow a wake meant for the other*/
+    for (uint8_t c = 0; c < TEX_DECODE_THREADS; c++) {
+        voodoo->tex_decode_ctx[c].voodoo = voodoo;
+        voodoo->tex_decode_ctx[c].index  = c;
+
+        voodoo->wake_tex_decode_thread[c] = thread_create_event();
+        voodoo->tex_decode_thread[c]      = thread_create(voodoo_tex_decode_thread, &voodoo->tex_decode_ctx[c]);
+    }
+}
+
+void
+voodoo_texture_cache_close(voodoo_t *voodoo)
+{
+    voodoo->tex_decode_thread_run = 0;
+    for (uint8_t c = 0; c < TEX_DECODE_THREADS; c++) {
+        thread_set_event(voodoo->wake_tex_decode_thread[c]);
+        thread_wait(voodoo->tex_decode_thread[c]);
+        thread_destroy_event(voodoo->wake_tex_decode_thread[c]);
+    }
+    thread_destroy_event(voodoo->tex_decoded_event);
+    thread_close_mutex(voodoo->tex_job_mutex);
+    thread_close_mutex(voodoo->texture_cache_mutex);
+
+    for (uint8_t tmu = 0; tmu < 2; tmu++) {
+        for (int c = 0; c < voodoo->texture_cache_size; c++)
+            free(voodoo->texture_cache[tmu][c].data);
+        free(voodoo->texture_cache[tmu]);
+        free(voodoo->texture_hash[tmu]);
+    }
 }
 
 void
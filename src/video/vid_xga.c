@@ -3287,6 +3287,7 @@ xga_readl_linear(uint32_t addr, void *priv)
 void
 xga_set_poll(svga_t *svga)
 {
+    svga_deferred_sync(svga);
     timer_set_callback(&svga->timer, xga_poll);
 }
 